@@ -0,0 +1,601 @@
+﻿/**
+ * メッシュのUV上にAmbient Occlusionをベイク.
+ */
+#include "AmbientOcclusionBake.h"
+#include "ImageUtil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+// BVHの葉に格納する三角形の数.
+#define AO_BVH_LEAF_TRIANGLES  4
+
+// BVHの最大の深さ (トレース時のスタックのサイズ).
+#define AO_BVH_MAX_DEPTH  60
+
+// BVH構築時に、SAHでの分割位置を求めるときの分割数.
+#define AO_BVH_BINS_COUNT  12
+
+// ベイク後に、メッシュで覆われないテクセルを埋めるピクセル数.
+#define AO_DILATION_PIXELS  8
+
+namespace {
+	/**
+	 * BVH構築時の三角形情報.
+	 */
+	struct BVH_BUILD_TRIANGLE {
+		float bbMin[3];
+		float bbMax[3];
+		float center[3];
+		int index;
+	};
+
+	/**
+	 * BVH構築時の処理待ちのノード.
+	 */
+	struct BVH_BUILD_ITEM {
+		int nodeIndex;
+		int start, end;			// BVH_BUILD_TRIANGLEの範囲.
+		int depth;
+	};
+
+	inline float m_dot (const float* a, const float* b) {
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	inline void m_cross (const float* a, const float* b, float* r) {
+		r[0] = a[1] * b[2] - a[2] * b[1];
+		r[1] = a[2] * b[0] - a[0] * b[2];
+		r[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	inline bool m_normalize (float* v) {
+		const float len = std::sqrt(m_dot(v, v));
+		if (len < 1e-20f) return false;
+		const float d = 1.0f / len;
+		v[0] *= d;
+		v[1] *= d;
+		v[2] *= d;
+		return true;
+	}
+
+	/**
+	 * バウンディングボックスの表面積 (SAHの計算用のため、1/2の値).
+	 */
+	inline float m_calcHalfArea (const float* bbMin, const float* bbMax) {
+		const float dx = bbMax[0] - bbMin[0];
+		const float dy = bbMax[1] - bbMin[1];
+		const float dz = bbMax[2] - bbMin[2];
+		if (dx < 0.0f || dy < 0.0f || dz < 0.0f) return 0.0f;
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	inline void m_expandBoundingBox (float* bbMin, float* bbMax, const float* minV, const float* maxV) {
+		for (int i = 0; i < 3; ++i) {
+			bbMin[i] = std::min(bbMin[i], minV[i]);
+			bbMax[i] = std::max(bbMax[i], maxV[i]);
+		}
+	}
+
+	inline void m_clearBoundingBox (float* bbMin, float* bbMax) {
+		for (int i = 0; i < 3; ++i) {
+			bbMin[i] =  FLT_MAX;
+			bbMax[i] = -FLT_MAX;
+		}
+	}
+
+	/**
+	 * テクセルごとの乱数のシード値を作成 (PCG hash).
+	 */
+	inline unsigned int m_hash (const unsigned int v) {
+		const unsigned int state = v * 747796405u + 2891336453u;
+		const unsigned int word  = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	/**
+	 * [0, 1)の乱数に変換.
+	 */
+	inline float m_toUnitFloat (const unsigned int v) {
+		return (float)(v >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/**
+	 * Van der Corput列 (基数2).
+	 */
+	inline float m_radicalInverse (unsigned int v) {
+		v = (v << 16u) | (v >> 16u);
+		v = ((v & 0x55555555u) << 1u) | ((v & 0xAAAAAAAAu) >> 1u);
+		v = ((v & 0x33333333u) << 2u) | ((v & 0xCCCCCCCCu) >> 2u);
+		v = ((v & 0x0F0F0F0Fu) << 4u) | ((v & 0xF0F0F0F0u) >> 4u);
+		v = ((v & 0x00FF00FFu) << 8u) | ((v & 0xFF00FF00u) >> 8u);
+		return (float)v * 2.3283064365386963e-10f;
+	}
+
+	inline float m_frac (const float v) {
+		return v - std::floor(v);
+	}
+}
+
+CAmbientOcclusionBake::CAmbientOcclusionBake (const int width, const int height)
+{
+	m_width  = std::max(1, width);
+	m_height = std::max(1, height);
+	clear();
+}
+
+CAmbientOcclusionBake::~CAmbientOcclusionBake ()
+{
+}
+
+void CAmbientOcclusionBake::clear ()
+{
+	m_triangles.clear();
+	m_traceTriangles.clear();
+	m_nodes.clear();
+
+	const size_t texelsCount = (size_t)m_width * (size_t)m_height;
+	m_texelPositions.assign(texelsCount * 3, 0.0f);
+	m_texelNormals.assign(texelsCount * 3, 0.0f);
+	m_texelMask.assign(texelsCount, 0);
+
+	m_clearBoundingBox(m_bbMin, m_bbMax);
+}
+
+/**
+ * メッシュを追加.
+ */
+void CAmbientOcclusionBake::appendMesh (const std::vector<float>& positions, const std::vector<float>& normals, const std::vector<int>& faceVertexCounts, const std::vector<int>& faceIndices, const std::vector<float>& faceUVs, const bool bakeTarget)
+{
+	const int versCou = (int)(positions.size() / 3);
+	const bool useNormals = (normals.size() == positions.size());
+	const bool useUVs     = bakeTarget && (faceUVs.size() >= faceIndices.size() * 2);
+
+	size_t iPos = 0;
+	for (size_t i = 0; i < faceVertexCounts.size(); ++i) {
+		const int vCou = faceVertexCounts[i];
+		if (vCou < 0 || iPos + (size_t)vCou > faceIndices.size()) break;
+
+		// 多角形は扇状に三角形分割する.
+		for (int j = 1; j + 1 < vCou; ++j) {
+			const size_t fPos[3] = {iPos, iPos + (size_t)j, iPos + (size_t)j + 1};
+			int vIndices[3];
+			bool validF = true;
+			for (int k = 0; k < 3; ++k) {
+				vIndices[k] = faceIndices[fPos[k]];
+				if (vIndices[k] < 0 || vIndices[k] >= versCou) validF = false;
+			}
+			if (!validF) continue;
+
+			const float* p0 = &(positions[vIndices[0] * 3]);
+			const float* p1 = &(positions[vIndices[1] * 3]);
+			const float* p2 = &(positions[vIndices[2] * 3]);
+			for (int k = 0; k < 3; ++k) {
+				const float* p = &(positions[vIndices[k] * 3]);
+				m_triangles.push_back(p[0]);
+				m_triangles.push_back(p[1]);
+				m_triangles.push_back(p[2]);
+				m_expandBoundingBox(m_bbMin, m_bbMax, p, p);
+			}
+			if (!useUVs) continue;
+
+			// 面の法線 (頂点ごとの法線がない場合に使用).
+			float faceNormal[3];
+			{
+				float e1[3], e2[3];
+				for (int k = 0; k < 3; ++k) {
+					e1[k] = p1[k] - p0[k];
+					e2[k] = p2[k] - p0[k];
+				}
+				m_cross(e1, e2, faceNormal);
+				if (!m_normalize(faceNormal)) continue;
+			}
+			const float* n0 = useNormals ? &(normals[vIndices[0] * 3]) : faceNormal;
+			const float* n1 = useNormals ? &(normals[vIndices[1] * 3]) : faceNormal;
+			const float* n2 = useNormals ? &(normals[vIndices[2] * 3]) : faceNormal;
+
+			m_rasterizeTriangle(&(faceUVs[fPos[0] * 2]), &(faceUVs[fPos[1] * 2]), &(faceUVs[fPos[2] * 2]), p0, p1, p2, n0, n1, n2);
+		}
+		iPos += (size_t)vCou;
+	}
+}
+
+/**
+ * UV上の三角形をテクセルに展開し、位置と法線を格納.
+ * テクセルの中心が三角形内に入るものを対象とする.
+ */
+void CAmbientOcclusionBake::m_rasterizeTriangle (const float* uv0, const float* uv1, const float* uv2, const float* p0, const float* p1, const float* p2, const float* n0, const float* n1, const float* n2)
+{
+	// イメージ上の座標に変換 (イメージの上端がV=1).
+	const float x0 = uv0[0] * (float)m_width;
+	const float y0 = (1.0f - uv0[1]) * (float)m_height;
+	const float x1 = uv1[0] * (float)m_width;
+	const float y1 = (1.0f - uv1[1]) * (float)m_height;
+	const float x2 = uv2[0] * (float)m_width;
+	const float y2 = (1.0f - uv2[1]) * (float)m_height;
+
+	const float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+	if (std::abs(area) < 1e-8f) return;
+	const float invArea = 1.0f / area;
+
+	const int minX = std::max(0, (int)std::floor(std::min(x0, std::min(x1, x2)) - 0.5f));
+	const int maxX = std::min(m_width - 1, (int)std::ceil(std::max(x0, std::max(x1, x2)) - 0.5f));
+	const int minY = std::max(0, (int)std::floor(std::min(y0, std::min(y1, y2)) - 0.5f));
+	const int maxY = std::min(m_height - 1, (int)std::ceil(std::max(y0, std::max(y1, y2)) - 0.5f));
+
+	const float eps = -1e-4f;
+	for (int y = minY; y <= maxY; ++y) {
+		const float py = (float)y + 0.5f;
+		for (int x = minX; x <= maxX; ++x) {
+			const float px = (float)x + 0.5f;
+
+			// 重心座標.
+			const float w0 = ((x1 - px) * (y2 - py) - (x2 - px) * (y1 - py)) * invArea;
+			const float w1 = ((x2 - px) * (y0 - py) - (x0 - px) * (y2 - py)) * invArea;
+			const float w2 = 1.0f - w0 - w1;
+			if (w0 < eps || w1 < eps || w2 < eps) continue;
+
+			const size_t index = (size_t)y * (size_t)m_width + (size_t)x;
+			float* pos = &(m_texelPositions[index * 3]);
+			float* nor = &(m_texelNormals[index * 3]);
+			for (int k = 0; k < 3; ++k) {
+				pos[k] = p0[k] * w0 + p1[k] * w1 + p2[k] * w2;
+				nor[k] = n0[k] * w0 + n1[k] * w1 + n2[k] * w2;
+			}
+			if (!m_normalize(nor)) continue;
+			m_texelMask[index] = 1;
+		}
+	}
+}
+
+/**
+ * 遮蔽物のバウンディングボックスの対角線の長さを取得.
+ */
+float CAmbientOcclusionBake::getBoundingBoxSize () const
+{
+	if (m_triangles.empty()) return 0.0f;
+	const float dx = m_bbMax[0] - m_bbMin[0];
+	const float dy = m_bbMax[1] - m_bbMin[1];
+	const float dz = m_bbMax[2] - m_bbMin[2];
+	return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/**
+ * BVHを構築.
+ * 各ノードで、三角形の中心位置をAO_BVH_BINS_COUNT個に分けてSAHが最小となる位置で分割する.
+ */
+void CAmbientOcclusionBake::m_buildBVH ()
+{
+	m_nodes.clear();
+	m_traceTriangles.clear();
+	const int trianglesCount = (int)(m_triangles.size() / 9);
+	if (trianglesCount == 0) return;
+
+	std::vector<BVH_BUILD_TRIANGLE> buildTris(trianglesCount);
+	for (int i = 0; i < trianglesCount; ++i) {
+		BVH_BUILD_TRIANGLE& tri = buildTris[i];
+		const float* p = &(m_triangles[(size_t)i * 9]);
+		m_clearBoundingBox(tri.bbMin, tri.bbMax);
+		for (int j = 0; j < 3; ++j) m_expandBoundingBox(tri.bbMin, tri.bbMax, p + j * 3, p + j * 3);
+		for (int j = 0; j < 3; ++j) tri.center[j] = (tri.bbMin[j] + tri.bbMax[j]) * 0.5f;
+		tri.index = i;
+	}
+
+	m_nodes.reserve((size_t)trianglesCount * 2);
+	m_nodes.push_back(BVH_NODE());
+
+	std::vector<BVH_BUILD_ITEM> stack;
+	{
+		BVH_BUILD_ITEM item;
+		item.nodeIndex = 0;
+		item.start     = 0;
+		item.end       = trianglesCount;
+		item.depth     = 0;
+		stack.push_back(item);
+	}
+
+	while (!stack.empty()) {
+		const BVH_BUILD_ITEM item = stack.back();
+		stack.pop_back();
+
+		// ノードのバウンディングボックスと、三角形の中心位置の範囲.
+		float bbMin[3], bbMax[3], cMin[3], cMax[3];
+		m_clearBoundingBox(bbMin, bbMax);
+		m_clearBoundingBox(cMin, cMax);
+		for (int i = item.start; i < item.end; ++i) {
+			m_expandBoundingBox(bbMin, bbMax, buildTris[i].bbMin, buildTris[i].bbMax);
+			m_expandBoundingBox(cMin, cMax, buildTris[i].center, buildTris[i].center);
+		}
+		{
+			BVH_NODE& node = m_nodes[item.nodeIndex];
+			for (int j = 0; j < 3; ++j) {
+				node.bbMin[j] = bbMin[j];
+				node.bbMax[j] = bbMax[j];
+			}
+			node.firstIndex     = item.start;
+			node.trianglesCount = item.end - item.start;
+		}
+
+		const int count = item.end - item.start;
+		if (count <= AO_BVH_LEAF_TRIANGLES || item.depth >= AO_BVH_MAX_DEPTH - 1) continue;
+
+		// SAHが最小となる分割位置を探す.
+		int bestAxis = -1;
+		int bestBin  = -1;
+		float bestCost = FLT_MAX;
+		for (int axis = 0; axis < 3; ++axis) {
+			const float extent = cMax[axis] - cMin[axis];
+			if (extent <= 1e-12f) continue;
+			const float binScale = (float)AO_BVH_BINS_COUNT / extent;
+
+			int binCounts[AO_BVH_BINS_COUNT];
+			float binMin[AO_BVH_BINS_COUNT][3], binMax[AO_BVH_BINS_COUNT][3];
+			for (int b = 0; b < AO_BVH_BINS_COUNT; ++b) {
+				binCounts[b] = 0;
+				m_clearBoundingBox(binMin[b], binMax[b]);
+			}
+			for (int i = item.start; i < item.end; ++i) {
+				const int b = std::min(AO_BVH_BINS_COUNT - 1, (int)((buildTris[i].center[axis] - cMin[axis]) * binScale));
+				binCounts[b]++;
+				m_expandBoundingBox(binMin[b], binMax[b], buildTris[i].bbMin, buildTris[i].bbMax);
+			}
+
+			// 右側から累積した面積と数.
+			float rightAreas[AO_BVH_BINS_COUNT];
+			int rightCounts[AO_BVH_BINS_COUNT];
+			{
+				float rMin[3], rMax[3];
+				m_clearBoundingBox(rMin, rMax);
+				int rCount = 0;
+				for (int b = AO_BVH_BINS_COUNT - 1; b > 0; --b) {
+					m_expandBoundingBox(rMin, rMax, binMin[b], binMax[b]);
+					rCount += binCounts[b];
+					rightAreas[b]  = m_calcHalfArea(rMin, rMax);
+					rightCounts[b] = rCount;
+				}
+			}
+
+			float lMin[3], lMax[3];
+			m_clearBoundingBox(lMin, lMax);
+			int lCount = 0;
+			for (int b = 0; b < AO_BVH_BINS_COUNT - 1; ++b) {
+				m_expandBoundingBox(lMin, lMax, binMin[b], binMax[b]);
+				lCount += binCounts[b];
+				if (lCount == 0 || rightCounts[b + 1] == 0) continue;
+				const float cost = m_calcHalfArea(lMin, lMax) * (float)lCount + rightAreas[b + 1] * (float)rightCounts[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin  = b;
+				}
+			}
+		}
+		if (bestAxis < 0) continue;
+
+		// 分割しない場合のコストより大きい場合は葉とする.
+		const float nodeArea = m_calcHalfArea(bbMin, bbMax);
+		if (nodeArea > 0.0f && count <= AO_BVH_LEAF_TRIANGLES * 4) {
+			if (1.0f + bestCost / nodeArea >= (float)count) continue;
+		}
+
+		const float binScale = (float)AO_BVH_BINS_COUNT / (cMax[bestAxis] - cMin[bestAxis]);
+		const float splitMin = cMin[bestAxis];
+		std::vector<BVH_BUILD_TRIANGLE>::iterator midIter = std::partition(buildTris.begin() + item.start, buildTris.begin() + item.end, [&](const BVH_BUILD_TRIANGLE& tri) {
+			const int b = std::min(AO_BVH_BINS_COUNT - 1, (int)((tri.center[bestAxis] - splitMin) * binScale));
+			return (b <= bestBin);
+		});
+		const int mid = (int)(midIter - buildTris.begin());
+		if (mid <= item.start || mid >= item.end) continue;
+
+		const int leftIndex = (int)m_nodes.size();
+		m_nodes.push_back(BVH_NODE());
+		m_nodes.push_back(BVH_NODE());
+		m_nodes[item.nodeIndex].firstIndex     = leftIndex;
+		m_nodes[item.nodeIndex].trianglesCount = 0;
+
+		BVH_BUILD_ITEM leftItem, rightItem;
+		leftItem.nodeIndex  = leftIndex;
+		leftItem.start      = item.start;
+		leftItem.end        = mid;
+		leftItem.depth      = item.depth + 1;
+		rightItem.nodeIndex = leftIndex + 1;
+		rightItem.start     = mid;
+		rightItem.end       = item.end;
+		rightItem.depth     = item.depth + 1;
+		stack.push_back(leftItem);
+		stack.push_back(rightItem);
+	}
+
+	// 三角形をBVHの順に並べ替え、交差判定用にv0/edge1/edge2として格納.
+	m_traceTriangles.resize((size_t)trianglesCount * 9);
+	for (int i = 0; i < trianglesCount; ++i) {
+		const float* p = &(m_triangles[(size_t)buildTris[i].index * 9]);
+		float* t = &(m_traceTriangles[(size_t)i * 9]);
+		for (int j = 0; j < 3; ++j) {
+			t[j]     = p[j];
+			t[j + 3] = p[j + 3] - p[j];
+			t[j + 6] = p[j + 6] - p[j];
+		}
+	}
+}
+
+/**
+ * 指定の距離内で、レイが遮蔽物に当たるか.
+ * 遮蔽の有無のみを判定するため、最初に見つかった交差で終了する.
+ */
+bool CAmbientOcclusionBake::m_traceOcclusion (const float* origin, const float* dir, const float maxDistance) const
+{
+	if (m_nodes.empty()) return false;
+
+	float invDir[3];
+	for (int i = 0; i < 3; ++i) {
+		invDir[i] = (std::abs(dir[i]) > 1e-20f) ? (1.0f / dir[i]) : ((dir[i] < 0.0f) ? -1e20f : 1e20f);
+	}
+
+	int stack[AO_BVH_MAX_DEPTH * 2];
+	int stackCount = 0;
+	stack[stackCount++] = 0;
+
+	while (stackCount > 0) {
+		const BVH_NODE& node = m_nodes[stack[--stackCount]];
+
+		// バウンディングボックスとの交差判定.
+		float tNear = 0.0f;
+		float tFar  = maxDistance;
+		for (int i = 0; i < 3; ++i) {
+			float t0 = (node.bbMin[i] - origin[i]) * invDir[i];
+			float t1 = (node.bbMax[i] - origin[i]) * invDir[i];
+			if (t0 > t1) std::swap(t0, t1);
+			tNear = std::max(tNear, t0);
+			tFar  = std::min(tFar, t1);
+		}
+		if (tNear > tFar) continue;
+
+		if (node.trianglesCount > 0) {
+			// 三角形との交差判定 (Moller-Trumbore).
+			const float* t = &(m_traceTriangles[(size_t)node.firstIndex * 9]);
+			for (int i = 0; i < node.trianglesCount; ++i, t += 9) {
+				const float* v0 = t;
+				const float* e1 = t + 3;
+				const float* e2 = t + 6;
+
+				float pVec[3];
+				m_cross(dir, e2, pVec);
+				const float det = m_dot(e1, pVec);
+				if (std::abs(det) < 1e-20f) continue;
+				const float invDet = 1.0f / det;
+
+				const float tVec[3] = {origin[0] - v0[0], origin[1] - v0[1], origin[2] - v0[2]};
+				const float u = m_dot(tVec, pVec) * invDet;
+				if (u < 0.0f || u > 1.0f) continue;
+
+				float qVec[3];
+				m_cross(tVec, e1, qVec);
+				const float v = m_dot(dir, qVec) * invDet;
+				if (v < 0.0f || u + v > 1.0f) continue;
+
+				const float dist = m_dot(e2, qVec) * invDet;
+				if (dist > 0.0f && dist < maxDistance) return true;
+			}
+		} else {
+			stack[stackCount++] = node.firstIndex;
+			stack[stackCount++] = node.firstIndex + 1;
+		}
+	}
+	return false;
+}
+
+/**
+ * Ambient Occlusionをベイク.
+ */
+bool CAmbientOcclusionBake::bake (const int raysCount, const float maxDistance, std::vector<unsigned char>& grayBuff)
+{
+	const size_t texelsCount = (size_t)m_width * (size_t)m_height;
+	grayBuff.assign(texelsCount, 255);
+
+	std::vector<int> texelIndices;
+	for (size_t i = 0; i < texelsCount; ++i) {
+		if (m_texelMask[i]) texelIndices.push_back((int)i);
+	}
+	if (texelIndices.empty()) return false;
+
+	m_buildBVH();
+
+	// 自己交差を避けるため、レイの開始位置を法線方向にずらす.
+	const float offset = std::max(getBoundingBoxSize() * 1e-4f, 1e-6f);
+	const int raysCou = std::max(1, raysCount);
+	const float invRaysCou = 1.0f / (float)raysCou;
+	const float PI2 = 6.28318530717958647692f;
+
+	// 覆われるテクセルは偏って存在するため、スレッドごとに交互にテクセルを割り当てる.
+	const int threadsCount = std::max(1, ImageUtil::getThreadsCount());
+	ImageUtil::parallelFor(threadsCount, [&](const int tStart, const int tEnd) {
+		for (int tIndex = tStart; tIndex < tEnd; ++tIndex) {
+			for (size_t i = (size_t)tIndex; i < texelIndices.size(); i += (size_t)threadsCount) {
+				const int index = texelIndices[i];
+				const float* pos = &(m_texelPositions[(size_t)index * 3]);
+				const float* nor = &(m_texelNormals[(size_t)index * 3]);
+
+				// 法線をZ軸とする接空間.
+				float tangent[3], binormal[3];
+				{
+					const float axis[3] = {(std::abs(nor[0]) > 0.9f) ? 0.0f : 1.0f, (std::abs(nor[0]) > 0.9f) ? 1.0f : 0.0f, 0.0f};
+					m_cross(axis, nor, tangent);
+					m_normalize(tangent);
+					m_cross(nor, tangent, binormal);
+				}
+				const float origin[3] = {pos[0] + nor[0] * offset, pos[1] + nor[1] * offset, pos[2] + nor[2] * offset};
+
+				// テクセルごとにサンプル位置をずらした、層化サンプリング.
+				const float r1 = m_toUnitFloat(m_hash((unsigned int)index * 2u + 1u));
+				const float r2 = m_toUnitFloat(m_hash((unsigned int)index * 2u + 2u));
+
+				int hitsCount = 0;
+				for (int k = 0; k < raysCou; ++k) {
+					const float u1 = m_frac(((float)k + 0.5f) * invRaysCou + r1);
+					const float u2 = m_frac(m_radicalInverse((unsigned int)k) + r2);
+
+					// cosine weightedで半球方向のベクトルを計算.
+					const float r   = std::sqrt(u1);
+					const float phi = PI2 * u2;
+					const float lx  = r * std::cos(phi);
+					const float ly  = r * std::sin(phi);
+					const float lz  = std::sqrt(std::max(0.0f, 1.0f - u1));
+
+					const float dir[3] = {
+						tangent[0] * lx + binormal[0] * ly + nor[0] * lz,
+						tangent[1] * lx + binormal[1] * ly + nor[1] * lz,
+						tangent[2] * lx + binormal[2] * ly + nor[2] * lz
+					};
+					if (m_traceOcclusion(origin, dir, maxDistance)) hitsCount++;
+				}
+
+				const float v = 1.0f - (float)hitsCount * invRaysCou;
+				grayBuff[index] = (unsigned char)std::max(0, std::min(255, (int)(v * 255.0f + 0.5f)));
+			}
+		}
+	}, threadsCount);
+
+	// UVの境界でのにじみを防ぐため、覆われないテクセルを周囲のテクセルの平均で埋める.
+	{
+		std::vector<unsigned char> mask = m_texelMask;
+		std::vector<unsigned char> newMask;
+		std::vector<unsigned char> dstBuff;
+		for (int loop = 0; loop < AO_DILATION_PIXELS; ++loop) {
+			newMask = mask;
+			dstBuff = grayBuff;
+			bool changedF = false;
+			for (int y = 0; y < m_height; ++y) {
+				for (int x = 0; x < m_width; ++x) {
+					const size_t index = (size_t)y * (size_t)m_width + (size_t)x;
+					if (mask[index]) continue;
+
+					int sum = 0;
+					int count = 0;
+					for (int dy = -1; dy <= 1; ++dy) {
+						const int yy = y + dy;
+						if (yy < 0 || yy >= m_height) continue;
+						for (int dx = -1; dx <= 1; ++dx) {
+							const int xx = x + dx;
+							if (xx < 0 || xx >= m_width) continue;
+							const size_t index2 = (size_t)yy * (size_t)m_width + (size_t)xx;
+							if (!mask[index2]) continue;
+							sum += grayBuff[index2];
+							count++;
+						}
+					}
+					if (count == 0) continue;
+					dstBuff[index]  = (unsigned char)((sum + count / 2) / count);
+					newMask[index] = 1;
+					changedF = true;
+				}
+			}
+			if (!changedF) break;
+			mask.swap(newMask);
+			grayBuff.swap(dstBuff);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,93 @@
+﻿/**
+ * メッシュのUV上にAmbient Occlusionをベイク.
+ * Shade3D SDKに依存せず、BVHを使ったCPUのレイトレースで遮蔽率を求める.
+ */
+
+#ifndef _AMBIENTOCCLUSIONBAKE_H
+#define _AMBIENTOCCLUSIONBAKE_H
+
+#include <vector>
+
+class CAmbientOcclusionBake
+{
+private:
+	/**
+	 * BVHのノード.
+	 * 葉の場合はtrianglesCountが1以上で、firstIndexから三角形を参照する.
+	 * 葉でない場合は、firstIndexが左の子ノード番号 (右の子はfirstIndex + 1).
+	 */
+	struct BVH_NODE {
+		float bbMin[3];
+		float bbMax[3];
+		int firstIndex;
+		int trianglesCount;
+	};
+
+	int m_width, m_height;						// ベイクするイメージのサイズ.
+
+	std::vector<float> m_triangles;				// 遮蔽物の三角形 (三角形ごとに9要素の頂点座標).
+	std::vector<float> m_traceTriangles;		// BVHの順に並べ替えた三角形 (三角形ごとにv0/edge1/edge2の9要素).
+	std::vector<BVH_NODE> m_nodes;				// BVHのノード.
+
+	std::vector<float> m_texelPositions;		// テクセルごとの位置 (xyz).
+	std::vector<float> m_texelNormals;			// テクセルごとの法線 (xyz).
+	std::vector<unsigned char> m_texelMask;		// テクセルがメッシュで覆われている場合は1.
+
+	float m_bbMin[3], m_bbMax[3];				// 遮蔽物のバウンディングボックス.
+
+private:
+	/**
+	 * BVHを構築.
+	 */
+	void m_buildBVH ();
+
+	/**
+	 * 指定の距離内で、レイが遮蔽物に当たるか.
+	 */
+	bool m_traceOcclusion (const float* origin, const float* dir, const float maxDistance) const;
+
+	/**
+	 * UV上の三角形をテクセルに展開し、位置と法線を格納.
+	 */
+	void m_rasterizeTriangle (const float* uv0, const float* uv1, const float* uv2, const float* p0, const float* p1, const float* p2, const float* n0, const float* n1, const float* n2);
+
+public:
+	/**
+	 * @param[in] width   ベイクするイメージの幅.
+	 * @param[in] height  ベイクするイメージの高さ.
+	 */
+	CAmbientOcclusionBake (const int width, const int height);
+	~CAmbientOcclusionBake ();
+
+	void clear ();
+
+	/**
+	 * メッシュを追加.
+	 * 多角形は三角形に分割して、遮蔽物として格納する.
+	 * @param[in] positions         頂点座標 (xyz).
+	 * @param[in] normals           頂点ごとの法線 (xyz)。空の場合は面の法線を使用.
+	 * @param[in] faceVertexCounts  面ごとの頂点数.
+	 * @param[in] faceIndices       面の頂点インデックス.
+	 * @param[in] faceUVs           面の頂点ごとのUV (uv)。USDと同じくイメージの上端がV=1.
+	 * @param[in] bakeTarget        UV上にベイクする対象の場合はtrue。falseの場合は遮蔽物としてのみ使用.
+	 */
+	void appendMesh (const std::vector<float>& positions, const std::vector<float>& normals, const std::vector<int>& faceVertexCounts, const std::vector<int>& faceIndices, const std::vector<float>& faceUVs, const bool bakeTarget);
+
+	/**
+	 * 遮蔽物のバウンディングボックスの対角線の長さを取得.
+	 */
+	float getBoundingBoxSize () const;
+
+	/**
+	 * Ambient Occlusionをベイク.
+	 * テクセルごとに半球方向(cosine weighted)にレイを飛ばし、遮蔽されなかった割合を明るさとする.
+	 * メッシュで覆われないテクセルは、周囲のテクセルの値で埋める.
+	 * @param[in]  raysCount    テクセルごとのレイの数.
+	 * @param[in]  maxDistance  遮蔽と判定する最大距離.
+	 * @param[out] grayBuff     グレイスケール(8bit)のピクセル (width x height).
+	 * @return ベイクするテクセルがない場合はfalse.
+	 */
+	bool bake (const int raysCount, const float maxDistance, std::vector<unsigned char>& grayBuff);
+};
+
+#endif
@@ -37,27 +37,29 @@ double MathUtil::calcSurfaceArea (sxsdk::scene_interface* scene, const CNodeMesh
 	for (size_t loop = 0; loop < meshD.faceVertexCounts.size(); ++loop) {
 		// 面の頂点座標を取得.
 		const int vCou = meshD.faceVertexCounts[loop];
-		if (vCou < 3) continue;
+		if (vCou < 3) {
+			iPos += vCou;
+			continue;
+		}
 		if (vCou >= (int)vertices.size()) {
 			vertices.resize(vCou + 16);
 		}
 		for (int i = 0; i < vCou; ++i) {
 			vertices[i] = meshD.vertices[ meshD.faceIndices[i + iPos] ];
 		}
+		iPos += vCou;
 		if (vCou == 3) {
 			areaV += MathUtil::calcTriangleArea(vertices[0], vertices[1], vertices[2]);
 			continue;
 		}
 
 		// 多角形を三角形分割.
+		::m_triangleIndex.clear();
 		scene->divide_polygon(divC, vCou, &(vertices[0]), true);
-		const int triCou = ::m_triangleIndex.size() / 3;
 
 		for (int i = 0; i < ::m_triangleIndex.size(); i += 3) {
 			areaV += MathUtil::calcTriangleArea(vertices[ ::m_triangleIndex[i + 0] ], vertices[ ::m_triangleIndex[i + 1] ], vertices[ ::m_triangleIndex[i + 2] ]);
 		}
-
-		iPos += vCou;
 	}
 
 	return areaV;
@@ -0,0 +1,227 @@
+﻿/**
+ * マスターイメージのピクセルを1回だけ取得して共有するキャッシュ.
+ */
+#include "DecodedImageCache.h"
+#include "Shade3DUtil.h"
+#include "HashUtil.h"
+
+#include <algorithm>
+
+//------------------------------------------------------------------.
+CDecodedImageData::CDecodedImageData ()
+{
+	clear();
+}
+
+CDecodedImageData::~CDecodedImageData ()
+{
+}
+
+void CDecodedImageData::clear ()
+{
+	pMasterImageHandle = NULL;
+	width = height = 0;
+	pixels.reset();
+	lastUsed = 0;
+	hasHash = false;
+	pixelsHash = 0;
+	hasAlpha = -1;
+}
+
+//------------------------------------------------------------------.
+CDecodedImageCache::CDecodedImageCache (sxsdk::scene_interface* scene, const size_t budgetBytes) : m_pScene(scene), m_budgetBytes(budgetBytes)
+{
+	clear();
+}
+
+CDecodedImageCache::~CDecodedImageCache ()
+{
+}
+
+void CDecodedImageCache::clear ()
+{
+	m_usedBytes  = 0;
+	m_useCounter = 0;
+	m_listed     = false;
+	m_imagesList.clear();
+	m_handleToIndex.clear();
+}
+
+/**
+ * シーン内のマスターイメージの一覧を取得.
+ */
+void CDecodedImageCache::m_listMasterImages ()
+{
+	if (m_listed) return;
+	m_listed = true;
+
+	sxsdk::shape_class* pMasterImagePart = Shade3DUtil::findMasterImagePart(m_pScene);
+	if (!pMasterImagePart || !(pMasterImagePart->has_son())) return;
+
+	try {
+		sxsdk::shape_class* pS = pMasterImagePart->get_son();
+		while (pS->has_bro()) {
+			pS = pS->get_bro();
+			if (!pS) break;
+			if (pS->get_type() != sxsdk::enums::master_image) continue;
+			sxsdk::master_image_class& masterImage = pS->get_master_image();
+			sxsdk::image_interface* image = masterImage.get_image();
+			if (!image || !image->has_image()) continue;
+
+			CDecodedImageData imageD;
+			imageD.pMasterImageHandle = masterImage.get_handle();
+			imageD.width  = image->get_size().x;
+			imageD.height = image->get_size().y;
+			m_handleToIndex[imageD.pMasterImageHandle] = (int)m_imagesList.size();
+			m_imagesList.push_back(imageD);
+		}
+	} catch (...) { }
+}
+
+/**
+ * 指定のハンドルのキャッシュ情報を取得.
+ */
+CDecodedImageData* CDecodedImageCache::m_getImageData (void* pMasterImageHandle)
+{
+	if (!pMasterImageHandle) return NULL;
+	m_listMasterImages();
+
+	std::map<void*, int>::const_iterator iter = m_handleToIndex.find(pMasterImageHandle);
+	if (iter == m_handleToIndex.end()) return NULL;
+	return &(m_imagesList[iter->second]);
+}
+
+/**
+ * メモリの上限を超える場合に、最後に参照したのが古いものからピクセルを解放.
+ */
+void CDecodedImageCache::m_evict (const size_t requiredBytes)
+{
+	while (m_usedBytes > 0 && m_usedBytes + requiredBytes > m_budgetBytes) {
+		int index = -1;
+		for (size_t i = 0; i < m_imagesList.size(); ++i) {
+			const CDecodedImageData& imageD = m_imagesList[i];
+			if (!imageD.pixels) continue;
+			if (index < 0 || imageD.lastUsed < m_imagesList[index].lastUsed) index = (int)i;
+		}
+		if (index < 0) break;
+
+		CDecodedImageData& imageD = m_imagesList[index];
+		m_usedBytes -= std::min(m_usedBytes, imageD.pixels->size());
+		imageD.pixels.reset();
+	}
+}
+
+/**
+ * イメージに対応するマスターイメージを取得.
+ */
+sxsdk::master_image_class* CDecodedImageCache::findMasterImage (sxsdk::image_interface* image)
+{
+	if (!image || !image->has_image()) return NULL;
+	m_listMasterImages();
+
+	const int width  = image->get_size().x;
+	const int height = image->get_size().y;
+	try {
+		for (size_t i = 0; i < m_imagesList.size(); ++i) {
+			const CDecodedImageData& imageD = m_imagesList[i];
+			if (imageD.width != width || imageD.height != height) continue;
+
+			sxsdk::master_image_class& masterImage = m_pScene->get_shape_by_handle(imageD.pMasterImageHandle)->get_master_image();
+			if (image->is_same_as(masterImage.get_image())) return &masterImage;
+		}
+	} catch (...) { }
+
+	return NULL;
+}
+
+/**
+ * マスターイメージのRGBA(8bit)のピクセルを取得.
+ */
+std::shared_ptr< const std::vector<unsigned char> > CDecodedImageCache::getPixels (void* pMasterImageHandle, int& width, int& height)
+{
+	width = height = 0;
+	CDecodedImageData* pImageD = m_getImageData(pMasterImageHandle);
+	if (!pImageD || pImageD->width <= 0 || pImageD->height <= 0) return nullptr;
+
+	CDecodedImageData& imageD = *pImageD;
+	imageD.lastUsed = ++m_useCounter;
+	width  = imageD.width;
+	height = imageD.height;
+	if (imageD.pixels) return imageD.pixels;
+
+	const size_t bytes = (size_t)width * (size_t)height * 4;
+	m_evict(bytes);
+
+	try {
+		sxsdk::master_image_class& masterImage = m_pScene->get_shape_by_handle(pMasterImageHandle)->get_master_image();
+		compointer<sxsdk::image_interface> image(masterImage.get_image());
+		if (!image) return nullptr;
+
+		std::shared_ptr< std::vector<unsigned char> > pixels(new std::vector<unsigned char>(bytes));
+		std::vector<sx::rgba8_class> lineBuff(width);
+		size_t iPos = 0;
+		for (int y = 0; y < height; ++y) {
+			image->get_pixels_rgba(0, y, width, 1, &(lineBuff[0]));
+			for (int x = 0; x < width; ++x, iPos += 4) {
+				(*pixels)[iPos + 0] = lineBuff[x].red;
+				(*pixels)[iPos + 1] = lineBuff[x].green;
+				(*pixels)[iPos + 2] = lineBuff[x].blue;
+				(*pixels)[iPos + 3] = lineBuff[x].alpha;
+			}
+		}
+
+		imageD.pixels = pixels;
+		m_usedBytes += bytes;
+		return pixels;
+	} catch (...) { }
+
+	width = height = 0;
+	return nullptr;
+}
+
+/**
+ * マスターイメージのRGBAピクセルのハッシュ値を取得.
+ */
+unsigned long long CDecodedImageCache::getPixelsHash (void* pMasterImageHandle)
+{
+	CDecodedImageData* pImageD = m_getImageData(pMasterImageHandle);
+	if (!pImageD) return 0;
+	if (pImageD->hasHash) return pImageD->pixelsHash;
+
+	int width, height;
+	std::shared_ptr< const std::vector<unsigned char> > pixels = getPixels(pMasterImageHandle, width, height);
+	if (!pixels) return 0;
+
+	unsigned long long hash = HashUtil::calcFNV1a64(&width, sizeof(int));
+	hash = HashUtil::calcFNV1a64(&height, sizeof(int), hash);
+	hash = HashUtil::calcFNV1a64(&((*pixels)[0]), pixels->size(), hash);
+
+	// getPixelsでm_imagesListの要素は移動しないため、pImageDはそのまま使用できる.
+	pImageD->hasHash    = true;
+	pImageD->pixelsHash = hash;
+	return hash;
+}
+
+/**
+ * マスターイメージがアルファ情報を持つか.
+ */
+bool CDecodedImageCache::hasAlpha (void* pMasterImageHandle)
+{
+	CDecodedImageData* pImageD = m_getImageData(pMasterImageHandle);
+	if (!pImageD) return false;
+	if (pImageD->hasAlpha >= 0) return (pImageD->hasAlpha != 0);
+
+	int width, height;
+	std::shared_ptr< const std::vector<unsigned char> > pixels = getPixels(pMasterImageHandle, width, height);
+	if (!pixels) return false;
+
+	bool alphaF = false;
+	for (size_t i = 3; i < pixels->size(); i += 4) {
+		if ((*pixels)[i] != 255) {
+			alphaF = true;
+			break;
+		}
+	}
+	pImageD->hasAlpha = alphaF ? 1 : 0;
+	return alphaF;
+}
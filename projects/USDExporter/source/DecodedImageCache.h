@@ -0,0 +1,137 @@
+﻿/**
+ * マスターイメージのピクセルを1回だけ取得して共有するキャッシュ.
+ * エクスポートごとに作成し、マスターイメージのハンドルをキーとして保持する.
+ */
+
+#ifndef _DECODEDIMAGECACHE_H
+#define _DECODEDIMAGECACHE_H
+
+#include "GlobalHeader.h"
+
+#include <vector>
+#include <map>
+#include <memory>
+
+//------------------------------------------------------------------.
+/**
+ * キャッシュするマスターイメージ情報.
+ */
+class CDecodedImageData
+{
+public:
+	void* pMasterImageHandle;							// マスターイメージのハンドル.
+	int width, height;									// イメージのサイズ.
+
+	std::shared_ptr< std::vector<unsigned char> > pixels;	// RGBA(8bit)のピクセル (メモリの上限を超えた場合は解放される).
+	unsigned long long lastUsed;						// 最後に参照した順番 (解放の判定用).
+
+	bool hasHash;										// pixelsHashを計算済みか.
+	unsigned long long pixelsHash;						// RGBAピクセルのハッシュ値.
+	int hasAlpha;										// アルファ要素が255でないものがあるか (-1の場合は未計算).
+
+public:
+	CDecodedImageData ();
+	~CDecodedImageData ();
+
+	CDecodedImageData (const CDecodedImageData& v) {
+		this->pMasterImageHandle = v.pMasterImageHandle;
+		this->width  = v.width;
+		this->height = v.height;
+		this->pixels   = v.pixels;
+		this->lastUsed = v.lastUsed;
+		this->hasHash    = v.hasHash;
+		this->pixelsHash = v.pixelsHash;
+		this->hasAlpha   = v.hasAlpha;
+	}
+
+	CDecodedImageData& operator = (const CDecodedImageData &v) {
+		this->pMasterImageHandle = v.pMasterImageHandle;
+		this->width  = v.width;
+		this->height = v.height;
+		this->pixels   = v.pixels;
+		this->lastUsed = v.lastUsed;
+		this->hasHash    = v.hasHash;
+		this->pixelsHash = v.pixelsHash;
+		this->hasAlpha   = v.hasAlpha;
+		return (*this);
+	}
+
+	void clear ();
+};
+
+//------------------------------------------------------------------.
+/**
+ * マスターイメージのキャッシュ.
+ */
+class CDecodedImageCache
+{
+private:
+	sxsdk::scene_interface* m_pScene;
+
+	size_t m_budgetBytes;								// ピクセルを保持するメモリの上限 (バイト).
+	size_t m_usedBytes;									// 保持しているピクセルのバイト数.
+	unsigned long long m_useCounter;					// 参照順のカウンタ.
+
+	bool m_listed;										// マスターイメージの一覧を取得済みか.
+	std::vector<CDecodedImageData> m_imagesList;		// マスターイメージごとの情報.
+	std::map<void*, int> m_handleToIndex;				// ハンドルからm_imagesListの番号を取得.
+
+private:
+	/**
+	 * シーン内のマスターイメージの一覧を取得.
+	 */
+	void m_listMasterImages ();
+
+	/**
+	 * 指定のハンドルのキャッシュ情報を取得.
+	 */
+	CDecodedImageData* m_getImageData (void* pMasterImageHandle);
+
+	/**
+	 * メモリの上限を超える場合に、最後に参照したのが古いものからピクセルを解放.
+	 * @param[in] requiredBytes  これから確保するバイト数.
+	 */
+	void m_evict (const size_t requiredBytes);
+
+public:
+	/**
+	 * @param[in] scene        Shade3Dのシーンクラス.
+	 * @param[in] budgetBytes  ピクセルを保持するメモリの上限 (バイト).
+	 */
+	CDecodedImageCache (sxsdk::scene_interface* scene, const size_t budgetBytes = (size_t)256 * 1024 * 1024);
+	~CDecodedImageCache ();
+
+	void clear ();
+
+	/**
+	 * イメージに対応するマスターイメージを取得.
+	 * シーンの走査はキャッシュ作成後の1回のみで、同じサイズのマスターイメージのみを比較する.
+	 * @param[in] image  対象のイメージ.
+	 * @return マスターイメージが存在する場合はそのポインタ.
+	 */
+	sxsdk::master_image_class* findMasterImage (sxsdk::image_interface* image);
+
+	/**
+	 * マスターイメージのRGBA(8bit)のピクセルを取得.
+	 * 返したバッファは、キャッシュから解放されても参照している間は有効.
+	 * @param[in]  pMasterImageHandle  マスターイメージのハンドル.
+	 * @param[out] width               幅.
+	 * @param[out] height              高さ.
+	 * @return ピクセル (width x height x 4). 取得できない場合はnullptr.
+	 */
+	std::shared_ptr< const std::vector<unsigned char> > getPixels (void* pMasterImageHandle, int& width, int& height);
+
+	/**
+	 * マスターイメージのRGBAピクセルのハッシュ値を取得.
+	 * @param[in] pMasterImageHandle  マスターイメージのハンドル.
+	 */
+	unsigned long long getPixelsHash (void* pMasterImageHandle);
+
+	/**
+	 * マスターイメージがアルファ情報を持つか.
+	 * @param[in] pMasterImageHandle  マスターイメージのハンドル.
+	 */
+	bool hasAlpha (void* pMasterImageHandle);
+};
+
+#endif
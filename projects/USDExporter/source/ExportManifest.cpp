@@ -0,0 +1,197 @@
+﻿/**
+ * 差分エクスポート用の出力情報 (マニフェスト).
+ */
+#include "ExportManifest.h"
+#include "FileUtil.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+
+// マニフェストのバージョン.
+// マテリアルのハッシュ値を持たない前回のマニフェストは、すべてを出力し直すため読み込まない.
+#define EXPORT_MANIFEST_VERSION  2
+
+namespace {
+	/**
+	 * ハッシュ値を16進数の文字列に変換.
+	 */
+	std::string m_hashToString (const unsigned long long hash) {
+		char szStr[32];
+		snprintf(szStr, sizeof(szStr), "%016llx", hash);
+		return std::string(szStr);
+	}
+
+	/**
+	 * 16進数の文字列からハッシュ値に変換.
+	 */
+	bool m_stringToHash (const std::string& str, unsigned long long& hash) {
+		if (str.empty()) return false;
+		char* pEnd = NULL;
+		hash = strtoull(str.c_str(), &pEnd, 16);
+		return (pEnd != NULL && (*pEnd) == '\0');
+	}
+}
+
+CExportManifest::CExportManifest ()
+{
+	clear();
+}
+
+CExportManifest::~CExportManifest ()
+{
+}
+
+void CExportManifest::clear ()
+{
+	paramsHash = 0;
+	nodesHash.clear();
+	refNodesList.clear();
+	materialsHash.clear();
+	texturesHash.clear();
+}
+
+/**
+ * USDファイルに対応するマニフェストのファイルパスを取得.
+ */
+std::string CExportManifest::getManifestFileName (const std::string& filePath)
+{
+	return filePath + std::string(".manifest");
+}
+
+/**
+ * 差分エクスポートの元にする、前回出力したUSDファイルのコピーのファイルパスを取得.
+ * "xxx.usdc"の場合は"xxx.manifest.usdc"となる.
+ */
+std::string CExportManifest::getBaseLayerFileName (const std::string& filePath)
+{
+	const size_t sepPos = filePath.find_last_of("/\\");
+	const size_t extPos = filePath.find_last_of(".");
+	if (extPos == std::string::npos || (sepPos != std::string::npos && extPos < sepPos)) return filePath + std::string(".manifest.usd");
+	return filePath.substr(0, extPos) + std::string(".manifest") + filePath.substr(extPos);
+}
+
+/**
+ * ファイルから読み込み.
+ * 1行ごとに「種類 ハッシュ値 名前」の形式で格納されている.
+ */
+bool CExportManifest::load (const std::string& fileName)
+{
+	clear();
+
+	try {
+		std::ifstream inStream(fileName.c_str(), std::ios::in | std::ios::binary);
+		if (!inStream) return false;
+
+		int version = 0;
+		std::string lineStr;
+		while (std::getline(inStream, lineStr)) {
+			if (!lineStr.empty() && lineStr[lineStr.length() - 1] == '\r') lineStr = lineStr.substr(0, lineStr.length() - 1);
+			if (lineStr.empty() || lineStr[0] == '#') continue;
+
+			std::istringstream lineStream(lineStr);
+			std::string typeStr, valueStr;
+			lineStream >> typeStr >> valueStr;
+
+			if (typeStr == "version") {
+				version = std::atoi(valueStr.c_str());
+				if (version != EXPORT_MANIFEST_VERSION) break;
+				continue;
+			}
+			if (typeStr == "ref") {
+				refNodesList.push_back(valueStr);
+				continue;
+			}
+
+			unsigned long long hash = 0;
+			if (!m_stringToHash(valueStr, hash)) continue;
+
+			// 名前は空白を含む場合があるため、残りをすべて名前とする.
+			std::string nameStr;
+			std::getline(lineStream, nameStr);
+			if (!nameStr.empty() && nameStr[0] == ' ') nameStr = nameStr.substr(1);
+
+			if (typeStr == "params") {
+				paramsHash = hash;
+			} else if (typeStr == "node") {
+				if (nameStr != "") nodesHash[nameStr] = hash;
+			} else if (typeStr == "material") {
+				if (nameStr != "") materialsHash[nameStr] = hash;
+			} else if (typeStr == "texture") {
+				if (nameStr != "") texturesHash[nameStr] = hash;
+			}
+		}
+		if (version == EXPORT_MANIFEST_VERSION) return true;
+
+	} catch (...) { }
+
+	clear();
+	return false;
+}
+
+/**
+ * ファイルに保存.
+ */
+bool CExportManifest::save (const std::string& fileName) const
+{
+	// 同一フォルダの一時ファイルに出力し、完了後に置き換える.
+	const std::string tempFileName = FileUtil::getTempFileName(fileName);
+	try {
+		std::ofstream outStream(tempFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!outStream) return false;
+
+		outStream << "# USD Exporter for Shade3D : incremental export manifest" << "\n";
+		outStream << "version " << EXPORT_MANIFEST_VERSION << "\n";
+		outStream << "params " << m_hashToString(paramsHash) << "\n";
+
+		for (std::map<std::string, unsigned long long>::const_iterator it = nodesHash.begin(); it != nodesHash.end(); ++it) {
+			outStream << "node " << m_hashToString(it->second) << " " << it->first << "\n";
+		}
+		for (size_t i = 0; i < refNodesList.size(); ++i) {
+			outStream << "ref " << refNodesList[i] << "\n";
+		}
+		for (std::map<std::string, unsigned long long>::const_iterator it = materialsHash.begin(); it != materialsHash.end(); ++it) {
+			outStream << "material " << m_hashToString(it->second) << " " << it->first << "\n";
+		}
+		for (std::map<std::string, unsigned long long>::const_iterator it = texturesHash.begin(); it != texturesHash.end(); ++it) {
+			outStream << "texture " << m_hashToString(it->second) << " " << it->first << "\n";
+		}
+		outStream.close();
+		if (!outStream.fail()) return FileUtil::replaceFile(tempFileName, fileName);
+
+	} catch (...) { }
+
+	std::remove(tempFileName.c_str());
+	return false;
+}
+
+/**
+ * 指定のノードが前回と同じハッシュ値か.
+ */
+bool CExportManifest::isSameNode (const std::string& nodeName, const unsigned long long hash) const
+{
+	std::map<std::string, unsigned long long>::const_iterator it = nodesHash.find(nodeName);
+	if (it == nodesHash.end()) return false;
+	return (it->second == hash);
+}
+
+/**
+ * 指定のマテリアルが前回と同じハッシュ値か.
+ */
+bool CExportManifest::isSameMaterial (const std::string& materialName, const unsigned long long hash) const
+{
+	std::map<std::string, unsigned long long>::const_iterator it = materialsHash.find(materialName);
+	if (it == materialsHash.end()) return false;
+	return (it->second == hash);
+}
+
+/**
+ * 指定のテクスチャが前回と同じハッシュ値か.
+ */
+bool CExportManifest::isSameTexture (const std::string& fileName, const unsigned long long hash) const
+{
+	std::map<std::string, unsigned long long>::const_iterator it = texturesHash.find(fileName);
+	if (it == texturesHash.end()) return false;
+	return (it->second == hash);
+}
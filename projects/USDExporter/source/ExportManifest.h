@@ -0,0 +1,71 @@
+﻿/**
+ * 差分エクスポート用の出力情報 (マニフェスト).
+ * 前回のエクスポート時のノード/マテリアル/テクスチャのハッシュ値を、USDファイルと同じフォルダのテキストファイルとして保持する.
+ */
+
+#ifndef _EXPORTMANIFEST_H
+#define _EXPORTMANIFEST_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+class CExportManifest
+{
+public:
+	unsigned long long paramsHash;									// エクスポートパラメータのハッシュ値.
+	std::map<std::string, unsigned long long> nodesHash;			// ノードのパスとハッシュ値.
+	std::vector<std::string> refNodesList;							// リンクの参照として作成したノードのパス.
+	std::map<std::string, unsigned long long> materialsHash;		// マテリアルのパスとハッシュ値.
+	std::map<std::string, unsigned long long> texturesHash;			// テクスチャファイル名とハッシュ値.
+
+public:
+	CExportManifest ();
+	~CExportManifest ();
+
+	void clear ();
+
+	/**
+	 * USDファイルに対応するマニフェストのファイルパスを取得.
+	 * @param[in] filePath  USDファイルパス.
+	 */
+	static std::string getManifestFileName (const std::string& filePath);
+
+	/**
+	 * 差分エクスポートの元にする、前回出力したUSDファイルのコピーのファイルパスを取得.
+	 * 出力先のファイルはエクスポート開始時にShade3D側で空にされるため、マニフェストと同じフォルダに別名で保持する.
+	 * 拡張子は変更しないため、そのままUsdStage::Openで開くことができる.
+	 * @param[in] filePath  USDファイルパス.
+	 */
+	static std::string getBaseLayerFileName (const std::string& filePath);
+
+	/**
+	 * ファイルから読み込み.
+	 * @param[in] fileName  マニフェストのファイルパス.
+	 * @return 読み込みに失敗した場合、またはバージョンが異なる場合はfalse.
+	 */
+	bool load (const std::string& fileName);
+
+	/**
+	 * ファイルに保存.
+	 * @param[in] fileName  マニフェストのファイルパス.
+	 */
+	bool save (const std::string& fileName) const;
+
+	/**
+	 * 指定のノードが前回と同じハッシュ値か.
+	 */
+	bool isSameNode (const std::string& nodeName, const unsigned long long hash) const;
+
+	/**
+	 * 指定のマテリアルが前回と同じハッシュ値か.
+	 */
+	bool isSameMaterial (const std::string& materialName, const unsigned long long hash) const;
+
+	/**
+	 * 指定のテクスチャが前回と同じハッシュ値か.
+	 */
+	bool isSameTexture (const std::string& fileName, const unsigned long long hash) const;
+};
+
+#endif
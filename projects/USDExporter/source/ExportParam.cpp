@@ -2,6 +2,9 @@
  * エクスポート時のパラメータ.
  */
 #include "ExportParam.h"
+#include "HashUtil.h"
+
+#include <vector>
 
 /**
  * 最大テクスチャサイズを数値で取得.
@@ -12,6 +15,7 @@ int USD_DATA::EXPORT::getTextureSize (const USD_DATA::EXPORT::MAX_TEXTURE_SIZE s
 	if (size == USD_DATA::EXPORT::texture_size_1024) return 1024;
 	if (size == USD_DATA::EXPORT::texture_size_2048) return 2048;
 	if (size == USD_DATA::EXPORT::texture_size_4096) return 4096;
+	if (size == USD_DATA::EXPORT::texture_size_auto) return 4096;		// 自動の場合の上限.
 	return 1024;
 }
 
@@ -31,8 +35,11 @@ void CExportParam::clear ()
 	exportFileType = USD_DATA::EXPORT::FILE_TYPE::file_type_usdc;
 	exportUSDZ = true;
 	exportOutputTempFiles = true;
+	exportIncremental = false;
+	exportSplitLayers = false;
 	materialShaderType = USD_DATA::EXPORT::MATERIAL_SHADER_TYPE::material_shader_type_UsdPreviewSurface;
 	separateOpacityAndTransmission = false;
+	materialOutputPreviewSurface = false;
 
 	optTextureType = USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_use_image_name;
 	optMaxTextureSize = USD_DATA::EXPORT::MAX_TEXTURE_SIZE::texture_size_2048;
@@ -45,7 +52,20 @@ void CExportParam::clear ()
 
 	texOptConvGrayscale     = false;
 	bakeWithoutProcessingTextures = false;
+	texOptPackORM = false;
 	grayscaleTexturesColorSpace = USD_DATA::EXPORT::TEXTURE_COLOR_SPACE::texture_colorspace_raw;
+	mergeSameMaterials = true;
+	texPNGCompressionLevel = 6;
+	texPNGFilterType = USD_DATA::EXPORT::PNG_FILTER_TYPE::png_filter_adaptive;
+	texPNGOptimize = false;
+	texJPEGQuality = 90;
+	texTexelDensity = 10;
+	texEncodeReport = false;
+	texPackAtlas = false;
+	texAtlasMaxSize = 256;
+	texCopySourceImages = false;
+	texBakeAO = false;
+	texBakeAOSize = 1024;
 
 	animKeyframeMode = USD_DATA::EXPORT::ANIM_KEYFRAME_MODE::anim_keyframe_only;
 	animStep = 3;
@@ -63,3 +83,56 @@ bool CExportParam::useShaderMDL () const
 	return true;
 }
 
+/**
+ * Shaderの種類としてUsdPreviewSurfaceを出力するか.
+ */
+bool CExportParam::useShaderPreviewSurface () const
+{
+	if (!useShaderMDL()) return true;
+	return materialOutputPreviewSurface;
+}
+
+/**
+ * 出力結果に影響するパラメータのハッシュ値を取得.
+ * exportUSDZ/exportOutputTempFiles/exportIncremental/texEncodeReportは、USDファイルの内容には影響しないため含めない.
+ */
+unsigned long long CExportParam::getHash () const
+{
+	std::vector<int> values;
+	values.push_back(exportAppleUSDZ ? 1 : 0);
+	values.push_back((int)exportFileType);
+	values.push_back((int)materialShaderType);
+	values.push_back(exportSplitLayers ? 1 : 0);
+	values.push_back(separateOpacityAndTransmission ? 1 : 0);
+	values.push_back(materialOutputPreviewSurface ? 1 : 0);
+
+	values.push_back((int)optTextureType);
+	values.push_back((int)optMaxTextureSize);
+	values.push_back(optOutputBoneSkin ? 1 : 0);
+	values.push_back(optOutputVertexColor ? 1 : 0);
+	values.push_back(optSubdivision ? 1 : 0);
+	values.push_back(optDividePolyTriQuad ? 1 : 0);
+	values.push_back(optDividePolyTri ? 1 : 0);
+	values.push_back((int)optKind);
+
+	values.push_back(texOptConvGrayscale ? 1 : 0);
+	values.push_back(bakeWithoutProcessingTextures ? 1 : 0);
+	values.push_back(texOptPackORM ? 1 : 0);
+	values.push_back((int)grayscaleTexturesColorSpace);
+	values.push_back(mergeSameMaterials ? 1 : 0);
+	values.push_back(texPNGCompressionLevel);
+	values.push_back((int)texPNGFilterType);
+	values.push_back(texPNGOptimize ? 1 : 0);
+	values.push_back(texJPEGQuality);
+	values.push_back(texTexelDensity);
+	values.push_back(texPackAtlas ? 1 : 0);
+	values.push_back(texAtlasMaxSize);
+	values.push_back(texCopySourceImages ? 1 : 0);
+	values.push_back(texBakeAO ? 1 : 0);
+	values.push_back(texBakeAOSize);
+
+	values.push_back((int)animKeyframeMode);
+	values.push_back(animStep);
+
+	return HashUtil::calcFNV1a64(&(values[0]), sizeof(int) * values.size());
+}
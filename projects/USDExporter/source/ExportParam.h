@@ -32,6 +32,7 @@ namespace USD_DATA {
 			texture_type_use_image_name = 0,		// イメージ名から拡張子を参照.
 			texture_type_replace_png,				// pngに置き換え.
 			texture_type_replace_jpeg,				// jpegに置き換え.
+			texture_type_replace_ktx2,				// ミップマップ付きのktx2 (pngも出力).
 		};
 
 		/**
@@ -44,6 +45,19 @@ namespace USD_DATA {
 			texture_size_1024,						// 1024.
 			texture_size_2048,						// 2048.
 			texture_size_4096,						// 4096.
+			texture_size_auto,						// テクセル密度から自動で決める.
+		};
+
+		/**
+		 * pngのスキャンラインのフィルタ.
+		 */
+		enum PNG_FILTER_TYPE {
+			png_filter_adaptive = 0,				// ラインごとに自動選択.
+			png_filter_none,						// None.
+			png_filter_sub,							// Sub.
+			png_filter_up,							// Up.
+			png_filter_average,						// Average.
+			png_filter_paeth,						// Paeth.
 		};
 
 		/**
@@ -93,6 +107,8 @@ public:
 
 	bool exportUSDZ;										// usdzを出力.
 	bool exportOutputTempFiles;								// usdz出力時に作業ファイルを出力 (ver.0.0.1.1 - ).
+	bool exportIncremental;									// 前回の出力から変更のあったノード/テクスチャのみを書き換える.
+	bool exportSplitLayers;									// 形状/マテリアル/アニメーションを別々のサブレイヤとして出力.
 
 	USD_DATA::EXPORT::TEXTURE_TYPE optTextureType;			// テクスチャ出力.
 	USD_DATA::EXPORT::MAX_TEXTURE_SIZE optMaxTextureSize;	// 最大テクスチャサイズ.
@@ -107,11 +123,25 @@ public:
 
 	// マテリアルオプション.
 	bool separateOpacityAndTransmission;					// 「不透明(Opacity)」と「透明(Transmission)」を分ける (MDL時).
+	bool materialOutputPreviewSurface;						// MDL時に、UsdPreviewSurfaceも同じマテリアルに出力する.
 	USD_DATA::EXPORT::TEXTURE_COLOR_SPACE grayscaleTexturesColorSpace;				// グレイスケールテクスチャのColor Space.
+	bool mergeSameMaterials;								// 異なる表面材質でも、同じパラメータのマテリアルは1つにまとめる.
 
 	// テクスチャオプション.
 	bool texOptConvGrayscale;								// R/G/B/A要素のテクスチャがある場合に、それぞれをグレイスケール変換する.
 	bool bakeWithoutProcessingTextures;						// テクスチャを加工せずにベイク.
+	bool texOptPackORM;										// Occlusion/Roughness/Metallicを1枚のテクスチャ(R/G/B)にまとめる.
+	int texPNGCompressionLevel;								// pngの圧縮レベル (0 - 9).
+	USD_DATA::EXPORT::PNG_FILTER_TYPE texPNGFilterType;		// pngのスキャンラインのフィルタ.
+	bool texPNGOptimize;									// pngですべてのフィルタを試して最小サイズのものを採用する.
+	int texJPEGQuality;										// jpegの品質 (1 - 100).
+	int texTexelDensity;									// 最大テクスチャサイズが自動の場合の、目標とするテクセル密度 (texels/cm).
+	bool texEncodeReport;									// テクスチャごとの出力サイズ/エンコード時間を表示.
+	bool texPackAtlas;										// 小さいベイク済みテクスチャをアトラスにまとめる.
+	int texAtlasMaxSize;									// アトラスにまとめるテクスチャの最大サイズ (ピクセル).
+	bool texCopySourceImages;								// 加工なしで使用できるマスターイメージは、元の画像ファイルをそのままコピーする.
+	bool texBakeAO;											// Occlusionテクスチャがないマテリアルに、Ambient Occlusionをベイクする.
+	int texBakeAOSize;										// Ambient Occlusionをベイクするテクスチャのサイズ (ピクセル).
 
 	// アニメーションオプション.
 	USD_DATA::EXPORT::ANIM_KEYFRAME_MODE animKeyframeMode;	// キーフレームの出力の種類.
@@ -126,8 +156,11 @@ public:
 		this->exportFileType       = v.exportFileType;
 		this->exportUSDZ           = v.exportUSDZ;
 		this->exportOutputTempFiles = v.exportOutputTempFiles;
+		this->exportIncremental    = v.exportIncremental;
+		this->exportSplitLayers    = v.exportSplitLayers;
 		this->materialShaderType   = v.materialShaderType;
 		this->separateOpacityAndTransmission = v.separateOpacityAndTransmission;
+		this->materialOutputPreviewSurface   = v.materialOutputPreviewSurface;
 
 		this->optTextureType       = v.optTextureType;
 		this->optMaxTextureSize    = v.optMaxTextureSize;
@@ -140,7 +173,20 @@ public:
 
 		this->texOptConvGrayscale     = v.texOptConvGrayscale;
 		this->bakeWithoutProcessingTextures = v.bakeWithoutProcessingTextures;
+		this->texOptPackORM = v.texOptPackORM;
 		this->grayscaleTexturesColorSpace   = v.grayscaleTexturesColorSpace;
+		this->mergeSameMaterials = v.mergeSameMaterials;
+		this->texPNGCompressionLevel = v.texPNGCompressionLevel;
+		this->texPNGFilterType       = v.texPNGFilterType;
+		this->texPNGOptimize         = v.texPNGOptimize;
+		this->texJPEGQuality         = v.texJPEGQuality;
+		this->texTexelDensity        = v.texTexelDensity;
+		this->texEncodeReport        = v.texEncodeReport;
+		this->texPackAtlas           = v.texPackAtlas;
+		this->texAtlasMaxSize        = v.texAtlasMaxSize;
+		this->texCopySourceImages    = v.texCopySourceImages;
+		this->texBakeAO              = v.texBakeAO;
+		this->texBakeAOSize          = v.texBakeAOSize;
 
 		this->animKeyframeMode = v.animKeyframeMode;
 		this->animStep = v.animStep;
@@ -151,8 +197,11 @@ public:
 		this->exportFileType       = v.exportFileType;
 		this->exportUSDZ           = v.exportUSDZ;
 		this->exportOutputTempFiles = v.exportOutputTempFiles;
+		this->exportIncremental    = v.exportIncremental;
+		this->exportSplitLayers    = v.exportSplitLayers;
 		this->materialShaderType   = v.materialShaderType;
 		this->separateOpacityAndTransmission = v.separateOpacityAndTransmission;
+		this->materialOutputPreviewSurface   = v.materialOutputPreviewSurface;
 
 		this->optTextureType       = v.optTextureType;
 		this->optMaxTextureSize    = v.optMaxTextureSize;
@@ -165,7 +214,20 @@ public:
 
 		this->texOptConvGrayscale     = v.texOptConvGrayscale;
 		this->bakeWithoutProcessingTextures = v.bakeWithoutProcessingTextures;
+		this->texOptPackORM = v.texOptPackORM;
 		this->grayscaleTexturesColorSpace   = v.grayscaleTexturesColorSpace;
+		this->mergeSameMaterials = v.mergeSameMaterials;
+		this->texPNGCompressionLevel = v.texPNGCompressionLevel;
+		this->texPNGFilterType       = v.texPNGFilterType;
+		this->texPNGOptimize         = v.texPNGOptimize;
+		this->texJPEGQuality         = v.texJPEGQuality;
+		this->texTexelDensity        = v.texTexelDensity;
+		this->texEncodeReport        = v.texEncodeReport;
+		this->texPackAtlas           = v.texPackAtlas;
+		this->texAtlasMaxSize        = v.texAtlasMaxSize;
+		this->texCopySourceImages    = v.texCopySourceImages;
+		this->texBakeAO              = v.texBakeAO;
+		this->texBakeAOSize          = v.texBakeAOSize;
 
 		this->animKeyframeMode = v.animKeyframeMode;
 		this->animStep = v.animStep;
@@ -179,6 +241,19 @@ public:
 	 * これは、Macのusdz出力ではないこと、materialShaderTypeでmaterial_shader_type_OmniPBR_NVIDIA_omniverseが選択されていることが条件.
 	 */
 	bool useShaderMDL () const;
+
+	/**
+	 * Shaderの種類としてUsdPreviewSurfaceを出力するか.
+	 * MDLを使用しない場合、またはMDL時にmaterialOutputPreviewSurfaceが指定されている場合.
+	 * MDLと両方出力する場合は、outputs:mdl:surfaceとoutputs:surfaceを同じマテリアルに持つ.
+	 */
+	bool useShaderPreviewSurface () const;
+
+	/**
+	 * 出力結果に影響するパラメータのハッシュ値を取得.
+	 * 差分エクスポート時に、前回と同じパラメータで出力されたかの判定に使用.
+	 */
+	unsigned long long getHash () const;
 };
 
 #endif
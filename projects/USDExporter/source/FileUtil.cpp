@@ -0,0 +1,156 @@
+﻿/**
+ * ファイル操作関数.
+ */
+#include "FileUtil.h"
+#include "StringUtil.h"
+
+#if _WINDOWS
+#include "windows.h"
+#elif defined(__APPLE__)
+#include <sys/clonefile.h>
+#endif
+
+#undef max
+#undef min
+
+#include <vector>
+#include <cstdio>
+#include <fstream>
+
+#if _WINDOWS
+namespace {
+	/**
+	 * UTF-8の文字列をWCHARに変換.
+	 */
+	std::vector<WCHAR> m_convUTF8ToWideChar (const std::string& utf8Str) {
+		std::vector<WCHAR> wideCharStr;
+		const int n = MultiByteToWideChar(CP_UTF8, 0, utf8Str.c_str(), -1, 0, 0);
+		if (n <= 0) return wideCharStr;
+		wideCharStr.resize(n + 1, 0);
+		MultiByteToWideChar(CP_UTF8, 0, utf8Str.c_str(), -1, &(wideCharStr[0]), n);
+		return wideCharStr;
+	}
+}
+#endif
+
+/**
+ * 書き込み途中のファイルとして使用する、同一フォルダの一時ファイル名を取得.
+ */
+const std::string FileUtil::getTempFileName (const std::string& filePath)
+{
+	const std::string fileName = StringUtil::getFileName(filePath);
+	return filePath.substr(0, filePath.length() - fileName.length()) + std::string("~") + fileName;
+}
+
+/**
+ * ファイルを置き換える (既存のファイルがある場合は上書き).
+ */
+bool FileUtil::replaceFile (const std::string& srcFilePath, const std::string& dstFilePath)
+{
+	if (srcFilePath == dstFilePath) return true;
+
+#if _WINDOWS
+	const std::vector<WCHAR> srcName = m_convUTF8ToWideChar(srcFilePath);
+	const std::vector<WCHAR> dstName = m_convUTF8ToWideChar(dstFilePath);
+	if (srcName.empty() || dstName.empty()) return false;
+	if (MoveFileExW(&(srcName[0]), &(dstName[0]), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) return true;
+#else
+	// rename()は同一ファイルシステム内では、既存のファイルをアトミックに置き換える.
+	if (std::rename(srcFilePath.c_str(), dstFilePath.c_str()) == 0) return true;
+#endif
+
+	std::remove(srcFilePath.c_str());
+	return false;
+}
+
+/**
+ * ファイルが存在するか.
+ */
+bool FileUtil::existFile (const std::string& filePath)
+{
+	if (filePath == "") return false;
+
+#if _WINDOWS
+	const std::vector<WCHAR> fileName = m_convUTF8ToWideChar(filePath);
+	if (fileName.empty()) return false;
+	const DWORD attr = GetFileAttributesW(&(fileName[0]));
+	return (attr != INVALID_FILE_ATTRIBUTES) && !(attr & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	std::ifstream inStream(filePath.c_str(), std::ios::in | std::ios::binary);
+	return inStream.is_open();
+#endif
+}
+
+/**
+ * ファイルサイズを取得 (存在しない場合は0).
+ */
+unsigned long long FileUtil::getFileSize (const std::string& filePath)
+{
+	if (filePath == "") return 0;
+
+#if _WINDOWS
+	const std::vector<WCHAR> fileName = m_convUTF8ToWideChar(filePath);
+	if (fileName.empty()) return 0;
+	WIN32_FILE_ATTRIBUTE_DATA attrData;
+	if (!GetFileAttributesExW(&(fileName[0]), GetFileExInfoStandard, &attrData)) return 0;
+	return ((unsigned long long)attrData.nFileSizeHigh << 32) | (unsigned long long)attrData.nFileSizeLow;
+#else
+	std::ifstream inStream(filePath.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!inStream.is_open()) return 0;
+	const std::streamoff size = inStream.tellg();
+	return (size > 0) ? (unsigned long long)size : 0;
+#endif
+}
+
+/**
+ * ファイルの内容をそのままコピーする (既存のファイルがある場合は上書き).
+ */
+bool FileUtil::copyFile (const std::string& srcFilePath, const std::string& dstFilePath)
+{
+	if (srcFilePath == "" || dstFilePath == "") return false;
+	if (srcFilePath == dstFilePath) return existFile(srcFilePath);
+
+	const std::string tempFilePath = getTempFileName(dstFilePath);
+	std::remove(tempFilePath.c_str());
+
+#if _WINDOWS
+	const std::vector<WCHAR> srcName  = m_convUTF8ToWideChar(srcFilePath);
+	const std::vector<WCHAR> tempName = m_convUTF8ToWideChar(tempFilePath);
+	if (srcName.empty() || tempName.empty()) return false;
+	if (!CopyFileW(&(srcName[0]), &(tempName[0]), FALSE)) {
+		std::remove(tempFilePath.c_str());
+		return false;
+	}
+	return replaceFile(tempFilePath, dstFilePath);
+#else
+
+#if defined(__APPLE__)
+	// 同一ボリューム(APFS)の場合は、ブロックを共有するクローンを作成.
+	if (clonefile(srcFilePath.c_str(), tempFilePath.c_str(), 0) == 0) return replaceFile(tempFilePath, dstFilePath);
+#endif
+
+	try {
+		std::ifstream inStream(srcFilePath.c_str(), std::ios::in | std::ios::binary);
+		if (!inStream) return false;
+		std::ofstream outStream(tempFilePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!outStream) return false;
+
+		std::vector<char> buff(1024 * 1024);
+		while (inStream) {
+			inStream.read(&(buff[0]), buff.size());
+			const std::streamsize readSize = inStream.gcount();
+			if (readSize <= 0) break;
+			outStream.write(&(buff[0]), readSize);
+		}
+		const bool readF = inStream.eof();
+		outStream.close();
+		if (!readF || outStream.fail()) {
+			std::remove(tempFilePath.c_str());
+			return false;
+		}
+		return replaceFile(tempFilePath, dstFilePath);
+	} catch (...) { }
+	std::remove(tempFilePath.c_str());
+	return false;
+#endif
+}
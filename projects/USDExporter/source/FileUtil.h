@@ -0,0 +1,49 @@
+﻿/**
+ * ファイル操作関数.
+ */
+
+#ifndef _FILEUTIL_H
+#define _FILEUTIL_H
+
+#include <string>
+
+namespace FileUtil
+{
+	/**
+	 * 書き込み途中のファイルとして使用する、同一フォルダの一時ファイル名を取得.
+	 * 拡張子は変更しないため、拡張子で形式を判断する出力処理でもそのまま使用できる.
+	 * @param[in] filePath  最終的な出力ファイルパス.
+	 */
+	const std::string getTempFileName (const std::string& filePath);
+
+	/**
+	 * ファイルを置き換える (既存のファイルがある場合は上書き).
+	 * 同一フォルダ内での置き換えの場合、途中の状態のファイルが見えることはない.
+	 * @param[in] srcFilePath  書き込み済みの一時ファイル.
+	 * @param[in] dstFilePath  出力ファイル.
+	 */
+	bool replaceFile (const std::string& srcFilePath, const std::string& dstFilePath);
+
+	/**
+	 * ファイルが存在するか.
+	 * @param[in] filePath  ファイルパス.
+	 */
+	bool existFile (const std::string& filePath);
+
+	/**
+	 * ファイルサイズを取得 (存在しない場合は0).
+	 * @param[in] filePath  ファイルパス.
+	 */
+	unsigned long long getFileSize (const std::string& filePath);
+
+	/**
+	 * ファイルの内容をそのままコピーする (既存のファイルがある場合は上書き).
+	 * 同一フォルダの一時ファイルにコピーしてから置き換える.
+	 * macOSでAPFSの場合は、データを複製しないクローン(clonefile)を使用する.
+	 * @param[in] srcFilePath  コピー元のファイル.
+	 * @param[in] dstFilePath  コピー先のファイル.
+	 */
+	bool copyFile (const std::string& srcFilePath, const std::string& dstFilePath);
+}
+
+#endif
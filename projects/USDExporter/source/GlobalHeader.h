@@ -34,7 +34,7 @@
 #define OCCLUSION_PARAM_DLG_STREAM_VERSION_101	0x101
 #define OCCLUSION_PARAM_DLG_STREAM_VERSION_100	0x100
 
-#define USD_EXPORTER_DLG_STREAM_VERSION 0x107			// エクスポートダイアログボックスのStreamバージョン.
+#define USD_EXPORTER_DLG_STREAM_VERSION 0x111			// エクスポートダイアログボックスのStreamバージョン.
 #define USD_EXPORTER_DLG_STREAM_VERSION_100 0x100
 #define USD_EXPORTER_DLG_STREAM_VERSION_101 0x101
 #define USD_EXPORTER_DLG_STREAM_VERSION_102 0x102
@@ -43,10 +43,21 @@
 #define USD_EXPORTER_DLG_STREAM_VERSION_105 0x105
 #define USD_EXPORTER_DLG_STREAM_VERSION_106 0x106
 #define USD_EXPORTER_DLG_STREAM_VERSION_107 0x107
+#define USD_EXPORTER_DLG_STREAM_VERSION_108 0x108
+#define USD_EXPORTER_DLG_STREAM_VERSION_109 0x109
+#define USD_EXPORTER_DLG_STREAM_VERSION_10A 0x10a
+#define USD_EXPORTER_DLG_STREAM_VERSION_10B 0x10b
+#define USD_EXPORTER_DLG_STREAM_VERSION_10C 0x10c
+#define USD_EXPORTER_DLG_STREAM_VERSION_10D 0x10d
+#define USD_EXPORTER_DLG_STREAM_VERSION_10E 0x10e
+#define USD_EXPORTER_DLG_STREAM_VERSION_10F 0x10f
+#define USD_EXPORTER_DLG_STREAM_VERSION_110 0x110
+#define USD_EXPORTER_DLG_STREAM_VERSION_111 0x111
 
 #define ALPHA_MODE_DLG_STREAM_VERSION			0x100
 
 #define MAPPING_TYPE_OPACITY  ((sxsdk::enums::mapping_type)24)				// sxsdk::enums::mapping_typeでの「不透明マスク」.
 #define MAPPING_TYPE_USD_OCCLUSION  ((sxsdk::enums::mapping_type)1001)		// 「オクルージョン」これはUSDで割り当てたカスタムの種類.
+#define MAPPING_TYPE_USD_ORM  ((sxsdk::enums::mapping_type)1002)				// Occlusion/Roughness/MetallicをR/G/Bにまとめたテクスチャ (カスタムの種類).
 
 #endif
@@ -0,0 +1,121 @@
+﻿/**
+ * ハッシュ値/チェックサムの計算関数.
+ */
+#include "HashUtil.h"
+
+namespace {
+	/**
+	 * CRC32のテーブル.
+	 * 8バイト単位で計算するため (Slicing-by-8)、8個のテーブルを持つ.
+	 */
+	class CCRC32Table
+	{
+	public:
+		unsigned int table[8][256];
+
+	public:
+		CCRC32Table () {
+			for (unsigned int n = 0; n < 256; ++n) {
+				unsigned int c = n;
+				for (int k = 0; k < 8; ++k) c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+				table[0][n] = c;
+			}
+			for (unsigned int n = 0; n < 256; ++n) {
+				unsigned int c = table[0][n];
+				for (int k = 1; k < 8; ++k) {
+					c = table[0][c & 0xff] ^ (c >> 8);
+					table[k][n] = c;
+				}
+			}
+		}
+	};
+
+	/**
+	 * GF(2)上の32x32の行列とベクトルの積.
+	 */
+	unsigned int m_gf2MatrixTimes (const unsigned int* mat, unsigned int vec) {
+		unsigned int sum = 0;
+		for (int i = 0; vec; ++i, vec >>= 1) {
+			if (vec & 1) sum ^= mat[i];
+		}
+		return sum;
+	}
+
+	/**
+	 * GF(2)上の32x32の行列の2乗.
+	 */
+	void m_gf2MatrixSquare (unsigned int* square, const unsigned int* mat) {
+		for (int i = 0; i < 32; ++i) square[i] = m_gf2MatrixTimes(mat, mat[i]);
+	}
+}
+
+/**
+ * CRC32を計算 (png/zipで使用).
+ */
+unsigned int HashUtil::calcCRC32 (const unsigned char* data, const size_t size, const unsigned int crc)
+{
+	static const CCRC32Table crcTable;
+	const unsigned int (*t)[256] = crcTable.table;
+	unsigned int c = crc ^ 0xffffffff;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		const unsigned int v1 = c ^ ((unsigned int)data[i + 0] | ((unsigned int)data[i + 1] << 8) | ((unsigned int)data[i + 2] << 16) | ((unsigned int)data[i + 3] << 24));
+		const unsigned int v2 = (unsigned int)data[i + 4] | ((unsigned int)data[i + 5] << 8) | ((unsigned int)data[i + 6] << 16) | ((unsigned int)data[i + 7] << 24);
+		c = t[7][v1 & 0xff] ^ t[6][(v1 >> 8) & 0xff] ^ t[5][(v1 >> 16) & 0xff] ^ t[4][v1 >> 24] ^
+			t[3][v2 & 0xff] ^ t[2][(v2 >> 8) & 0xff] ^ t[1][(v2 >> 16) & 0xff] ^ t[0][v2 >> 24];
+	}
+	for (; i < size; ++i) c = t[0][(c ^ data[i]) & 0xff] ^ (c >> 8);
+	return c ^ 0xffffffff;
+}
+
+/**
+ * 連続する2つのデータのCRC32から、結合したデータのCRC32を計算.
+ * zlibのcrc32_combineと同じ計算 (size2分の0を追加する演算子を行列の2乗で求める).
+ */
+unsigned int HashUtil::combineCRC32 (const unsigned int crc1, const unsigned int crc2, const unsigned long long size2)
+{
+	if (size2 == 0) return crc1;
+
+	unsigned int even[32];		// 2^(2n)個の0ビットを追加する演算子.
+	unsigned int odd[32];		// 2^(2n+1)個の0ビットを追加する演算子.
+
+	// 1ビットの0を追加する演算子.
+	odd[0] = 0xedb88320;
+	unsigned int row = 1;
+	for (int i = 1; i < 32; ++i) {
+		odd[i] = row;
+		row <<= 1;
+	}
+	m_gf2MatrixSquare(even, odd);		// 2ビット.
+	m_gf2MatrixSquare(odd, even);		// 4ビット.
+
+	// crc1にsize2バイト分の0を追加.
+	unsigned int c = crc1;
+	unsigned long long len = size2;
+	do {
+		m_gf2MatrixSquare(even, odd);
+		if (len & 1) c = m_gf2MatrixTimes(even, c);
+		len >>= 1;
+		if (len == 0) break;
+
+		m_gf2MatrixSquare(odd, even);
+		if (len & 1) c = m_gf2MatrixTimes(odd, c);
+		len >>= 1;
+	} while (len != 0);
+
+	return c ^ crc2;
+}
+
+/**
+ * FNV-1a(64bit)のハッシュ値を計算 (同一データの判定用).
+ */
+unsigned long long HashUtil::calcFNV1a64 (const void* data, const size_t size, const unsigned long long hash)
+{
+	const unsigned char* pData = (const unsigned char *)data;
+	unsigned long long h = hash;
+	for (size_t i = 0; i < size; ++i) {
+		h ^= (unsigned long long)pData[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
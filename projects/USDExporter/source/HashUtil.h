@@ -0,0 +1,43 @@
+﻿/**
+ * ハッシュ値/チェックサムの計算関数.
+ */
+
+#ifndef _HASHUTIL_H
+#define _HASHUTIL_H
+
+#include <cstddef>
+
+namespace HashUtil
+{
+	/**
+	 * CRC32を計算 (png/zipで使用).
+	 * @param[in] data  データ.
+	 * @param[in] size  データのバイト数.
+	 * @param[in] crc   続けて計算する場合は、前回までのCRC32.
+	 */
+	unsigned int calcCRC32 (const unsigned char* data, const size_t size, const unsigned int crc = 0);
+
+	/**
+	 * 連続する2つのデータのCRC32から、結合したデータのCRC32を計算.
+	 * データを分割して並列にCRC32を計算する場合に使用.
+	 * @param[in] crc1   前半のデータのCRC32.
+	 * @param[in] crc2   後半のデータのCRC32.
+	 * @param[in] size2  後半のデータのバイト数.
+	 */
+	unsigned int combineCRC32 (const unsigned int crc1, const unsigned int crc2, const unsigned long long size2);
+
+	/**
+	 * FNV-1a(64bit)のハッシュ値の初期値.
+	 */
+	const unsigned long long FNV1A64_OFFSET_BASIS = 14695981039346656037ULL;
+
+	/**
+	 * FNV-1a(64bit)のハッシュ値を計算 (同一データの判定用).
+	 * @param[in] data  データ.
+	 * @param[in] size  データのバイト数.
+	 * @param[in] hash  続けて計算する場合は、前回までのハッシュ値.
+	 */
+	unsigned long long calcFNV1a64 (const void* data, const size_t size, const unsigned long long hash = FNV1A64_OFFSET_BASIS);
+}
+
+#endif
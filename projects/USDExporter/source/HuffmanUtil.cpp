@@ -0,0 +1,97 @@
+﻿/**
+ * ハフマン符号の作成関数.
+ */
+#include "HuffmanUtil.h"
+
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+/**
+ * シンボルの出現頻度から、ハフマン符号の符号長を計算.
+ */
+void HuffmanUtil::calcCodeLengths (const std::vector<unsigned int>& freqs, const int maxBits, std::vector<int>& lengths)
+{
+	const int symbolsCount = (int)freqs.size();
+	lengths.clear();
+	lengths.resize(symbolsCount, 0);
+
+	std::vector<int> symbols;
+	std::vector<unsigned long long> weights;
+	for (int i = 0; i < symbolsCount; ++i) {
+		if (freqs[i] == 0) continue;
+		symbols.push_back(i);
+		weights.push_back(freqs[i]);
+	}
+	const int leavesCount = (int)symbols.size();
+	if (leavesCount == 0) return;
+	if (leavesCount == 1) {
+		lengths[symbols[0]] = 1;
+		return;
+	}
+
+	typedef std::pair<unsigned long long, int> NodeT;
+	std::vector<int> parents(leavesCount * 2 - 1);
+	std::vector<int> depths(leavesCount * 2 - 1);
+
+	while (true) {
+		// 重みの小さい2つのノードを結合していく.
+		// 子ノードのインデックスは、常に親ノードよりも小さくなる.
+		std::priority_queue< NodeT, std::vector<NodeT>, std::greater<NodeT> > nodesQueue;
+		for (int i = 0; i < leavesCount; ++i) nodesQueue.push(NodeT(weights[i], i));
+		int nodeIndex = leavesCount;
+		while (nodesQueue.size() > 1) {
+			const NodeT node1 = nodesQueue.top();
+			nodesQueue.pop();
+			const NodeT node2 = nodesQueue.top();
+			nodesQueue.pop();
+			parents[node1.second] = nodeIndex;
+			parents[node2.second] = nodeIndex;
+			nodesQueue.push(NodeT(node1.first + node2.first, nodeIndex));
+			nodeIndex++;
+		}
+
+		const int rootIndex = nodeIndex - 1;
+		depths[rootIndex] = 0;
+		int maxDepth = 0;
+		for (int i = rootIndex - 1; i >= 0; --i) {
+			depths[i] = depths[parents[i]] + 1;
+			if (i < leavesCount) maxDepth = std::max(maxDepth, depths[i]);
+		}
+		if (maxDepth <= maxBits) break;
+
+		// 最大の符号長を超える場合は、頻度の差を縮めて作り直す.
+		for (int i = 0; i < leavesCount; ++i) weights[i] = std::max((unsigned long long)1, weights[i] >> 1);
+	}
+
+	for (int i = 0; i < leavesCount; ++i) lengths[symbols[i]] = depths[i];
+}
+
+/**
+ * 符号長から、カノニカルハフマン符号を計算.
+ */
+void HuffmanUtil::calcCanonicalCodes (const std::vector<int>& lengths, std::vector<unsigned int>& codes)
+{
+	const int symbolsCount = (int)lengths.size();
+	codes.clear();
+	codes.resize(symbolsCount, 0);
+
+	int maxBits = 0;
+	for (int i = 0; i < symbolsCount; ++i) maxBits = std::max(maxBits, lengths[i]);
+	if (maxBits == 0) return;
+
+	std::vector<unsigned int> bitsCount(maxBits + 1, 0);
+	for (int i = 0; i < symbolsCount; ++i) {
+		if (lengths[i] > 0) bitsCount[lengths[i]]++;
+	}
+
+	std::vector<unsigned int> nextCodes(maxBits + 1, 0);
+	unsigned int code = 0;
+	for (int bits = 1; bits <= maxBits; ++bits) {
+		code = (code + bitsCount[bits - 1]) << 1;
+		nextCodes[bits] = code;
+	}
+	for (int i = 0; i < symbolsCount; ++i) {
+		if (lengths[i] > 0) codes[i] = nextCodes[lengths[i]]++;
+	}
+}
@@ -0,0 +1,31 @@
+﻿/**
+ * ハフマン符号の作成関数 (png/jpegのエンコードで使用).
+ */
+
+#ifndef _HUFFMANUTIL_H
+#define _HUFFMANUTIL_H
+
+#include <vector>
+
+namespace HuffmanUtil
+{
+	/**
+	 * シンボルの出現頻度から、ハフマン符号の符号長を計算.
+	 * 符号長がmaxBitsを超える場合は、頻度を半分にして作り直す.
+	 * 使用されるシンボルが1つだけの場合は、符号長1とする.
+	 * @param[in]  freqs     シンボルごとの出現頻度.
+	 * @param[in]  maxBits   最大の符号長.
+	 * @param[out] lengths   シンボルごとの符号長が返る (未使用のシンボルは0).
+	 */
+	void calcCodeLengths (const std::vector<unsigned int>& freqs, const int maxBits, std::vector<int>& lengths);
+
+	/**
+	 * 符号長から、カノニカルハフマン符号を計算.
+	 * 同じ符号長の場合はシンボル番号の小さい順に符号を割り当てる (deflate/jpeg共通).
+	 * @param[in]  lengths   シンボルごとの符号長.
+	 * @param[out] codes     シンボルごとの符号 (MSBから使用).
+	 */
+	void calcCanonicalCodes (const std::vector<int>& lengths, std::vector<unsigned int>& codes);
+}
+
+#endif
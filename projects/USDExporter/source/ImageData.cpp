@@ -25,6 +25,89 @@ void CImageData::clear ()
 	occlusionF = false;
 
 	imageWidth = imageHeight = 0;
-	rgbaBuff.clear();
+	pixelFormat = USD_DATA::IMAGE_PIXEL_FORMAT::image_pixel_format_rgba8;
+	pixelsBuff.clear();
+	spillFileName = "";
+	pixelsHash = 0;
+}
+
+/**
+ * ベイクされたピクセルをすべて取得 (一時ファイルに退避している場合は読み込む).
+ * @param[out] buff  ピクセルが返る (pixelFormatの形式).
+ */
+bool CImageData::loadPixels (std::vector<unsigned char>& buff) const
+{
+	buff.clear();
+	if (spillFileName == "") {
+		buff = pixelsBuff;
+		return !buff.empty();
+	}
+
+	try {
+		const size_t size = (size_t)imageWidth * (size_t)imageHeight * (size_t)getPixelBytes();
+		if (size == 0) return false;
+		std::ifstream inStream(spillFileName.c_str(), std::ios::in | std::ios::binary);
+		if (!inStream) return false;
+		buff.resize(size);
+		inStream.read((char *)&(buff[0]), (std::streamsize)size);
+		if (inStream.gcount() != (std::streamsize)size) {
+			buff.clear();
+			return false;
+		}
+		return true;
+	} catch (...) { }
+	buff.clear();
+	return false;
+}
+
+//------------------------------------------------------------------.
+CImagePixelsReader::CImagePixelsReader (const CImageData& imageData) : m_imageData(imageData)
+{
+	m_y = 0;
+	if (m_imageData.spillFileName != "") {
+		m_stream.open(m_imageData.spillFileName.c_str(), std::ios::in | std::ios::binary);
+		m_lineBuff.resize((size_t)m_imageData.imageWidth * (size_t)m_imageData.getPixelBytes());
+	}
+}
+
+CImagePixelsReader::~CImagePixelsReader ()
+{
+	if (m_stream.is_open()) m_stream.close();
+}
+
+/**
+ * 次の1ラインを取得.
+ * @return ピクセル (imageWidth x getPixelBytes()). 読み込めない場合はNULL.
+ */
+const unsigned char* CImagePixelsReader::readLine ()
+{
+	if (m_y >= m_imageData.imageHeight || m_imageData.imageWidth <= 0) return NULL;
+	const size_t lineBytes = (size_t)m_imageData.imageWidth * (size_t)m_imageData.getPixelBytes();
+
+	const unsigned char* pLine = NULL;
+	if (m_imageData.spillFileName == "") {
+		const size_t iPos = (size_t)m_y * lineBytes;
+		if (iPos + lineBytes > m_imageData.pixelsBuff.size()) return NULL;
+		pLine = &(m_imageData.pixelsBuff[iPos]);
+	} else {
+		if (!m_stream) return NULL;
+		m_stream.read((char *)&(m_lineBuff[0]), (std::streamsize)lineBytes);
+		if (m_stream.gcount() != (std::streamsize)lineBytes) return NULL;
+		pLine = &(m_lineBuff[0]);
+	}
+	m_y++;
+	return pLine;
+}
+
+/**
+ * 先頭のラインから読み込み直す.
+ */
+void CImagePixelsReader::rewind ()
+{
+	m_y = 0;
+	if (m_stream.is_open()) {
+		m_stream.clear();
+		m_stream.seekg(0, std::ios::beg);
+	}
 }
 
@@ -10,6 +10,7 @@
 
 #include <string>
 #include <vector>
+#include <fstream>
 
 //------------------------------------------------------------------.
 /**
@@ -34,7 +35,10 @@ public:
 
 	// 以下、ベイクしたテクスチャ情報格納用.
 	int imageWidth, imageHeight;			// イメージの幅と高さ.
-	std::vector<unsigned char> rgbaBuff;	// RGBAの格納.
+	USD_DATA::IMAGE_PIXEL_FORMAT pixelFormat;	// ピクセルの格納形式.
+	std::vector<unsigned char> pixelsBuff;	// ピクセルの格納 (pixelFormatにより、RGBAまたはグレイスケール).
+	std::string spillFileName;				// ピクセルを一時ファイルに退避した場合のファイル名 (この場合、pixelsBuffは空).
+	unsigned long long pixelsHash;			// ベイク時のRGBAピクセルのハッシュ値 (同一イメージの判定用).
 
 public:
 	CImageData ();
@@ -58,7 +62,10 @@ public:
 
 		this->imageWidth  = v.imageWidth;
 		this->imageHeight = v.imageHeight;
-		this->rgbaBuff    = v.rgbaBuff;
+		this->pixelFormat = v.pixelFormat;
+		this->pixelsBuff  = v.pixelsBuff;
+		this->spillFileName = v.spillFileName;
+		this->pixelsHash    = v.pixelsHash;
 	}
 
 	CImageData& operator = (const CImageData &v) {
@@ -79,13 +86,61 @@ public:
 
 		this->imageWidth  = v.imageWidth;
 		this->imageHeight = v.imageHeight;
-		this->rgbaBuff    = v.rgbaBuff;
+		this->pixelFormat = v.pixelFormat;
+		this->pixelsBuff  = v.pixelsBuff;
+		this->spillFileName = v.spillFileName;
+		this->pixelsHash    = v.pixelsHash;
 
 		return (*this);
 	}
 
 	void clear ();
 
+	/**
+	 * ベイクされたピクセルを持つか (メモリ上または一時ファイル).
+	 */
+	bool hasPixels () const { return !pixelsBuff.empty() || spillFileName != ""; }
+
+	/**
+	 * 1ピクセルのバイト数.
+	 */
+	int getPixelBytes () const { return (pixelFormat == USD_DATA::IMAGE_PIXEL_FORMAT::image_pixel_format_gray8) ? 1 : 4; }
+
+	/**
+	 * ベイクされたピクセルをすべて取得 (一時ファイルに退避している場合は読み込む).
+	 * @param[out] buff  ピクセルが返る (pixelFormatの形式).
+	 */
+	bool loadPixels (std::vector<unsigned char>& buff) const;
+};
+
+//------------------------------------------------------------------.
+/**
+ * ベイクされたピクセルを1ラインずつ読み込む.
+ * 一時ファイルに退避されている場合も、1ライン分のみをメモリに保持する.
+ */
+class CImagePixelsReader
+{
+private:
+	const CImageData& m_imageData;
+	std::ifstream m_stream;
+	std::vector<unsigned char> m_lineBuff;
+	int m_y;
+
+public:
+	CImagePixelsReader (const CImageData& imageData);
+	~CImagePixelsReader ();
+
+	/**
+	 * 次の1ラインを取得.
+	 * @return ピクセル (imageWidth x getPixelBytes()). 読み込めない場合はNULL.
+	 */
+	const unsigned char* readLine ();
+
+	/**
+	 * 先頭のラインから読み込み直す.
+	 */
+	void rewind ();
+
 };
 
 #endif
@@ -0,0 +1,456 @@
+﻿/**
+ * イメージのピクセル操作関数.
+ */
+#include "ImageUtil.h"
+
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <fstream>
+
+namespace {
+	const double RESIZE_PI = 3.14159265358979323846;
+
+	/**
+	 * フィルタの半径 (拡大時).
+	 */
+	double m_getFilterSupport (const ImageUtil::RESIZE_FILTER filter) {
+		switch (filter) {
+		case ImageUtil::resize_filter_box:      return 0.5;
+		case ImageUtil::resize_filter_bilinear: return 1.0;
+		case ImageUtil::resize_filter_bicubic:  return 2.0;
+		case ImageUtil::resize_filter_lanczos3: return 3.0;
+		}
+		return 1.0;
+	}
+
+	double m_sinc (const double x) {
+		if (std::abs(x) < 1e-8) return 1.0;
+		const double v = x * RESIZE_PI;
+		return std::sin(v) / v;
+	}
+
+	/**
+	 * フィルタの重みを計算.
+	 * @param[in] filter  フィルタの種類.
+	 * @param[in] x       中心からの距離.
+	 */
+	double m_calcFilter (const ImageUtil::RESIZE_FILTER filter, const double x) {
+		const double ax = std::abs(x);
+		switch (filter) {
+		case ImageUtil::resize_filter_box:
+			return (ax <= 0.5) ? 1.0 : 0.0;
+
+		case ImageUtil::resize_filter_bilinear:
+			return (ax < 1.0) ? (1.0 - ax) : 0.0;
+
+		case ImageUtil::resize_filter_bicubic:
+			// Catmull-Rom (B = 0, C = 0.5).
+			if (ax < 1.0) return (1.5 * ax - 2.5) * ax * ax + 1.0;
+			if (ax < 2.0) return ((-0.5 * ax + 2.5) * ax - 4.0) * ax + 2.0;
+			return 0.0;
+
+		case ImageUtil::resize_filter_lanczos3:
+			return (ax < 3.0) ? (m_sinc(ax) * m_sinc(ax / 3.0)) : 0.0;
+		}
+		return 0.0;
+	}
+
+	/**
+	 * 1次元のリサンプリングでの参照位置と重み.
+	 * 出力ピクセルごとに、元のピクセルの参照開始位置と参照数、正規化した重みを保持する.
+	 */
+	class CResampleWeights
+	{
+	public:
+		int maxCount;						// 1ピクセルあたりの最大参照数.
+		std::vector<int> startList;			// 参照開始位置.
+		std::vector<int> countList;			// 参照数.
+		std::vector<float> weightsList;		// 重み (maxCount個ずつ).
+
+	public:
+		void calc (const int srcSize, const int dstSize, const ImageUtil::RESIZE_FILTER filter) {
+			const double scale = (double)dstSize / (double)srcSize;
+			const double filterScale = (scale < 1.0) ? (1.0 / scale) : 1.0;		// 縮小時はフィルタを広げる.
+			const double support = m_getFilterSupport(filter) * filterScale;
+
+			maxCount = (int)std::ceil(support * 2.0) + 2;
+			startList.resize(dstSize);
+			countList.resize(dstSize);
+			weightsList.assign((size_t)dstSize * (size_t)maxCount, 0.0f);
+
+			for (int i = 0; i < dstSize; ++i) {
+				const double center = ((double)i + 0.5) / scale;
+				int iStart = std::max(0, (int)std::floor(center - support));
+				const int iEnd = std::min(srcSize, (int)std::ceil(center + support));
+				int count = std::max(1, std::min(iEnd - iStart, maxCount));
+
+				float* pW = &(weightsList[(size_t)i * (size_t)maxCount]);
+				double sumW = 0.0;
+				for (int j = 0; j < count; ++j) {
+					const double w = m_calcFilter(filter, ((double)(iStart + j) + 0.5 - center) / filterScale);
+					pW[j] = (float)w;
+					sumW += w;
+				}
+				if (std::abs(sumW) > 1e-8) {
+					for (int j = 0; j < count; ++j) pW[j] = (float)((double)pW[j] / sumW);
+				} else {
+					// 重みがない場合は最近傍のピクセルを使用.
+					iStart = std::min(srcSize - 1, (int)center);
+					count  = 1;
+					pW[0]  = 1.0f;
+				}
+				startList[i] = iStart;
+				countList[i] = count;
+			}
+		}
+	};
+
+	/**
+	 * [0, count)の範囲を分割し、複数スレッドでfunc(開始, 終了)を実行.
+	 */
+	void m_parallelFor (const int count, const int threadsCount, const std::function<void (const int, const int)>& func) {
+		const int tCount = std::max(1, std::min(threadsCount, count));
+		if (tCount <= 1) {
+			func(0, count);
+			return;
+		}
+
+		std::vector<std::thread> threads;
+		const int step = (count + tCount - 1) / tCount;
+		for (int i = 0; i < tCount; ++i) {
+			const int iStart = i * step;
+			const int iEnd   = std::min(count, iStart + step);
+			if (iStart >= iEnd) break;
+			try {
+				threads.push_back(std::thread(func, iStart, iEnd));
+			} catch (...) {
+				// スレッドを作成できない場合はこのスレッドで処理.
+				func(iStart, iEnd);
+			}
+		}
+		for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+	}
+
+	inline float m_toFloat (const float v) { return v; }
+	inline float m_toFloat (const unsigned char v) { return (float)v * (1.0f / 255.0f); }
+
+	inline void m_fromFloat (const float v, float& dstV) { dstV = v; }
+	inline void m_fromFloat (const float v, unsigned char& dstV) {
+		dstV = (unsigned char)std::max(0, std::min(255, (int)(v * 255.0f + 0.5f)));
+	}
+
+	/**
+	 * ピクセルバッファをリサイズ.
+	 * T は float または unsigned char.
+	 * channelsが4の場合はRGBAとみなし、アルファを乗算済みにして補間する.
+	 * channelsが1の場合はグレイスケールとみなす.
+	 */
+	template<typename T> bool m_resizeImage (const T* srcBuff, const int srcWidth, const int srcHeight, T* dstBuff, const int dstWidth, const int dstHeight, const int channels, const ImageUtil::RESIZE_FILTER filter, const int threadsCount) {
+		if (!srcBuff || !dstBuff) return false;
+		if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) return false;
+		if (channels != 1 && channels != 4) return false;
+
+		if (srcWidth == dstWidth && srcHeight == dstHeight) {
+			std::copy(srcBuff, srcBuff + (size_t)srcWidth * (size_t)srcHeight * channels, dstBuff);
+			return true;
+		}
+
+		int tCount = (threadsCount > 0) ? threadsCount : ImageUtil::getThreadsCount();
+		if ((size_t)srcWidth * (size_t)srcHeight < 256 * 256) tCount = 1;		// 小さいイメージはスレッド化しない.
+
+		CResampleWeights weightsX, weightsY;
+		weightsX.calc(srcWidth, dstWidth, filter);
+		weightsY.calc(srcHeight, dstHeight, filter);
+
+		try {
+			// 水平方向のリサンプリング.
+			// RGBAの場合は、アルファを乗算済みにしてから補間する.
+			std::vector<float> tmpBuff((size_t)dstWidth * (size_t)srcHeight * channels);
+			m_parallelFor(srcHeight, tCount, [&](const int yStart, const int yEnd) {
+				std::vector<float> lineBuff((size_t)srcWidth * channels);
+				for (int y = yStart; y < yEnd; ++y) {
+					const T* pS = srcBuff + (size_t)y * (size_t)srcWidth * channels;
+					if (channels == 4) {
+						for (int x = 0, iPos = 0; x < srcWidth; ++x, iPos += 4) {
+							const float a = m_toFloat(pS[iPos + 3]);
+							lineBuff[iPos + 0] = m_toFloat(pS[iPos + 0]) * a;
+							lineBuff[iPos + 1] = m_toFloat(pS[iPos + 1]) * a;
+							lineBuff[iPos + 2] = m_toFloat(pS[iPos + 2]) * a;
+							lineBuff[iPos + 3] = a;
+						}
+					} else {
+						for (int x = 0; x < srcWidth; ++x) lineBuff[x] = m_toFloat(pS[x]);
+					}
+
+					float* pD = &(tmpBuff[(size_t)y * (size_t)dstWidth * channels]);
+					for (int x = 0; x < dstWidth; ++x) {
+						const int count = weightsX.countList[x];
+						const float* pW = &(weightsX.weightsList[(size_t)x * (size_t)weightsX.maxCount]);
+						const float* pL = &(lineBuff[(size_t)weightsX.startList[x] * channels]);
+						if (channels == 4) {
+							float r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+							for (int j = 0; j < count; ++j, pL += 4) {
+								const float w = pW[j];
+								r += pL[0] * w;
+								g += pL[1] * w;
+								b += pL[2] * w;
+								a += pL[3] * w;
+							}
+							pD[0] = r;
+							pD[1] = g;
+							pD[2] = b;
+							pD[3] = a;
+						} else {
+							float v = 0.0f;
+							for (int j = 0; j < count; ++j) v += pL[j] * pW[j];
+							pD[0] = v;
+						}
+						pD += channels;
+					}
+				}
+			});
+
+			// 垂直方向のリサンプリング.
+			// 行単位で重みを加算し、RGBAの場合は最後にアルファの乗算を戻す.
+			const size_t lineSize = (size_t)dstWidth * channels;
+			m_parallelFor(dstHeight, tCount, [&](const int yStart, const int yEnd) {
+				std::vector<float> lineBuff(lineSize);
+				for (int y = yStart; y < yEnd; ++y) {
+					std::fill(lineBuff.begin(), lineBuff.end(), 0.0f);
+					const int iStart = weightsY.startList[y];
+					const int count  = weightsY.countList[y];
+					const float* pW = &(weightsY.weightsList[(size_t)y * (size_t)weightsY.maxCount]);
+					for (int j = 0; j < count; ++j) {
+						const float w = pW[j];
+						const float* pT = &(tmpBuff[(size_t)(iStart + j) * lineSize]);
+						for (size_t i = 0; i < lineSize; ++i) lineBuff[i] += pT[i] * w;
+					}
+
+					T* pD = dstBuff + (size_t)y * lineSize;
+					if (channels == 4) {
+						for (size_t i = 0; i < lineSize; i += 4) {
+							const float a = lineBuff[i + 3];
+							const float aInv = (a > 1e-5f) ? (1.0f / a) : 0.0f;
+							m_fromFloat(std::max(0.0f, lineBuff[i + 0] * aInv), pD[i + 0]);
+							m_fromFloat(std::max(0.0f, lineBuff[i + 1] * aInv), pD[i + 1]);
+							m_fromFloat(std::max(0.0f, lineBuff[i + 2] * aInv), pD[i + 2]);
+							m_fromFloat(std::max(0.0f, std::min(1.0f, a)), pD[i + 3]);
+						}
+					} else {
+						for (size_t i = 0; i < lineSize; ++i) m_fromFloat(std::max(0.0f, lineBuff[i]), pD[i]);
+					}
+				}
+			});
+			return true;
+
+		} catch (...) { }
+		return false;
+	}
+}
+
+/**
+ * 並列処理で使用するスレッド数を取得.
+ */
+int ImageUtil::getThreadsCount ()
+{
+	const int count = (int)std::thread::hardware_concurrency();
+	return std::max(1, count);
+}
+
+/**
+ * [0, count)の範囲を分割し、複数スレッドでfunc(開始, 終了)を実行.
+ */
+void ImageUtil::parallelFor (const int count, const std::function<void (const int, const int)>& func, const int threadsCount)
+{
+	if (count <= 0) return;
+	m_parallelFor(count, (threadsCount > 0) ? threadsCount : getThreadsCount(), func);
+}
+
+/**
+ * RGBA(float)のピクセルバッファをリサイズ.
+ */
+bool ImageUtil::resizeRGBA (const float* srcBuff, const int srcWidth, const int srcHeight, float* dstBuff, const int dstWidth, const int dstHeight, const RESIZE_FILTER filter, const int threadsCount)
+{
+	return m_resizeImage(srcBuff, srcWidth, srcHeight, dstBuff, dstWidth, dstHeight, 4, filter, threadsCount);
+}
+
+/**
+ * RGBA(8bit)のピクセルバッファをリサイズ.
+ */
+bool ImageUtil::resizeRGBA8 (const unsigned char* srcBuff, const int srcWidth, const int srcHeight, unsigned char* dstBuff, const int dstWidth, const int dstHeight, const RESIZE_FILTER filter, const int threadsCount)
+{
+	return m_resizeImage(srcBuff, srcWidth, srcHeight, dstBuff, dstWidth, dstHeight, 4, filter, threadsCount);
+}
+
+bool ImageUtil::resizeRGBA8 (const std::vector<unsigned char>& srcBuff, const int srcWidth, const int srcHeight, std::vector<unsigned char>& dstBuff, const int dstWidth, const int dstHeight, const RESIZE_FILTER filter, const int threadsCount)
+{
+	if (srcBuff.size() < (size_t)srcWidth * (size_t)srcHeight * 4) return false;
+	if (dstWidth <= 0 || dstHeight <= 0) return false;
+	dstBuff.resize((size_t)dstWidth * (size_t)dstHeight * 4);
+	return m_resizeImage(&(srcBuff[0]), srcWidth, srcHeight, &(dstBuff[0]), dstWidth, dstHeight, 4, filter, threadsCount);
+}
+
+/**
+ * グレイスケール(8bit)のピクセルバッファをリサイズ.
+ */
+bool ImageUtil::resizeGray8 (const std::vector<unsigned char>& srcBuff, const int srcWidth, const int srcHeight, std::vector<unsigned char>& dstBuff, const int dstWidth, const int dstHeight, const RESIZE_FILTER filter, const int threadsCount)
+{
+	if (srcBuff.size() < (size_t)srcWidth * (size_t)srcHeight) return false;
+	if (dstWidth <= 0 || dstHeight <= 0) return false;
+	dstBuff.resize((size_t)dstWidth * (size_t)dstHeight);
+	return m_resizeImage(&(srcBuff[0]), srcWidth, srcHeight, &(dstBuff[0]), dstWidth, dstHeight, 1, filter, threadsCount);
+}
+
+/**
+ * RGBA(8bit)のピクセルバッファがグレイスケールか (R=G=B、A=255).
+ */
+bool ImageUtil::isGrayscaleRGBA8 (const std::vector<unsigned char>& rgbaBuff)
+{
+	for (size_t i = 0; i + 3 < rgbaBuff.size(); i += 4) {
+		if (rgbaBuff[i + 0] != rgbaBuff[i + 1] || rgbaBuff[i + 0] != rgbaBuff[i + 2] || rgbaBuff[i + 3] != 255) return false;
+	}
+	return true;
+}
+
+/**
+ * RGBA(8bit)のピクセルバッファから、Redをグレイスケール(8bit)として取り出す.
+ */
+void ImageUtil::convertRGBA8ToGray8 (const std::vector<unsigned char>& rgbaBuff, std::vector<unsigned char>& grayBuff)
+{
+	grayBuff.resize(rgbaBuff.size() / 4);
+	for (size_t i = 0, iPos = 0; i < grayBuff.size(); ++i, iPos += 4) grayBuff[i] = rgbaBuff[iPos];
+}
+
+/**
+ * グレイスケール(8bit)のピクセルバッファをRGBA(8bit)に変換.
+ */
+void ImageUtil::convertGray8ToRGBA8 (const std::vector<unsigned char>& grayBuff, std::vector<unsigned char>& rgbaBuff)
+{
+	rgbaBuff.resize(grayBuff.size() * 4);
+	for (size_t i = 0, iPos = 0; i < grayBuff.size(); ++i, iPos += 4) {
+		rgbaBuff[iPos + 0] = rgbaBuff[iPos + 1] = rgbaBuff[iPos + 2] = grayBuff[i];
+		rgbaBuff[iPos + 3] = 255;
+	}
+}
+
+/**
+ * 高さ(バンプ)のピクセルバッファから、+Z向きの法線を計算.
+ * 各要素を別々のバッファ(planar)で扱い、端以外のピクセルは分岐なしのループで処理する.
+ */
+bool ImageUtil::convertHeightToNormal (const std::vector<float>& heights, const int width, const int height, const float strength, std::vector<float>& normalsX, std::vector<float>& normalsY, std::vector<float>& normalsZ, const int threadsCount)
+{
+	if (width <= 0 || height <= 0) return false;
+	const size_t pixelsCount = (size_t)width * (size_t)height;
+	if (heights.size() < pixelsCount) return false;
+
+	try {
+		normalsX.resize(pixelsCount);
+		normalsY.resize(pixelsCount);
+		normalsZ.resize(pixelsCount);
+	} catch (...) {
+		return false;
+	}
+
+	ImageUtil::parallelFor(height, [&](const int yStart, const int yEnd) {
+		std::vector<float> gxLine(width), gyLine(width);
+		for (int y = yStart; y < yEnd; ++y) {
+			const float* lineU = &(heights[(size_t)((y + height - 1) % height) * (size_t)width]);
+			const float* lineC = &(heights[(size_t)y * (size_t)width]);
+			const float* lineD = &(heights[(size_t)((y + 1) % height) * (size_t)width]);
+
+			// Sobelフィルタで、X(右)/Y(下)方向の勾配を求める.
+			for (int x = 1; x < width - 1; ++x) {
+				gxLine[x] = (lineU[x + 1] + 2.0f * lineC[x + 1] + lineD[x + 1]) - (lineU[x - 1] + 2.0f * lineC[x - 1] + lineD[x - 1]);
+				gyLine[x] = (lineD[x - 1] + 2.0f * lineD[x] + lineD[x + 1]) - (lineU[x - 1] + 2.0f * lineU[x] + lineU[x + 1]);
+			}
+			{
+				const int xList[] = {0, width - 1};
+				for (int i = 0; i < 2; ++i) {
+					const int x  = xList[i];
+					const int xL = (x + width - 1) % width;
+					const int xR = (x + 1) % width;
+					gxLine[x] = (lineU[xR] + 2.0f * lineC[xR] + lineD[xR]) - (lineU[xL] + 2.0f * lineC[xL] + lineD[xL]);
+					gyLine[x] = (lineD[xL] + 2.0f * lineD[x] + lineD[xR]) - (lineU[xL] + 2.0f * lineU[x] + lineU[xR]);
+				}
+			}
+
+			// 法線 (-dh/dx, dh/dy, 1) を正規化.
+			// イメージの下方向は-Vのため、Yは符号を反転しない.
+			float* nX = &(normalsX[(size_t)y * (size_t)width]);
+			float* nY = &(normalsY[(size_t)y * (size_t)width]);
+			float* nZ = &(normalsZ[(size_t)y * (size_t)width]);
+			for (int x = 0; x < width; ++x) {
+				const float vx = -gxLine[x] * strength;
+				const float vy =  gyLine[x] * strength;
+				const float d  = 1.0f / std::sqrt(vx * vx + vy * vy + 1.0f);
+				nX[x] = vx * d;
+				nY[x] = vy * d;
+				nZ[x] = d;
+			}
+		}
+	}, threadsCount);
+
+	return true;
+}
+
+/**
+ * png/jpegファイルのヘッダから、形式と幅/高さを取得 (ピクセルはデコードしない).
+ */
+bool ImageUtil::readImageFileHeader (const std::string& filePath, std::string& formatStr, int& width, int& height)
+{
+	formatStr = "";
+	width = height = 0;
+
+	try {
+		std::ifstream inStream(filePath.c_str(), std::ios::in | std::ios::binary);
+		if (!inStream) return false;
+
+		unsigned char buff[24];
+		inStream.read((char *)buff, 8);
+		if (inStream.gcount() != 8) return false;
+
+		// png : シグネチャの直後のIHDRチャンクに幅/高さ(ビッグエンディアン)がある.
+		const unsigned char pngSignature[] = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
+		if (std::equal(pngSignature, pngSignature + 8, buff)) {
+			inStream.read((char *)buff, 16);
+			if (inStream.gcount() != 16) return false;
+			if (buff[4] != 'I' || buff[5] != 'H' || buff[6] != 'D' || buff[7] != 'R') return false;
+			width  = (int)(((unsigned int)buff[8]  << 24) | ((unsigned int)buff[9]  << 16) | ((unsigned int)buff[10] << 8) | buff[11]);
+			height = (int)(((unsigned int)buff[12] << 24) | ((unsigned int)buff[13] << 16) | ((unsigned int)buff[14] << 8) | buff[15]);
+			formatStr = "png";
+			return (width > 0 && height > 0);
+		}
+
+		// jpeg : SOI(FFD8)からマーカーをたどり、SOFn(DHT/JPG/DACを除く)から幅/高さを取得.
+		if (buff[0] != 0xFF || buff[1] != 0xD8) return false;
+		inStream.seekg(2, std::ios::beg);
+		while (inStream) {
+			int c = inStream.get();
+			if (c != 0xFF) return false;
+			while (c == 0xFF) c = inStream.get();
+			if (c == EOF) return false;
+
+			// 長さを持たないマーカー (RSTn/TEM).
+			if ((c >= 0xD0 && c <= 0xD7) || c == 0x01) continue;
+			if (c == 0xD9 || c == 0xDA) return false;		// SOFの前にEOI/SOSが来た場合.
+
+			inStream.read((char *)buff, 2);
+			if (inStream.gcount() != 2) return false;
+			const int length = ((int)buff[0] << 8) | buff[1];
+			if (length < 2) return false;
+
+			if (c >= 0xC0 && c <= 0xCF && c != 0xC4 && c != 0xC8 && c != 0xCC) {
+				inStream.read((char *)buff, 5);
+				if (inStream.gcount() != 5) return false;
+				height = ((int)buff[1] << 8) | buff[2];
+				width  = ((int)buff[3] << 8) | buff[4];
+				formatStr = "jpg";
+				return (width > 0 && height > 0);
+			}
+			inStream.seekg(length - 2, std::ios::cur);
+		}
+	} catch (...) { }
+	return false;
+}
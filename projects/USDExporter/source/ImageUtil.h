@@ -0,0 +1,111 @@
+﻿/**
+ * イメージのピクセル操作関数.
+ * Shade3D SDKに依存せず、RGBAのピクセルバッファを直接扱う.
+ */
+
+#ifndef _IMAGEUTIL_H
+#define _IMAGEUTIL_H
+
+#include <vector>
+#include <string>
+#include <functional>
+
+namespace ImageUtil
+{
+	/**
+	 * リサイズ時のフィルタの種類.
+	 */
+	enum RESIZE_FILTER {
+		resize_filter_box = 0,					// Box (平均).
+		resize_filter_bilinear,					// Bilinear (Triangle).
+		resize_filter_bicubic,					// Bicubic (Catmull-Rom).
+		resize_filter_lanczos3,					// Lanczos3.
+	};
+
+	/**
+	 * 並列処理で使用するスレッド数を取得.
+	 */
+	int getThreadsCount ();
+
+	/**
+	 * [0, count)の範囲を分割し、複数スレッドでfunc(開始, 終了)を実行.
+	 * funcの中ではShade3DのSDKにアクセスしないこと.
+	 * @param[in] count         要素数.
+	 * @param[in] func          処理 (開始, 終了).
+	 * @param[in] threadsCount  スレッド数 (0の場合はgetThreadsCount()).
+	 */
+	void parallelFor (const int count, const std::function<void (const int, const int)>& func, const int threadsCount = 0);
+
+	/**
+	 * 1ライン分のピクセルを取得する関数 (画像全体をメモリ上に保持せずにエンコードする場合に使用).
+	 * yは0から順に呼ばれる。画像を複数回読む場合は、再び0から呼ばれる.
+	 * 返すポインタは、次に呼ばれるまで有効であればよい。読み込めない場合はNULLを返す.
+	 */
+	typedef std::function<const unsigned char* (const int y)> LineReader;
+
+	/**
+	 * RGBA(float)のピクセルバッファをリサイズ.
+	 * 水平/垂直の2パスの分離型フィルタで、アルファを乗算済みにして補間する.
+	 * @param[in]  srcBuff       元のピクセル (srcWidth x srcHeight x 4).
+	 * @param[in]  srcWidth      元の幅.
+	 * @param[in]  srcHeight     元の高さ.
+	 * @param[out] dstBuff       出力先のピクセル (dstWidth x dstHeight x 4).
+	 * @param[in]  dstWidth      出力する幅.
+	 * @param[in]  dstHeight     出力する高さ.
+	 * @param[in]  filter        フィルタの種類.
+	 * @param[in]  threadsCount  スレッド数。0の場合は自動.
+	 */
+	bool resizeRGBA (const float* srcBuff, const int srcWidth, const int srcHeight, float* dstBuff, const int dstWidth, const int dstHeight, const RESIZE_FILTER filter = resize_filter_lanczos3, const int threadsCount = 0);
+
+	/**
+	 * RGBA(8bit)のピクセルバッファをリサイズ.
+	 */
+	bool resizeRGBA8 (const unsigned char* srcBuff, const int srcWidth, const int srcHeight, unsigned char* dstBuff, const int dstWidth, const int dstHeight, const RESIZE_FILTER filter = resize_filter_lanczos3, const int threadsCount = 0);
+	bool resizeRGBA8 (const std::vector<unsigned char>& srcBuff, const int srcWidth, const int srcHeight, std::vector<unsigned char>& dstBuff, const int dstWidth, const int dstHeight, const RESIZE_FILTER filter = resize_filter_lanczos3, const int threadsCount = 0);
+
+	/**
+	 * グレイスケール(8bit)のピクセルバッファをリサイズ.
+	 */
+	bool resizeGray8 (const std::vector<unsigned char>& srcBuff, const int srcWidth, const int srcHeight, std::vector<unsigned char>& dstBuff, const int dstWidth, const int dstHeight, const RESIZE_FILTER filter = resize_filter_lanczos3, const int threadsCount = 0);
+
+	/**
+	 * RGBA(8bit)のピクセルバッファがグレイスケールか (R=G=B、A=255).
+	 */
+	bool isGrayscaleRGBA8 (const std::vector<unsigned char>& rgbaBuff);
+
+	/**
+	 * RGBA(8bit)のピクセルバッファから、Redをグレイスケール(8bit)として取り出す.
+	 */
+	void convertRGBA8ToGray8 (const std::vector<unsigned char>& rgbaBuff, std::vector<unsigned char>& grayBuff);
+
+	/**
+	 * グレイスケール(8bit)のピクセルバッファをRGBA(8bit)に変換.
+	 */
+	void convertGray8ToRGBA8 (const std::vector<unsigned char>& grayBuff, std::vector<unsigned char>& rgbaBuff);
+
+	/**
+	 * 高さ(バンプ)のピクセルバッファから、+Z向きの法線を計算.
+	 * Sobelフィルタで勾配を求める。テクスチャは繰り返すため、端のピクセルは反対側を参照する.
+	 * イメージの上端をV=1とし、法線のYはVの方向とする.
+	 * @param[in]  heights       高さ (width x height).
+	 * @param[in]  width         幅.
+	 * @param[in]  height        高さ.
+	 * @param[in]  strength      凹凸の強さ.
+	 * @param[out] normalsX      法線のX (width x height).
+	 * @param[out] normalsY      法線のY (width x height).
+	 * @param[out] normalsZ      法線のZ (width x height).
+	 * @param[in]  threadsCount  スレッド数。0の場合は自動.
+	 */
+	bool convertHeightToNormal (const std::vector<float>& heights, const int width, const int height, const float strength, std::vector<float>& normalsX, std::vector<float>& normalsY, std::vector<float>& normalsZ, const int threadsCount = 0);
+
+	/**
+	 * png/jpegファイルのヘッダから、形式と幅/高さを取得 (ピクセルはデコードしない).
+	 * @param[in]  filePath   ファイルパス.
+	 * @param[out] formatStr  "png"または"jpg"が返る.
+	 * @param[out] width      幅.
+	 * @param[out] height     高さ.
+	 */
+	bool readImageFileHeader (const std::string& filePath, std::string& formatStr, int& width, int& height);
+}
+
+#endif
@@ -7,6 +7,8 @@
 #include "StreamCtrl.h"
 #include "StringUtil.h"
 #include "USDData.h"
+#include "DecodedImageCache.h"
+#include "ImageUtil.h"
 
 #include <math.h>
 
@@ -14,13 +16,17 @@
 // 注意点として、compointer<sxsdk::image_interface>で確保した場合は自動で解放されるため、Releaseを呼んではいけない.
 #define IMAGE_INTERFACE_RELEASE(image) {if (image) { image->Release(); image = NULL; } }
 
+// テクスチャの合成時に、まとめて読み込んで並列に処理するピクセル数.
+// スレッドの生成回数を減らすため、1024x1024以下のテクスチャはレイヤごとに1回で処理する.
+#define BLEND_BLOCK_PIXELS (1024 * 1024)
+
 /*
 	Shade3Dの「透明」「不透明マスク」「チャンネル合成のアルファ透明」は、最終的に合成されてすべてOpacityのテクスチャに格納される.
 	USDの場合は、BaseColor/Metallic/Roughness/NormalのFactorとテクスチャは両方使うことはできない.
 	テクスチャを使用した場合は、Factorをテクスチャに乗算する必要がある.その処理はCMaterialTextureBakeクラスでおこなっている.
 */
 
-CImagesBlend::CImagesBlend (sxsdk::scene_interface* scene, sxsdk::surface_class* surface) : m_pScene(scene), m_surface(surface)
+CImagesBlend::CImagesBlend (sxsdk::scene_interface* scene, sxsdk::surface_class* surface, CDecodedImageCache* imageCache) : m_pScene(scene), m_surface(surface), m_pImageCache(imageCache)
 {
 	m_diffuseImage      = NULL;
 	m_normalImage       = NULL;
@@ -282,10 +288,15 @@ bool CImagesBlend::m_checkImage (const sxsdk::enums::mapping_type mappingType,
 
 	int uvIndex = 0;
 	int occlusionChannelMix = 0;
+	ProceduralPattern::CPatternParam patternParam;
 	for (int i = 0; i < layersCou; ++i) {
 		sxsdk::mapping_layer_class& mappingLayer = m_surface->mapping_layer(i);
+		bool patternF = false;			// ベイクできるイメージ以外のパターンの場合.
 		if (mappingType != MAPPING_TYPE_USD_OCCLUSION) {
-			if (mappingLayer.get_pattern() != sxsdk::enums::image_pattern) continue;
+			if (mappingLayer.get_pattern() != sxsdk::enums::image_pattern) {
+				if (!m_getPatternParam(mappingLayer, mappingType, patternParam)) continue;
+				patternF = true;
+			}
 			uvIndex = mappingLayer.get_uv_mapping();
 		} else {
 			if (!Shade3DUtil::isOcclusionMappingLayer(&mappingLayer)) continue;
@@ -323,8 +334,10 @@ bool CImagesBlend::m_checkImage (const sxsdk::enums::mapping_type mappingType,
 			}
 		}
 
-		compointer<sxsdk::image_interface> image(mappingLayer.get_image_interface());
-		if (!image || !(image->has_image()) || (image->get_size().x) <= 0 || (image->get_size().y) <= 0) continue;
+		if (!patternF) {
+			compointer<sxsdk::image_interface> image(mappingLayer.get_image_interface());
+			if (!image || !(image->has_image()) || (image->get_size().x) <= 0 || (image->get_size().y) <= 0) continue;
+		}
 
 		const bool flipColor = mappingLayer.get_flip_color();			// 色反転.
 		const bool flipH     = mappingLayer.get_horizontal_flip();		// 左右反転.
@@ -392,6 +405,21 @@ bool CImagesBlend::m_checkImage (const sxsdk::enums::mapping_type mappingType,
 	return true;
 }
 
+/**
+ * イメージ以外のパターンのマッピングレイヤで、指定のマッピングの種類としてベイクできるものか.
+ * 不透明マスク/Occlusionには使用しない.
+ */
+bool CImagesBlend::m_getPatternParam (sxsdk::mapping_layer_class& mappingLayer, const sxsdk::enums::mapping_type mappingType, ProceduralPattern::CPatternParam& patternParam)
+{
+	if (mappingType == MAPPING_TYPE_OPACITY || mappingType == MAPPING_TYPE_USD_OCCLUSION) return false;
+	if (!Shade3DUtil::getProceduralPatternParam(&mappingLayer, patternParam)) return false;
+
+	// 法線マップには、バンプのパターンを高さとして合成する.
+	const int type = mappingLayer.get_type();
+	if (mappingType == sxsdk::enums::normal_mapping) return (type == sxsdk::enums::bump_mapping);
+	return (type == mappingType);
+}
+
 /**
  * 指定のマッピングの種類でのテクスチャサイズの最大を取得.
  * 異なるサイズのテクスチャが混在する場合、一番大きいサイズのテクスチャに合わせる.
@@ -403,11 +431,17 @@ sx::vec<int,2> CImagesBlend::m_getMaxMappingImageSize (const sxsdk::enums::mappi
 
 	int uvTexCoord = -1;
 	int uvIndex = 0;
+	bool hasPattern = false;
+	ProceduralPattern::CPatternParam patternParam;
 	const int layersCou = m_surface->get_number_of_mapping_layers();
 	for (int i = 0; i < layersCou; ++i) {
 		sxsdk::mapping_layer_class& mappingLayer = m_surface->mapping_layer(i);
+		bool patternF = false;			// ベイクできるイメージ以外のパターンの場合.
 		if (mappingType != MAPPING_TYPE_USD_OCCLUSION) {
-			if (mappingLayer.get_pattern() != sxsdk::enums::image_pattern) continue;
+			if (mappingLayer.get_pattern() != sxsdk::enums::image_pattern) {
+				if (!m_getPatternParam(mappingLayer, mappingType, patternParam)) continue;
+				patternF = true;
+			}
 			uvIndex = mappingLayer.get_uv_mapping();
 		} else {
 			if (!Shade3DUtil::isOcclusionMappingLayer(&mappingLayer)) continue;
@@ -444,6 +478,13 @@ sx::vec<int,2> CImagesBlend::m_getMaxMappingImageSize (const sxsdk::enums::mappi
 			}
 		}
 
+		// イメージ以外のパターンはサイズを持たないため、イメージのサイズに合わせる.
+		if (patternF) {
+			if (uvTexCoord < 0) uvTexCoord = uvIndex;
+			if (uvTexCoord == uvIndex) hasPattern = true;
+			continue;
+		}
+
 		compointer<sxsdk::image_interface> image(mappingLayer.get_image_interface());
 		if (!image || !(image->has_image()) || (image->get_size().x) <= 0 || (image->get_size().y) <= 0) continue;
 		sx::vec<int,2> size = image->get_size();
@@ -471,6 +512,12 @@ sx::vec<int,2> CImagesBlend::m_getMaxMappingImageSize (const sxsdk::enums::mappi
 		texSize.x = std::max(texSize.x, size.x);
 		texSize.y = std::max(texSize.y, size.y);
 	}
+
+	// イメージ以外のパターンのみの場合は、最大テクスチャサイズでベイクする.
+	if ((texSize.x == 0 || texSize.y == 0) && hasPattern) {
+		const int size = USD_DATA::EXPORT::getTextureSize(m_exportParam.optMaxTextureSize);
+		texSize = sx::vec<int,2>(size, size);
+	}
 	return texSize;
 }
 
@@ -749,11 +796,16 @@ bool CImagesBlend::m_singleTextureAndMulti (const sxsdk::enums::mapping_type map
 	mWeight = 1.0f;
 	int counter = 0;
 
+	ProceduralPattern::CPatternParam patternParam;
 	const int layersCou = m_surface->get_number_of_mapping_layers();
 	for (int i = 0; i < layersCou; ++i) {
 		sxsdk::mapping_layer_class& mappingLayer = m_surface->mapping_layer(i);
+		bool patternF = false;			// ベイクできるイメージ以外のパターンの場合.
 		if (mappingType != MAPPING_TYPE_USD_OCCLUSION) {
-			if (mappingLayer.get_pattern() != sxsdk::enums::image_pattern) continue;
+			if (mappingLayer.get_pattern() != sxsdk::enums::image_pattern) {
+				if (!m_getPatternParam(mappingLayer, mappingType, patternParam)) continue;
+				patternF = true;
+			}
 		} else {
 			if (!Shade3DUtil::isOcclusionMappingLayer(&mappingLayer)) continue;
 
@@ -772,13 +824,15 @@ bool CImagesBlend::m_singleTextureAndMulti (const sxsdk::enums::mapping_type map
 		const float weight2 = 1.0f - weight;
 		if (MathUtil::isZero(weight)) continue;
 
-		try {
-			compointer<sxsdk::image_interface> image(mappingLayer.get_image_interface());
-			if (!image || !(image->has_image())) continue;
-			const int width  = image->get_size().x;
-			const int height = image->get_size().y;
-			if (width <= 1 || height <= 1) continue;
-		} catch (...) { }
+		if (!patternF) {
+			try {
+				compointer<sxsdk::image_interface> image(mappingLayer.get_image_interface());
+				if (!image || !(image->has_image())) continue;
+				const int width  = image->get_size().x;
+				const int height = image->get_size().y;
+				if (width <= 1 || height <= 1) continue;
+			} catch (...) { }
+		}
 
 		if (counter == 0) {
 			const int blendMode = mappingLayer.get_blend_mode();
@@ -816,7 +870,10 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 	sxsdk::master_image_class* pNewMasterImage = NULL;
 	std::string newTexName;
 	int counter = 0;
-	std::vector<sxsdk::rgba_class> rgbaLine0, rgbaLine, rgbaWeightLine;
+	std::vector<sxsdk::rgba_class> rgbaBlock0, rgbaBlock, rgbaWeightBlock;
+	std::vector<float> bumpHeights, bumpNormalsX, bumpNormalsY, bumpNormalsZ;
+	ProceduralPattern::CPatternParam patternParam;
+	std::vector<float> patternMask;
 	sxsdk::rgba_class col, whiteCol;
 	whiteCol = sxsdk::rgba_class(1, 1, 1, 1);
 	bool singleSimpleMapping = true;				// 1枚のテクスチャのみの参照で、色反転や左右反転/上下反転などがない場合は.
@@ -851,15 +908,16 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 	const sx::vec<int,2> dstTexSize = m_getMaxMappingImageSize(mappingType);
 	if (dstTexSize.x == 0 || dstTexSize.y == 0) return false;
 
-	// 「マット」を持つか.
-	const bool hasWeightTex = m_hasWeightTexture(mappingType);
-
 	int uvIndex = 0;
 	int occlusionChannelMix = 0;
 	for (int i = 0; i < layersCou; ++i) {
 		sxsdk::mapping_layer_class& mappingLayer = m_surface->mapping_layer(i);
+		bool patternF = false;			// ベイクできるイメージ以外のパターンの場合.
 		if (mappingType != MAPPING_TYPE_USD_OCCLUSION) {
-			if (mappingLayer.get_pattern() != sxsdk::enums::image_pattern) continue;
+			if (mappingLayer.get_pattern() != sxsdk::enums::image_pattern) {
+				if (!m_getPatternParam(mappingLayer, mappingType, patternParam)) continue;
+				patternF = true;
+			}
 			uvIndex = mappingLayer.get_uv_mapping();
 		} else {
 			if (!Shade3DUtil::isOcclusionMappingLayer(&mappingLayer)) continue;
@@ -960,11 +1018,17 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 
 		const int blendMode = mappingLayer.get_blend_mode();
 		try {
-			compointer<sxsdk::image_interface> image(mappingLayer.get_image_interface());
-			if (!image || !(image->has_image())) continue;
-			const int width  = image->get_size().x;
-			const int height = image->get_size().y;
-			if (width <= 1 || height <= 1) continue;
+			// イメージ以外のパターンの場合は、イメージの代わりにマッピングレイヤの色を使い、パターンの濃さを適用率に乗算する.
+			compointer<sxsdk::image_interface> image;
+			int width  = 0;
+			int height = 0;
+			if (!patternF) {
+				image = mappingLayer.get_image_interface();
+				if (!image || !(image->has_image())) continue;
+				width  = image->get_size().x;
+				height = image->get_size().y;
+				if (width <= 1 || height <= 1) continue;
+			}
 
 			// Diffuseテクスチャの場合はAlpha要素をRGBに入れる.
 			if (mappingType == MAPPING_TYPE_OPACITY) {
@@ -997,7 +1061,8 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 				else if (occlusionChannelMix == 1) channelMix = sxsdk::enums::mapping_grayscale_green_mode;
 				else if (occlusionChannelMix == 2) channelMix = sxsdk::enums::mapping_grayscale_blue_mode;
 			}
-			const bool useChannelMix = (channelMix == sxsdk::enums::mapping_grayscale_alpha_mode ||
+			const bool useChannelMix = !patternF &&
+									   (channelMix == sxsdk::enums::mapping_grayscale_alpha_mode ||
 										channelMix == sxsdk::enums::mapping_grayscale_red_mode ||
 										channelMix == sxsdk::enums::mapping_grayscale_green_mode ||
 										channelMix == sxsdk::enums::mapping_grayscale_blue_mode ||
@@ -1010,12 +1075,9 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 				newRepeatX  = repeatU;
 				newRepeatY  = repeatV;
 				newTexCoord = uvIndex;
-				rgbaLine.resize(newWidth);
-				rgbaLine0.resize(newWidth);
-				if (hasWeightTex) rgbaWeightLine.resize(newWidth);
 
 				// マスターイメージを持つか調べる.
-				pNewMasterImage = Shade3DUtil::getMasterImageFromImage(m_pScene, image);
+				if (!patternF) pNewMasterImage = m_pImageCache ? m_pImageCache->findMasterImage(image) : Shade3DUtil::getMasterImageFromImage(m_pScene, image);
 
 				if (pNewMasterImage) {
 					// そのまま画像を採用する可能性があるかどうか.
@@ -1029,7 +1091,16 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 			if (uvIndex != newTexCoord) continue;
 
 			sx::vec<int,2> newImgSize = newImage->get_size();
-			compointer<sxsdk::image_interface> image2 = m_duplicateImage(image, newImgSize, flipColor, flipH, flipV, rotate90, repeatU, repeatV);
+			compointer<sxsdk::image_interface> image2;
+			if (patternF) {
+				// パターンの濃さをUV空間でベイク (反転はpatternParamに格納済み).
+				patternParam.repeatU = (int)repeatU;
+				patternParam.repeatV = (int)repeatV;
+				patternParam.seed    = (unsigned int)i;
+				if (!ProceduralPattern::bakeMask(patternParam, newWidth, newHeight, patternMask)) continue;
+			} else {
+				image2 = m_duplicateImage(image, newImgSize, flipColor, flipH, flipV, rotate90, repeatU, repeatV);
+			}
 
 			compointer<sxsdk::image_interface> weightImage2;
 			if (weightWidth > 0) {
@@ -1037,159 +1108,270 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 			}
 
 			// バンプの場合は法線マップに置き換え.
-			if (mappingType == sxsdk::enums::normal_mapping) {
-				if (type == sxsdk::enums::bump_mapping) image2->convert_bump_to_normalmap(1.0f);
-			}
-
-			for (int y = 0; y < newHeight; ++y) {
-				image2->get_pixels_rgba_float(0, y, newWidth, 1, &(rgbaLine[0]));
-
-				if (weightWidth > 0) {
-					weightImage2->get_pixels_rgba_float(0, y, newWidth, 1, &(rgbaWeightLine[0]));
-				}
-
-				// チャンネルの合成モード により、色を埋める.
-				if (useChannelMix) {
-					float fVal;
-					if (channelMix == sxsdk::enums::mapping_grayscale_alpha_mode) {
-						for (int x = 0; x < newWidth; ++x) {
-							fVal = rgbaLine[x].alpha;
-							rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
-						}
-					} else if (channelMix == sxsdk::enums::mapping_grayscale_red_mode) {
-						for (int x = 0; x < newWidth; ++x) {
-							fVal = rgbaLine[x].red;
-							rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
-						}
-					} else if (channelMix == sxsdk::enums::mapping_grayscale_green_mode) {
-						for (int x = 0; x < newWidth; ++x) {
-							fVal = rgbaLine[x].green;
-							rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
-						}
-					} else if (channelMix == sxsdk::enums::mapping_grayscale_blue_mode) {
-						for (int x = 0; x < newWidth; ++x) {
-							fVal = rgbaLine[x].blue;
-							rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
-						}
-					} else if (channelMix == sxsdk::enums::mapping_grayscale_average_mode) {
-						for (int x = 0; x < newWidth; ++x) {
-							fVal = (rgbaLine[x].red + rgbaLine[x].green + rgbaLine[x].blue) * 0.3333f;
-							rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
+			// 高さを読み込み、法線の計算は複数スレッドで行う.
+			bool bumpF = false;
+			if (mappingType == sxsdk::enums::normal_mapping && type == sxsdk::enums::bump_mapping) {
+				if (patternF) {
+					bumpHeights = patternMask;
+				} else {
+					bumpHeights.resize((size_t)newWidth * (size_t)newHeight);
+					std::vector<sxsdk::rgba_class> lineBuff(newWidth);
+					for (int y = 0; y < newHeight; ++y) {
+						image2->get_pixels_rgba_float(0, y, newWidth, 1, &(lineBuff[0]));
+						float* hLine = &(bumpHeights[(size_t)y * (size_t)newWidth]);
+						if (channelMix == sxsdk::enums::mapping_grayscale_alpha_mode) {
+							for (int x = 0; x < newWidth; ++x) hLine[x] = lineBuff[x].alpha;
+						} else if (channelMix == sxsdk::enums::mapping_grayscale_red_mode) {
+							for (int x = 0; x < newWidth; ++x) hLine[x] = lineBuff[x].red;
+						} else if (channelMix == sxsdk::enums::mapping_grayscale_green_mode) {
+							for (int x = 0; x < newWidth; ++x) hLine[x] = lineBuff[x].green;
+						} else if (channelMix == sxsdk::enums::mapping_grayscale_blue_mode) {
+							for (int x = 0; x < newWidth; ++x) hLine[x] = lineBuff[x].blue;
+						} else {
+							for (int x = 0; x < newWidth; ++x) hLine[x] = (lineBuff[x].red + lineBuff[x].green + lineBuff[x].blue) * 0.3333f;
 						}
 					}
 				}
+				bumpF = ImageUtil::convertHeightToNormal(bumpHeights, newWidth, newHeight, 1.0f, bumpNormalsX, bumpNormalsY, bumpNormalsZ);
+				if (!bumpF) continue;
+			}
 
-				// 「アルファ透明」でない場合.
-				if (mappingType == sxsdk::enums::diffuse_mapping) {
-					if (channelMix != sxsdk::enums::mapping_transparent_alpha_mode) {
-						for (int x = 0; x < newWidth; ++x) rgbaLine[x].alpha = 1.0f;
+			// パターンの濃さを適用率とする場合 (バンプの場合は高さとして使用済み).
+			const bool patternWeightF = patternF && !bumpF;
+			const sxsdk::rgba_class patternCol = patternF ? sxsdk::rgba_class(mappingLayer.get_color()) : whiteCol;
+			const bool useWeightBlock = (weightWidth > 0 || patternWeightF);
+
+			// Shade3DのSDK(イメージ)へのアクセスはこのスレッドのみで行い、
+			// BLEND_BLOCK_PIXELSピクセル分のライン単位で読み込んだピクセルの合成処理を複数スレッドで行う.
+			const int blockLines = std::max(1, std::min(newHeight, BLEND_BLOCK_PIXELS / std::max(1, newWidth)));
+			const size_t blockSize = (size_t)newWidth * (size_t)blockLines;
+			rgbaBlock.resize(blockSize);
+			if (counter > 0) rgbaBlock0.resize(blockSize);
+			if (useWeightBlock) rgbaWeightBlock.resize(blockSize);
+
+			for (int y0 = 0; y0 < newHeight; y0 += blockLines) {
+				const int linesCou = std::min(blockLines, newHeight - y0);
+				for (int y = 0; y < linesCou; ++y) {
+					const size_t iPos = (size_t)y * (size_t)newWidth;
+					if (patternWeightF) {
+						std::fill(rgbaBlock.begin() + iPos, rgbaBlock.begin() + iPos + newWidth, patternCol);
+					} else if (!bumpF) {
+						image2->get_pixels_rgba_float(0, y0 + y, newWidth, 1, &(rgbaBlock[iPos]));
 					}
-				}
-
-				// Roughnessの場合、Shade3Dはテクスチャの濃淡は逆転している.
-				// 「テクスチャを加工せずにベイク」の場合はそのまま採用するため、この処理は行わない.
-				if (!m_exportParam.bakeWithoutProcessingTextures) {
-					if (mappingType == sxsdk::enums::roughness_mapping) {
-						for (int x = 0; x < newWidth; ++x) {
-							rgbaLine[x].red   = 1.0f - rgbaLine[x].red;
-							rgbaLine[x].green = 1.0f - rgbaLine[x].green;
-							rgbaLine[x].blue  = 1.0f - rgbaLine[x].blue;
+					if (weightWidth > 0) weightImage2->get_pixels_rgba_float(0, y0 + y, newWidth, 1, &(rgbaWeightBlock[iPos]));
+					if (patternWeightF) {
+						const float* pMask = &(patternMask[(size_t)(y0 + y) * (size_t)newWidth]);
+						sxsdk::rgba_class* pWeight = &(rgbaWeightBlock[iPos]);
+						if (weightWidth > 0) {
+							for (int x = 0; x < newWidth; ++x) pWeight[x].red *= pMask[x];
+						} else {
+							for (int x = 0; x < newWidth; ++x) pWeight[x].red = pMask[x];
 						}
 					}
+					if (counter > 0) newImage->get_pixels_rgba_float(0, y0 + y, newWidth, 1, &(rgbaBlock0[iPos]));
 				}
 
-				if (counter == 0) {
-					float aV;
-					if (blendMode == 7 && mappingType != sxsdk::enums::normal_mapping) {				// 「乗算」合成.
-						for (int x = 0; x < newWidth; ++x) {
-							const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-							const float w2 = 1.0f - w;
-							rgbaLine[x] = (baseCol * w2 + rgbaLine[x] * w) * baseCol;
+				ImageUtil::parallelFor(linesCou, [&](const int yStart, const int yEnd) {
+					for (int y = yStart; y < yEnd; ++y) {
+						const size_t iPos = (size_t)y * (size_t)newWidth;
+						sxsdk::rgba_class* rgbaLine = &(rgbaBlock[iPos]);
+						const sxsdk::rgba_class* rgbaWeightLine = useWeightBlock ? &(rgbaWeightBlock[iPos]) : NULL;
+						const sxsdk::rgba_class* rgbaLine0 = (counter > 0) ? &(rgbaBlock0[iPos]) : NULL;
+
+						// バンプから計算した法線を、法線マップのRGBとして格納.
+						// 高さの要素はチャンネルの合成モードで選択済み.
+						if (bumpF) {
+							const size_t nPos = (size_t)(y0 + y) * (size_t)newWidth;
+							const float* nX = &(bumpNormalsX[nPos]);
+							const float* nY = &(bumpNormalsY[nPos]);
+							const float* nZ = &(bumpNormalsZ[nPos]);
+							for (int x = 0; x < newWidth; ++x) {
+								rgbaLine[x] = sxsdk::rgba_class(nX[x] * 0.5f + 0.5f, nY[x] * 0.5f + 0.5f, nZ[x], 1.0f);
+							}
 						}
 
-					} else {										// 「通常」合成.
-						for (int x = 0; x < newWidth; ++x) {
-							const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-							const float w2 = 1.0f - w;
-							rgbaLine[x] = rgbaLine[x] * w + baseCol * w2;
+						// チャンネルの合成モード により、色を埋める.
+						if (useChannelMix && !bumpF) {
+							float fVal;
+							if (channelMix == sxsdk::enums::mapping_grayscale_alpha_mode) {
+								for (int x = 0; x < newWidth; ++x) {
+									fVal = rgbaLine[x].alpha;
+									rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
+								}
+							} else if (channelMix == sxsdk::enums::mapping_grayscale_red_mode) {
+								for (int x = 0; x < newWidth; ++x) {
+									fVal = rgbaLine[x].red;
+									rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
+								}
+							} else if (channelMix == sxsdk::enums::mapping_grayscale_green_mode) {
+								for (int x = 0; x < newWidth; ++x) {
+									fVal = rgbaLine[x].green;
+									rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
+								}
+							} else if (channelMix == sxsdk::enums::mapping_grayscale_blue_mode) {
+								for (int x = 0; x < newWidth; ++x) {
+									fVal = rgbaLine[x].blue;
+									rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
+								}
+							} else if (channelMix == sxsdk::enums::mapping_grayscale_average_mode) {
+								for (int x = 0; x < newWidth; ++x) {
+									fVal = (rgbaLine[x].red + rgbaLine[x].green + rgbaLine[x].blue) * 0.3333f;
+									rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
+								}
+							}
 						}
-					}
 
-				} else {
-					newImage->get_pixels_rgba_float(0, y, newWidth, 1, &(rgbaLine0[0]));
-
-					if (mappingType == sxsdk::enums::normal_mapping) {
-						sxsdk::vec3 n, n2;
-						sxsdk::rgb_class col;
-						for (int x = 0; x < newWidth; ++x) {
-							const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-							const float w2 = 1.0f - w;
-							n  = MathUtil::convRGBToNormal(sxsdk::rgb_class(rgbaLine[x].red, rgbaLine[x].green, rgbaLine[x].blue));
-							n2 = MathUtil::convRGBToNormal(sxsdk::rgb_class(rgbaLine0[x].red, rgbaLine0[x].green, rgbaLine0[x].blue));
-
-							n = n * w + n2 * w2;
-							col = MathUtil::convNormalToRGB(n);
-							rgbaLine[x] = sxsdk::rgba_class(col.red, col.green, col.blue, 1.0f);
+						// 「アルファ透明」でない場合.
+						if (mappingType == sxsdk::enums::diffuse_mapping) {
+							if (channelMix != sxsdk::enums::mapping_transparent_alpha_mode) {
+								for (int x = 0; x < newWidth; ++x) rgbaLine[x].alpha = 1.0f;
+							}
 						}
 
-					} else {
-						if (blendMode == sxsdk::enums::mapping_blend_mode) {		// 「通常」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								const float w2 = 1.0f - w;
-								rgbaLine[x] = rgbaLine[x] * w + rgbaLine0[x] * w2;
+						// Roughnessの場合、Shade3Dはテクスチャの濃淡は逆転している.
+						// 「テクスチャを加工せずにベイク」の場合はそのまま採用するため、この処理は行わない.
+						if (!m_exportParam.bakeWithoutProcessingTextures) {
+							if (mappingType == sxsdk::enums::roughness_mapping) {
+								for (int x = 0; x < newWidth; ++x) {
+									rgbaLine[x].red   = 1.0f - rgbaLine[x].red;
+									rgbaLine[x].green = 1.0f - rgbaLine[x].green;
+									rgbaLine[x].blue  = 1.0f - rgbaLine[x].blue;
+								}
 							}
+						}
 
-						} else if (blendMode == sxsdk::enums::mapping_mul_mode) {	// 「乗算 (レガシー)」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								const float w2 = 1.0f - w;
-								rgbaLine[x] = rgbaLine[x] * rgbaLine0[x] * w;
-							}
-						} else if (blendMode == 7) {							// 「乗算」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								const float w2 = 1.0f - w;
+						if (counter == 0) {
+							float aV;
+							if (blendMode == 7 && mappingType != sxsdk::enums::normal_mapping) {				// 「乗算」合成.
+								for (int x = 0; x < newWidth; ++x) {
+									const float w  = alphaTrans ? 1.0f : (useWeightBlock ? rgbaWeightLine[x].red * weight : weight);
+									const float w2 = 1.0f - w;
+									rgbaLine[x] = (baseCol * w2 + rgbaLine[x] * w) * baseCol;
+								}
 
-								rgbaLine[x] = (whiteCol * w2 + rgbaLine[x] * w) * rgbaLine0[x];
+							} else {										// 「通常」合成.
+								for (int x = 0; x < newWidth; ++x) {
+									const float w  = alphaTrans ? 1.0f : (useWeightBlock ? rgbaWeightLine[x].red * weight : weight);
+									const float w2 = 1.0f - w;
+									rgbaLine[x] = rgbaLine[x] * w + baseCol * w2;
+								}
 							}
 
-						} else if (blendMode == sxsdk::enums::mapping_add_mode) {		// 「加算」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								rgbaLine[x] = rgbaLine0[x] + (rgbaLine[x] * w);
-								rgbaLine[x].red   = std::min(std::max(0.0f, rgbaLine[x].red), 1.0f);
-								rgbaLine[x].green = std::min(std::max(0.0f, rgbaLine[x].green), 1.0f);
-								rgbaLine[x].blue  = std::min(std::max(0.0f, rgbaLine[x].blue), 1.0f);
-								rgbaLine[x].alpha = std::min(std::max(0.0f, rgbaLine[x].alpha), 1.0f);
-							}
-						} else if (blendMode == sxsdk::enums::mapping_sub_mode) {		// 「減算」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								rgbaLine[x] = rgbaLine0[x] - (rgbaLine[x] * w);
-								rgbaLine[x].red   = std::min(std::max(0.0f, rgbaLine[x].red), 1.0f);
-								rgbaLine[x].green = std::min(std::max(0.0f, rgbaLine[x].green), 1.0f);
-								rgbaLine[x].blue  = std::min(std::max(0.0f, rgbaLine[x].blue), 1.0f);
-								rgbaLine[x].alpha = std::min(std::max(0.0f, rgbaLine[x].alpha), 1.0f);
-							}
-						} else if (blendMode == sxsdk::enums::mapping_min_mode) {		// 「比較(暗)」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								rgbaLine[x].red   = std::min(rgbaLine0[x].red,   rgbaLine[x].red   * w);
-								rgbaLine[x].green = std::min(rgbaLine0[x].green, rgbaLine[x].green * w);
-								rgbaLine[x].blue  = std::min(rgbaLine0[x].blue,  rgbaLine[x].blue  * w);
-							}
-						} else if (blendMode == sxsdk::enums::mapping_max_mode) {		// 「比較(明)」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								rgbaLine[x].red   = std::max(rgbaLine0[x].red,   rgbaLine[x].red   * w);
-								rgbaLine[x].green = std::max(rgbaLine0[x].green, rgbaLine[x].green * w);
-								rgbaLine[x].blue  = std::max(rgbaLine0[x].blue,  rgbaLine[x].blue  * w);
+						} else {
+							if (mappingType == sxsdk::enums::normal_mapping) {
+								// 下のレイヤの法線(b)に、上のレイヤの法線(d)の凹凸を重ねる (Reoriented Normal Mapping).
+								// r = t * dot(t, u) / t.z - u  (t = b + (0, 0, 1), u = (-d.x, -d.y, d.z)).
+								// 法線の変換はMathUtil::convRGBToNormal/convNormalToRGBと同じ.
+								for (int x = 0; x < newWidth; ++x) {
+									const float w  = alphaTrans ? 1.0f : (useWeightBlock ? rgbaWeightLine[x].red * weight : weight);
+									const float w2 = 1.0f - w;
+
+									float bx = (rgbaLine0[x].red   - 0.5f) * 2.0f;
+									float by = (rgbaLine0[x].green - 0.5f) * 2.0f;
+									float bz = rgbaLine0[x].blue;
+									float dx = (rgbaLine[x].red   - 0.5f) * 2.0f;
+									float dy = (rgbaLine[x].green - 0.5f) * 2.0f;
+									float dz = rgbaLine[x].blue;
+									float len = std::sqrt(bx * bx + by * by + bz * bz);
+									if (len > 1e-6f) {
+										bx /= len;
+										by /= len;
+										bz /= len;
+									} else {
+										bx = by = 0.0f;
+										bz = 1.0f;
+									}
+									len = std::sqrt(dx * dx + dy * dy + dz * dz);
+									if (len > 1e-6f) {
+										dx /= len;
+										dy /= len;
+										dz /= len;
+									} else {
+										dx = dy = 0.0f;
+										dz = 1.0f;
+									}
+
+									const float tz = std::max(bz, 0.0f) + 1.0f;
+									const float s  = (bx * (-dx) + by * (-dy) + tz * dz) / tz;
+									float nx = (bx * s + dx) * w + bx * w2;
+									float ny = (by * s + dy) * w + by * w2;
+									float nz = (tz * s - dz) * w + bz * w2;
+									len = std::sqrt(nx * nx + ny * ny + nz * nz);
+									if (len > 1e-6f) {
+										nx /= len;
+										ny /= len;
+										nz /= len;
+									} else {
+										nx = bx;
+										ny = by;
+										nz = bz;
+									}
+									rgbaLine[x] = sxsdk::rgba_class(nx * 0.5f + 0.5f, ny * 0.5f + 0.5f, nz, 1.0f);
+								}
+
+							} else {
+								if (blendMode == sxsdk::enums::mapping_blend_mode) {		// 「通常」合成.
+									for (int x = 0; x < newWidth; ++x) {
+										const float w  = alphaTrans ? 1.0f : (useWeightBlock ? rgbaWeightLine[x].red * weight : weight);
+										const float w2 = 1.0f - w;
+										rgbaLine[x] = rgbaLine[x] * w + rgbaLine0[x] * w2;
+									}
+
+								} else if (blendMode == sxsdk::enums::mapping_mul_mode) {	// 「乗算 (レガシー)」合成.
+									for (int x = 0; x < newWidth; ++x) {
+										const float w  = alphaTrans ? 1.0f : (useWeightBlock ? rgbaWeightLine[x].red * weight : weight);
+										const float w2 = 1.0f - w;
+										rgbaLine[x] = rgbaLine[x] * rgbaLine0[x] * w;
+									}
+								} else if (blendMode == 7) {							// 「乗算」合成.
+									for (int x = 0; x < newWidth; ++x) {
+										const float w  = alphaTrans ? 1.0f : (useWeightBlock ? rgbaWeightLine[x].red * weight : weight);
+										const float w2 = 1.0f - w;
+
+										rgbaLine[x] = (whiteCol * w2 + rgbaLine[x] * w) * rgbaLine0[x];
+									}
+
+								} else if (blendMode == sxsdk::enums::mapping_add_mode) {		// 「加算」合成.
+									for (int x = 0; x < newWidth; ++x) {
+										const float w  = alphaTrans ? 1.0f : (useWeightBlock ? rgbaWeightLine[x].red * weight : weight);
+										rgbaLine[x] = rgbaLine0[x] + (rgbaLine[x] * w);
+										rgbaLine[x].red   = std::min(std::max(0.0f, rgbaLine[x].red), 1.0f);
+										rgbaLine[x].green = std::min(std::max(0.0f, rgbaLine[x].green), 1.0f);
+										rgbaLine[x].blue  = std::min(std::max(0.0f, rgbaLine[x].blue), 1.0f);
+										rgbaLine[x].alpha = std::min(std::max(0.0f, rgbaLine[x].alpha), 1.0f);
+									}
+								} else if (blendMode == sxsdk::enums::mapping_sub_mode) {		// 「減算」合成.
+									for (int x = 0; x < newWidth; ++x) {
+										const float w  = alphaTrans ? 1.0f : (useWeightBlock ? rgbaWeightLine[x].red * weight : weight);
+										rgbaLine[x] = rgbaLine0[x] - (rgbaLine[x] * w);
+										rgbaLine[x].red   = std::min(std::max(0.0f, rgbaLine[x].red), 1.0f);
+										rgbaLine[x].green = std::min(std::max(0.0f, rgbaLine[x].green), 1.0f);
+										rgbaLine[x].blue  = std::min(std::max(0.0f, rgbaLine[x].blue), 1.0f);
+										rgbaLine[x].alpha = std::min(std::max(0.0f, rgbaLine[x].alpha), 1.0f);
+									}
+								} else if (blendMode == sxsdk::enums::mapping_min_mode) {		// 「比較(暗)」合成.
+									for (int x = 0; x < newWidth; ++x) {
+										const float w  = alphaTrans ? 1.0f : (useWeightBlock ? rgbaWeightLine[x].red * weight : weight);
+										rgbaLine[x].red   = std::min(rgbaLine0[x].red,   rgbaLine[x].red   * w);
+										rgbaLine[x].green = std::min(rgbaLine0[x].green, rgbaLine[x].green * w);
+										rgbaLine[x].blue  = std::min(rgbaLine0[x].blue,  rgbaLine[x].blue  * w);
+									}
+								} else if (blendMode == sxsdk::enums::mapping_max_mode) {		// 「比較(明)」合成.
+									for (int x = 0; x < newWidth; ++x) {
+										const float w  = alphaTrans ? 1.0f : (useWeightBlock ? rgbaWeightLine[x].red * weight : weight);
+										rgbaLine[x].red   = std::max(rgbaLine0[x].red,   rgbaLine[x].red   * w);
+										rgbaLine[x].green = std::max(rgbaLine0[x].green, rgbaLine[x].green * w);
+										rgbaLine[x].blue  = std::max(rgbaLine0[x].blue,  rgbaLine[x].blue  * w);
+									}
+								}
 							}
 						}
 					}
+				}, (blockSize < 256 * 256) ? 1 : 0);		// 小さいイメージはスレッド化しない.
+
+				for (int y = 0; y < linesCou; ++y) {
+					newImage->set_pixels_rgba_float(0, y0 + y, newWidth, 1, &(rgbaBlock[(size_t)y * (size_t)newWidth]));
 				}
-				newImage->set_pixels_rgba_float(0, y, newWidth, 1, &(rgbaLine[0]));
 			}
 			counter++;
 
@@ -1988,7 +2170,7 @@ USD_DATA::IMAGE_FORMAT_TYPE CImagesBlend::getImageFormatType (const sxsdk::enums
 		compointer<sxsdk::image_interface> image(mappingLayer.get_image_interface());
 		if (!image || !(image->has_image()) || (image->get_size().x) <= 0 || (image->get_size().y) <= 0) continue;
 
-		sxsdk::master_image_class* masterImage = Shade3DUtil::getMasterImageFromImage(m_pScene, image);
+		sxsdk::master_image_class* masterImage = m_pImageCache ? m_pImageCache->findMasterImage(image) : Shade3DUtil::getMasterImageFromImage(m_pScene, image);
 		if (!masterImage) continue;
 		const std::string name(masterImage->get_name());
 
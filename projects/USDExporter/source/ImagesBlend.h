@@ -7,6 +7,9 @@
 #include "GlobalHeader.h"
 #include "ExportParam.h"
 #include "usddata.h"
+#include "ProceduralPattern.h"
+
+class CDecodedImageCache;
 
 class CImagesBlend
 {
@@ -22,6 +25,7 @@ private:
 	sxsdk::scene_interface* m_pScene;
 	sxsdk::surface_class* m_surface;
 	CExportParam m_exportParam;							// Export時のパラメータ.
+	CDecodedImageCache* m_pImageCache;					// マスターイメージのキャッシュ (NULLの場合は使用しない).
 
 	sxsdk::image_interface* m_diffuseImage;				// Diffuseの画像.
 	sxsdk::image_interface* m_normalImage;				// Normalの画像.
@@ -97,6 +101,14 @@ private:
 		sx::vec<int,2>& texRepeat,
 		bool& hasImage);
 
+	/**
+	 * イメージ以外のパターンのマッピングレイヤで、指定のマッピングの種類としてベイクできるものか.
+	 * @param[in]  mappingLayer  マッピングレイヤ.
+	 * @param[in]  mappingType   マッピングの種類.
+	 * @param[out] patternParam  パターンのパラメータが返る.
+	 */
+	bool m_getPatternParam (sxsdk::mapping_layer_class& mappingLayer, const sxsdk::enums::mapping_type mappingType, ProceduralPattern::CPatternParam& patternParam);
+
 	/**
 	 * 指定のマッピングの種類でのテクスチャサイズの最大を取得.
 	 * 異なるサイズのテクスチャが混在する場合、一番大きいサイズのテクスチャに合わせる.
@@ -150,7 +162,12 @@ private:
 	bool m_singleTextureAndMulti (const sxsdk::enums::mapping_type mappingType, float& mWeight);
 
 public:
-	CImagesBlend (sxsdk::scene_interface* scene, sxsdk::surface_class* surface);
+	/**
+	 * @param[in] scene       Shade3Dのシーンクラス.
+	 * @param[in] surface     表面材質クラス.
+	 * @param[in] imageCache  マスターイメージのキャッシュ.
+	 */
+	CImagesBlend (sxsdk::scene_interface* scene, sxsdk::surface_class* surface, CDecodedImageCache* imageCache = NULL);
 
 	void clear ();
 
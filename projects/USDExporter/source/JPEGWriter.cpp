@@ -0,0 +1,441 @@
+﻿/**
+ * JPEG形式でのテクスチャ出力.
+ * 参考 : ITU-T T.81 (JPEG) , JFIF 1.02.
+ */
+#include "JPEGWriter.h"
+#include "HuffmanUtil.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// 輝度/色差の量子化テーブル (T.81 Annex K).
+	const int g_quantLuminance[64] = {
+		16, 11, 10, 16,  24,  40,  51,  61,
+		12, 12, 14, 19,  26,  58,  60,  55,
+		14, 13, 16, 24,  40,  57,  69,  56,
+		14, 17, 22, 29,  51,  87,  80,  62,
+		18, 22, 37, 56,  68, 109, 103,  77,
+		24, 35, 55, 64,  81, 104, 113,  92,
+		49, 64, 78, 87, 103, 121, 120, 101,
+		72, 92, 95, 98, 112, 100, 103,  99
+	};
+	const int g_quantChrominance[64] = {
+		17, 18, 24, 47, 99, 99, 99, 99,
+		18, 21, 26, 66, 99, 99, 99, 99,
+		24, 26, 56, 99, 99, 99, 99, 99,
+		47, 66, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99
+	};
+
+	/**
+	 * ジグザグ順と、DCTの係数.
+	 */
+	class CJPEGTable
+	{
+	public:
+		int zigzag[64];				// ジグザグ順のインデックスから、8x8ブロック内のインデックス.
+		float dctMatrix[8][8];		// 1次元DCTの係数.
+
+	public:
+		CJPEGTable () {
+			int index = 0;
+			for (int s = 0; s < 15; ++s) {
+				const int minY = std::max(0, s - 7);
+				const int maxY = std::min(s, 7);
+				if ((s & 1) == 0) {
+					for (int y = maxY; y >= minY; --y) zigzag[index++] = y * 8 + (s - y);
+				} else {
+					for (int y = minY; y <= maxY; ++y) zigzag[index++] = y * 8 + (s - y);
+				}
+			}
+
+			const double pi = 3.14159265358979323846;
+			for (int u = 0; u < 8; ++u) {
+				const double c = (u == 0) ? std::sqrt(0.125) : 0.5;
+				for (int x = 0; x < 8; ++x) dctMatrix[u][x] = (float)(c * std::cos((double)(2 * x + 1) * (double)u * pi / 16.0));
+			}
+		}
+	};
+	const CJPEGTable g_jpegTable;
+
+	/**
+	 * 品質から量子化テーブルを計算 (IJGと同じスケーリング).
+	 */
+	void m_calcQuantTable (const int* baseTable, const int quality, int* table) {
+		const int q = std::max(1, std::min(100, quality));
+		const int scale = (q < 50) ? (5000 / q) : (200 - q * 2);
+		for (int i = 0; i < 64; ++i) table[i] = std::max(1, std::min(255, (baseTable[i] * scale + 50) / 100));
+	}
+
+	/**
+	 * 8x8ブロックのDCTと量子化.
+	 * @param[in]  block       画素値 (-128 - 127).
+	 * @param[in]  quantTable  量子化テーブル.
+	 * @param[out] coefs       ジグザグ順の量子化済みの係数.
+	 */
+	void m_quantizeBlock (const float* block, const int* quantTable, int* coefs) {
+		float tmp[64], dct[64];
+		for (int y = 0; y < 8; ++y) {
+			for (int u = 0; u < 8; ++u) {
+				float sum = 0.0f;
+				for (int x = 0; x < 8; ++x) sum += g_jpegTable.dctMatrix[u][x] * block[y * 8 + x];
+				tmp[y * 8 + u] = sum;
+			}
+		}
+		for (int u = 0; u < 8; ++u) {
+			for (int v = 0; v < 8; ++v) {
+				float sum = 0.0f;
+				for (int y = 0; y < 8; ++y) sum += g_jpegTable.dctMatrix[v][y] * tmp[y * 8 + u];
+				dct[v * 8 + u] = sum;
+			}
+		}
+		for (int i = 0; i < 64; ++i) {
+			const int index = g_jpegTable.zigzag[i];
+			const float v = dct[index] / (float)quantTable[index];
+			coefs[i] = (int)((v < 0.0f) ? (v - 0.5f) : (v + 0.5f));
+		}
+	}
+
+	/**
+	 * 値を表すのに必要なビット数 (カテゴリ).
+	 */
+	inline int m_getBitsCount (const int v) {
+		int a = std::abs(v);
+		int bits = 0;
+		while (a > 0) {
+			a >>= 1;
+			bits++;
+		}
+		return bits;
+	}
+
+	/**
+	 * ハフマンテーブル.
+	 */
+	class CHuffmanTable
+	{
+	public:
+		std::vector<unsigned int> freqs;		// シンボルごとの出現頻度 (1パス目で集計).
+		std::vector<int> lengths;				// シンボルごとの符号長.
+		std::vector<unsigned int> codes;		// シンボルごとの符号.
+		unsigned char bits[16];					// 符号長ごとのシンボル数 (DHTのBITS).
+		std::vector<unsigned char> values;		// 符号長順のシンボル (DHTのHUFFVAL).
+
+	public:
+		CHuffmanTable () {
+			freqs.resize(257, 0);
+		}
+
+		/**
+		 * 出現頻度から符号を作成.
+		 * すべて1の符号はJPEGで使用できないため、ダミーのシンボル256に割り当てる.
+		 */
+		void build () {
+			freqs[256] = 1;
+			HuffmanUtil::calcCodeLengths(freqs, 16, lengths);
+
+			// ダミーのシンボルが最長の符号となるように入れ替える.
+			int maxLength = 0;
+			for (int i = 0; i < 256; ++i) maxLength = std::max(maxLength, lengths[i]);
+			if (lengths[256] < maxLength) {
+				for (int i = 255; i >= 0; --i) {
+					if (lengths[i] == maxLength) {
+						std::swap(lengths[i], lengths[256]);
+						break;
+					}
+				}
+			}
+			HuffmanUtil::calcCanonicalCodes(lengths, codes);
+
+			for (int i = 0; i < 16; ++i) bits[i] = 0;
+			values.clear();
+			for (int len = 1; len <= 16; ++len) {
+				for (int i = 0; i < 256; ++i) {
+					if (lengths[i] != len) continue;
+					bits[len - 1]++;
+					values.push_back((unsigned char)i);
+				}
+			}
+		}
+	};
+
+	/**
+	 * エントロピー符号のビット出力 (MSBから詰める).
+	 */
+	class CJPEGBitWriter
+	{
+	private:
+		std::vector<unsigned char>& m_buff;
+		unsigned int m_bitBuff;
+		int m_bitCount;
+
+		void m_putByte (const unsigned char v) {
+			m_buff.push_back(v);
+			if (v == 0xff) m_buff.push_back(0x00);		// バイトスタッフィング.
+		}
+
+	public:
+		CJPEGBitWriter (std::vector<unsigned char>& buff) : m_buff(buff), m_bitBuff(0), m_bitCount(0) { }
+
+		void writeBits (const unsigned int v, const int count) {
+			if (count <= 0) return;
+			m_bitBuff = (m_bitBuff << count) | (v & ((1U << count) - 1));
+			m_bitCount += count;
+			while (m_bitCount >= 8) {
+				m_putByte((unsigned char)((m_bitBuff >> (m_bitCount - 8)) & 0xff));
+				m_bitCount -= 8;
+			}
+		}
+
+		/**
+		 * 残りのビットを1で埋めて出力.
+		 */
+		void flush () {
+			if (m_bitCount > 0) writeBits(0x7f, 8 - m_bitCount);
+			m_bitBuff  = 0;
+			m_bitCount = 0;
+		}
+	};
+
+	/**
+	 * 1ブロック分の係数を符号化.
+	 * bitWriterがNULLの場合は出現頻度を集計し、それ以外は出力する.
+	 */
+	void m_encodeBlock (const int* coefs, int& prevDC, CHuffmanTable& dcTable, CHuffmanTable& acTable, CJPEGBitWriter* bitWriter) {
+		const int diff = coefs[0] - prevDC;
+		prevDC = coefs[0];
+		{
+			const int bits = m_getBitsCount(diff);
+			if (bitWriter) {
+				bitWriter->writeBits(dcTable.codes[bits], dcTable.lengths[bits]);
+				bitWriter->writeBits((diff < 0) ? (diff - 1) : diff, bits);
+			} else {
+				dcTable.freqs[bits]++;
+			}
+		}
+
+		int lastIndex = 63;
+		while (lastIndex > 0 && coefs[lastIndex] == 0) lastIndex--;
+
+		int runCount = 0;
+		for (int i = 1; i <= lastIndex; ++i) {
+			const int v = coefs[i];
+			if (v == 0) {
+				runCount++;
+				continue;
+			}
+			while (runCount > 15) {
+				if (bitWriter) bitWriter->writeBits(acTable.codes[0xf0], acTable.lengths[0xf0]);
+				else acTable.freqs[0xf0]++;
+				runCount -= 16;
+			}
+			const int bits   = m_getBitsCount(v);
+			const int symbol = (runCount << 4) | bits;
+			if (bitWriter) {
+				bitWriter->writeBits(acTable.codes[symbol], acTable.lengths[symbol]);
+				bitWriter->writeBits((v < 0) ? (v - 1) : v, bits);
+			} else {
+				acTable.freqs[symbol]++;
+			}
+			runCount = 0;
+		}
+		if (lastIndex < 63) {
+			if (bitWriter) bitWriter->writeBits(acTable.codes[0x00], acTable.lengths[0x00]);
+			else acTable.freqs[0x00]++;
+		}
+	}
+
+	void m_writeU16BE (std::vector<unsigned char>& buff, const unsigned int v) {
+		buff.push_back((unsigned char)((v >> 8) & 0xff));
+		buff.push_back((unsigned char)(v & 0xff));
+	}
+
+	void m_writeDHT (std::vector<unsigned char>& buff, const int tableClassID, const CHuffmanTable& table) {
+		buff.push_back((unsigned char)tableClassID);
+		for (int i = 0; i < 16; ++i) buff.push_back(table.bits[i]);
+		buff.insert(buff.end(), table.values.begin(), table.values.end());
+	}
+}
+
+/**
+ * RGBA(8bit)のピクセルバッファをJPEGとしてメモリ上にエンコード.
+ */
+bool JPEGWriter::encodeRGBA8 (const std::vector<unsigned char>& rgbaBuff, const int width, const int height, std::vector<unsigned char>& jpegBuff, const int quality)
+{
+	jpegBuff.clear();
+	if (width <= 0 || height <= 0) return false;
+	if (rgbaBuff.size() < (size_t)width * (size_t)height * 4) return false;
+
+	const unsigned char* pixels = &(rgbaBuff[0]);
+	return encodeLines([pixels, width](const int y) { return pixels + (size_t)y * (size_t)width * 4; }, width, height, jpegBuff, quality);
+}
+
+/**
+ * 1ラインずつ取得したRGBA(8bit)のピクセルをJPEGとしてメモリ上にエンコード.
+ */
+bool JPEGWriter::encodeLines (const ImageUtil::LineReader& readLine, const int width, const int height, std::vector<unsigned char>& jpegBuff, const int quality)
+{
+	jpegBuff.clear();
+	if (width <= 0 || height <= 0 || width > 65535 || height > 65535) return false;
+
+	try {
+		int quantTables[2][64];
+		m_calcQuantTable(g_quantLuminance, quality, quantTables[0]);
+		m_calcQuantTable(g_quantChrominance, quality, quantTables[1]);
+
+		// MCUのサイズ (4:2:0の場合は16x16, 4:4:4の場合は8x8).
+		const bool subsampling = (quality < 90);
+		const int mcuSize = subsampling ? 16 : 8;
+		const int mcuCountX = (width + mcuSize - 1) / mcuSize;
+		const int mcuCountY = (height + mcuSize - 1) / mcuSize;
+
+		// 輝度(0)/色差(1)のハフマンテーブル.
+		CHuffmanTable dcTables[2], acTables[2];
+
+		// MCUの高さ分のライン.
+		const size_t lineSize = (size_t)width * 4;
+		std::vector<unsigned char> bandBuff(lineSize * (size_t)mcuSize);
+
+		// 1パス目で出現頻度を集計し、2パス目で出力する (ラインは2回読み込まれる).
+		std::vector<unsigned char> scanBuff;
+		for (int pass = 0; pass < 2; ++pass) {
+			CJPEGBitWriter bitWriter(scanBuff);
+			CJPEGBitWriter* pBitWriter = (pass == 1) ? &bitWriter : NULL;
+			if (pass == 1) {
+				for (int i = 0; i < 2; ++i) {
+					dcTables[i].build();
+					acTables[i].build();
+				}
+			}
+
+			int prevDC[3] = {0, 0, 0};
+			float yBlock[64], cbBlock[64], crBlock[64];
+			float mcuY[256], mcuCb[256], mcuCr[256];
+			int coefs[64];
+
+			for (int my = 0; my < mcuCountY; ++my) {
+				// MCUの高さ分のラインを読み込む (画像外は最後のラインを繰り返す).
+				for (int y = 0; y < mcuSize; ++y) {
+					const int py = my * mcuSize + y;
+					if (py < height) {
+						const unsigned char* pLine = readLine(py);
+						if (!pLine) {
+							jpegBuff.clear();
+							return false;
+						}
+						std::copy(pLine, pLine + lineSize, bandBuff.begin() + lineSize * y);
+					} else {
+						std::copy(bandBuff.begin() + lineSize * (y - 1), bandBuff.begin() + lineSize * y, bandBuff.begin() + lineSize * y);
+					}
+				}
+
+				for (int mx = 0; mx < mcuCountX; ++mx) {
+					// MCU内のピクセルをYCbCrに変換 (画像外は端のピクセルを繰り返す).
+					for (int y = 0; y < mcuSize; ++y) {
+						for (int x = 0; x < mcuSize; ++x) {
+							const int px = std::min(width - 1, mx * mcuSize + x);
+							const unsigned char* pP = &(bandBuff[lineSize * y + (size_t)px * 4]);
+							const float r = (float)pP[0];
+							const float g = (float)pP[1];
+							const float b = (float)pP[2];
+							const int index = y * mcuSize + x;
+							mcuY[index]  =  0.299f    * r + 0.587f    * g + 0.114f    * b - 128.0f;
+							mcuCb[index] = -0.168736f * r - 0.331264f * g + 0.5f      * b;
+							mcuCr[index] =  0.5f      * r - 0.418688f * g - 0.081312f * b;
+						}
+					}
+
+					if (subsampling) {
+						for (int by = 0; by < 2; ++by) {
+							for (int bx = 0; bx < 2; ++bx) {
+								for (int y = 0; y < 8; ++y) {
+									for (int x = 0; x < 8; ++x) yBlock[y * 8 + x] = mcuY[(by * 8 + y) * 16 + bx * 8 + x];
+								}
+								m_quantizeBlock(yBlock, quantTables[0], coefs);
+								m_encodeBlock(coefs, prevDC[0], dcTables[0], acTables[0], pBitWriter);
+							}
+						}
+						for (int y = 0; y < 8; ++y) {
+							for (int x = 0; x < 8; ++x) {
+								const int i0 = (y * 2) * 16 + x * 2;
+								cbBlock[y * 8 + x] = (mcuCb[i0] + mcuCb[i0 + 1] + mcuCb[i0 + 16] + mcuCb[i0 + 17]) * 0.25f;
+								crBlock[y * 8 + x] = (mcuCr[i0] + mcuCr[i0 + 1] + mcuCr[i0 + 16] + mcuCr[i0 + 17]) * 0.25f;
+							}
+						}
+					} else {
+						for (int i = 0; i < 64; ++i) {
+							cbBlock[i] = mcuCb[i];
+							crBlock[i] = mcuCr[i];
+						}
+						m_quantizeBlock(mcuY, quantTables[0], coefs);
+						m_encodeBlock(coefs, prevDC[0], dcTables[0], acTables[0], pBitWriter);
+					}
+					m_quantizeBlock(cbBlock, quantTables[1], coefs);
+					m_encodeBlock(coefs, prevDC[1], dcTables[1], acTables[1], pBitWriter);
+					m_quantizeBlock(crBlock, quantTables[1], coefs);
+					m_encodeBlock(coefs, prevDC[2], dcTables[1], acTables[1], pBitWriter);
+				}
+			}
+			if (pass == 1) bitWriter.flush();
+		}
+
+		std::vector<unsigned char>& buff = jpegBuff;
+		m_writeU16BE(buff, 0xffd8);				// SOI.
+
+		// APP0 (JFIF).
+		{
+			const unsigned char app0[] = {0xff, 0xe0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00};
+			buff.insert(buff.end(), app0, app0 + sizeof(app0));
+		}
+
+		// DQT.
+		m_writeU16BE(buff, 0xffdb);
+		m_writeU16BE(buff, 2 + 65 * 2);
+		for (int i = 0; i < 2; ++i) {
+			buff.push_back((unsigned char)i);
+			for (int j = 0; j < 64; ++j) buff.push_back((unsigned char)quantTables[i][g_jpegTable.zigzag[j]]);
+		}
+
+		// SOF0.
+		m_writeU16BE(buff, 0xffc0);
+		m_writeU16BE(buff, 17);
+		buff.push_back(8);
+		m_writeU16BE(buff, height);
+		m_writeU16BE(buff, width);
+		buff.push_back(3);
+		for (int i = 0; i < 3; ++i) {
+			buff.push_back((unsigned char)(i + 1));
+			buff.push_back((i == 0 && subsampling) ? 0x22 : 0x11);
+			buff.push_back((i == 0) ? 0 : 1);
+		}
+
+		// DHT.
+		{
+			std::vector<unsigned char> dhtBuff;
+			m_writeDHT(dhtBuff, 0x00, dcTables[0]);
+			m_writeDHT(dhtBuff, 0x10, acTables[0]);
+			m_writeDHT(dhtBuff, 0x01, dcTables[1]);
+			m_writeDHT(dhtBuff, 0x11, acTables[1]);
+			m_writeU16BE(buff, 0xffc4);
+			m_writeU16BE(buff, (unsigned int)(2 + dhtBuff.size()));
+			buff.insert(buff.end(), dhtBuff.begin(), dhtBuff.end());
+		}
+
+		// SOS.
+		{
+			const unsigned char sos[] = {0xff, 0xda, 0x00, 0x0c, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00, 0x3f, 0x00};
+			buff.insert(buff.end(), sos, sos + sizeof(sos));
+		}
+		buff.insert(buff.end(), scanBuff.begin(), scanBuff.end());
+
+		m_writeU16BE(buff, 0xffd9);				// EOI.
+		return true;
+
+	} catch (...) { }
+	jpegBuff.clear();
+	return false;
+}
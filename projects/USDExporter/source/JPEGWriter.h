@@ -0,0 +1,41 @@
+﻿/**
+ * JPEG形式でのテクスチャ出力.
+ * Shade3D SDKに依存せず、品質を指定してベースラインJPEGを出力する.
+ */
+
+#ifndef _JPEGWRITER_H
+#define _JPEGWRITER_H
+
+#include "ImageUtil.h"
+
+#include <vector>
+
+namespace JPEGWriter
+{
+	/**
+	 * RGBA(8bit)のピクセルバッファをJPEGとしてメモリ上にエンコード.
+	 * アルファは無視される.
+	 * 品質が90未満の場合は、色差を4:2:0で間引く.
+	 * ハフマンテーブルは画像ごとに最適化したものを格納する.
+	 * @param[in]  rgbaBuff   ピクセル (width x height x 4).
+	 * @param[in]  width      幅.
+	 * @param[in]  height     高さ.
+	 * @param[out] jpegBuff   jpegファイルのデータが返る.
+	 * @param[in]  quality    品質 (1 - 100).
+	 */
+	bool encodeRGBA8 (const std::vector<unsigned char>& rgbaBuff, const int width, const int height, std::vector<unsigned char>& jpegBuff, const int quality = 90);
+
+	/**
+	 * 1ラインずつ取得したRGBA(8bit)のピクセルをJPEGとしてメモリ上にエンコード.
+	 * 画像全体のピクセルをメモリ上に保持せず、MCUの高さ分のラインのみを保持する.
+	 * ハフマンテーブルの最適化のため、ラインは2回読み込まれる.
+	 * @param[in]  readLine   ラインの取得関数 (width x 4バイト).
+	 * @param[in]  width      幅.
+	 * @param[in]  height     高さ.
+	 * @param[out] jpegBuff   jpegファイルのデータが返る.
+	 * @param[in]  quality    品質 (1 - 100).
+	 */
+	bool encodeLines (const ImageUtil::LineReader& readLine, const int width, const int height, std::vector<unsigned char>& jpegBuff, const int quality = 90);
+}
+
+#endif
@@ -0,0 +1,487 @@
+﻿/**
+ * KTX2形式でのテクスチャ出力.
+ * 参考 : https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+ */
+#include "KTX2Writer.h"
+#include "ImageUtil.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// VkFormat.
+#define KTX2_VK_FORMAT_BC1_RGB_UNORM_BLOCK  131
+#define KTX2_VK_FORMAT_BC1_RGB_SRGB_BLOCK   132
+#define KTX2_VK_FORMAT_BC3_UNORM_BLOCK      137
+#define KTX2_VK_FORMAT_BC3_SRGB_BLOCK       138
+
+// Data Format DescriptorのcolorModel.
+#define KTX2_DF_MODEL_BC1A  128
+#define KTX2_DF_MODEL_BC3   130
+
+namespace {
+	/**
+	 * リトルエンディアンでバッファに追加.
+	 */
+	void m_writeU8 (std::vector<unsigned char>& buff, const unsigned int v) {
+		buff.push_back((unsigned char)(v & 0xff));
+	}
+	void m_writeU16 (std::vector<unsigned char>& buff, const unsigned int v) {
+		for (int i = 0; i < 2; ++i) buff.push_back((unsigned char)((v >> (i * 8)) & 0xff));
+	}
+	void m_writeU32 (std::vector<unsigned char>& buff, const unsigned int v) {
+		for (int i = 0; i < 4; ++i) buff.push_back((unsigned char)((v >> (i * 8)) & 0xff));
+	}
+	void m_writeU64 (std::vector<unsigned char>& buff, const unsigned long long v) {
+		for (int i = 0; i < 8; ++i) buff.push_back((unsigned char)((v >> (i * 8)) & 0xff));
+	}
+
+	/**
+	 * Data Format Descriptor (BC1/BC3)を作成.
+	 * BC3の場合は、アルファ(64bit)とカラー(64bit)の2つのサンプルを持つ.
+	 */
+	void m_writeDFD (std::vector<unsigned char>& buff, const bool useSRGB, const bool useBC3) {
+		const int samplesCount = useBC3 ? 2 : 1;
+		const unsigned int blockSize = 24 + 16 * samplesCount;
+		m_writeU32(buff, 4 + blockSize);		// dfdTotalSize.
+
+		m_writeU32(buff, 0);					// vendorId (KHR) / descriptorType (basic).
+		m_writeU16(buff, 2);					// versionNumber.
+		m_writeU16(buff, blockSize);			// descriptorBlockSize.
+
+		m_writeU8(buff, useBC3 ? KTX2_DF_MODEL_BC3 : KTX2_DF_MODEL_BC1A);		// colorModel.
+		m_writeU8(buff, 1);						// colorPrimaries (BT709).
+		m_writeU8(buff, useSRGB ? 2 : 1);		// transferFunction (sRGB or linear).
+		m_writeU8(buff, 0);						// flags (alpha straight).
+
+		m_writeU8(buff, 3);						// texelBlockDimension (4x4).
+		m_writeU8(buff, 3);
+		m_writeU8(buff, 0);
+		m_writeU8(buff, 0);
+		m_writeU8(buff, useBC3 ? 16 : 8);		// bytesPlane0.
+		for (int i = 1; i < 8; ++i) m_writeU8(buff, 0);
+
+		// アルファ(BC3のみ)/カラーのサンプル情報.
+		for (int i = 0; i < samplesCount; ++i) {
+			const bool alphaF = (useBC3 && i == 0);
+			unsigned int channelType = alphaF ? 15 : 0;
+			if (alphaF && useSRGB) channelType |= 0x10;		// アルファはリニア.
+
+			m_writeU16(buff, i * 64);			// bitOffset.
+			m_writeU8(buff, 63);				// bitLength - 1.
+			m_writeU8(buff, channelType);
+			for (int j = 0; j < 4; ++j) m_writeU8(buff, 0);		// samplePosition.
+			m_writeU32(buff, 0);				// sampleLower.
+			m_writeU32(buff, 0xffffffff);		// sampleUpper.
+		}
+	}
+
+	/**
+	 * sRGBの8bit値からリニアへの変換テーブル.
+	 */
+	const float* m_getSRGBToLinearTable () {
+		static const std::vector<float> table = [] {
+			std::vector<float> t(256);
+			for (int i = 0; i < 256; ++i) {
+				const float v = (float)i / 255.0f;
+				t[i] = (v <= 0.04045f) ? (v / 12.92f) : std::pow((v + 0.055f) / 1.055f, 2.4f);
+			}
+			return t;
+		}();
+		return &(table[0]);
+	}
+
+	/**
+	 * リニアの値をsRGBの8bit値に変換.
+	 */
+	inline unsigned char m_linearToSRGB8 (const float v) {
+		const float v2 = std::max(0.0f, std::min(1.0f, v));
+		const float s = (v2 <= 0.0031308f) ? (v2 * 12.92f) : (1.055f * std::pow(v2, 1.0f / 2.4f) - 0.055f);
+		return (unsigned char)std::min(255.0f, s * 255.0f + 0.5f);
+	}
+
+	/**
+	 * ミップマップの1つ下の段を作成 (2x2の平均).
+	 * アルファを乗算してから平均し、透明なピクセルの色が混ざらないようにする.
+	 * sRGBの場合は、リニアに変換してから平均する.
+	 */
+	void m_downsampleHalf (const std::vector<unsigned char>& srcBuff, const int srcWidth, const int srcHeight, std::vector<unsigned char>& dstBuff, const int dstWidth, const int dstHeight, const bool useSRGB) {
+		dstBuff.resize((size_t)dstWidth * (size_t)dstHeight * 4);
+		const float* toLinear = m_getSRGBToLinearTable();
+
+		ImageUtil::parallelFor(dstHeight, [&](const int yStart, const int yEnd) {
+			for (int y = yStart; y < yEnd; ++y) {
+				const int sy0 = std::min(y * 2, srcHeight - 1);
+				const int sy1 = std::min(y * 2 + 1, srcHeight - 1);
+				for (int x = 0; x < dstWidth; ++x) {
+					const int sx0 = std::min(x * 2, srcWidth - 1);
+					const int sx1 = std::min(x * 2 + 1, srcWidth - 1);
+					const size_t srcIndices[] = {
+						((size_t)sy0 * srcWidth + sx0) * 4, ((size_t)sy0 * srcWidth + sx1) * 4,
+						((size_t)sy1 * srcWidth + sx0) * 4, ((size_t)sy1 * srcWidth + sx1) * 4};
+
+					float col[3] = {0.0f, 0.0f, 0.0f};
+					float alphaSum = 0.0f;
+					for (int i = 0; i < 4; ++i) {
+						const unsigned char* pS = &(srcBuff[srcIndices[i]]);
+						const float a = (float)pS[3] / 255.0f;
+						for (int j = 0; j < 3; ++j) col[j] += (useSRGB ? toLinear[pS[j]] : ((float)pS[j] / 255.0f)) * a;
+						alphaSum += a;
+					}
+
+					unsigned char* pD = &(dstBuff[((size_t)y * dstWidth + x) * 4]);
+					for (int j = 0; j < 3; ++j) {
+						const float v = (alphaSum > 0.0f) ? (col[j] / alphaSum) : 0.0f;
+						pD[j] = useSRGB ? m_linearToSRGB8(v) : (unsigned char)std::max(0.0f, std::min(255.0f, v * 255.0f + 0.5f));
+					}
+					pD[3] = (unsigned char)std::min(255.0f, alphaSum * (255.0f / 4.0f) + 0.5f);
+				}
+			}
+		});
+	}
+
+	/**
+	 * RGB565に変換.
+	 */
+	inline unsigned int m_toRGB565 (const float r, const float g, const float b) {
+		const int r5 = std::max(0, std::min(31, (int)(r * (31.0f / 255.0f) + 0.5f)));
+		const int g6 = std::max(0, std::min(63, (int)(g * (63.0f / 255.0f) + 0.5f)));
+		const int b5 = std::max(0, std::min(31, (int)(b * (31.0f / 255.0f) + 0.5f)));
+		return (unsigned int)((r5 << 11) | (g6 << 5) | b5);
+	}
+
+	/**
+	 * RGB565を8bitのRGBに展開.
+	 */
+	inline void m_fromRGB565 (const unsigned int c, int* rgb) {
+		const int r5 = (c >> 11) & 31;
+		const int g6 = (c >> 5) & 63;
+		const int b5 = c & 31;
+		rgb[0] = (r5 << 3) | (r5 >> 2);
+		rgb[1] = (g6 << 2) | (g6 >> 4);
+		rgb[2] = (b5 << 3) | (b5 >> 2);
+	}
+
+	/**
+	 * 4x4ピクセルのカラーをBC1のブロック(8バイト)に圧縮.
+	 * 色の分布の主軸上で両端の色を求め、4色のパレットから最も近い色のインデックスを選ぶ.
+	 * @param[in]  block  4x4ピクセルのRGBA.
+	 * @param[out] pDst   出力先 (8バイト).
+	 */
+	void m_encodeBC1Color (const unsigned char* block, unsigned char* pDst) {
+		// 平均と共分散.
+		float mean[3] = {0.0f, 0.0f, 0.0f};
+		for (int i = 0; i < 16; ++i) {
+			for (int j = 0; j < 3; ++j) mean[j] += (float)block[i * 4 + j];
+		}
+		for (int j = 0; j < 3; ++j) mean[j] /= 16.0f;
+
+		float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+		for (int i = 0; i < 16; ++i) {
+			const float r = (float)block[i * 4 + 0] - mean[0];
+			const float g = (float)block[i * 4 + 1] - mean[1];
+			const float b = (float)block[i * 4 + 2] - mean[2];
+			cov[0] += r * r;
+			cov[1] += r * g;
+			cov[2] += r * b;
+			cov[3] += g * g;
+			cov[4] += g * b;
+			cov[5] += b * b;
+		}
+
+		// べき乗法で主軸を求める.
+		float axis[3] = {1.0f, 1.0f, 1.0f};
+		for (int loop = 0; loop < 8; ++loop) {
+			const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+			const float len = std::max(std::abs(x), std::max(std::abs(y), std::abs(z)));
+			if (len <= 1e-6f) break;
+			axis[0] = x / len;
+			axis[1] = y / len;
+			axis[2] = z / len;
+		}
+
+		// 主軸上の最小/最大の位置から両端の色を求める (量子化誤差を考慮して少し内側にする).
+		float tMin = 0.0f, tMax = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			float t = 0.0f;
+			for (int j = 0; j < 3; ++j) t += ((float)block[i * 4 + j] - mean[j]) * axis[j];
+			if (i == 0 || t < tMin) tMin = t;
+			if (i == 0 || t > tMax) tMax = t;
+		}
+		const float axisLen2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		if (axisLen2 > 0.0f) {
+			const float inset = (tMax - tMin) / 16.0f;
+			tMin = (tMin + inset) / axisLen2;
+			tMax = (tMax - inset) / axisLen2;
+		}
+		unsigned int c0 = m_toRGB565(mean[0] + axis[0] * tMax, mean[1] + axis[1] * tMax, mean[2] + axis[2] * tMax);
+		unsigned int c1 = m_toRGB565(mean[0] + axis[0] * tMin, mean[1] + axis[1] * tMin, mean[2] + axis[2] * tMin);
+
+		// c0 > c1の場合に4色のパレットとなる.
+		if (c0 < c1) std::swap(c0, c1);
+
+		unsigned int indices = 0;
+		if (c0 != c1) {
+			int palette[4][3];
+			m_fromRGB565(c0, palette[0]);
+			m_fromRGB565(c1, palette[1]);
+			for (int j = 0; j < 3; ++j) {
+				palette[2][j] = (2 * palette[0][j] + palette[1][j] + 1) / 3;
+				palette[3][j] = (palette[0][j] + 2 * palette[1][j] + 1) / 3;
+			}
+			for (int i = 0; i < 16; ++i) {
+				int bestIndex = 0;
+				int bestDist  = 0;
+				for (int k = 0; k < 4; ++k) {
+					int dist = 0;
+					for (int j = 0; j < 3; ++j) {
+						const int d = (int)block[i * 4 + j] - palette[k][j];
+						dist += d * d;
+					}
+					if (k == 0 || dist < bestDist) {
+						bestIndex = k;
+						bestDist  = dist;
+					}
+				}
+				indices |= (unsigned int)bestIndex << (i * 2);
+			}
+		}
+
+		pDst[0] = (unsigned char)(c0 & 0xff);
+		pDst[1] = (unsigned char)((c0 >> 8) & 0xff);
+		pDst[2] = (unsigned char)(c1 & 0xff);
+		pDst[3] = (unsigned char)((c1 >> 8) & 0xff);
+		for (int i = 0; i < 4; ++i) pDst[4 + i] = (unsigned char)((indices >> (i * 8)) & 0xff);
+	}
+
+	/**
+	 * 4x4ピクセルのアルファをBC3のアルファブロック(8バイト)に圧縮.
+	 * 最大値と最小値を両端とした8段階のパレットから、最も近い値のインデックスを選ぶ.
+	 * @param[in]  block  4x4ピクセルのRGBA.
+	 * @param[out] pDst   出力先 (8バイト).
+	 */
+	void m_encodeBC3Alpha (const unsigned char* block, unsigned char* pDst) {
+		int a0 = block[3];
+		int a1 = block[3];
+		for (int i = 1; i < 16; ++i) {
+			a0 = std::max(a0, (int)block[i * 4 + 3]);
+			a1 = std::min(a1, (int)block[i * 4 + 3]);
+		}
+
+		unsigned long long indices = 0;
+		if (a0 != a1) {
+			// a0 > a1の場合、インデックス0がa0、1がa1、2-7がその間を7等分した値となる.
+			int palette[8];
+			palette[0] = a0;
+			palette[1] = a1;
+			for (int k = 1; k < 7; ++k) palette[k + 1] = ((7 - k) * a0 + k * a1 + 3) / 7;
+
+			for (int i = 0; i < 16; ++i) {
+				const int a = block[i * 4 + 3];
+				int bestIndex = 0;
+				for (int k = 1; k < 8; ++k) {
+					if (std::abs(a - palette[k]) < std::abs(a - palette[bestIndex])) bestIndex = k;
+				}
+				indices |= (unsigned long long)bestIndex << (i * 3);
+			}
+		}
+
+		pDst[0] = (unsigned char)a0;
+		pDst[1] = (unsigned char)a1;
+		for (int i = 0; i < 6; ++i) pDst[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xff);
+	}
+
+	/**
+	 * RGBA(8bit)のピクセルをBC1またはBC3で圧縮.
+	 * 4の倍数でない端のブロックは、端のピクセルを繰り返して埋める.
+	 * @param[in]  rgbaBuff  ピクセル (width x height x 4).
+	 * @param[in]  useBC3    アルファを含めてBC3で圧縮する場合はtrue.
+	 * @param[out] dstBuff   圧縮したデータが返る.
+	 */
+	void m_compressBC (const std::vector<unsigned char>& rgbaBuff, const int width, const int height, const bool useBC3, std::vector<unsigned char>& dstBuff) {
+		const int blocksX = (width + 3) / 4;
+		const int blocksY = (height + 3) / 4;
+		const size_t blockBytes = useBC3 ? 16 : 8;
+		dstBuff.resize((size_t)blocksX * (size_t)blocksY * blockBytes);
+
+		ImageUtil::parallelFor(blocksY, [&](const int byStart, const int byEnd) {
+			unsigned char block[16 * 4];
+			for (int by = byStart; by < byEnd; ++by) {
+				for (int bx = 0; bx < blocksX; ++bx) {
+					for (int y = 0; y < 4; ++y) {
+						const int sy = std::min(by * 4 + y, height - 1);
+						for (int x = 0; x < 4; ++x) {
+							const int sx = std::min(bx * 4 + x, width - 1);
+							const unsigned char* pS = &(rgbaBuff[((size_t)sy * width + sx) * 4]);
+							for (int j = 0; j < 4; ++j) block[(y * 4 + x) * 4 + j] = pS[j];
+						}
+					}
+					unsigned char* pD = &(dstBuff[((size_t)by * blocksX + bx) * blockBytes]);
+					if (useBC3) {
+						m_encodeBC3Alpha(block, pD);
+						m_encodeBC1Color(block, pD + 8);
+					} else {
+						m_encodeBC1Color(block, pD);
+					}
+				}
+			}
+		});
+	}
+
+	/**
+	 * Key/Valueのデータを追加.
+	 */
+	void m_writeKeyValue (std::vector<unsigned char>& buff, const std::string& key, const std::string& value) {
+		const unsigned int len = (unsigned int)(key.length() + 1 + value.length() + 1);
+		m_writeU32(buff, len);
+		for (size_t i = 0; i < key.length(); ++i) buff.push_back((unsigned char)key[i]);
+		buff.push_back(0);
+		for (size_t i = 0; i < value.length(); ++i) buff.push_back((unsigned char)value[i]);
+		buff.push_back(0);
+		while ((buff.size() & 3) != 0) buff.push_back(0);
+	}
+}
+
+/**
+ * ミップマップの段数を計算.
+ */
+int KTX2Writer::calcMipLevelsCount (const int width, const int height)
+{
+	int count = 1;
+	int size = std::max(width, height);
+	while (size > 1) {
+		size >>= 1;
+		count++;
+	}
+	return count;
+}
+
+/**
+ * RGBA(8bit)のピクセルバッファをKTX2ファイルとして保存.
+ */
+bool KTX2Writer::saveRGBA8 (const std::string& fileName, const std::vector<unsigned char>& rgbaBuff, const int width, const int height, const bool useSRGB, const bool useMipmap)
+{
+	try {
+		std::vector<unsigned char> buff;
+		if (!encodeRGBA8(rgbaBuff, width, height, buff, useSRGB, useMipmap)) return false;
+
+		std::ofstream outStream(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!outStream) return false;
+		outStream.write((const char *)&(buff[0]), buff.size());
+		outStream.close();
+		return !outStream.fail();
+	} catch (...) { }
+	return false;
+}
+
+/**
+ * RGBA(8bit)のピクセルバッファをKTX2としてメモリ上にエンコード.
+ */
+bool KTX2Writer::encodeRGBA8 (const std::vector<unsigned char>& rgbaBuff, const int width, const int height, std::vector<unsigned char>& ktx2Buff, const bool useSRGB, const bool useMipmap)
+{
+	ktx2Buff.clear();
+	if (width <= 0 || height <= 0) return false;
+	if (rgbaBuff.size() < (size_t)width * (size_t)height * 4) return false;
+
+	try {
+		// 不透明の場合はBC1、アルファを含む場合はBC3で圧縮する.
+		bool useBC3 = false;
+		for (size_t i = 0, pixelsCount = (size_t)width * (size_t)height; i < pixelsCount; ++i) {
+			if (rgbaBuff[i * 4 + 3] != 255) {
+				useBC3 = true;
+				break;
+			}
+		}
+
+		// ミップマップを作成し、段ごとに圧縮.
+		// 1つ前の段から1/2に縮小していく.
+		const int levelsCount = useMipmap ? calcMipLevelsCount(width, height) : 1;
+		std::vector< std::vector<unsigned char> > levelBuffs(levelsCount);
+		std::vector<int> mipWidths(levelsCount), mipHeights(levelsCount);
+		mipWidths[0]  = width;
+		mipHeights[0] = height;
+		m_compressBC(rgbaBuff, width, height, useBC3, levelBuffs[0]);
+		{
+			std::vector<unsigned char> prevBuff, mipBuff;
+			for (int level = 1; level < levelsCount; ++level) {
+				mipWidths[level]  = std::max(1, mipWidths[level - 1] >> 1);
+				mipHeights[level] = std::max(1, mipHeights[level - 1] >> 1);
+				m_downsampleHalf((level == 1) ? rgbaBuff : prevBuff, mipWidths[level - 1], mipHeights[level - 1], mipBuff, mipWidths[level], mipHeights[level], useSRGB);
+				m_compressBC(mipBuff, mipWidths[level], mipHeights[level], useBC3, levelBuffs[level]);
+				prevBuff.swap(mipBuff);
+			}
+		}
+
+		// ヘッダ以外のブロックを作成.
+		std::vector<unsigned char> dfdBuff, kvdBuff;
+		m_writeDFD(dfdBuff, useSRGB, useBC3);
+		m_writeKeyValue(kvdBuff, "KTXorientation", "rd");
+		m_writeKeyValue(kvdBuff, "KTXwriter", "USD Exporter for Shade3D");
+
+		const size_t headerSize     = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+		const size_t levelIndexSize = (size_t)levelsCount * 3 * 8;
+		const size_t dfdOffset      = headerSize + levelIndexSize;
+		const size_t kvdOffset      = dfdOffset + dfdBuff.size();
+		size_t dataOffset           = kvdOffset + kvdBuff.size();
+		dataOffset = (dataOffset + 15) & ~((size_t)15);		// ブロックサイズ(8/16バイト)に揃える.
+
+		// ミップマップは小さいものから順に格納する.
+		std::vector<unsigned long long> levelOffsets(levelsCount), levelSizes(levelsCount);
+		{
+			size_t offset = dataOffset;
+			for (int level = levelsCount - 1; level >= 0; --level) {
+				levelOffsets[level] = offset;
+				levelSizes[level]   = (unsigned long long)levelBuffs[level].size();
+				offset += (size_t)levelSizes[level];
+			}
+		}
+
+		std::vector<unsigned char> headerBuff;
+		{
+			const unsigned char identifier[] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+			for (int i = 0; i < 12; ++i) headerBuff.push_back(identifier[i]);
+
+			if (useBC3) {
+				m_writeU32(headerBuff, useSRGB ? KTX2_VK_FORMAT_BC3_SRGB_BLOCK : KTX2_VK_FORMAT_BC3_UNORM_BLOCK);
+			} else {
+				m_writeU32(headerBuff, useSRGB ? KTX2_VK_FORMAT_BC1_RGB_SRGB_BLOCK : KTX2_VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+			}
+			m_writeU32(headerBuff, 1);				// typeSize.
+			m_writeU32(headerBuff, width);
+			m_writeU32(headerBuff, height);
+			m_writeU32(headerBuff, 0);				// pixelDepth.
+			m_writeU32(headerBuff, 0);				// layerCount.
+			m_writeU32(headerBuff, 1);				// faceCount.
+			m_writeU32(headerBuff, levelsCount);
+			m_writeU32(headerBuff, 0);				// supercompressionScheme (none).
+
+			m_writeU32(headerBuff, (unsigned int)dfdOffset);
+			m_writeU32(headerBuff, (unsigned int)dfdBuff.size());
+			m_writeU32(headerBuff, (unsigned int)kvdOffset);
+			m_writeU32(headerBuff, (unsigned int)kvdBuff.size());
+			m_writeU64(headerBuff, 0);				// sgdByteOffset.
+			m_writeU64(headerBuff, 0);				// sgdByteLength.
+
+			for (int level = 0; level < levelsCount; ++level) {
+				m_writeU64(headerBuff, levelOffsets[level]);
+				m_writeU64(headerBuff, levelSizes[level]);
+				m_writeU64(headerBuff, levelSizes[level]);
+			}
+		}
+		headerBuff.insert(headerBuff.end(), dfdBuff.begin(), dfdBuff.end());
+		headerBuff.insert(headerBuff.end(), kvdBuff.begin(), kvdBuff.end());
+		while (headerBuff.size() < dataOffset) headerBuff.push_back(0);
+
+		ktx2Buff.swap(headerBuff);
+		for (int level = levelsCount - 1; level >= 0; --level) {
+			ktx2Buff.insert(ktx2Buff.end(), levelBuffs[level].begin(), levelBuffs[level].end());
+		}
+		return true;
+
+	} catch (...) { }
+	ktx2Buff.clear();
+	return false;
+}
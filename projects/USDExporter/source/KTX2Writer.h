@@ -0,0 +1,43 @@
+﻿/**
+ * KTX2形式でのテクスチャ出力.
+ * ミップマップを含め、不透明の場合はBC1、アルファを含む場合はBC3でブロック圧縮したKTX2ファイルを出力する.
+ * sRGBの場合、ミップマップはリニアに変換してから縮小する.
+ */
+
+#ifndef _KTX2WRITER_H
+#define _KTX2WRITER_H
+
+#include <string>
+#include <vector>
+
+namespace KTX2Writer
+{
+	/**
+	 * RGBA(8bit)のピクセルバッファをKTX2ファイルとして保存.
+	 * @param[in] fileName   出力ファイル名.
+	 * @param[in] rgbaBuff   ピクセル (width x height x 4).
+	 * @param[in] width      幅.
+	 * @param[in] height     高さ.
+	 * @param[in] useSRGB    sRGBとして格納する場合はtrue.
+	 * @param[in] useMipmap  ミップマップを生成する場合はtrue.
+	 */
+	bool saveRGBA8 (const std::string& fileName, const std::vector<unsigned char>& rgbaBuff, const int width, const int height, const bool useSRGB = false, const bool useMipmap = true);
+
+	/**
+	 * RGBA(8bit)のピクセルバッファをKTX2としてメモリ上にエンコード.
+	 * @param[in]  rgbaBuff   ピクセル (width x height x 4).
+	 * @param[in]  width      幅.
+	 * @param[in]  height     高さ.
+	 * @param[out] ktx2Buff   ktx2ファイルのデータが返る.
+	 * @param[in]  useSRGB    sRGBとして格納する場合はtrue.
+	 * @param[in]  useMipmap  ミップマップを生成する場合はtrue.
+	 */
+	bool encodeRGBA8 (const std::vector<unsigned char>& rgbaBuff, const int width, const int height, std::vector<unsigned char>& ktx2Buff, const bool useSRGB = false, const bool useMipmap = true);
+
+	/**
+	 * ミップマップの段数を計算.
+	 */
+	int calcMipLevelsCount (const int width, const int height);
+}
+
+#endif
@@ -3,6 +3,9 @@
  */
 #include "MaterialData.h"
 #include "MathUtil.h"
+#include "HashUtil.h"
+
+#include <cmath>
 
 //------------------------------------------------------------------.
 CTextureMappingData::CTextureMappingData ()
@@ -120,7 +123,7 @@ bool CMaterialData::isSame (const CMaterialData& mDat) const
 	if (!MathUtil::isZero(alphaModeParam.alphaCutoff - mDat.alphaModeParam.alphaCutoff)) return false;
 
 	if (useTransparency != mDat.useTransparency) return false;
-	if (!MathUtil::isZero(useTransparency - mDat.useTransparency)) return false;
+	if (!MathUtil::isZero(transparency - mDat.transparency)) return false;
 	if (!MathUtil::isZero(transparencyColor[0] - mDat.transparencyColor[0])) return false;
 	if (!MathUtil::isZero(transparencyColor[1] - mDat.transparencyColor[1])) return false;
 	if (!MathUtil::isZero(transparencyColor[2] - mDat.transparencyColor[2])) return false;
@@ -132,3 +135,78 @@ bool CMaterialData::isSame (const CMaterialData& mDat) const
 
 	return true;
 }
+
+/**
+ * パラメータのハッシュ値を計算 (同一パラメータのマテリアルの検索用).
+ * floatはisSameの許容誤差の単位で量子化する.
+ * 量子化の境界をまたぐ場合は同じ値にならないが、ハッシュ値が一致した後にisSameで比較するため誤って統合されることはない.
+ */
+unsigned long long CMaterialData::getHash () const
+{
+	std::vector<int> values;
+	auto pushFloat = [&](const float v) {
+		values.push_back((int)std::floor(v * 1000.0f + 0.5f));
+	};
+	auto pushTexture = [&](const CTextureMappingData& tmDat) {
+		values.push_back((int)tmDat.textureSource);
+		values.push_back(tmDat.textureParam.uvLayerIndex);
+		values.push_back(tmDat.textureParam.repeatU);
+		values.push_back(tmDat.textureParam.repeatV);
+		values.push_back(tmDat.textureParam.wrapRepeat ? 1 : 0);
+		values.push_back(tmDat.textureParam.imageIndex);
+	};
+
+	for (int i = 0; i < 3; ++i) pushFloat(diffuseColor[i]);
+	for (int i = 0; i < 3; ++i) pushFloat(emissiveColor[i]);
+	pushFloat(roughness);
+	pushFloat(metallic);
+	pushFloat(ior);
+	pushFloat(opacity);
+	values.push_back(useDiffuseAlpha ? 1 : 0);
+	values.push_back(doubleSided ? 1 : 0);
+	values.push_back(unlitMode ? 1 : 0);
+
+	pushTexture(diffuseTexture);
+	pushTexture(normalTexture);
+	pushTexture(roughnessTexture);
+	pushTexture(metallicTexture);
+	pushTexture(emissiveTexture);
+	pushTexture(occlusionTexture);
+	pushTexture(opacityTexture);
+
+	values.push_back((int)alphaModeParam.alphaModeType);
+	pushFloat(alphaModeParam.alphaCutoff);
+
+	values.push_back(useTransparency ? 1 : 0);
+	pushFloat(transparency);
+	for (int i = 0; i < 3; ++i) pushFloat(transparencyColor[i]);
+	pushTexture(transparencyTexture);
+
+	pushFloat(normalStrength);
+	values.push_back(glassThin ? 1 : 0);
+	pushFloat(emissiveIntensity);
+
+	return HashUtil::calcFNV1a64(&(values[0]), sizeof(int) * values.size());
+}
+
+/**
+ * Occlusion/Roughness/MetallicのテクスチャがR/G/Bにまとめられた1枚のテクスチャ(ORM)を参照しているか.
+ * 2つ以上が同一のイメージを参照し、それぞれR(Occlusion)/G(Roughness)/B(Metallic)を採用している場合にtrueを返す.
+ */
+bool CMaterialData::usePackedORMTexture () const
+{
+	const CTextureMappingData* texMappingsList[] = {&occlusionTexture, &roughnessTexture, &metallicTexture};
+	const USD_DATA::TEXTURE_SOURE sourcesList[] = {USD_DATA::TEXTURE_SOURE::texture_source_r, USD_DATA::TEXTURE_SOURE::texture_source_g, USD_DATA::TEXTURE_SOURE::texture_source_b};
+
+	int imageIndex = -1;
+	int texCount = 0;
+	for (int i = 0; i < 3; ++i) {
+		const CTextureMappingData& texMappingD = *(texMappingsList[i]);
+		if (texMappingD.textureParam.imageIndex < 0) continue;
+		if (texMappingD.textureSource != sourcesList[i]) return false;
+		if (imageIndex >= 0 && imageIndex != texMappingD.textureParam.imageIndex) return false;
+		imageIndex = texMappingD.textureParam.imageIndex;
+		texCount++;
+	}
+	return (texCount >= 2);
+}
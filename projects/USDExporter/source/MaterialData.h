@@ -190,6 +190,17 @@ public:
 	 * 同じパラメータを持つか.
 	 */
 	bool isSame (const CMaterialData& mDat) const;
+
+	/**
+	 * パラメータのハッシュ値を計算 (同一パラメータのマテリアルの検索用).
+	 * isSameで比較する要素のみを使用する.
+	 */
+	unsigned long long getHash () const;
+
+	/**
+	 * Occlusion/Roughness/MetallicのテクスチャがR/G/Bにまとめられた1枚のテクスチャ(ORM)を参照しているか.
+	 */
+	bool usePackedORMTexture () const;
 };
 
 #endif
@@ -7,9 +7,15 @@
 #include "StringUtil.h"
 #include "StreamCtrl.h"
 #include "MathUtil.h"
+#include "ImageUtil.h"
 #include "ImagesBlend.h"
 #include "OcclusionShaderData.h"
 #include "DOKIMaterialParam.h"
+#include "HashUtil.h"
+
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
 
 /*
 	＜＜ Memo ＞＞
@@ -30,6 +36,30 @@
 
 #define MATERIAL_ROOT_PATH  "/root/Materials"
 
+namespace {
+	/**
+	 * 1ライン分のピクセルにfactorを乗算 (RGBA).
+	 */
+	void m_applyFactor (const std::vector<sx::rgba8_class>& lineBuff, const sxsdk::rgb_class& factor, std::vector<unsigned char>& rgbaLine) {
+		const int width = (int)lineBuff.size();
+		rgbaLine.resize(width * 4);
+		for (int x = 0, iPos = 0; x < width; ++x, iPos += 4) {
+			rgbaLine[iPos + 0] = (unsigned char)((float)lineBuff[x].red * factor.red);
+			rgbaLine[iPos + 1] = (unsigned char)((float)lineBuff[x].green * factor.green);
+			rgbaLine[iPos + 2] = (unsigned char)((float)lineBuff[x].blue * factor.blue);
+			rgbaLine[iPos + 3] = lineBuff[x].alpha;
+		}
+	}
+
+	/**
+	 * ハッシュ値を計算 (FNV-1a 64bit).
+	 */
+	unsigned long long m_calcHash (unsigned long long hash, const std::vector<unsigned char>& buff) {
+		if (buff.empty()) return hash;
+		return HashUtil::calcFNV1a64(&(buff[0]), buff.size(), hash);
+	}
+}
+
 //------------------------------------------------------------------.
 CImageRefData::CImageRefData ()
 {
@@ -49,6 +79,7 @@ void CImageRefData::clear ()
 //------------------------------------------------------------------.
 CCheckImageRef::CCheckImageRef ()
 {
+	m_pImageCache = NULL;
 	clear();
 }
 
@@ -60,10 +91,11 @@ void CCheckImageRef::clear ()
 /**
  * シーンを走査し、マスターイメージの参照情報を取得.
  */
-void CCheckImageRef::checkMasterImages (sxsdk::scene_interface* scene)
+void CCheckImageRef::checkMasterImages (sxsdk::scene_interface* scene, CDecodedImageCache* imageCache)
 {
 	clear();
 	m_pScene = scene;
+	m_pImageCache = imageCache;
 
 	sxsdk::shape_class* pRootShape = &(scene->get_shape());
 	m_checkMasterImages(pRootShape);
@@ -148,7 +180,7 @@ void CCheckImageRef::m_checkMappingInSurface (sxsdk::surface_class* surface)
 		try {
 			compointer<sxsdk::image_interface> image(mappingLayer.get_image_interface());
 			if (image && image->has_image()) {
-				sxsdk::master_image_class* masterImage = Shade3DUtil::getMasterImageFromImage(m_pScene, image);
+				sxsdk::master_image_class* masterImage = m_pImageCache ? m_pImageCache->findMasterImage(image) : Shade3DUtil::getMasterImageFromImage(m_pScene, image);
 				if (masterImage) {
 					void* imgHandle = masterImage->get_handle();
 
@@ -202,25 +234,108 @@ bool CCheckImageRef::isNoProcessingImage (sxsdk::master_image_class* masterImage
 }
 
 //------------------------------------------------------------------.
-CMaterialTextureBake::CMaterialTextureBake (sxsdk::scene_interface* scene, const CExportParam& exportParam)
+CMaterialTextureBake::CMaterialTextureBake (sxsdk::scene_interface* scene, const CExportParam& exportParam, const std::string& spillPath) : m_imageCache(scene)
 {
 	m_pScene = scene;
 	m_exportParam = exportParam;
-	m_checkImageRef.checkMasterImages(m_pScene);
+	m_spillPath = spillPath;
+	m_checkImageRef.checkMasterImages(m_pScene, &m_imageCache);
 
 	clear();
 }
 
 CMaterialTextureBake::~CMaterialTextureBake ()
 {
+	m_removeSpillFiles();
 }
 
 void CMaterialTextureBake::clear ()
 {
+	m_removeSpillFiles();
 	m_imagesList.clear();
+	m_masterImageIndices.clear();
 	m_findImageFileNames.clear();
 }
 
+/**
+ * ベイクしたピクセルを格納していた一時ファイルを削除.
+ */
+void CMaterialTextureBake::m_removeSpillFiles ()
+{
+	for (size_t i = 0; i < m_imagesList.size(); ++i) {
+		CImageData& imageD = m_imagesList[i];
+		if (imageD.spillFileName == "") continue;
+		std::remove(imageD.spillFileName.c_str());
+		imageD.spillFileName = "";
+	}
+}
+
+/**
+ * ベイク済みのイメージを追加.
+ * @param[in] imageData  追加するイメージ (fileNameは拡張子を含む名前).
+ * @return イメージ番号.
+ */
+int CMaterialTextureBake::appendImage (const CImageData& imageData)
+{
+	const int imageIndex = (int)m_imagesList.size();
+	m_imagesList.push_back(imageData);
+	m_imagesList[imageIndex].fileName = m_findImageFileNames.appendName(imageData.fileName, USD_DATA::NODE_TYPE::texture_node, true);
+	return imageIndex;
+}
+
+/**
+ * CPUでベイクしたグレイスケールのピクセルを、テクスチャとして格納.
+ * @param[in]  mappingType     マッピングの種類.
+ * @param[in]  materialName    マテリアル名.
+ * @param[in]  grayBuff        ピクセル (width x height).
+ * @param[in]  width           幅.
+ * @param[in]  height          高さ.
+ * @param[out] texMappingData  マッピング情報の格納先.
+ * @return イメージ番号.
+ */
+int CMaterialTextureBake::storeGrayscaleImage (const sxsdk::enums::mapping_type mappingType, const std::string& materialName, const std::vector<unsigned char>& grayBuff, const int width, const int height, CTextureMappingData& texMappingData)
+{
+	if (width <= 0 || height <= 0 || grayBuff.size() < (size_t)width * (size_t)height) return -1;
+
+	int imageIndex = -1;
+	try {
+		compointer<sxsdk::image_interface> image(m_pScene->create_image_interface(sx::vec<int,2>(width, height)));
+		if (!image) return -1;
+		std::vector<sx::rgba8_class> lineBuff(width);
+		size_t iPos = 0;
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x, ++iPos) {
+				const unsigned char v = grayBuff[iPos];
+				lineBuff[x].red   = v;
+				lineBuff[x].green = v;
+				lineBuff[x].blue  = v;
+				lineBuff[x].alpha = 255;
+			}
+			image->set_pixels_rgba(0, y, width, 1, &(lineBuff[0]));
+		}
+		image->update();
+
+		std::string masterImageName;
+		imageIndex = m_storeCustomImage(mappingType, USD_DATA::IMAGE_FORMAT_TYPE::image_format_none, materialName, image, sxsdk::rgb_class(1, 1, 1), texMappingData, masterImageName);
+	} catch (...) { }
+
+	return imageIndex;
+}
+
+/**
+ * 参照されなくなったイメージを、出力しないようにする.
+ * @param[in] imageIndex  イメージ番号.
+ */
+void CMaterialTextureBake::releaseImage (const int imageIndex)
+{
+	if (imageIndex < 0 || imageIndex >= (int)m_imagesList.size()) return;
+	CImageData& imageD = m_imagesList[imageIndex];
+	if (imageD.spillFileName != "") std::remove(imageD.spillFileName.c_str());
+	imageD.spillFileName = "";
+	imageD.fileName = "";
+	std::vector<unsigned char>().swap(imageD.pixelsBuff);
+}
+
 /**
  * 指定の形状でマテリアルを取得.
  * @param[in]  shape         対象の形状.
@@ -393,7 +508,7 @@ void CMaterialTextureBake::m_setTextureMappingData (sxsdk::mapping_layer_class&
 		if (!image->has_image()) return;
 
 		// imageからマスターイメージを取得.
-		sxsdk::master_image_class* masterImage = Shade3DUtil::getMasterImageFromImage(m_pScene, image);
+		sxsdk::master_image_class* masterImage = m_imageCache.findMasterImage(image);
 		if (!masterImage) return;
 
 		std::string masterImageName = "";
@@ -455,7 +570,7 @@ void CMaterialTextureBake::m_setTextureMappingData (sxsdk::mapping_layer_class&
 					// 拡張子がある場合はそれを採用し、ない場合はpngにする.
 					masterImageName = StringUtil::SetFileImageExtension(masterImageName, "png");
 				} else {
-					const bool usePng = (m_exportParam.optTextureType == USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_png);
+					const bool usePng = (m_exportParam.optTextureType != USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_jpeg);		// KTX2の場合もpngをフォールバック用として出力.
 					masterImageName = StringUtil::SetFileImageExtension(masterImageName, usePng ? "png" : "jpg", true);
 				}
 			}
@@ -473,6 +588,7 @@ void CMaterialTextureBake::m_setTextureMappingData (sxsdk::mapping_layer_class&
 			imageD.pMasterImageHandle = masterImage->get_handle();
 			imageD.fileName = masterImageName;
 			imageD.occlusionF = occlusionF;
+			m_appendMasterImageIndex(imageD.pMasterImageHandle, imageIndex);
 
 			texMappingData.textureParam.imageIndex = imageIndex;
 			texMappingData.textureParam.uvLayerIndex = mappingLayer.get_uv_mapping();
@@ -578,7 +694,7 @@ void CMaterialTextureBake::m_setTextureMappingOpacityData (sxsdk::mapping_layer_
 		if (!image->has_image()) return;
 
 		// imageからマスターイメージを取得.
-		sxsdk::master_image_class* masterImage = Shade3DUtil::getMasterImageFromImage(m_pScene, image);
+		sxsdk::master_image_class* masterImage = m_imageCache.findMasterImage(image);
 		if (!masterImage) return;
 
 		std::string masterImageName = "";
@@ -620,7 +736,7 @@ void CMaterialTextureBake::m_setTextureMappingOpacityData (sxsdk::mapping_layer_
 				// 拡張子がある場合はそれを採用し、ない場合はpngにする.
 				masterImageName = StringUtil::SetFileImageExtension(masterImageName, "png");
 			} else {
-				const bool usePng = (m_exportParam.optTextureType == USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_png);
+				const bool usePng = (m_exportParam.optTextureType != USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_jpeg);		// KTX2の場合もpngをフォールバック用として出力.
 				masterImageName = StringUtil::SetFileImageExtension(masterImageName, usePng ? "png" : "jpg", true);
 			}
 
@@ -636,6 +752,7 @@ void CMaterialTextureBake::m_setTextureMappingOpacityData (sxsdk::mapping_layer_
 			CImageData& imageD = m_imagesList[imageIndex];
 			imageD.pMasterImageHandle = masterImage->get_handle();
 			imageD.fileName = masterImageName;
+			m_appendMasterImageIndex(imageD.pMasterImageHandle, imageIndex);
 
 			texMappingData.textureParam.imageIndex = imageIndex;
 			texMappingData.textureParam.uvLayerIndex = diffuseMappingLayer.get_uv_mapping();
@@ -663,6 +780,8 @@ void CMaterialTextureBake::m_setTextureMappingOpacityData (sxsdk::mapping_layer_
 
 /**
  * 同一のマスターイメージがすでにimagesListに格納済みか.
+ * マスターイメージのハンドルで候補を絞り、その中でRGBA要素と変換情報を比較する.
+ * 格納後にtextureSource/texTransformが更新されることがあるため、これらは検索時に比較する.
  * @param[in]  masterImage     追加するMasterImage.
  * @param[in]  texTransform    マッピングの変換情報.
  * @param[in]  channelMix      mapping_layerのchanelMixの指定.
@@ -672,9 +791,13 @@ int CMaterialTextureBake::m_findMasterImageInImagesList (sxsdk::master_image_cla
 	if (!masterImage || m_imagesList.empty()) return -1;
 	void* mHandle = masterImage->get_handle();
 
+	std::unordered_map<void*, std::vector<int> >::const_iterator iter = m_masterImageIndices.find(mHandle);
+	if (iter == m_masterImageIndices.end()) return -1;
+	const std::vector<int>& indices = iter->second;
+
 	int retI = -1;
-	for (size_t i = 0; i < m_imagesList.size(); ++i) {
-		const CImageData& imageD = m_imagesList[i];
+	for (size_t i = 0; i < indices.size(); ++i) {
+		const CImageData& imageD = m_imagesList[indices[i]];
 
 		// 有効なRGBA要素をチェック.
 		bool chkF = false;
@@ -713,7 +836,7 @@ int CMaterialTextureBake::m_findMasterImageInImagesList (sxsdk::master_image_cla
 		if (!chkF) continue;
 
 		if (imageD.pMasterImageHandle == mHandle) {
-			retI = (int)i;
+			retI = indices[i];
 			break;
 		}
 	}
@@ -721,6 +844,18 @@ int CMaterialTextureBake::m_findMasterImageInImagesList (sxsdk::master_image_cla
 	return retI;
 }
 
+/**
+ * マスターイメージを参照するイメージ番号を、検索用に登録.
+ * イメージ番号は追加順のため、昇順に並ぶ (線形に検索した場合と同じものが見つかる).
+ */
+void CMaterialTextureBake::m_appendMasterImageIndex (void* pMasterImageHandle, const int imageIndex)
+{
+	if (!pMasterImageHandle) return;
+	std::vector<int>& indices = m_masterImageIndices[pMasterImageHandle];
+	if (std::find(indices.begin(), indices.end(), imageIndex) != indices.end()) return;
+	indices.push_back(imageIndex);
+}
+
 /**
  * マッピングレイヤで、複数テクスチャをベイク.
  * @param[in]  surface           表面材質クラス.
@@ -732,7 +867,7 @@ bool CMaterialTextureBake::m_getMaterialMultiMappingFromSurface (sxsdk::surface_
 	if (m_getMaterialDOKIFromSurface(surface, materialData)) return true;
 
 	// 複数テクスチャの合成クラス.
-	CImagesBlend imagesBlend(m_pScene, surface);
+	CImagesBlend imagesBlend(m_pScene, surface, &m_imageCache);
 	CImagesBlend::IMAGE_BAKE_RESULT blendResult = imagesBlend.blendImages(m_exportParam);
 
 	if (blendResult == CImagesBlend::bake_error_mixed_uv_layer) {
@@ -755,6 +890,9 @@ bool CMaterialTextureBake::m_getMaterialMultiMappingFromSurface (sxsdk::surface_
 	std::string materialName = StringUtil::getFileName(materialData.name);
 	if (!StringUtil::checkASCII(materialName)) materialName = "";
 
+	// Occlusion/Roughness/Metallicを1枚のテクスチャにまとめる場合.
+	const bool packORM = m_exportParam.texOptPackORM && m_storeORMImage(materialName, imagesBlend, materialData, masterImageName);
+
 	{
 		const sxsdk::enums::mapping_type iType = sxsdk::enums::diffuse_mapping;
 		const sxsdk::rgb_class factor = imagesBlend.getImageFactor(iType);
@@ -786,7 +924,7 @@ bool CMaterialTextureBake::m_getMaterialMultiMappingFromSurface (sxsdk::surface_
 
 	{
 		const sxsdk::enums::mapping_type iType = sxsdk::enums::reflection_mapping;
-		if (imagesBlend.hasImage(iType)) {
+		if (!packORM && imagesBlend.hasImage(iType)) {
 			const sxsdk::rgb_class factor = imagesBlend.getImageFactor(iType);
 
 			const USD_DATA::IMAGE_FORMAT_TYPE imgFormatType = imagesBlend.getImageFormatType(iType);
@@ -829,7 +967,7 @@ bool CMaterialTextureBake::m_getMaterialMultiMappingFromSurface (sxsdk::surface_
 
 	{
 		const sxsdk::enums::mapping_type iType = sxsdk::enums::roughness_mapping;
-		if (imagesBlend.hasImage(iType)) {
+		if (!packORM && imagesBlend.hasImage(iType)) {
 			const USD_DATA::IMAGE_FORMAT_TYPE imgFormatType = imagesBlend.getImageFormatType(iType);
 
 			const sxsdk::rgb_class factor = imagesBlend.getImageFactor(iType);
@@ -889,7 +1027,7 @@ bool CMaterialTextureBake::m_getMaterialMultiMappingFromSurface (sxsdk::surface_
 
 	{
 		const sxsdk::enums::mapping_type iType = MAPPING_TYPE_USD_OCCLUSION;
-		if (imagesBlend.hasImage(iType)) {
+		if (!packORM && imagesBlend.hasImage(iType)) {
 			const USD_DATA::IMAGE_FORMAT_TYPE imgFormatType = imagesBlend.getImageFormatType(iType);
 
 			const sxsdk::rgb_class factor(1.0f, 1.0f, 1.0f);
@@ -921,6 +1059,138 @@ bool CMaterialTextureBake::m_getMaterialMultiMappingFromSurface (sxsdk::surface_
 	return true;
 }
 
+/**
+ * Occlusion/Roughness/Metallicを1枚のテクスチャのR/G/Bにまとめて格納.
+ * 2つ以上のテクスチャが存在し、UV層と反復回数が同じ場合のみまとめる.
+ * 存在しない要素は、Occlusion/Roughnessは1.0、Metallicは0.0で埋める.
+ * @param[in]  materialName     マテリアル名.
+ * @param[in]  imagesBlend      ベイク済みのイメージ.
+ * @param[out] materialData     マテリアル情報の格納先.
+ * @param[out] masterImageName  USDでのマスターイメージ名が返る.
+ * @return まとめて格納した場合はtrue.
+ */
+bool CMaterialTextureBake::m_storeORMImage (const std::string& materialName, CImagesBlend& imagesBlend, CMaterialData& materialData, std::string& masterImageName)
+{
+	// OmniGlassではORMテクスチャを参照できないため、まとめない.
+	if (m_exportParam.useShaderMDL() && m_exportParam.separateOpacityAndTransmission) {
+		if (imagesBlend.getTransparency() > 0.0001f) return false;
+	}
+
+	const sxsdk::enums::mapping_type typesList[] = {MAPPING_TYPE_USD_OCCLUSION, sxsdk::enums::roughness_mapping, sxsdk::enums::reflection_mapping};
+	const USD_DATA::TEXTURE_SOURE sourcesList[] = {USD_DATA::TEXTURE_SOURE::texture_source_r, USD_DATA::TEXTURE_SOURE::texture_source_g, USD_DATA::TEXTURE_SOURE::texture_source_b};
+	CTextureMappingData* texMappingsList[] = {&(materialData.occlusionTexture), &(materialData.roughnessTexture), &(materialData.metallicTexture)};
+
+	// まとめることができるかチェックし、最大のサイズを取得.
+	int texCount = 0;
+	int uvLayerIndex = 0;
+	sx::vec<int,2> repeatV(1, 1);
+	int width  = 0;
+	int height = 0;
+	for (int i = 0; i < 3; ++i) {
+		if (!imagesBlend.hasImage(typesList[i])) continue;
+		sxsdk::image_interface* image = imagesBlend.getImage(typesList[i]);
+		if (!image) continue;
+
+		const int uvIndex = imagesBlend.getTexCoord(typesList[i]);
+		const sx::vec<int,2> rV = imagesBlend.getImageRepeat(typesList[i]);
+		if (texCount == 0) {
+			uvLayerIndex = uvIndex;
+			repeatV = rV;
+		} else {
+			if (uvLayerIndex != uvIndex || repeatV.x != rV.x || repeatV.y != rV.y) return false;
+		}
+		width  = std::max(width, image->get_size().x);
+		height = std::max(height, image->get_size().y);
+		texCount++;
+	}
+	if (texCount < 2 || width <= 0 || height <= 0) return false;
+
+	bool retF = false;
+	try {
+		// R/G/Bにそれぞれのテクスチャのグレイスケール値を格納.
+		std::vector<unsigned char> ormBuff((size_t)width * (size_t)height * 4);
+		for (size_t i = 0; i < ormBuff.size(); i += 4) {
+			ormBuff[i + 0] = 255;
+			ormBuff[i + 1] = 255;
+			ormBuff[i + 2] = 0;
+			ormBuff[i + 3] = 255;
+		}
+
+		std::vector<unsigned char> rgbaBuff, resizedBuff;
+		std::vector<sx::rgba8_class> lineBuff;
+		for (int i = 0; i < 3; ++i) {
+			if (!imagesBlend.hasImage(typesList[i])) continue;
+			sxsdk::image_interface* image = imagesBlend.getImage(typesList[i]);
+			if (!image) continue;
+			const sxsdk::rgb_class factor = (typesList[i] == MAPPING_TYPE_USD_OCCLUSION) ? sxsdk::rgb_class(1, 1, 1) : imagesBlend.getImageFactor(typesList[i]);
+
+			const int srcWidth  = image->get_size().x;
+			const int srcHeight = image->get_size().y;
+			rgbaBuff.resize((size_t)srcWidth * (size_t)srcHeight * 4);
+			lineBuff.resize(srcWidth);
+			size_t iPos = 0;
+			for (int y = 0; y < srcHeight; ++y) {
+				image->get_pixels_rgba(0, y, srcWidth, 1, &(lineBuff[0]));
+				for (int x = 0; x < srcWidth; ++x) {
+					const unsigned char v = (unsigned char)((float)lineBuff[x].red * factor.red);
+					rgbaBuff[iPos + 0] = v;
+					rgbaBuff[iPos + 1] = v;
+					rgbaBuff[iPos + 2] = v;
+					rgbaBuff[iPos + 3] = 255;
+					iPos += 4;
+				}
+			}
+
+			// サイズが異なる場合は、最大のサイズに合わせる.
+			// まとめずに出力する場合と同じフィルタ(デフォルトのLanczos3)を使用する.
+			const std::vector<unsigned char>* pBuff = &rgbaBuff;
+			if (srcWidth != width || srcHeight != height) {
+				if (!ImageUtil::resizeRGBA8(rgbaBuff, srcWidth, srcHeight, resizedBuff, width, height)) return false;
+				pBuff = &resizedBuff;
+			}
+			for (size_t j = 0, k = (size_t)i; j < ormBuff.size(); j += 4, k += 4) {
+				ormBuff[k] = (*pBuff)[j];
+			}
+		}
+
+		// イメージを作成して格納.
+		compointer<sxsdk::image_interface> ormImage(m_pScene->create_image_interface(sx::vec<int,2>(width, height)));
+		if (!ormImage) return false;
+		lineBuff.resize(width);
+		size_t iPos = 0;
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				lineBuff[x].red   = ormBuff[iPos + 0];
+				lineBuff[x].green = ormBuff[iPos + 1];
+				lineBuff[x].blue  = ormBuff[iPos + 2];
+				lineBuff[x].alpha = ormBuff[iPos + 3];
+				iPos += 4;
+			}
+			ormImage->set_pixels_rgba(0, y, width, 1, &(lineBuff[0]));
+		}
+		ormImage->update();
+
+		CTextureMappingData ormMappingData;
+		const int imageIndex = m_storeCustomImage(MAPPING_TYPE_USD_ORM, USD_DATA::IMAGE_FORMAT_TYPE::image_format_none, materialName, ormImage, sxsdk::rgb_class(1, 1, 1), ormMappingData, masterImageName);
+		if (imageIndex < 0) return false;
+
+		// テクスチャが存在する要素のみ、ORMテクスチャのR/G/Bを参照.
+		for (int i = 0; i < 3; ++i) {
+			if (!imagesBlend.hasImage(typesList[i]) || !imagesBlend.getImage(typesList[i])) continue;
+			CTextureMappingData& texMappingD = *(texMappingsList[i]);
+			texMappingD.textureSource = sourcesList[i];
+			texMappingD.textureParam.imageIndex   = imageIndex;
+			texMappingD.textureParam.repeatU      = repeatV.x;
+			texMappingD.textureParam.repeatV      = repeatV.y;
+			texMappingD.textureParam.uvLayerIndex = uvLayerIndex;
+		}
+		retF = true;
+
+	} catch (...) { }
+
+	return retF;
+}
+
 /**
  * DOKI for Shade3D(OSPRay)の情報を取得.
  * @param[in]  surface           表面材質クラス.
@@ -979,10 +1249,12 @@ bool CMaterialTextureBake::m_getMaterialDOKIFromSurface (sxsdk::surface_class* s
 
 /**
  * 指定のimageと同じものがm_imagesList内に存在するか.
+ * ハッシュ値が一致するものについてのみ、1ラインずつピクセルを比較する.
  * @param[in]  image            マスターイメージクラス.
  * @param[in]  factor           乗算値.
+ * @param[in]  pixelsHash       factorを乗算したRGBAピクセルのハッシュ値.
  */
-int CMaterialTextureBake::m_existImage (sxsdk::image_interface* image, const sxsdk::rgb_class factor)
+int CMaterialTextureBake::m_existImage (sxsdk::image_interface* image, const sxsdk::rgb_class factor, const unsigned long long pixelsHash)
 {
 	const int width  = image->get_size().x;
 	const int height = image->get_size().y;
@@ -990,26 +1262,38 @@ int CMaterialTextureBake::m_existImage (sxsdk::image_interface* image, const sxs
 	int index = -1;
 	const size_t cou = m_imagesList.size();
 	for (size_t i = 0; i < cou; ++i) {
-		CImageData& imgD = m_imagesList[i];
-		if (imgD.rgbaBuff.empty()) continue;
+		const CImageData& imgD = m_imagesList[i];
+		if (!imgD.hasPixels()) continue;
 		if (imgD.imageWidth != width || imgD.imageHeight != height) continue;
+		if (imgD.pixelsHash != pixelsHash) continue;
+		const bool grayF = (imgD.pixelFormat == USD_DATA::IMAGE_PIXEL_FORMAT::image_pixel_format_gray8);
 
+		CImagePixelsReader pixelsReader(imgD);
 		std::vector<sx::rgba8_class> lineBuff;
+		std::vector<unsigned char> rgbaLine;
 		lineBuff.resize(width);
-		int iPos = 0;
 		bool sameF = true;
 		for (int y = 0; y < height; ++y) {
+			const unsigned char* pLine = pixelsReader.readLine();
+			if (!pLine) {
+				sameF = false;
+				break;
+			}
 			image->get_pixels_rgba(0, y, width, 1, &(lineBuff[0]));
-			for (int x = 0; x < width; ++x) {
-				const unsigned char rV = (unsigned char)((float)lineBuff[x].red * factor.red);
-				const unsigned char gV = (unsigned char)((float)lineBuff[x].green * factor.green);
-				const unsigned char bV = (unsigned char)((float)lineBuff[x].blue * factor.blue);
-				const unsigned char aV = lineBuff[x].alpha;
-				if (imgD.rgbaBuff[iPos + 0] != rV || imgD.rgbaBuff[iPos + 1] != gV || imgD.rgbaBuff[iPos + 2] != bV || imgD.rgbaBuff[iPos + 3] != aV) {
-					sameF = false;
-					break;
+			m_applyFactor(lineBuff, factor, rgbaLine);
+			for (int x = 0, iPos = 0; x < width; ++x, iPos += 4) {
+				if (grayF) {
+					const unsigned char v = pLine[x];
+					if (v != rgbaLine[iPos + 0] || v != rgbaLine[iPos + 1] || v != rgbaLine[iPos + 2] || rgbaLine[iPos + 3] != 255) {
+						sameF = false;
+						break;
+					}
+				} else {
+					if (pLine[iPos + 0] != rgbaLine[iPos + 0] || pLine[iPos + 1] != rgbaLine[iPos + 1] || pLine[iPos + 2] != rgbaLine[iPos + 2] || pLine[iPos + 3] != rgbaLine[iPos + 3]) {
+						sameF = false;
+						break;
+					}
 				}
-				iPos += 4;
 			}
 			if (!sameF) break;
 		}
@@ -1038,8 +1322,29 @@ int CMaterialTextureBake::m_storeCustomImage (const sxsdk::enums::mapping_type m
 	int imageIndex = -1;
 	if (image == NULL) return -1;
 
+	const int width  = image->get_size().x;
+	const int height = image->get_size().y;
+	if (width <= 0 || height <= 0) return -1;
+
+	// 1要素のみ参照されるテクスチャで、グレイスケールの場合は1チャンネルで保持.
+	const bool singleChannelF = (mappingType == sxsdk::enums::reflection_mapping || mappingType == sxsdk::enums::roughness_mapping || mappingType == MAPPING_TYPE_USD_OCCLUSION || mappingType == MAPPING_TYPE_OPACITY);
+
+	// ピクセルバッファ全体は確保せずに、1ラインずつハッシュ値とグレイスケールかを調べる.
+	unsigned long long pixelsHash = HashUtil::FNV1A64_OFFSET_BASIS;
+	bool grayF = singleChannelF;
+	{
+		std::vector<sx::rgba8_class> lineBuff(width);
+		std::vector<unsigned char> rgbaLine;
+		for (int y = 0; y < height; ++y) {
+			image->get_pixels_rgba(0, y, width, 1, &(lineBuff[0]));
+			m_applyFactor(lineBuff, factor, rgbaLine);
+			pixelsHash = m_calcHash(pixelsHash, rgbaLine);
+			if (grayF && !ImageUtil::isGrayscaleRGBA8(rgbaLine)) grayF = false;
+		}
+	}
+
 	// 同一の画像が存在するかチェック.
-	imageIndex = m_existImage(image, factor);
+	imageIndex = m_existImage(image, factor, pixelsHash);
 	if (imageIndex >= 0) {
 		texMappingData.textureParam.imageIndex = imageIndex;
 		return imageIndex;
@@ -1056,6 +1361,7 @@ int CMaterialTextureBake::m_storeCustomImage (const sxsdk::enums::mapping_type m
 	else if (mappingType == sxsdk::enums::transparency_mapping) imageName += "_transparency";
 	else if (mappingType == MAPPING_TYPE_OPACITY) imageName += "_opacity";
 	else if (mappingType == MAPPING_TYPE_USD_OCCLUSION) imageName += "_occlusion";
+	else if (mappingType == MAPPING_TYPE_USD_ORM) imageName += "_orm";
 	else imageName += "_texture";
 
 	// mappingType別に割り当てられたイメージより、ファイル拡張子をつける.
@@ -1075,7 +1381,7 @@ int CMaterialTextureBake::m_storeCustomImage (const sxsdk::enums::mapping_type m
 			// 拡張子がある場合はそれを採用し、ない場合はpngにする.
 			imageName = StringUtil::SetFileImageExtension(imageName, "png");
 		} else {
-			const bool usePng = (m_exportParam.optTextureType == USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_png);
+			const bool usePng = (m_exportParam.optTextureType != USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_jpeg);		// KTX2の場合もpngをフォールバック用として出力.
 			imageName = StringUtil::SetFileImageExtension(imageName, usePng ? "png" : "jpg", true);
 		}
 	}
@@ -1090,27 +1396,50 @@ int CMaterialTextureBake::m_storeCustomImage (const sxsdk::enums::mapping_type m
 	CImageData& imageD = m_imagesList[imageIndex];
 	imageD.fileName   = imageName;
 
-	// テクスチャのRGBAを保持.
+	// テクスチャのピクセルを保持.
+	// 作業フォルダが指定されている場合は、1ラインずつ一時ファイルに書き出してメモリ上には保持しない.
+	// 一時ファイルに書き込めなかった場合(ディスクの空き容量不足など)は、イメージから読み直してメモリ上に保持する.
 	try {
-		const int width  = image->get_size().x;
-		const int height = image->get_size().y;
 		imageD.imageWidth  = width;
 		imageD.imageHeight = height;
+		imageD.pixelsHash  = pixelsHash;
+		if (grayF) imageD.pixelFormat = USD_DATA::IMAGE_PIXEL_FORMAT::image_pixel_format_gray8;
+		const int pixelBytes = imageD.getPixelBytes();
 
-		imageD.rgbaBuff.resize(width * height * 4);
-
-		std::vector<sx::rgba8_class> lineBuff;
-		lineBuff.resize(width);
-
-		int iPos = 0;
-		for (int y = 0; y < height; ++y) {
+		std::vector<sx::rgba8_class> lineBuff(width);
+		std::vector<unsigned char> rgbaLine, grayLine;
+		auto readLine = [&](const int y) -> const std::vector<unsigned char>& {
 			image->get_pixels_rgba(0, y, width, 1, &(lineBuff[0]));
-			for (int x = 0; x < width; ++x) {
-				imageD.rgbaBuff[iPos + 0] = (unsigned char)((float)lineBuff[x].red * factor.red);
-				imageD.rgbaBuff[iPos + 1] = (unsigned char)((float)lineBuff[x].green * factor.green);
-				imageD.rgbaBuff[iPos + 2] = (unsigned char)((float)lineBuff[x].blue * factor.blue);
-				imageD.rgbaBuff[iPos + 3] = lineBuff[x].alpha;
-				iPos += 4;
+			m_applyFactor(lineBuff, factor, rgbaLine);
+			if (!grayF) return rgbaLine;
+			ImageUtil::convertRGBA8ToGray8(rgbaLine, grayLine);
+			return grayLine;
+		};
+
+		if (m_spillPath != "") {
+			const std::string spillFileName = m_spillPath + StringUtil::getFileSeparator() + std::string("bake_pixels_") + std::to_string(imageIndex) + std::string(".raw");
+			std::ofstream outStream(spillFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			if (outStream) {
+				for (int y = 0; y < height && outStream; ++y) {
+					const std::vector<unsigned char>& line = readLine(y);
+					outStream.write((const char *)&(line[0]), (std::streamsize)line.size());
+				}
+				outStream.close();
+				if (!outStream.fail()) {
+					imageD.spillFileName = spillFileName;
+				} else {
+					std::remove(spillFileName.c_str());
+				}
+			}
+		}
+
+		if (imageD.spillFileName == "") {
+			imageD.pixelsBuff.resize((size_t)width * (size_t)height * (size_t)pixelBytes);
+			size_t iPos = 0;
+			for (int y = 0; y < height; ++y) {
+				const std::vector<unsigned char>& line = readLine(y);
+				std::copy(line.begin(), line.end(), imageD.pixelsBuff.begin() + iPos);
+				iPos += line.size();
 			}
 		}
 	} catch (...) { }
@@ -13,9 +13,13 @@
 #include "FindNames.h"
 #include "ImageData.h"
 #include "ExportParam.h"
+#include "DecodedImageCache.h"
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+
+class CImagesBlend;
 
 //------------------------------------------------------------------.
 /**
@@ -54,6 +58,7 @@ class CCheckImageRef
 private:
 	std::vector<CImageRefData> m_imageRefData;		// 画像の参照情報.
 	sxsdk::scene_interface* m_pScene;
+	CDecodedImageCache* m_pImageCache;				// マスターイメージのキャッシュ.
 
 private:
 	/**
@@ -73,8 +78,10 @@ public:
 
 	/**
 	 * シーンを走査し、マスターイメージの参照情報を取得.
+	 * @param[in] scene       Shade3Dのシーンクラス.
+	 * @param[in] imageCache  マスターイメージのキャッシュ.
 	 */
-	void checkMasterImages (sxsdk::scene_interface* scene);
+	void checkMasterImages (sxsdk::scene_interface* scene, CDecodedImageCache* imageCache);
 
 	/**
 	 * 指定のマスターイメージがオリジナルのまま加工せずに使用できるか.
@@ -93,8 +100,12 @@ private:
 	CExportParam m_exportParam;					// エクスポート時のパラメータ.
 	CFindNames m_findImageFileNames;			// 画像ファイル名が同じにならないようにするクラス.
 	std::vector<CImageData> m_imagesList;		// テクスチャイメージを格納.
+	std::unordered_map<void*, std::vector<int> > m_masterImageIndices;		// マスターイメージのハンドルから、m_imagesList内のイメージ番号を取得.
 
 	CCheckImageRef m_checkImageRef;				// マスターイメージがそのまま加工無しに使用できるか調査するクラス.
+	CDecodedImageCache m_imageCache;			// マスターイメージのピクセルのキャッシュ (エクスポート中は共有する).
+
+	std::string m_spillPath;					// ベイクしたピクセルを退避する作業フォルダ (空の場合はメモリ上に保持).
 
 private:
 	/**
@@ -140,6 +151,13 @@ private:
 	 */
 	int m_findMasterImageInImagesList (sxsdk::master_image_class* masterImage, const CTextureTransform& texTransform, const int channelMix);
 
+	/**
+	 * マスターイメージを参照するイメージ番号を、検索用に登録.
+	 * @param[in]  pMasterImageHandle  マスターイメージのハンドル.
+	 * @param[in]  imageIndex          m_imagesList内のイメージ番号.
+	 */
+	void m_appendMasterImageIndex (void* pMasterImageHandle, const int imageIndex);
+
 	/**
 	 * 指定のカスタムイメージをエクスポート用に格納.
 	 * @param[in]  mappingType      マッピングの種類.
@@ -158,8 +176,14 @@ private:
 	 * 指定のimageと同じものがm_imagesList内に存在するか.
 	 * @param[in]  image            マスターイメージクラス.
 	 * @param[in]  factor           乗算値.
+	 * @param[in]  pixelsHash       factorを乗算したRGBAピクセルのハッシュ値.
 	 */
-	int m_existImage (sxsdk::image_interface* image, const sxsdk::rgb_class factor);
+	int m_existImage (sxsdk::image_interface* image, const sxsdk::rgb_class factor, const unsigned long long pixelsHash);
+
+	/**
+	 * ベイクしたピクセルを格納していた一時ファイルを削除.
+	 */
+	void m_removeSpillFiles ();
 
 	/**
 	 * DOKI for Shade3D(OSPRay)の情報を取得.
@@ -168,8 +192,23 @@ private:
 	 */
 	bool m_getMaterialDOKIFromSurface (sxsdk::surface_class* surface, CMaterialData& materialData);
 
+	/**
+	 * Occlusion/Roughness/Metallicを1枚のテクスチャのR/G/Bにまとめて格納.
+	 * @param[in]  materialName     マテリアル名.
+	 * @param[in]  imagesBlend      ベイク済みのイメージ.
+	 * @param[out] materialData     マテリアル情報の格納先.
+	 * @param[out] masterImageName  USDでのマスターイメージ名が返る.
+	 * @return まとめて格納した場合はtrue.
+	 */
+	bool m_storeORMImage (const std::string& materialName, CImagesBlend& imagesBlend, CMaterialData& materialData, std::string& masterImageName);
+
 public:
-	CMaterialTextureBake (sxsdk::scene_interface* scene, const CExportParam& exportParam);
+	/**
+	 * @param[in] scene        Shade3Dのシーンクラス.
+	 * @param[in] exportParam  エクスポートパラメータ.
+	 * @param[in] spillPath    ベイクしたピクセルを一時ファイルとして退避する作業フォルダ.
+	 */
+	CMaterialTextureBake (sxsdk::scene_interface* scene, const CExportParam& exportParam, const std::string& spillPath = "");
 	~CMaterialTextureBake ();
 
 	void clear ();
@@ -179,6 +218,44 @@ public:
 	 */
 	const std::vector<CImageData>& getImagesList () const { return m_imagesList; }
 
+	/**
+	 * マスターイメージのキャッシュを取得.
+	 */
+	CDecodedImageCache& getImageCache () { return m_imageCache; }
+
+	/**
+	 * マスターイメージの参照情報を取得.
+	 */
+	CCheckImageRef& getCheckImageRef () { return m_checkImageRef; }
+
+	/**
+	 * ベイク済みのイメージを追加.
+	 * ファイル名は、他のテクスチャとかぶらないように連番が付く場合がある.
+	 * @param[in] imageData  追加するイメージ (fileNameは拡張子を含む名前).
+	 * @return イメージ番号.
+	 */
+	int appendImage (const CImageData& imageData);
+
+	/**
+	 * CPUでベイクしたグレイスケールのピクセルを、テクスチャとして格納.
+	 * ベイクしたテクスチャと同じく、同一のイメージがある場合はそれを参照する.
+	 * @param[in]  mappingType     マッピングの種類.
+	 * @param[in]  materialName    マテリアル名.
+	 * @param[in]  grayBuff        ピクセル (width x height).
+	 * @param[in]  width           幅.
+	 * @param[in]  height          高さ.
+	 * @param[out] texMappingData  マッピング情報の格納先.
+	 * @return イメージ番号.
+	 */
+	int storeGrayscaleImage (const sxsdk::enums::mapping_type mappingType, const std::string& materialName, const std::vector<unsigned char>& grayBuff, const int width, const int height, CTextureMappingData& texMappingData);
+
+	/**
+	 * 参照されなくなったイメージを、出力しないようにする.
+	 * イメージ番号は変わらない.
+	 * @param[in] imageIndex  イメージ番号.
+	 */
+	void releaseImage (const int imageIndex);
+
 	/**
 	 * 指定の形状でマテリアルを取得.
 	 * @param[in]  shape         対象の形状.
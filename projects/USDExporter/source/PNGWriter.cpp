@@ -0,0 +1,832 @@
+﻿/**
+ * PNG形式でのテクスチャ出力.
+ * 参考 : https://www.w3.org/TR/png/ , RFC1950 (zlib) , RFC1951 (deflate).
+ */
+#include "PNGWriter.h"
+#include "HashUtil.h"
+#include "HuffmanUtil.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+	/**
+	 * ビッグエンディアンでバッファに追加.
+	 */
+	void m_writeU32BE (std::vector<unsigned char>& buff, const unsigned int v) {
+		for (int i = 3; i >= 0; --i) buff.push_back((unsigned char)((v >> (i * 8)) & 0xff));
+	}
+
+	/**
+	 * deflateのビット出力 (LSBから詰める).
+	 */
+	class CBitWriter
+	{
+	private:
+		std::vector<unsigned char>& m_buff;
+		unsigned int m_bitBuff;
+		int m_bitCount;
+
+	public:
+		CBitWriter (std::vector<unsigned char>& buff) : m_buff(buff), m_bitBuff(0), m_bitCount(0) { }
+
+		void writeBits (const unsigned int v, const int count) {
+			m_bitBuff |= v << m_bitCount;
+			m_bitCount += count;
+			while (m_bitCount >= 8) {
+				m_buff.push_back((unsigned char)(m_bitBuff & 0xff));
+				m_bitBuff >>= 8;
+				m_bitCount -= 8;
+			}
+		}
+
+		/**
+		 * バイト境界に揃えたあとに、バイト列をそのまま出力.
+		 */
+		void writeBytes (const unsigned char* data, const size_t size) {
+			flush();
+			m_buff.insert(m_buff.end(), data, data + size);
+		}
+
+		void flush () {
+			if (m_bitCount > 0) m_buff.push_back((unsigned char)(m_bitBuff & 0xff));
+			m_bitBuff  = 0;
+			m_bitCount = 0;
+		}
+	};
+
+	const int g_lengthBase[]  = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+	const int g_lengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+	const int g_distBase[]    = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+	const int g_distExtra[]   = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+	// 符号長の出力順 (動的ハフマン).
+	const int g_codeLengthOrder[] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+	const int g_litLenCodesCount = 286;
+	const int g_distCodesCount   = 30;
+	const int g_storedBlockSize  = 65535;
+	const int g_maxBlockTokens   = 65536;		// 1ブロックに格納するトークン数.
+	const int g_maxBlockBytes    = 1 << 20;		// 1ブロックに格納する元データの最大バイト数.
+
+	/**
+	 * 長さ(3-258)/距離(1-32768)から、符号のインデックスを引くテーブル.
+	 */
+	class CDeflateCodeTable
+	{
+	public:
+		unsigned char lengthCodes[259];
+		unsigned char distCodes[32769];
+
+	public:
+		CDeflateCodeTable () {
+			for (int li = 0, len = 0; len <= 258; ++len) {
+				while (li < 28 && g_lengthBase[li + 1] <= len) li++;
+				lengthCodes[len] = (unsigned char)li;
+			}
+			for (int di = 0, dist = 0; dist <= 32768; ++dist) {
+				while (di < 29 && g_distBase[di + 1] <= dist) di++;
+				distCodes[dist] = (unsigned char)di;
+			}
+		}
+	};
+	const CDeflateCodeTable g_codeTable;
+
+	/**
+	 * LZ77の結果 (dist = 0の場合はリテラル).
+	 */
+	struct DeflateToken {
+		unsigned short litLen;
+		unsigned short dist;
+	};
+
+	/**
+	 * 圧縮レベルごとのLZ77の探索パラメータ.
+	 */
+	class CDeflateLevelParam
+	{
+	public:
+		int maxChain;			// ハッシュチェーンをたどる最大数.
+		int niceLength;			// この長さ以上の一致が見つかれば探索を打ち切る.
+		bool lazyMatch;			// 1バイト先の一致も確認する.
+
+	public:
+		CDeflateLevelParam (const int level) {
+			const int maxChains[]   = {0, 4, 8, 16, 32, 64, 128, 256, 1024, 4096};
+			const int niceLengths[] = {0, 8, 16, 32, 64, 128, 128, 258, 258, 258};
+			const int lv = std::max(0, std::min(9, level));
+			maxChain   = maxChains[lv];
+			niceLength = niceLengths[lv];
+			lazyMatch  = (lv >= 4);
+		}
+	};
+
+	/**
+	 * ハフマン符号を出力用に反転 (deflateはLSBから詰めるため).
+	 */
+	void m_reverseCodes (const std::vector<int>& lengths, std::vector<unsigned int>& codes) {
+		HuffmanUtil::calcCanonicalCodes(lengths, codes);
+		for (size_t i = 0; i < codes.size(); ++i) {
+			unsigned int v = 0;
+			for (int j = 0; j < lengths[i]; ++j) v |= ((codes[i] >> j) & 1) << (lengths[i] - 1 - j);
+			codes[i] = v;
+		}
+	}
+
+	/**
+	 * 使用する符号が1つ以下の場合は、符号長1のダミーを加えて完全な符号にする.
+	 * 不完全な符号はデコーダによってはエラーとなるため.
+	 */
+	void m_completeCodeLengths (std::vector<int>& lengths) {
+		int usedCount = 0;
+		for (size_t i = 0; i < lengths.size(); ++i) {
+			if (lengths[i] > 0) usedCount++;
+		}
+		for (size_t i = 0; i < lengths.size() && usedCount < 2; ++i) {
+			if (lengths[i] > 0) continue;
+			lengths[i] = 1;
+			usedCount++;
+		}
+	}
+
+	/**
+	 * 固定ハフマン符号の符号長.
+	 */
+	void m_getFixedCodeLengths (std::vector<int>& litLenLengths, std::vector<int>& distLengths) {
+		litLenLengths.resize(288);
+		for (int i = 0; i < 288; ++i) litLenLengths[i] = (i < 144) ? 8 : ((i < 256) ? 9 : ((i < 280) ? 7 : 8));
+		distLengths.assign(g_distCodesCount, 5);
+	}
+
+	/**
+	 * 無圧縮ブロックとして出力.
+	 */
+	void m_writeStoredBlocks (CBitWriter& bitWriter, const unsigned char* data, const int size, const bool finalBlock) {
+		int pos = 0;
+		do {
+			const int blockSize = std::min(g_storedBlockSize, size - pos);
+			const bool lastBlock = finalBlock && (pos + blockSize >= size);
+			bitWriter.writeBits(lastBlock ? 1 : 0, 1);		// BFINAL.
+			bitWriter.writeBits(0, 2);						// BTYPE (無圧縮).
+			bitWriter.flush();
+			bitWriter.writeBits(blockSize, 16);
+			bitWriter.writeBits((~blockSize) & 0xffff, 16);
+			if (blockSize > 0) bitWriter.writeBytes(data + pos, blockSize);
+			pos += blockSize;
+		} while (pos < size);
+	}
+
+	/**
+	 * トークンをハフマン符号で出力.
+	 */
+	void m_writeTokens (CBitWriter& bitWriter, const std::vector<DeflateToken>& tokens, const std::vector<int>& litLenLengths, const std::vector<int>& distLengths) {
+		std::vector<unsigned int> litLenCodes, distCodes;
+		m_reverseCodes(litLenLengths, litLenCodes);
+		m_reverseCodes(distLengths, distCodes);
+
+		for (size_t i = 0; i < tokens.size(); ++i) {
+			const DeflateToken& token = tokens[i];
+			if (token.dist == 0) {
+				bitWriter.writeBits(litLenCodes[token.litLen], litLenLengths[token.litLen]);
+				continue;
+			}
+			const int li = g_codeTable.lengthCodes[token.litLen];
+			bitWriter.writeBits(litLenCodes[257 + li], litLenLengths[257 + li]);
+			if (g_lengthExtra[li] > 0) bitWriter.writeBits(token.litLen - g_lengthBase[li], g_lengthExtra[li]);
+
+			const int di = g_codeTable.distCodes[token.dist];
+			bitWriter.writeBits(distCodes[di], distLengths[di]);
+			if (g_distExtra[di] > 0) bitWriter.writeBits(token.dist - g_distBase[di], g_distExtra[di]);
+		}
+		bitWriter.writeBits(litLenCodes[256], litLenLengths[256]);		// ブロックの終端.
+	}
+
+	/**
+	 * トークンを出力したときのビット数を計算.
+	 */
+	unsigned long long m_calcTokensBits (const std::vector<unsigned int>& litLenFreqs, const std::vector<unsigned int>& distFreqs, const std::vector<int>& litLenLengths, const std::vector<int>& distLengths) {
+		unsigned long long bits = 0;
+		for (int i = 0; i < g_litLenCodesCount; ++i) {
+			if (litLenFreqs[i] == 0) continue;
+			bits += (unsigned long long)litLenFreqs[i] * (unsigned long long)(litLenLengths[i] + ((i >= 257) ? g_lengthExtra[i - 257] : 0));
+		}
+		for (int i = 0; i < g_distCodesCount; ++i) {
+			if (distFreqs[i] == 0) continue;
+			bits += (unsigned long long)distFreqs[i] * (unsigned long long)(distLengths[i] + g_distExtra[i]);
+		}
+		return bits;
+	}
+
+	/**
+	 * 1ブロック分を出力.
+	 * 無圧縮/固定ハフマン/動的ハフマンのうち、最もサイズの小さいものを採用する.
+	 * @param[in] tokens      LZ77の結果.
+	 * @param[in] data        ブロックに対応する元データ.
+	 * @param[in] size        元データのバイト数.
+	 * @param[in] finalBlock  最後のブロックの場合はtrue.
+	 */
+	void m_writeBlock (CBitWriter& bitWriter, const std::vector<DeflateToken>& tokens, const unsigned char* data, const int size, const bool finalBlock) {
+		std::vector<unsigned int> litLenFreqs(g_litLenCodesCount, 0), distFreqs(g_distCodesCount, 0);
+		for (size_t i = 0; i < tokens.size(); ++i) {
+			if (tokens[i].dist == 0) {
+				litLenFreqs[tokens[i].litLen]++;
+			} else {
+				litLenFreqs[257 + g_codeTable.lengthCodes[tokens[i].litLen]]++;
+				distFreqs[g_codeTable.distCodes[tokens[i].dist]]++;
+			}
+		}
+		litLenFreqs[256] = 1;
+
+		// 動的ハフマンの符号長.
+		std::vector<int> litLenLengths, distLengths;
+		HuffmanUtil::calcCodeLengths(litLenFreqs, 15, litLenLengths);
+		HuffmanUtil::calcCodeLengths(distFreqs, 15, distLengths);
+		m_completeCodeLengths(litLenLengths);
+		m_completeCodeLengths(distLengths);
+
+		int litLenCount = g_litLenCodesCount;
+		while (litLenCount > 257 && litLenLengths[litLenCount - 1] == 0) litLenCount--;
+		int distCount = g_distCodesCount;
+		while (distCount > 1 && distLengths[distCount - 1] == 0) distCount--;
+
+		// 符号長の並びをランレングスで表す (16 : 直前の値の繰り返し, 17/18 : 0の繰り返し).
+		std::vector<int> allLengths(litLenLengths.begin(), litLenLengths.begin() + litLenCount);
+		allLengths.insert(allLengths.end(), distLengths.begin(), distLengths.begin() + distCount);
+		std::vector<int> clSymbols, clExtras;
+		std::vector<unsigned int> clFreqs(19, 0);
+		for (size_t i = 0; i < allLengths.size();) {
+			const int len = allLengths[i];
+			size_t runCount = 1;
+			while (i + runCount < allLengths.size() && allLengths[i + runCount] == len) runCount++;
+
+			if (len == 0 && runCount >= 3) {
+				const int count = (int)std::min(runCount, (size_t)138);
+				if (count <= 10) {
+					clSymbols.push_back(17);
+					clExtras.push_back(count - 3);
+				} else {
+					clSymbols.push_back(18);
+					clExtras.push_back(count - 11);
+				}
+				i += count;
+			} else if (len != 0 && runCount >= 4) {
+				clSymbols.push_back(len);
+				clExtras.push_back(0);
+				const int count = (int)std::min(runCount - 1, (size_t)6);
+				clSymbols.push_back(16);
+				clExtras.push_back(count - 3);
+				i += 1 + count;
+			} else {
+				clSymbols.push_back(len);
+				clExtras.push_back(0);
+				i++;
+			}
+			clFreqs[clSymbols.back()]++;
+			if (clSymbols.size() >= 2 && clSymbols.back() == 16) clFreqs[clSymbols[clSymbols.size() - 2]]++;
+		}
+		std::vector<int> clLengths;
+		HuffmanUtil::calcCodeLengths(clFreqs, 7, clLengths);
+		m_completeCodeLengths(clLengths);
+		int clCount = 19;
+		while (clCount > 4 && clLengths[g_codeLengthOrder[clCount - 1]] == 0) clCount--;
+
+		// それぞれの形式でのビット数を計算.
+		unsigned long long dynamicBits = 3 + 5 + 5 + 4 + (unsigned long long)clCount * 3;
+		for (size_t i = 0; i < clSymbols.size(); ++i) {
+			const int extraBits = (clSymbols[i] == 16) ? 2 : ((clSymbols[i] == 17) ? 3 : ((clSymbols[i] == 18) ? 7 : 0));
+			dynamicBits += clLengths[clSymbols[i]] + extraBits;
+		}
+		dynamicBits += m_calcTokensBits(litLenFreqs, distFreqs, litLenLengths, distLengths);
+
+		std::vector<int> fixedLitLenLengths, fixedDistLengths;
+		m_getFixedCodeLengths(fixedLitLenLengths, fixedDistLengths);
+		const unsigned long long fixedBits = 3 + m_calcTokensBits(litLenFreqs, distFreqs, fixedLitLenLengths, fixedDistLengths);
+
+		const unsigned long long storedBits = (unsigned long long)size * 8 + (unsigned long long)(size / g_storedBlockSize + 1) * (3 + 7 + 32);
+
+		if (storedBits <= fixedBits && storedBits <= dynamicBits) {
+			m_writeStoredBlocks(bitWriter, data, size, finalBlock);
+
+		} else if (fixedBits <= dynamicBits) {
+			bitWriter.writeBits(finalBlock ? 1 : 0, 1);		// BFINAL.
+			bitWriter.writeBits(1, 2);						// BTYPE (固定ハフマン).
+			m_writeTokens(bitWriter, tokens, fixedLitLenLengths, fixedDistLengths);
+
+		} else {
+			bitWriter.writeBits(finalBlock ? 1 : 0, 1);		// BFINAL.
+			bitWriter.writeBits(2, 2);						// BTYPE (動的ハフマン).
+			bitWriter.writeBits(litLenCount - 257, 5);
+			bitWriter.writeBits(distCount - 1, 5);
+			bitWriter.writeBits(clCount - 4, 4);
+			for (int i = 0; i < clCount; ++i) bitWriter.writeBits(clLengths[g_codeLengthOrder[i]], 3);
+
+			std::vector<unsigned int> clCodes;
+			m_reverseCodes(clLengths, clCodes);
+			for (size_t i = 0; i < clSymbols.size(); ++i) {
+				const int symbol = clSymbols[i];
+				bitWriter.writeBits(clCodes[symbol], clLengths[symbol]);
+				if (symbol == 16)      bitWriter.writeBits(clExtras[i], 2);
+				else if (symbol == 17) bitWriter.writeBits(clExtras[i], 3);
+				else if (symbol == 18) bitWriter.writeBits(clExtras[i], 7);
+			}
+			m_writeTokens(bitWriter, tokens, litLenLengths, distLengths);
+		}
+	}
+
+	/**
+	 * LZ77のハッシュチェーン.
+	 * 位置は入力バッファ内の位置で、バッファの先頭を削除した場合はslideで位置をずらす.
+	 */
+	class CMatchFinder
+	{
+	private:
+		// std::minなどの参照渡しでも定義が不要なように、enumで定数を指定.
+		enum {
+			windowSize = 32768,
+			hashSize   = 1 << 15,
+			maxMatch   = 258,
+		};
+
+		const std::vector<unsigned char>& m_buff;
+		std::vector<int> m_headList;
+		std::vector<int> m_prevList;
+
+		inline int m_hash (const unsigned char* pSrc, const int pos) const {
+			return (((int)pSrc[pos] << 10) ^ ((int)pSrc[pos + 1] << 5) ^ (int)pSrc[pos + 2]) & (hashSize - 1);
+		}
+
+	public:
+		CMatchFinder (const std::vector<unsigned char>& buff) : m_buff(buff) {
+			m_headList.resize(hashSize, -1);
+			m_prevList.resize(windowSize, -1);
+		}
+
+		/**
+		 * 位置posでの最長一致を探す.
+		 * @param[in]  size      参照できるデータのバイト数.
+		 * @param[out] bestDist  一致した距離が返る.
+		 * @return 一致した長さ (3未満の場合は一致なし).
+		 */
+		int findMatch (const int pos, const int size, const int maxChain, const int niceLength, int& bestDist) const {
+			int bestLen = 0;
+			bestDist = 0;
+			if (pos + 3 > size) return 0;
+
+			const unsigned char* pSrc = &(m_buff[0]);
+			const int maxLen = std::min((int)maxMatch, size - pos);
+			int p = m_headList[m_hash(pSrc, pos)];
+			for (int chain = 0; chain < maxChain && p >= 0 && pos - p <= windowSize; ++chain) {
+				if (pSrc[p + bestLen] == pSrc[pos + bestLen]) {
+					int len = 0;
+					while (len < maxLen && pSrc[p + len] == pSrc[pos + len]) len++;
+					if (len > bestLen) {
+						bestLen  = len;
+						bestDist = pos - p;
+						if (len >= maxLen || len >= niceLength) break;
+					}
+				}
+				p = m_prevList[p & (windowSize - 1)];
+			}
+			return bestLen;
+		}
+
+		/**
+		 * ハッシュチェーンに登録.
+		 */
+		void insert (const int pos, const int size) {
+			if (pos + 3 > size) return;
+			const int h = m_hash(&(m_buff[0]), pos);
+			m_prevList[pos & (windowSize - 1)] = m_headList[h];
+			m_headList[h] = pos;
+		}
+
+		/**
+		 * 入力バッファの先頭からshiftバイトを削除した場合に、登録済みの位置をずらす.
+		 * shiftはwindowSizeの倍数であること.
+		 */
+		void slide (const int shift) {
+			for (size_t i = 0; i < m_headList.size(); ++i) m_headList[i] = (m_headList[i] >= shift) ? (m_headList[i] - shift) : -1;
+			for (size_t i = 0; i < m_prevList.size(); ++i) m_prevList[i] = (m_prevList[i] >= shift) ? (m_prevList[i] - shift) : -1;
+		}
+
+		static int getWindowSize () { return windowSize; }
+		static int getMaxMatch () { return maxMatch; }
+	};
+
+	/**
+	 * zlib形式で圧縮 (LZ77 + ハフマン符号).
+	 * writeで少しずつデータを渡し、finishで終端する.
+	 * 入力データは、直前のスライド窓(32KB)と出力前のブロック分のみを保持する.
+	 */
+	class CZlibWriter
+	{
+	private:
+		std::vector<unsigned char>& m_dstBuff;
+		CBitWriter m_bitWriter;
+		const int m_level;
+		const CDeflateLevelParam m_levelParam;
+
+		std::vector<unsigned char> m_buff;		// 入力データ.
+		CMatchFinder m_matchFinder;
+		std::vector<DeflateToken> m_tokens;
+		int m_blockStart;						// 出力前のブロックの先頭位置.
+		int m_pos;								// 次に符号化する位置.
+		int m_matchLen, m_matchDist;
+		bool m_hasMatch;						// 遅延評価で、位置m_posの一致を探索済みの場合はtrue.
+		unsigned int m_adlerA, m_adlerB;		// Adler-32.
+
+		/**
+		 * Adler-32を更新.
+		 */
+		void m_updateAdler32 (const unsigned char* data, const size_t size) {
+			size_t i = 0;
+			while (i < size) {
+				// 5552バイトごとに剰余を取る (オーバーフローしない最大数).
+				const size_t iEnd = std::min(size, i + 5552);
+				for (; i < iEnd; ++i) {
+					m_adlerA += data[i];
+					m_adlerB += m_adlerA;
+				}
+				m_adlerA %= 65521;
+				m_adlerB %= 65521;
+			}
+		}
+
+		/**
+		 * 出力前のブロックを出力し、不要になった入力データを削除.
+		 */
+		void m_flushBlock (const bool finalBlock) {
+			const unsigned char* pBlock = (m_pos > m_blockStart) ? &(m_buff[m_blockStart]) : NULL;
+			m_writeBlock(m_bitWriter, m_tokens, pBlock, m_pos - m_blockStart, finalBlock);
+			m_tokens.clear();
+			m_blockStart = m_pos;
+
+			// スライド窓より前のデータを削除 (ハッシュチェーンの位置を保つため、窓のサイズ単位).
+			const int windowSize = CMatchFinder::getWindowSize();
+			if (m_pos >= windowSize * 2) {
+				const int shift = (m_pos / windowSize - 1) * windowSize;
+				m_buff.erase(m_buff.begin(), m_buff.begin() + shift);
+				m_matchFinder.slide(shift);
+				m_pos        -= shift;
+				m_blockStart -= shift;
+			}
+		}
+
+		/**
+		 * LZ77で符号化.
+		 * 最後のデータでない場合は、最長一致の長さ分のデータが揃っている位置までを処理する.
+		 */
+		void m_process (const bool lastData) {
+			// ブロックを出力した場合は入力データの先頭が削除されるため、位置を計算し直す.
+			while (m_processBlock(lastData)) { }
+		}
+
+		/**
+		 * LZ77で符号化し、ブロックのサイズに達した場合は出力する.
+		 * @return ブロックを出力した場合はtrue.
+		 */
+		bool m_processBlock (const bool lastData) {
+			const int size  = (int)m_buff.size();
+			const int limit = lastData ? size : (size - CMatchFinder::getMaxMatch() - 1);
+			const unsigned char* pSrc = &(m_buff[0]);
+
+			while (m_pos < limit) {
+				const int i = m_pos;
+				if (!m_hasMatch) m_matchLen = m_matchFinder.findMatch(i, size, m_levelParam.maxChain, m_levelParam.niceLength, m_matchDist);
+				m_hasMatch = false;
+
+				// 1バイト先でより長く一致する場合は、リテラルを出力して次に進む.
+				if (m_levelParam.lazyMatch && m_matchLen >= 3 && m_matchLen < m_levelParam.niceLength && i + 1 < size) {
+					m_matchFinder.insert(i, size);
+					int nextDist = 0;
+					const int nextLen = m_matchFinder.findMatch(i + 1, size, m_levelParam.maxChain, m_levelParam.niceLength, nextDist);
+					if (nextLen > m_matchLen) {
+						DeflateToken token = {pSrc[i], 0};
+						m_tokens.push_back(token);
+						m_pos++;
+						m_matchLen  = nextLen;
+						m_matchDist = nextDist;
+						m_hasMatch  = true;
+					} else {
+						DeflateToken token = {(unsigned short)m_matchLen, (unsigned short)m_matchDist};
+						m_tokens.push_back(token);
+						for (int j = 1; j < m_matchLen; ++j) m_matchFinder.insert(i + j, size);
+						m_pos += m_matchLen;
+					}
+
+				} else if (m_matchLen >= 3) {
+					DeflateToken token = {(unsigned short)m_matchLen, (unsigned short)m_matchDist};
+					m_tokens.push_back(token);
+					for (int j = 0; j < m_matchLen; ++j) m_matchFinder.insert(i + j, size);
+					m_pos += m_matchLen;
+
+				} else {
+					DeflateToken token = {pSrc[i], 0};
+					m_tokens.push_back(token);
+					m_matchFinder.insert(i, size);
+					m_pos++;
+				}
+
+				if (!m_hasMatch && (m_tokens.size() >= (size_t)g_maxBlockTokens || m_pos - m_blockStart >= g_maxBlockBytes)) {
+					m_flushBlock(false);
+					return true;
+				}
+			}
+			return false;
+		}
+
+	public:
+		CZlibWriter (std::vector<unsigned char>& dstBuff, const int level) : m_dstBuff(dstBuff), m_bitWriter(dstBuff), m_level(level), m_levelParam(level), m_matchFinder(m_buff) {
+			m_blockStart = m_pos = 0;
+			m_matchLen = m_matchDist = 0;
+			m_hasMatch = false;
+			m_adlerA = 1;
+			m_adlerB = 0;
+			m_tokens.reserve(g_maxBlockTokens);
+
+			m_dstBuff.push_back(0x78);
+			m_dstBuff.push_back((level <= 1) ? 0x01 : ((level <= 5) ? 0x5e : ((level == 6) ? 0x9c : 0xda)));		// FLEVEL.
+		}
+
+		/**
+		 * データを追加して圧縮.
+		 */
+		void write (const unsigned char* data, const size_t size) {
+			if (size == 0) return;
+			m_updateAdler32(data, size);
+			m_buff.insert(m_buff.end(), data, data + size);
+
+			if (m_level <= 0) {
+				// 無圧縮の場合は、ブロックのサイズ分揃ったら出力.
+				size_t pos = 0;
+				while (m_buff.size() - pos >= (size_t)g_storedBlockSize) {
+					m_writeStoredBlocks(m_bitWriter, &(m_buff[pos]), g_storedBlockSize, false);
+					pos += g_storedBlockSize;
+				}
+				if (pos > 0) m_buff.erase(m_buff.begin(), m_buff.begin() + pos);
+				return;
+			}
+			m_process(false);
+		}
+
+		/**
+		 * 残りのデータを最後のブロックとして出力し、Adler-32を付加.
+		 */
+		void finish () {
+			if (m_level <= 0) {
+				m_writeStoredBlocks(m_bitWriter, m_buff.empty() ? NULL : &(m_buff[0]), (int)m_buff.size(), true);
+			} else {
+				if (!m_buff.empty()) m_process(true);
+				m_flushBlock(true);
+			}
+			m_bitWriter.flush();
+			m_writeU32BE(m_dstBuff, (m_adlerB << 16) | m_adlerA);
+			std::vector<unsigned char>().swap(m_buff);
+		}
+	};
+
+	inline int m_paeth (const int a, const int b, const int c) {
+		const int p  = a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc) return a;
+		if (pb <= pc) return b;
+		return c;
+	}
+
+	/**
+	 * 1ラインにフィルタを適用.
+	 * filter_adaptiveの場合は、5種類のフィルタのうち差分の絶対値の合計が最小のものを採用する.
+	 * @param[in]  pCur      現在のライン.
+	 * @param[in]  pPrev     1つ前のライン (先頭のラインの場合は0で埋めたもの).
+	 * @param[out] lineBuff  フィルタごとの作業バッファ (5つ).
+	 * @param[out] pDst      フィルタの番号 + フィルタ適用後のライン (lineSize + 1バイト).
+	 */
+	void m_filterLine (const unsigned char* pCur, const unsigned char* pPrev, const size_t lineSize, const int bytesPerPixel, const PNGWriter::FILTER_TYPE filterType, std::vector<unsigned char>* lineBuff, unsigned char* pDst) {
+		// 試すフィルタの範囲 (PNGのフィルタ番号は、FILTER_TYPEから1を引いたもの).
+		const int startFilter = (filterType == PNGWriter::filter_adaptive) ? 0 : ((int)filterType - 1);
+		const int endFilter   = (filterType == PNGWriter::filter_adaptive) ? 4 : startFilter;
+
+		int bestFilter = startFilter;
+		size_t bestSum = 0;
+		for (int f = startFilter; f <= endFilter; ++f) {
+			lineBuff[f].resize(lineSize);
+			unsigned char* pD = &(lineBuff[f][0]);
+			size_t sum = 0;
+			for (size_t x = 0; x < lineSize; ++x) {
+				const int a = (x >= (size_t)bytesPerPixel) ? pCur[x - bytesPerPixel] : 0;
+				const int b = pPrev[x];
+				const int c = (x >= (size_t)bytesPerPixel) ? pPrev[x - bytesPerPixel] : 0;
+				int v = pCur[x];
+				switch (f) {
+				case 1: v -= a; break;
+				case 2: v -= b; break;
+				case 3: v -= (a + b) / 2; break;
+				case 4: v -= m_paeth(a, b, c); break;
+				}
+				pD[x] = (unsigned char)(v & 0xff);
+				sum += (pD[x] < 128) ? pD[x] : (256 - pD[x]);
+			}
+			if (f == startFilter || sum < bestSum) {
+				bestFilter = f;
+				bestSum    = sum;
+			}
+		}
+
+		pDst[0] = (unsigned char)bestFilter;
+		std::copy(lineBuff[bestFilter].begin(), lineBuff[bestFilter].end(), pDst + 1);
+	}
+
+	/**
+	 * 1ラインずつフィルタを適用しながらzlib圧縮する.
+	 * 画像全体のピクセルやフィルタ適用後のデータは保持しない.
+	 * @return ラインを読み込めなかった場合はfalse.
+	 */
+	bool m_compressLines (const ImageUtil::LineReader& readLine, const int width, const int height, const int bytesPerPixel, const PNGWriter::FILTER_TYPE filterType, const int level, std::vector<unsigned char>& dstBuff) {
+		dstBuff.clear();
+		const size_t lineSize = (size_t)width * (size_t)bytesPerPixel;
+		std::vector<unsigned char> prevLine(lineSize, 0), curLine(lineSize), filteredLine(lineSize + 1);
+		std::vector<unsigned char> lineBuff[5];
+
+		CZlibWriter zlibWriter(dstBuff, level);
+		for (int y = 0; y < height; ++y) {
+			const unsigned char* pLine = readLine(y);
+			if (!pLine) return false;
+			std::copy(pLine, pLine + lineSize, curLine.begin());
+			m_filterLine(&(curLine[0]), &(prevLine[0]), lineSize, bytesPerPixel, filterType, lineBuff, &(filteredLine[0]));
+			zlibWriter.write(&(filteredLine[0]), filteredLine.size());
+			prevLine.swap(curLine);
+		}
+		zlibWriter.finish();
+		return true;
+	}
+
+	/**
+	 * フィルタとzlib圧縮を行い、IDATチャンクのデータを作成.
+	 * optimizeの場合は、すべてのフィルタを試して最もサイズの小さいものを採用する (ラインは複数回読み込まれる).
+	 */
+	bool m_compressImage (const ImageUtil::LineReader& readLine, const int width, const int height, const int bytesPerPixel, const PNGWriter::CEncodeParam& param, std::vector<unsigned char>& idat) {
+		const int level = std::max(0, std::min(9, param.compressionLevel));
+		if (!param.optimize || level == 0) {
+			return m_compressLines(readLine, width, height, bytesPerPixel, param.filterType, level, idat);
+		}
+
+		// フィルタの選択は圧縮レベル6以上で比較し、採用したものを最大レベルで圧縮し直す.
+		const int compareLevel = std::max(level, 6);
+		std::vector<unsigned char> tmpIdat;
+		PNGWriter::FILTER_TYPE bestFilter = PNGWriter::filter_adaptive;
+		idat.clear();
+		for (int f = (int)PNGWriter::filter_adaptive; f <= (int)PNGWriter::filter_paeth; ++f) {
+			if (!m_compressLines(readLine, width, height, bytesPerPixel, (PNGWriter::FILTER_TYPE)f, compareLevel, tmpIdat)) return false;
+			if (idat.empty() || tmpIdat.size() < idat.size()) {
+				idat.swap(tmpIdat);
+				bestFilter = (PNGWriter::FILTER_TYPE)f;
+			}
+		}
+		if (compareLevel < 9) {
+			if (!m_compressLines(readLine, width, height, bytesPerPixel, bestFilter, 9, tmpIdat)) return false;
+			if (tmpIdat.size() < idat.size()) idat.swap(tmpIdat);
+		}
+		return true;
+	}
+
+	/**
+	 * PNGのチャンクを追加.
+	 */
+	void m_writeChunk (std::vector<unsigned char>& buff, const char* type, const std::vector<unsigned char>& data) {
+		m_writeU32BE(buff, (unsigned int)data.size());
+		const size_t typePos = buff.size();
+		for (int i = 0; i < 4; ++i) buff.push_back((unsigned char)type[i]);
+		buff.insert(buff.end(), data.begin(), data.end());
+		m_writeU32BE(buff, HashUtil::calcCRC32(&(buff[typePos]), buff.size() - typePos));
+	}
+
+	/**
+	 * PNGとしてエンコード.
+	 * @param[in] colorType      PNGのカラータイプ (0 : グレイスケール, 2 : RGB, 6 : RGBA).
+	 * @param[in] bytesPerPixel  1ピクセルのバイト数.
+	 * @param[in] param          エンコード時のパラメータ.
+	 * @param[out] buff          pngファイルのデータが返る.
+	 */
+	bool m_encodePNG (const ImageUtil::LineReader& readLine, const int width, const int height, const int colorType, const int bytesPerPixel, const PNGWriter::CEncodeParam& param, std::vector<unsigned char>& buff) {
+		buff.clear();
+		{
+			const unsigned char signature[] = {0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a};
+			for (int i = 0; i < 8; ++i) buff.push_back(signature[i]);
+		}
+		{
+			std::vector<unsigned char> ihdr;
+			m_writeU32BE(ihdr, width);
+			m_writeU32BE(ihdr, height);
+			ihdr.push_back(8);							// bit depth.
+			ihdr.push_back((unsigned char)colorType);
+			ihdr.push_back(0);							// compression method.
+			ihdr.push_back(0);							// filter method.
+			ihdr.push_back(0);							// interlace method.
+			m_writeChunk(buff, "IHDR", ihdr);
+		}
+		{
+			std::vector<unsigned char> idat;
+			if (!m_compressImage(readLine, width, height, bytesPerPixel, param, idat)) return false;
+			m_writeChunk(buff, "IDAT", idat);
+		}
+		m_writeChunk(buff, "IEND", std::vector<unsigned char>());
+		return true;
+	}
+}
+
+/**
+ * グレイスケール(8bit)のピクセルバッファをPNGファイルとして保存.
+ */
+bool PNGWriter::saveGray8 (const std::string& fileName, const std::vector<unsigned char>& grayBuff, const int width, const int height, const CEncodeParam& param)
+{
+	try {
+		std::vector<unsigned char> buff;
+		if (!encodeGray8(grayBuff, width, height, buff, param)) return false;
+
+		std::ofstream outStream(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!outStream) return false;
+		outStream.write((const char *)&(buff[0]), buff.size());
+		outStream.close();
+		return !outStream.fail();
+	} catch (...) { }
+	return false;
+}
+
+/**
+ * グレイスケール(8bit)のピクセルバッファをPNGとしてメモリ上にエンコード.
+ */
+bool PNGWriter::encodeGray8 (const std::vector<unsigned char>& grayBuff, const int width, const int height, std::vector<unsigned char>& pngBuff, const CEncodeParam& param)
+{
+	pngBuff.clear();
+	if (width <= 0 || height <= 0) return false;
+	if (grayBuff.size() < (size_t)width * (size_t)height) return false;
+
+	const unsigned char* pixels = &(grayBuff[0]);
+	return encodeLines([pixels, width](const int y) { return pixels + (size_t)y * (size_t)width; }, width, height, 1, pngBuff, param);
+}
+
+/**
+ * RGBA(8bit)のピクセルバッファをPNGとしてメモリ上にエンコード.
+ */
+bool PNGWriter::encodeRGBA8 (const std::vector<unsigned char>& rgbaBuff, const int width, const int height, std::vector<unsigned char>& pngBuff, const CEncodeParam& param)
+{
+	pngBuff.clear();
+	if (width <= 0 || height <= 0) return false;
+	if (rgbaBuff.size() < (size_t)width * (size_t)height * 4) return false;
+
+	const unsigned char* pixels = &(rgbaBuff[0]);
+	return encodeLines([pixels, width](const int y) { return pixels + (size_t)y * (size_t)width * 4; }, width, height, 4, pngBuff, param);
+}
+
+/**
+ * 1ラインずつ取得したピクセルをPNGとしてメモリ上にエンコード.
+ */
+bool PNGWriter::encodeLines (const ImageUtil::LineReader& readLine, const int width, const int height, const int channels, std::vector<unsigned char>& pngBuff, const CEncodeParam& param)
+{
+	pngBuff.clear();
+	if (width <= 0 || height <= 0) return false;
+	if (channels != 1 && channels != 4) return false;
+
+	try {
+		bool ret = false;
+		if (channels == 1) {
+			ret = m_encodePNG(readLine, width, height, 0, 1, param, pngBuff);
+
+		} else {
+			// アルファがすべて255かどうか (ラインを1回読み込む).
+			bool opaque = true;
+			for (int y = 0; y < height && opaque; ++y) {
+				const unsigned char* pLine = readLine(y);
+				if (!pLine) return false;
+				for (int x = 0; x < width; ++x) {
+					if (pLine[x * 4 + 3] != 255) {
+						opaque = false;
+						break;
+					}
+				}
+			}
+
+			if (opaque) {
+				std::vector<unsigned char> rgbLine((size_t)width * 3);
+				ret = m_encodePNG([&readLine, &rgbLine, width](const int y) -> const unsigned char* {
+					const unsigned char* pLine = readLine(y);
+					if (!pLine) return NULL;
+					for (int x = 0; x < width; ++x) {
+						rgbLine[x * 3 + 0] = pLine[x * 4 + 0];
+						rgbLine[x * 3 + 1] = pLine[x * 4 + 1];
+						rgbLine[x * 3 + 2] = pLine[x * 4 + 2];
+					}
+					return &(rgbLine[0]);
+				}, width, height, 2, 3, param, pngBuff);
+			} else {
+				ret = m_encodePNG(readLine, width, height, 6, 4, param, pngBuff);
+			}
+		}
+		if (ret) return true;
+	} catch (...) { }
+	pngBuff.clear();
+	return false;
+}
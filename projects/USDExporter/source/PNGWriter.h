@@ -0,0 +1,95 @@
+﻿/**
+ * PNG形式でのテクスチャ出力.
+ * Shade3D SDKに依存せず、グレイスケール(1チャンネル)/RGB/RGBAのPNGファイルを出力する.
+ */
+
+#ifndef _PNGWRITER_H
+#define _PNGWRITER_H
+
+#include "ImageUtil.h"
+
+#include <string>
+#include <vector>
+
+namespace PNGWriter
+{
+	/**
+	 * スキャンラインのフィルタの種類.
+	 */
+	enum FILTER_TYPE {
+		filter_adaptive = 0,		// ラインごとに差分が最小となるものを選択.
+		filter_none,				// None.
+		filter_sub,					// Sub.
+		filter_up,					// Up.
+		filter_average,				// Average.
+		filter_paeth,				// Paeth.
+	};
+
+	/**
+	 * エンコード時のパラメータ.
+	 */
+	class CEncodeParam
+	{
+	public:
+		int compressionLevel;		// 圧縮レベル (0 : 無圧縮 - 9 : 最大圧縮).
+		FILTER_TYPE filterType;		// スキャンラインのフィルタ.
+		bool optimize;				// すべてのフィルタを試して、最もサイズの小さいものを採用する (時間がかかる).
+
+	public:
+		CEncodeParam () {
+			clear();
+		}
+
+		void clear () {
+			compressionLevel = 6;
+			filterType       = filter_adaptive;
+			optimize         = false;
+		}
+	};
+
+	/**
+	 * グレイスケール(8bit)のピクセルバッファをPNGファイルとして保存.
+	 * @param[in] fileName   出力ファイル名.
+	 * @param[in] grayBuff   ピクセル (width x height).
+	 * @param[in] width      幅.
+	 * @param[in] height     高さ.
+	 * @param[in] param      エンコード時のパラメータ.
+	 */
+	bool saveGray8 (const std::string& fileName, const std::vector<unsigned char>& grayBuff, const int width, const int height, const CEncodeParam& param = CEncodeParam());
+
+	/**
+	 * グレイスケール(8bit)のピクセルバッファをPNGとしてメモリ上にエンコード.
+	 * @param[in]  grayBuff   ピクセル (width x height).
+	 * @param[in]  width      幅.
+	 * @param[in]  height     高さ.
+	 * @param[out] pngBuff    pngファイルのデータが返る.
+	 * @param[in]  param      エンコード時のパラメータ.
+	 */
+	bool encodeGray8 (const std::vector<unsigned char>& grayBuff, const int width, const int height, std::vector<unsigned char>& pngBuff, const CEncodeParam& param = CEncodeParam());
+
+	/**
+	 * RGBA(8bit)のピクセルバッファをPNGとしてメモリ上にエンコード.
+	 * アルファがすべて255の場合はRGBとして格納する.
+	 * @param[in]  rgbaBuff   ピクセル (width x height x 4).
+	 * @param[in]  width      幅.
+	 * @param[in]  height     高さ.
+	 * @param[out] pngBuff    pngファイルのデータが返る.
+	 * @param[in]  param      エンコード時のパラメータ.
+	 */
+	bool encodeRGBA8 (const std::vector<unsigned char>& rgbaBuff, const int width, const int height, std::vector<unsigned char>& pngBuff, const CEncodeParam& param = CEncodeParam());
+
+	/**
+	 * 1ラインずつ取得したピクセルをPNGとしてメモリ上にエンコード.
+	 * 画像全体のピクセルをメモリ上に保持しない.
+	 * RGBAの場合は不透明かどうかの判定のため、optimizeの場合はフィルタの比較のため、ラインは複数回読み込まれる.
+	 * @param[in]  readLine   ラインの取得関数.
+	 * @param[in]  width      幅.
+	 * @param[in]  height     高さ.
+	 * @param[in]  channels   1 : グレイスケール , 4 : RGBA (アルファがすべて255の場合はRGBとして格納する).
+	 * @param[out] pngBuff    pngファイルのデータが返る.
+	 * @param[in]  param      エンコード時のパラメータ.
+	 */
+	bool encodeLines (const ImageUtil::LineReader& readLine, const int width, const int height, const int channels, std::vector<unsigned char>& pngBuff, const CEncodeParam& param = CEncodeParam());
+}
+
+#endif
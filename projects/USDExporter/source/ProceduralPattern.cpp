@@ -0,0 +1,185 @@
+﻿/**
+ * Shade3Dのプロシージャルテクスチャ(イメージ以外のパターン)をUV空間でベイク.
+ */
+#include "ProceduralPattern.h"
+#include "ImageUtil.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const int g_tileSize = 64;					// 並列処理するタイルのサイズ.
+	const int g_cloudBaseFrequency = 4;			// 雲の場合の、繰り返し1回あたりの格子数.
+
+	/**
+	 * 矩形波(0または1、周期1)をxまで積分した値.
+	 */
+	inline float m_integrateSquareWave (const float x) {
+		const float fx = std::floor(x);
+		return fx * 0.5f + std::max(x - fx - 0.5f, 0.0f);
+	}
+
+	/**
+	 * テクセルの幅でフィルタリングした矩形波 (エイリアシングを抑える).
+	 * @param[in] x  位置 (1で1周期).
+	 * @param[in] w  テクセルの幅.
+	 */
+	inline float m_filteredSquareWave (const float x, const float w) {
+		return (m_integrateSquareWave(x + w * 0.5f) - m_integrateSquareWave(x - w * 0.5f)) / w;
+	}
+
+	/**
+	 * 格子点のハッシュから0.0 - 1.0の値を求める.
+	 */
+	inline float m_hashLattice (const int ix, const int iy, const unsigned int seed) {
+		unsigned int h = (unsigned int)ix * 0x8da6b343u ^ (unsigned int)iy * 0xd8163841u ^ seed * 0xcb1ab31fu;
+		h ^= h >> 13;
+		h *= 0x5bd1e995u;
+		h ^= h >> 15;
+		return (float)(h & 0xffffff) * (1.0f / 16777215.0f);
+	}
+
+	/**
+	 * 周期的なバリューノイズ (0.0 - 1.0).
+	 * @param[in] period  格子の周期 (x/yとも).
+	 */
+	inline float m_valueNoise (const float x, const float y, const int periodX, const int periodY, const unsigned int seed) {
+		const float fx = std::floor(x);
+		const float fy = std::floor(y);
+		const float tx = x - fx;
+		const float ty = y - fy;
+		int ix0 = (int)fx % periodX;
+		int iy0 = (int)fy % periodY;
+		if (ix0 < 0) ix0 += periodX;
+		if (iy0 < 0) iy0 += periodY;
+		const int ix1 = (ix0 + 1) % periodX;
+		const int iy1 = (iy0 + 1) % periodY;
+
+		// 5次のエルミート補間.
+		const float sx = tx * tx * tx * (tx * (tx * 6.0f - 15.0f) + 10.0f);
+		const float sy = ty * ty * ty * (ty * (ty * 6.0f - 15.0f) + 10.0f);
+		const float v00 = m_hashLattice(ix0, iy0, seed);
+		const float v10 = m_hashLattice(ix1, iy0, seed);
+		const float v01 = m_hashLattice(ix0, iy1, seed);
+		const float v11 = m_hashLattice(ix1, iy1, seed);
+		const float v0 = v00 + (v10 - v00) * sx;
+		const float v1 = v01 + (v11 - v01) * sx;
+		return v0 + (v1 - v0) * sy;
+	}
+
+	/**
+	 * 1タイル内の1ライン分の濃さを計算.
+	 * 分岐をパターンの種類ごとのループの外に出し、ループ内はコンパイラがベクトル化できる形にする.
+	 * @param[in]  uBuff   テクセルごとのU (繰り返しを含む).
+	 * @param[in]  v       V (繰り返しを含む).
+	 * @param[in]  du/dv   1テクセルあたりのU/Vの幅.
+	 * @param[out] pDst    濃さ.
+	 */
+	void m_evalLine (const ProceduralPattern::CPatternParam& param, const float* uBuff, const float v, const float du, const float dv, const int count, float* pDst) {
+		switch (param.type) {
+		case ProceduralPattern::pattern_checker:
+			{
+				// 繰り返し1回で2x2の升目.
+				const float sy = m_filteredSquareWave(v, dv);
+				for (int i = 0; i < count; ++i) {
+					const float sx = m_filteredSquareWave(uBuff[i], du);
+					pDst[i] = sx * sy + (1.0f - sx) * (1.0f - sy);
+				}
+			}
+			break;
+
+		case ProceduralPattern::pattern_stripe:
+			for (int i = 0; i < count; ++i) pDst[i] = m_filteredSquareWave(uBuff[i], du);
+			break;
+
+		case ProceduralPattern::pattern_cloud:
+			{
+				for (int i = 0; i < count; ++i) pDst[i] = 0.0f;
+				float amplitude = 0.5f;
+				float sumAmplitude = 0.0f;
+				int frequency = g_cloudBaseFrequency;
+				const int octaves = std::max(1, std::min(param.octaves, 10));
+				for (int o = 0; o < octaves; ++o) {
+					const int periodX = frequency * std::max(1, param.repeatU);
+					const int periodY = frequency * std::max(1, param.repeatV);
+					const float ny = v * (float)frequency;
+					for (int i = 0; i < count; ++i) {
+						pDst[i] += amplitude * m_valueNoise(uBuff[i] * (float)frequency, ny, periodX, periodY, param.seed + (unsigned int)o);
+					}
+					sumAmplitude += amplitude;
+					amplitude *= 0.5f;
+					frequency *= 2;
+				}
+				const float scale = 1.0f / sumAmplitude;
+				for (int i = 0; i < count; ++i) pDst[i] *= scale;
+			}
+			break;
+		}
+
+		if (param.flipColor) {
+			for (int i = 0; i < count; ++i) pDst[i] = 1.0f - pDst[i];
+		}
+		for (int i = 0; i < count; ++i) pDst[i] = std::min(std::max(pDst[i], 0.0f), 1.0f);
+	}
+}
+
+/**
+ * パターンの濃さをUV空間でベイク.
+ */
+bool ProceduralPattern::bakeMask (const CPatternParam& param, const int width, const int height, std::vector<float>& maskBuff)
+{
+	maskBuff.clear();
+	if (width <= 0 || height <= 0) return false;
+
+	try {
+		maskBuff.resize((size_t)width * (size_t)height);
+
+		const int tilesX = (width  + g_tileSize - 1) / g_tileSize;
+		const int tilesY = (height + g_tileSize - 1) / g_tileSize;
+		const float repeatU = (float)std::max(1, param.repeatU);
+		const float repeatV = (float)std::max(1, param.repeatV);
+
+		ImageUtil::parallelFor(tilesX * tilesY, [&](const int iStart, const int iEnd) {
+			float uBuff[g_tileSize];
+			float lineBuff[g_tileSize];
+			for (int tileIndex = iStart; tileIndex < iEnd; ++tileIndex) {
+				const int x0 = (tileIndex % tilesX) * g_tileSize;
+				const int y0 = (tileIndex / tilesX) * g_tileSize;
+				const int countX = std::min(g_tileSize, width - x0);
+				const int countY = std::min(g_tileSize, height - y0);
+
+				for (int ty = 0; ty < countY; ++ty) {
+					const int y = y0 + ty;
+
+					// テクセルの中心のUV (イメージの上端がV=1).
+					float s = ((float)y + 0.5f) / (float)height;
+					if (param.flipV) s = 1.0f - s;
+					const float texV = 1.0f - s;
+
+					for (int tx = 0; tx < countX; ++tx) {
+						float texU = ((float)(x0 + tx) + 0.5f) / (float)width;
+						if (param.flipH) texU = 1.0f - texU;
+						uBuff[tx] = texU;
+					}
+
+					float* pDst = &(maskBuff[(size_t)y * (size_t)width + (size_t)x0]);
+					if (param.swapAxes) {
+						// UとVを入れ替える場合は、テクセルごとにVが変わるため1テクセルずつ計算.
+						for (int tx = 0; tx < countX; ++tx) {
+							const float u = texV * repeatU;
+							m_evalLine(param, &u, uBuff[tx] * repeatV, repeatU / (float)height, repeatV / (float)width, 1, lineBuff + tx);
+						}
+					} else {
+						for (int tx = 0; tx < countX; ++tx) uBuff[tx] *= repeatU;
+						m_evalLine(param, uBuff, texV * repeatV, repeatU / (float)width, repeatV / (float)height, countX, lineBuff);
+					}
+					std::copy(lineBuff, lineBuff + countX, pDst);
+				}
+			}
+		}, (tilesX * tilesY < 4) ? 1 : 0);		// 小さいイメージはスレッド化しない.
+		return true;
+
+	} catch (...) { }
+	maskBuff.clear();
+	return false;
+}
@@ -0,0 +1,64 @@
+﻿/**
+ * Shade3Dのプロシージャルテクスチャ(イメージ以外のパターン)をUV空間でベイク.
+ * Shade3D SDKに依存せず、パターンの濃さ(0.0 - 1.0)をテクセルごとに計算する.
+ */
+
+#ifndef _PROCEDURALPATTERN_H
+#define _PROCEDURALPATTERN_H
+
+#include <vector>
+
+namespace ProceduralPattern
+{
+	/**
+	 * パターンの種類.
+	 */
+	enum PATTERN_TYPE {
+		pattern_checker = 0,		// 市松模様.
+		pattern_stripe,				// 縞 (U方向に並ぶ).
+		pattern_cloud,				// 雲 (フラクタルノイズ).
+	};
+
+	/**
+	 * パターンのパラメータ.
+	 */
+	class CPatternParam
+	{
+	public:
+		PATTERN_TYPE type;			// パターンの種類.
+		int repeatU, repeatV;		// 繰り返し回数.
+		bool flipColor;				// 濃さを反転.
+		bool flipH, flipV;			// 左右反転/上下反転.
+		bool swapAxes;				// UとVを入れ替える.
+		int octaves;				// 雲の場合の、重ねるノイズの数.
+		unsigned int seed;			// 雲の場合の乱数の種.
+
+	public:
+		CPatternParam () {
+			clear();
+		}
+
+		void clear () {
+			type      = pattern_checker;
+			repeatU   = repeatV = 1;
+			flipColor = false;
+			flipH     = flipV = false;
+			swapAxes  = false;
+			octaves   = 5;
+			seed      = 0;
+		}
+	};
+
+	/**
+	 * パターンの濃さをUV空間でベイク.
+	 * テクスチャの端で繋がるように、繰り返し回数単位で周期的なパターンとなる.
+	 * 64x64のタイル単位で、複数スレッドで計算する.
+	 * @param[in]  param      パターンのパラメータ.
+	 * @param[in]  width      幅.
+	 * @param[in]  height     高さ.
+	 * @param[out] maskBuff   濃さ (0.0 - 1.0) が返る (width x height). イメージと同じく上のラインから格納.
+	 */
+	bool bakeMask (const CPatternParam& param, const int width, const int height, std::vector<float>& maskBuff);
+}
+
+#endif
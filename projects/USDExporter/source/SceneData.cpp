@@ -7,15 +7,92 @@
 #include "USDExporter.h"
 #include "Shade3DUtil.h"
 #include "MathUtil.h"
+#include "ImageUtil.h"
+#include "KTX2Writer.h"
+#include "PNGWriter.h"
+#include "JPEGWriter.h"
+#include "USDZWriter.h"
+#include "FileUtil.h"
+#include "HashUtil.h"
 #include "StreamCtrl.h"
 #include "SkeletonData.h"
 #include "AnimKeyframeBake.h"
+#include "CalcSurfaceArea.h"
+#include "TextureAtlas.h"
+#include "AmbientOcclusionBake.h"
+
+#include <fstream>
+#include <cstdio>
+#include <set>
+#include <map>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
 
 #define MATERIAL_ROOT_PATH  "/root/Materials"
 #define SKELETONS_ROOT_PATH  "/root/Skeletons"
 #define ROOT_PATH  "/root"
 #define MASTER_OBJECT_PART_PATH "/root/MasterObjects"
 
+namespace {
+	/**
+	 * 配列のハッシュ値を計算 (要素数も含める).
+	 */
+	template<typename T> unsigned long long m_hashVector (const std::vector<T>& values, const unsigned long long hash) {
+		const unsigned long long count = (unsigned long long)values.size();
+		unsigned long long h = HashUtil::calcFNV1a64(&count, sizeof(count), hash);
+		if (!values.empty()) h = HashUtil::calcFNV1a64(&(values[0]), sizeof(T) * values.size(), h);
+		return h;
+	}
+
+	/**
+	 * 文字列のハッシュ値を計算.
+	 */
+	unsigned long long m_hashString (const std::string& str, const unsigned long long hash) {
+		return m_hashVector(std::vector<char>(str.begin(), str.end()), hash);
+	}
+
+	/**
+	 * 変換行列のハッシュ値を計算.
+	 */
+	unsigned long long m_hashMatrix (const USD_DATA::NodeMatrixData& matrix, const unsigned long long hash) {
+		unsigned long long h = HashUtil::calcFNV1a64(matrix.translate, sizeof(float) * 3, hash);
+		h = HashUtil::calcFNV1a64(matrix.rotate, sizeof(float) * 3, h);
+		return HashUtil::calcFNV1a64(matrix.scale, sizeof(float) * 3, h);
+	}
+
+	/**
+	 * 面ごとのUVから、UV空間上の面積の合計を計算.
+	 */
+	double m_calcUVArea (const std::vector<int>& faceVertexCounts, const std::vector<sxsdk::vec2>& faceUVs) {
+		double areaV = 0.0;
+		size_t iPos = 0;
+		for (size_t i = 0; i < faceVertexCounts.size(); ++i) {
+			const int vCou = faceVertexCounts[i];
+			if (iPos + vCou > faceUVs.size()) break;
+			double a = 0.0;
+			for (int j = 0; j < vCou; ++j) {
+				const sxsdk::vec2& uv0 = faceUVs[iPos + j];
+				const sxsdk::vec2& uv1 = faceUVs[iPos + ((j + 1) % vCou)];
+				a += (double)uv0.x * (double)uv1.y - (double)uv1.x * (double)uv0.y;
+			}
+			areaV += std::abs(a) * 0.5;
+			iPos += vCou;
+		}
+		return areaV;
+	}
+
+	/**
+	 * 変換行列による面積の拡大率 (回転/移動は影響しない).
+	 */
+	double m_calcMatrixAreaScale (const sxsdk::mat4& m) {
+		const double det = (double)m[0][0] * ((double)m[1][1] * m[2][2] - (double)m[1][2] * m[2][1])
+						 - (double)m[0][1] * ((double)m[1][0] * m[2][2] - (double)m[1][2] * m[2][0])
+						 + (double)m[0][2] * ((double)m[1][0] * m[2][1] - (double)m[1][1] * m[2][0]);
+		return std::pow(std::abs(det), 2.0 / 3.0);
+	}
+}
+
 CSceneData::CSceneData ()
 {
 	clear();
@@ -35,20 +112,29 @@ void CSceneData::clear ()
 	tmpMeshData.clear();
 	nodesList.clear();
 	materialsList.clear();
+	m_surfaceMaterialIndex.clear();
+	m_materialHashIndices.clear();
 	m_exportFilesList.clear();
+	m_usdzFileName = "";
+	m_pUSDZWriter = NULL;
+	m_manifest.clear();
+	m_prevManifest.clear();
+	m_incrementalExport = false;
+	m_materialsExportTime = 0.0;
 }
 
 /**
  * エクスポート開始の情報を渡す.
  * @param[in] scene        Shade3Dのシーンクラス.
  * @param[in] exportParam  エクスポートパラメータ.
+ * @param[in] workPath     作業フォルダ (ベイクしたテクスチャのピクセルを一時ファイルとして退避する).
  */
-void CSceneData::setupExport (sxsdk::scene_interface* scene, const CExportParam& exportParam)
+void CSceneData::setupExport (sxsdk::scene_interface* scene, const CExportParam& exportParam, const std::string& workPath)
 {
 	m_pScene = scene;
 	m_exportParam = exportParam;
 
-	m_materialTextureBake.reset(new CMaterialTextureBake(m_pScene, m_exportParam));
+	m_materialTextureBake.reset(new CMaterialTextureBake(m_pScene, m_exportParam, workPath));
 }
 
 /**
@@ -472,16 +558,26 @@ void CSceneData::appendNodeMesh (sxsdk::shape_class* shape, const std::string& n
 				m_materialTextureBake->getMaterialFromMasterSurface(masterSurface, NULL, materialD);
 			}
 
-			// ユニークなマテリアル名を取得.
-			const std::string newName = m_findNames.appendName(materialD.name, USD_DATA::NODE_TYPE::material_node);
-			materialD.name = newName;
-			materialD.pSurface = (void *)tmpMaterialSurfaceList[tmpMaterialIndex];		// sxsdk::surface_classの識別用.
-			materialD.refCount = 1;
-			matIndex = (int)materialsList.size();
-			materialsList.push_back(materialD);
+			// 異なる表面材質でも、同じパラメータのマテリアルがある場合はそれを参照する.
+			matIndex = m_exportParam.mergeSameMaterials ? m_findSameMaterialData(materialD) : -1;
+			if (matIndex >= 0) {
+				materialsList[matIndex].refCount++;
+			} else {
+				// ユニークなマテリアル名を取得.
+				const std::string newName = m_findNames.appendName(materialD.name, USD_DATA::NODE_TYPE::material_node);
+				materialD.name = newName;
+				materialD.pSurface = (void *)tmpMaterialSurfaceList[tmpMaterialIndex];		// sxsdk::surface_classの識別用.
+				materialD.refCount = 1;
+				matIndex = (int)materialsList.size();
+				materialsList.push_back(materialD);
+				m_materialHashIndices[materialD.getHash()].push_back(matIndex);
+			}
 
+			// 同じ表面材質は、以降はベイクせずにこのマテリアルを参照する.
+			void* pSurface = (void *)tmpMaterialSurfaceList[tmpMaterialIndex];
+			m_surfaceMaterialIndex[pSurface] = matIndex;
 			for (size_t j = 0; j < tmpMaterialIndexList.size(); ++j) {
-				if ((void *)tmpMaterialSurfaceList[j] == materialD.pSurface) {
+				if ((void *)tmpMaterialSurfaceList[j] == pSurface) {
 					tmpMaterialIndexList[j] = matIndex;
 				}
 			}
@@ -507,15 +603,8 @@ void CSceneData::appendNodeMesh (sxsdk::shape_class* shape, const std::string& n
  */
 int CSceneData::m_findSameMaterial (sxsdk::surface_class* pSurface)
 {
-	int matIndex = -1;
-	for (size_t i = 0; i < materialsList.size(); ++i) {
-		const CMaterialData& mD = materialsList[i];
-		if (mD.pSurface == (void *)pSurface) {
-			matIndex = (int)i;
-			break;
-		}
-	}
-	return matIndex;
+	std::map<void*, int>::const_iterator iter = m_surfaceMaterialIndex.find((void *)pSurface);
+	return (iter != m_surfaceMaterialIndex.end()) ? iter->second : -1;
 }
 
 int CSceneData::m_findSameMaterial (sxsdk::master_surface_class* pMasterSurface)
@@ -526,6 +615,22 @@ int CSceneData::m_findSameMaterial (sxsdk::master_surface_class* pMasterSurface)
 	return m_findSameMaterial(pSurface);
 }
 
+/**
+ * 同じパラメータを持つマテリアル番号を取得.
+ * パラメータのハッシュ値で候補を絞り、isSameで比較する.
+ */
+int CSceneData::m_findSameMaterialData (const CMaterialData& materialD)
+{
+	std::unordered_map<unsigned long long, std::vector<int> >::const_iterator iter = m_materialHashIndices.find(materialD.getHash());
+	if (iter == m_materialHashIndices.end()) return -1;
+
+	const std::vector<int>& indices = iter->second;
+	for (size_t i = 0; i < indices.size(); ++i) {
+		if (materialsList[indices[i]].isSame(materialD)) return indices[i];
+	}
+	return -1;
+}
+
 /**
  * Shade3Dの変換行列から USD_DATA::NodeMatrixData に変換.
  */
@@ -555,6 +660,10 @@ USD_DATA::NodeMatrixData CSceneData::m_convMatrix (const sxsdk::mat4& m)
 
 /**
  * USDファイルを出力.
+ * 差分エクスポートの場合は、前回から変更のあったノードとマテリアルのみを書き換える.
+ * テクスチャのベイク (AOのベイク、アトラスへのまとめを含む)はすべてのマテリアルで行う.
+ * AOは形状の変更で、アトラスは他のマテリアルの変更で結果が変わるため、表面材質単位では省略できない.
+ * ベイク結果が前回と同じテクスチャは、出力済みのファイルをそのまま使用する (m_reuseTextureFiles).
  * @param[in] shade        shade_interface
  * @param[in] filePath     出力ファイル名（絶対パス）.
  */
@@ -566,12 +675,55 @@ void CSceneData::exportUSD (sxsdk::shade_interface& shade, const std::string& fi
 	m_usdzFileName = "";
 	m_exportFilesList.clear();
 	m_exportFilesList.push_back(filePath);
+	m_texturesReport.clear();
+	m_materialsExportTime = 0.0;
+
+	// 差分エクスポートの場合は、前回の出力情報を読み込む.
+	// エクスポートパラメータが前回と異なる場合は、すべてを出力し直す.
+	// 出力先のファイルはエクスポート開始時に空にされるため、マニフェストと一緒に保存した前回のUSDファイルのコピーを元にする.
+	const std::string manifestFileName  = CExportManifest::getManifestFileName(filePath);
+	const std::string baseLayerFileName = CExportManifest::getBaseLayerFileName(filePath);
+	m_manifest.clear();
+	m_prevManifest.clear();
+	m_incrementalExport = false;
+	if (m_useExportManifest()) {
+		m_manifest.paramsHash = m_exportParam.getHash();
+		if (m_prevManifest.load(manifestFileName) && m_prevManifest.paramsHash == m_manifest.paramsHash && FileUtil::existFile(baseLayerFileName)) {
+			m_incrementalExport = true;
+		} else {
+			m_prevManifest.clear();
+		}
+	}
+
+	// Occlusionテクスチャがないマテリアルに、Ambient Occlusionをベイク.
+	m_bakeAmbientOcclusion();
+
+	// 小さいベイク済みテクスチャをアトラスにまとめる.
+	m_packTexturesAtlas();
 
 	// テクスチャを出力.
-	m_exportTextures(filePath);
+	// usdzのみを出力する場合は、exportUSDZでusdzに直接格納する.
+	if (!m_isUSDZOnlyOutput()) m_exportTextures(filePath);
 
 	// エクスポート開始.
-	usdExport.beginExport(filePath, m_exportParam);
+	// 同一フォルダの一時ファイルに出力し、完了後に置き換える.
+	// 差分エクスポートの場合は、前回出力したファイルのコピーを開いて書き換える.
+	const std::string tempFilePath = FileUtil::getTempFileName(filePath);
+	usdExport.beginExport(tempFilePath, m_exportParam, m_incrementalExport ? baseLayerFileName : std::string(""));
+
+	// 形状/マテリアル/アニメーションを別々のサブレイヤとして出力する場合.
+	// サブレイヤも同一フォルダの一時ファイルに出力し、完了後に置き換える.
+	std::vector<std::string> subLayerFileNames, subLayerTempFileNames;
+	if (m_useSplitLayers()) {
+		m_getSubLayerFileNames(filePath, subLayerFileNames);
+		std::vector<std::string> subLayerNames;
+		for (size_t i = 0; i < subLayerFileNames.size(); ++i) {
+			const bool useLayer = (subLayerFileNames[i] != "");
+			subLayerTempFileNames.push_back(useLayer ? FileUtil::getTempFileName(subLayerFileNames[i]) : std::string(""));
+			subLayerNames.push_back(useLayer ? (std::string("./") + StringUtil::getFileName(subLayerFileNames[i])) : std::string(""));
+		}
+		usdExport.createSubLayers(subLayerTempFileNames, subLayerNames);
+	}
 
 	// プラグインバージョンを取得して渡す.
 	{
@@ -586,17 +738,21 @@ void CSceneData::exportUSD (sxsdk::shade_interface& shade, const std::string& fi
 	// スキンを持つ形状で、名前の重複がある場合は別名を付ける.
 	m_makeUniqueName();
 
+	// 差分エクスポートの場合は、削除されたノードとマテリアルを削除.
+	if (m_incrementalExport) m_removeOldNodes(usdExport);
+
 	// マテリアルを追加.
+	// 差分エクスポートの場合は、前回から変更のあったマテリアルのみを出力し直す.
 	if (!materialsList.empty()) {
-		usdExport.SetImagesList(m_materialTextureBake->getImagesList());
+		const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		std::vector<CMaterialData> changedMaterialsList;
 		for (size_t i = 0; i < materialsList.size(); ++i) {
-			const CMaterialData& matD = materialsList[i];
-			if (!m_exportParam.useShaderMDL()) {
-				usdExport.appendNodeMaterial(matD);
-			} else {
-				usdExport.appendNodeMaterial_OmniverseMDL(matD);
-			}
+			if (m_useExportManifest() && m_checkSameMaterial(usdExport, materialsList[i])) continue;
+			changedMaterialsList.push_back(materialsList[i]);
 		}
+		usdExport.SetImagesList(m_materialTextureBake->getImagesList());
+		usdExport.appendNodeMaterials(changedMaterialsList);
+		m_materialsExportTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
 	}
 
 	// アニメーション情報を出力 (ヘッダ部).
@@ -628,6 +784,18 @@ void CSceneData::exportUSD (sxsdk::shade_interface& shade, const std::string& fi
 
 				// 変換行列.
 				const USD_DATA::NodeMatrixData usdMatrix = m_convMatrix(nodeD.matrix);
+
+				// 差分エクスポート時に、前回から変更がない場合はスキップ.
+				if (m_useExportManifest()) {
+					unsigned long long hash = HashUtil::calcFNV1a64(&(nodeD.nodeType), sizeof(nodeD.nodeType));
+					hash = m_hashString(nodeD.name, hash);
+					hash = m_hashMatrix(usdMatrix, hash);
+					hash = m_hashVector(nodeD.jointMotion.translations, hash);
+					hash = m_hashVector(nodeD.jointMotion.rotations, hash);
+					hash = m_hashVector(nodeD.jointMotion.scales, hash);
+					if (m_checkSameNode(usdExport, nodeD.name, hash)) continue;
+				}
+
 				usdExport.appendNodeNull(nodeD.name, usdMatrix, nodeD.jointMotion);
 
 			} else if ((nodeBaseD.nodeType) == USD_DATA::NODE_TYPE::mesh_node) {
@@ -649,6 +817,31 @@ void CSceneData::exportUSD (sxsdk::shade_interface& shade, const std::string& fi
 				// スケルトン情報(m_skeletonList)から、メッシュ情報での参照(ジョイントインデックス)を取得/格納.
 				m_setMeshSkeletonRef(nodeD, tmpMeshData);
 
+				// 差分エクスポート時に、前回から変更がない場合はスキップ.
+				// スキンを出力する場合は差分エクスポートを行わないため、スキン情報はハッシュ値に含めない.
+				if (m_useExportManifest()) {
+					unsigned long long hash = HashUtil::calcFNV1a64(&(nodeD.nodeType), sizeof(nodeD.nodeType));
+					hash = m_hashString(nodeD.name, hash);
+					hash = m_hashMatrix(usdMatrix, hash);
+					hash = m_hashVector(tmpMeshData.vertices, hash);
+					hash = m_hashVector(tmpMeshData.normals, hash);
+					hash = m_hashVector(tmpMeshData.color0, hash);
+					hash = m_hashVector(tmpMeshData.faceVertexCounts, hash);
+					hash = m_hashVector(tmpMeshData.faceIndices, hash);
+					hash = m_hashVector(tmpMeshData.faceUV0, hash);
+					hash = m_hashVector(tmpMeshData.faceUV1, hash);
+					hash = m_hashString(tmpMeshData.refMaterialName, hash);
+					{
+						std::vector<int> values;
+						values.push_back(tmpMeshData.materialIndex);
+						values.push_back(tmpMeshData.subdivision ? 1 : 0);
+						values.push_back(tmpMeshData.faceGroupMesh ? 1 : 0);
+						values.push_back(doubleSided ? 1 : 0);
+						hash = m_hashVector(values, hash);
+					}
+					if (m_checkSameNode(usdExport, nodeD.name, hash)) continue;
+				}
+
 				usdExport.appendNodeMesh(nodeD.name, usdMatrix, tmpMeshData, doubleSided);
 			}
 		}
@@ -671,7 +864,10 @@ void CSceneData::exportUSD (sxsdk::shade_interface& shade, const std::string& fi
 					for (size_t j = 0; j < orgNameList.size(); ++j) {
 						orgShapeName    = orgNameList[j];
 						orgMaterialName = orgMaterialNameList[j];
-						if (orgShapeName != "") usdExport.setShapeReference(nodeD.name, orgShapeName, orgMaterialName);
+						if (orgShapeName != "") {
+							const std::string refNodeName = usdExport.setShapeReference(nodeD.name, orgShapeName, orgMaterialName);
+							if (refNodeName != "" && m_useExportManifest()) m_manifest.refNodesList.push_back(refNodeName);
+						}
 						if (orgMaterialName == "") linkPartF = true;
 					}
 
@@ -693,6 +889,25 @@ void CSceneData::exportUSD (sxsdk::shade_interface& shade, const std::string& fi
 
 	// エクスポート終了.
 	usdExport.endExport();
+	const bool replacedF = FileUtil::replaceFile(tempFilePath, filePath);
+	for (size_t i = 0; i < subLayerFileNames.size(); ++i) {
+		if (subLayerFileNames[i] == "") continue;
+		if (FileUtil::replaceFile(subLayerTempFileNames[i], subLayerFileNames[i])) {
+			// USDZ出力時のためのファイル名保持.
+			m_exportFilesList.push_back(subLayerFileNames[i]);
+		}
+	}
+
+	// 次回の差分エクスポート用に、出力情報と出力したUSDファイルのコピーを保存.
+	// 差分エクスポートを使用しない場合や出力に失敗した場合は、内容が一致しなくなるため前回の出力情報を削除する.
+	bool savedF = false;
+	if (m_useExportManifest() && replacedF) {
+		savedF = FileUtil::copyFile(filePath, baseLayerFileName) && m_manifest.save(manifestFileName);
+	}
+	if (!savedF) {
+		std::remove(manifestFileName.c_str());
+		std::remove(baseLayerFileName.c_str());
+	}
 }
 
 /**
@@ -705,6 +920,12 @@ void CSceneData::m_exportTextures (const std::string& filePath)
 	// ディレクトリパスを取得.
 	const std::string fileDir = StringUtil::getFileDir(filePath);
 
+	// 最大テクスチャサイズが自動の場合は、テクセル密度から必要なサイズを計算.
+	m_calcTexturesRequiredSize();
+
+	// ktx2をsRGBとして出力するテクスチャを調べる.
+	m_calcTexturesSRGB();
+
 	// テクスチャをファイル出力.
 	const std::vector<CImageData>& imagesList = m_materialTextureBake->getImagesList();
 	for (size_t i = 0; i < imagesList.size(); ++i) {
@@ -712,6 +933,10 @@ void CSceneData::m_exportTextures (const std::string& filePath)
 		if (imageD.fileName == "") continue;
 
 		const std::string fileName = fileDir + StringUtil::getFileSeparator() + imageD.fileName;
+
+		// 差分エクスポート時に、前回と同じテクスチャの場合は出力済みのファイルを使用.
+		if (m_reuseTextureFiles(fileName, (int)i, imageD)) continue;
+
 		if (imageD.pMasterImageHandle) {
 			try {
 				sxsdk::master_image_class& masterImage = m_pScene->get_shape_by_handle(imageD.pMasterImageHandle)->get_master_image();
@@ -721,25 +946,121 @@ void CSceneData::m_exportTextures (const std::string& filePath)
 					if (imageD.texTransform.convGrayscale) {
 						// テクスチャのピクセルを加工する場合.
 						compointer<sxsdk::image_interface> image2(Shade3DUtil::createImageWithTransform(image, imageD.textureSource, imageD.texTransform));
-						m_saveTextureImage(fileName, image2);
+						m_saveTextureImage(fileName, (int)i, image2, (imageD.textureSource != USD_DATA::TEXTURE_SOURE::texture_source_rgb));
 
 					} else if (imageD.texTransform.isDefault()) {		// 変換要素がない場合.
-						m_saveTextureImage(fileName, image);
+						// 元の画像ファイルをコピーできない場合はキャッシュ済みのピクセルから、それもできない場合はイメージから出力.
+						if (!m_copySourceImageFile(fileName, (int)i, masterImage, image->get_size())) {
+							if (!m_saveTextureCachedPixels(fileName, (int)i, imageD.pMasterImageHandle)) m_saveTextureImage(fileName, (int)i, image);
+						}
 
 					} else {					// 変換要素がある場合.
 						compointer<sxsdk::image_interface> image2(Shade3DUtil::createImageWithTransform(image, imageD.textureSource, imageD.texTransform));
-						m_saveTextureImage(fileName, image2);
+						m_saveTextureImage(fileName, (int)i, image2);
 					}
-
-					// USDZ出力時のためのファイル名保持.
-					m_exportFilesList.push_back(fileName);
 				}
 			} catch (...) { }
 
-		} else if (!imageD.rgbaBuff.empty()) {
+		} else if (imageD.hasPixels()) {
 			// ベイクされたカスタムイメージを保存する場合.
-			const int width  = imageD.imageWidth;
-			const int height = imageD.imageHeight;
+			int width  = imageD.imageWidth;
+			int height = imageD.imageHeight;
+			const bool grayF = (imageD.pixelFormat == USD_DATA::IMAGE_PIXEL_FORMAT::image_pixel_format_gray8);
+
+			// 最大テクスチャサイズを超えるか.
+			const sx::vec<int,2> newSize = m_calcOutputTextureSize((int)i, sx::vec<int,2>(width, height));
+			const bool needResize = (newSize.x != width || newSize.y != height);
+
+			// グレイスケールでpngとして出力する場合は、1チャンネルのpngとして出力.
+			// png/jpegの場合は、エクスポートパラメータの圧縮設定でピクセルバッファから直接エンコードする.
+			const bool outputKTX2 = (m_exportParam.optTextureType == USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_ktx2);
+			const std::string extStr = StringUtil::getFileExtension(fileName);
+			const bool outputGrayPNG = grayF && (extStr == "png");
+			const bool encodePixels = (extStr == "png" || extStr == "jpg" || extStr == "jpeg");
+
+			// リサイズ/KTX2の出力がない場合は、png/jpegのエンコーダに1ラインずつ渡す.
+			// ベイク時に一時ファイルに退避したピクセルは、ここでもメモリ上に展開しない.
+			if (!needResize && !outputKTX2 && encodePixels) {
+				CImagePixelsReader pixelsReader(imageD);
+				const ImageUtil::LineReader readLine = [&pixelsReader](const int y) -> const unsigned char* {
+					if (y == 0) pixelsReader.rewind();		// エンコーダは複数回読み込む場合がある.
+					return pixelsReader.readLine();
+				};
+				if (m_outputTextureLines(fileName, readLine, width, height, grayF)) continue;
+			}
+
+			// リサイズ/KTX2/png/jpegの出力がない場合は、1ラインずつイメージに渡す.
+			if (!needResize && !outputKTX2 && !encodePixels) {
+				compointer<sxsdk::image_interface> image(m_pScene->create_image_interface(sx::vec<int,2>(width, height)));
+				if (!image) continue;
+
+				CImagePixelsReader pixelsReader(imageD);
+				std::vector<sx::rgba8_class> lineBuff(width);
+				bool retF = true;
+				for (int y = 0; y < height; ++y) {
+					const unsigned char* pLine = pixelsReader.readLine();
+					if (!pLine) {
+						retF = false;
+						break;
+					}
+					for (int x = 0; x < width; ++x) {
+						if (grayF) {
+							lineBuff[x].red = lineBuff[x].green = lineBuff[x].blue = pLine[x];
+							lineBuff[x].alpha = 255;
+						} else {
+							lineBuff[x].red   = pLine[x * 4 + 0];
+							lineBuff[x].green = pLine[x * 4 + 1];
+							lineBuff[x].blue  = pLine[x * 4 + 2];
+							lineBuff[x].alpha = pLine[x * 4 + 3];
+						}
+					}
+					image->set_pixels_rgba(0, y, width, 1, &(lineBuff[0]));
+				}
+				if (!retF) continue;
+
+				m_outputTextureImage(fileName, image);
+				continue;
+			}
+
+			// このイメージのピクセルのみをメモリに読み込む.
+			std::vector<unsigned char> srcBuff;
+			if (!imageD.loadPixels(srcBuff)) continue;
+
+			// 最大テクスチャサイズを超える場合は、イメージを作成する前にピクセルバッファのままリサイズ.
+			std::vector<unsigned char> resizedBuff;
+			if (needResize) {
+				bool retF = false;
+				if (grayF) {
+					retF = ImageUtil::resizeGray8(srcBuff, width, height, resizedBuff, newSize.x, newSize.y, ImageUtil::resize_filter_lanczos3);
+				} else {
+					retF = ImageUtil::resizeRGBA8(srcBuff, width, height, resizedBuff, newSize.x, newSize.y, ImageUtil::resize_filter_lanczos3);
+				}
+				if (retF) {
+					width  = newSize.x;
+					height = newSize.y;
+					std::vector<unsigned char>().swap(srcBuff);
+				} else {
+					resizedBuff.clear();
+				}
+			}
+			const std::vector<unsigned char>& pixelsBuff = resizedBuff.empty() ? srcBuff : resizedBuff;
+
+			// RGBAとして参照する場合のピクセル.
+			std::vector<unsigned char> grayToRGBABuff;
+			if (grayF && (outputKTX2 || !outputGrayPNG)) ImageUtil::convertGray8ToRGBA8(pixelsBuff, grayToRGBABuff);
+			const std::vector<unsigned char>& rgbaBuff = grayF ? grayToRGBABuff : pixelsBuff;
+
+			// KTX2の場合は、ピクセルバッファから直接出力.
+			if (outputKTX2) {
+				m_saveTextureKTX2(fileName, (int)i, rgbaBuff, width, height);
+				if (!m_exportParam.useShaderPreviewSurface()) continue;		// MDLのみの場合はpngは参照されない.
+			}
+
+			if (outputGrayPNG) {
+				m_outputTexturePixels(fileName, pixelsBuff, width, height, true);
+				continue;
+			}
+			if (encodePixels && m_outputTexturePixels(fileName, rgbaBuff, width, height, false)) continue;
 
 			// イメージを作成.
 			compointer<sxsdk::image_interface> image(m_pScene->create_image_interface(sx::vec<int,2>(width, height)));
@@ -749,19 +1070,16 @@ void CSceneData::m_exportTextures (const std::string& filePath)
 				int iPos = 0;
 				for (int y = 0; y < height; ++y) {
 					for (int x = 0; x < width; ++x) {
-						lineBuff[x].red   = imageD.rgbaBuff[iPos + 0];
-						lineBuff[x].green = imageD.rgbaBuff[iPos + 1];
-						lineBuff[x].blue  = imageD.rgbaBuff[iPos + 2];
-						lineBuff[x].alpha = imageD.rgbaBuff[iPos + 3];
+						lineBuff[x].red   = rgbaBuff[iPos + 0];
+						lineBuff[x].green = rgbaBuff[iPos + 1];
+						lineBuff[x].blue  = rgbaBuff[iPos + 2];
+						lineBuff[x].alpha = rgbaBuff[iPos + 3];
 						iPos += 4;
 					}
 					image->set_pixels_rgba(0, y, width, 1, &(lineBuff[0]));
 				}
 
-				m_saveTextureImage(fileName, image);
-
-				// USDZ出力時のためのファイル名保持.
-				m_exportFilesList.push_back(fileName);
+				m_outputTextureImage(fileName, image);
 			}
 		}
 	}
@@ -769,25 +1087,628 @@ void CSceneData::m_exportTextures (const std::string& filePath)
 
  /**
   * テクスチャをエクスポートパラメータでリサイズしてファイル出力.
-  * @param[in] fileName  出力ファイル名.
-  * @param[in] image     imageクラス.
+  * KTX2出力の場合は、ミップマップ付きのktx2も出力する.
+  * @param[in] fileName   出力ファイル名.
+  * @param[in] image      imageクラス.
+  * @param[in] grayscale  グレイスケールのイメージの場合はtrue。pngの場合は1チャンネルで出力する.
   */
- void CSceneData::m_saveTextureImage (const std::string fileName, sxsdk::image_interface* image)
+ void CSceneData::m_saveTextureImage (const std::string fileName, const int imageIndex, sxsdk::image_interface* image, const bool grayscale)
  {
-	const int texSize = USD_DATA::EXPORT::getTextureSize(m_exportParam.optMaxTextureSize);
+	const bool outputKTX2    = (m_exportParam.optTextureType == USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_ktx2);
+	const bool outputImage   = !outputKTX2 || m_exportParam.useShaderPreviewSurface();		// MDLのみの場合はktx2のみを参照する.
+	const std::string extStr = StringUtil::getFileExtension(fileName);
+	const bool outputGrayPNG = outputImage && grayscale && (extStr == "png");
+	const bool encodePixels  = outputImage && (extStr == "png" || extStr == "jpg" || extStr == "jpeg");		// 圧縮設定を指定してエンコードする.
 
 	 try {
-		if (m_exportParam.optMaxTextureSize == USD_DATA::EXPORT::texture_size_none) {
-			image->save(fileName.c_str());
-		} else {
+		compointer<sxsdk::image_interface> image2;
+		{
 			// イメージを2の累乗にリサイズ.
-			const sx::vec<int,2> newSize = Shade3DUtil::calcImageSizePowerOf2(image->get_size(), texSize);
-			compointer<sxsdk::image_interface> image2(Shade3DUtil::resizeImageWithAlpha(m_pScene, image, newSize));
-			image2->save(fileName.c_str());
+			// すでに同じサイズの場合はリサイズを行わない.
+			const sx::vec<int,2> newSize = m_calcOutputTextureSize(imageIndex, image->get_size());
+			if (newSize.x != image->get_size().x || newSize.y != image->get_size().y) {
+				image2 = compointer<sxsdk::image_interface>(Shade3DUtil::resizeImageWithAlpha(m_pScene, image, newSize, ImageUtil::resize_filter_lanczos3));
+				if (!image2) return;
+				image = image2;
+			}
+		}
+
+		if (outputImage && !encodePixels) m_outputTextureImage(fileName, image);
+
+		if (outputKTX2 || encodePixels) {
+			// RGBA(8bit)のピクセルバッファを取得.
+			const int width  = image->get_size().x;
+			const int height = image->get_size().y;
+			std::vector<unsigned char> rgbaBuff((size_t)width * (size_t)height * 4);
+			std::vector<sx::rgba8_class> lineBuff(width);
+			size_t iPos = 0;
+			for (int y = 0; y < height; ++y) {
+				image->get_pixels_rgba(0, y, width, 1, &(lineBuff[0]));
+				for (int x = 0; x < width; ++x) {
+					rgbaBuff[iPos + 0] = lineBuff[x].red;
+					rgbaBuff[iPos + 1] = lineBuff[x].green;
+					rgbaBuff[iPos + 2] = lineBuff[x].blue;
+					rgbaBuff[iPos + 3] = lineBuff[x].alpha;
+					iPos += 4;
+				}
+			}
+			if (outputGrayPNG) {
+				std::vector<unsigned char> grayBuff;
+				ImageUtil::convertRGBA8ToGray8(rgbaBuff, grayBuff);
+				m_outputTexturePixels(fileName, grayBuff, width, height, true);
+			} else if (encodePixels) {
+				if (!m_outputTexturePixels(fileName, rgbaBuff, width, height, false)) m_outputTextureImage(fileName, image);
+			}
+			if (outputKTX2) m_saveTextureKTX2(fileName, imageIndex, rgbaBuff, width, height);
 		}
 	 } catch (...) { }
  }
 
+ /**
+  * マスターイメージのキャッシュ済みのピクセルから、テクスチャをファイル出力.
+  * png/jpeg/KTX2の場合のみ、イメージを介さずにピクセルバッファからエンコードする.
+  * @param[in] fileName            出力ファイル名.
+  * @param[in] imageIndex          イメージ番号.
+  * @param[in] pMasterImageHandle  マスターイメージのハンドル.
+  * @return 出力した場合はtrue。falseの場合はm_saveTextureImageで出力する.
+  */
+ bool CSceneData::m_saveTextureCachedPixels (const std::string fileName, const int imageIndex, void* pMasterImageHandle)
+ {
+	const bool outputKTX2    = (m_exportParam.optTextureType == USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_ktx2);
+	const bool outputImage   = !outputKTX2 || m_exportParam.useShaderPreviewSurface();		// MDLのみの場合はktx2のみを参照する.
+	const std::string extStr = StringUtil::getFileExtension(fileName);
+	const bool encodePixels  = outputImage && (extStr == "png" || extStr == "jpg" || extStr == "jpeg");
+	if (outputImage && !encodePixels) return false;
+
+	int width, height;
+	std::shared_ptr< const std::vector<unsigned char> > pixels = m_materialTextureBake->getImageCache().getPixels(pMasterImageHandle, width, height);
+	if (!pixels) return false;
+
+	// 最大テクスチャサイズを超える場合は、ピクセルバッファのままリサイズ.
+	std::vector<unsigned char> resizedBuff;
+	const sx::vec<int,2> newSize = m_calcOutputTextureSize(imageIndex, sx::vec<int,2>(width, height));
+	if (newSize.x != width || newSize.y != height) {
+		if (!ImageUtil::resizeRGBA8(*pixels, width, height, resizedBuff, newSize.x, newSize.y, ImageUtil::resize_filter_lanczos3)) return false;
+		width  = newSize.x;
+		height = newSize.y;
+	}
+	const std::vector<unsigned char>& rgbaBuff = resizedBuff.empty() ? *pixels : resizedBuff;
+
+	if (encodePixels && !m_outputTexturePixels(fileName, rgbaBuff, width, height, false)) return false;
+	if (outputKTX2) m_saveTextureKTX2(fileName, imageIndex, rgbaBuff, width, height);
+	return true;
+ }
+
+ /**
+  * 加工なしで使用できるマスターイメージの場合に、元の画像ファイルをそのままコピーして出力.
+  * マスターイメージ名がファイルパスの場合のみ対象とし、ヘッダの形式(png/jpeg)と幅/高さが出力するテクスチャと一致する場合のみコピーする.
+  * 出力フォルダには前回出力した同名のテクスチャがあるため、フォルダ名を含まない名前や出力ファイル自身は元の画像ファイルとして扱わない.
+  * デコード/エンコードを行わないため、jpegの再圧縮による劣化もない.
+  * @return 出力した場合はtrue。falseの場合はピクセルをエンコードして出力する.
+  */
+ bool CSceneData::m_copySourceImageFile (const std::string fileName, const int imageIndex, sxsdk::master_image_class& masterImage, const sx::vec<int,2>& imageSize)
+ {
+	if (!m_exportParam.texCopySourceImages) return false;
+
+	// KTX2の場合は、ピクセルからミップマップを作成するため対象外.
+	if (m_exportParam.optTextureType == USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_ktx2) return false;
+	if (!m_materialTextureBake->getCheckImageRef().isNoProcessingImage(&masterImage)) return false;
+
+	std::string dstFormat = StringUtil::getFileExtension(fileName);
+	if (dstFormat == "jpeg") dstFormat = "jpg";
+	if (dstFormat != "png" && dstFormat != "jpg") return false;
+
+	// 最大テクスチャサイズによりリサイズされる場合.
+	const sx::vec<int,2> newSize = m_calcOutputTextureSize(imageIndex, imageSize);
+	if (newSize.x != imageSize.x || newSize.y != imageSize.y) return false;
+
+	// 元の画像ファイルを探す.
+	std::string srcFilePath = "";
+	try {
+		const std::string name = masterImage.get_name();
+		if (name == "") return false;
+		if (name.find_first_of("/\\") == std::string::npos) return false;
+		const std::string filePath = name;
+		if (filePath == fileName) return false;
+
+		std::string formatStr;
+		int width, height;
+		if (FileUtil::existFile(filePath) && ImageUtil::readImageFileHeader(filePath, formatStr, width, height)) {
+			if (formatStr == dstFormat && width == imageSize.x && height == imageSize.y) srcFilePath = filePath;
+		}
+	} catch (...) { }
+	if (srcFilePath == "") return false;
+
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	if (m_pUSDZWriter) {
+		if (!m_pUSDZWriter->addFile(srcFilePath, StringUtil::getFileName(fileName))) return false;
+	} else {
+		if (!FileUtil::copyFile(srcFilePath, fileName)) return false;
+
+		// USDZ出力時のためのファイル名保持.
+		m_exportFilesList.push_back(fileName);
+	}
+	m_appendTextureReport(fileName, FileUtil::getFileSize(srcFilePath), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+	return true;
+ }
+
+ /**
+  * 最大テクスチャサイズが自動の場合に、メッシュの表面積とUVの面積からテクスチャごとに必要なピクセル数を計算.
+  * UV空間の[0, 1]が表面積(cm^2)/UVの面積に対応するとして、目標のテクセル密度(texels/cm)を満たす長辺のピクセル数を求める.
+  * 同じマテリアルを参照するメッシュは表面積とUVの面積を合算し、複数のマテリアルから参照されるテクスチャは最大のものを採用する.
+  */
+ void CSceneData::m_calcTexturesRequiredSize ()
+ {
+	const std::vector<CImageData>& imagesList = m_materialTextureBake->getImagesList();
+	m_texturesRequiredSize.clear();
+	m_texturesRequiredSize.resize(imagesList.size(), 0);
+	if (m_exportParam.optMaxTextureSize != USD_DATA::EXPORT::texture_size_auto) return;
+
+	// ノードパスごとの変換行列による面積の拡大率.
+	std::map<std::string, double> areaScalesMap;
+	for (size_t i = 0; i < nodesList.size(); ++i) {
+		areaScalesMap[nodesList[i]->name] = m_calcMatrixAreaScale(nodesList[i]->matrix);
+	}
+
+	// マテリアルのUV層ごとに、表面積とUVの面積を集計.
+	const size_t materialsCount = materialsList.size();
+	std::vector<double> surfaceAreas(materialsCount * 2, 0.0);
+	std::vector<double> uvAreas(materialsCount * 2, 0.0);
+	for (size_t i = 0; i < nodesList.size(); ++i) {
+		if (nodesList[i]->nodeType != USD_DATA::NODE_TYPE::mesh_node) continue;
+		const CNodeMeshData& meshD = static_cast<const CNodeMeshData &>(*nodesList[i]);
+		if (meshD.materialIndex < 0 || meshD.materialIndex >= (int)materialsCount) continue;
+
+		// 親をたどって、ワールド座標での面積の拡大率を求める.
+		double areaScale = 1.0;
+		for (size_t iPos = meshD.name.find('/', 1); ; iPos = meshD.name.find('/', iPos + 1)) {
+			std::map<std::string, double>::const_iterator iter = areaScalesMap.find(meshD.name.substr(0, iPos));
+			if (iter != areaScalesMap.end()) areaScale *= iter->second;
+			if (iPos == std::string::npos) break;
+		}
+
+		const double surfaceArea = MathUtil::calcSurfaceArea(m_pScene, meshD) * areaScale;
+		if (surfaceArea <= 0.0) continue;
+
+		for (int uvLayer = 0; uvLayer < 2; ++uvLayer) {
+			const std::vector<sxsdk::vec2>& faceUVs = (uvLayer == 0) ? meshD.faceUV0 : meshD.faceUV1;
+			if (faceUVs.size() != meshD.faceIndices.size()) continue;
+			const size_t index = (size_t)meshD.materialIndex * 2 + uvLayer;
+			surfaceAreas[index] += surfaceArea;
+			uvAreas[index]      += m_calcUVArea(meshD.faceVertexCounts, faceUVs);
+		}
+	}
+
+	const double texelDensity = (double)std::max(1, m_exportParam.texTexelDensity);
+	for (size_t i = 0; i < materialsCount; ++i) {
+		const CMaterialData& materialD = materialsList[i];
+		const CTextureMappingData* mappings[] = {&materialD.diffuseTexture, &materialD.normalTexture, &materialD.roughnessTexture, &materialD.metallicTexture,
+			&materialD.emissiveTexture, &materialD.occlusionTexture, &materialD.opacityTexture, &materialD.transparencyTexture};
+		for (size_t j = 0; j < sizeof(mappings) / sizeof(mappings[0]); ++j) {
+			const CTextureParamData& texParam = mappings[j]->textureParam;
+			if (texParam.imageIndex < 0 || texParam.imageIndex >= (int)m_texturesRequiredSize.size()) continue;
+			const size_t index = i * 2 + ((texParam.uvLayerIndex == 1) ? 1 : 0);
+			if (surfaceAreas[index] <= 0.0 || uvAreas[index] <= 0.0) continue;
+
+			// 繰り返しがある場合は、その分UV空間の面積が大きくなる.
+			const double uvArea = uvAreas[index] * (double)std::max(1, texParam.repeatU) * (double)std::max(1, texParam.repeatV);
+			const int requiredSize = (int)std::ceil(texelDensity * std::sqrt(surfaceAreas[index] / uvArea));
+			m_texturesRequiredSize[texParam.imageIndex] = std::max(m_texturesRequiredSize[texParam.imageIndex], requiredSize);
+		}
+	}
+ }
+
+ /**
+  * ベースカラー/Emissiveとして参照されるテクスチャを調べる.
+  * 複数のマテリアルから参照される場合は、1つでもカラーとして参照されればsRGBとする.
+  */
+ void CSceneData::m_calcTexturesSRGB ()
+ {
+	const std::vector<CImageData>& imagesList = m_materialTextureBake->getImagesList();
+	m_texturesSRGB.clear();
+	m_texturesSRGB.resize(imagesList.size(), false);
+
+	for (size_t i = 0; i < materialsList.size(); ++i) {
+		const CMaterialData& materialD = materialsList[i];
+		const CTextureMappingData* mappings[] = {&materialD.diffuseTexture, &materialD.emissiveTexture};
+		for (size_t j = 0; j < sizeof(mappings) / sizeof(mappings[0]); ++j) {
+			const int imageIndex = mappings[j]->textureParam.imageIndex;
+			if (imageIndex >= 0 && imageIndex < (int)m_texturesSRGB.size()) m_texturesSRGB[imageIndex] = true;
+		}
+	}
+ }
+
+ /**
+  * エクスポートパラメータから、テクスチャの出力サイズを求める.
+  * 自動の場合は、必要なピクセル数を満たすミップマップの段のサイズにする (形状から参照されていない場合は上限のサイズ).
+  * @param[in] imageIndex  イメージ番号.
+  * @param[in] size        元のサイズ.
+  */
+ sx::vec<int,2> CSceneData::m_calcOutputTextureSize (const int imageIndex, const sx::vec<int,2>& size) const
+ {
+	if (m_exportParam.optMaxTextureSize == USD_DATA::EXPORT::texture_size_none) return size;
+
+	const int texSize = USD_DATA::EXPORT::getTextureSize(m_exportParam.optMaxTextureSize);
+	if (m_exportParam.optMaxTextureSize == USD_DATA::EXPORT::texture_size_auto) {
+		const int minTextureSize = 64;
+		const int requiredSize = (imageIndex >= 0 && imageIndex < (int)m_texturesRequiredSize.size()) ? m_texturesRequiredSize[imageIndex] : 0;
+		if (requiredSize > 0) return Shade3DUtil::calcImageSizeMipLevel(size, std::max(minTextureSize, requiredSize), texSize);
+	}
+	return Shade3DUtil::calcImageSizePowerOf2(size, texSize);
+ }
+
+ /**
+  * Occlusionテクスチャを持たないマテリアルに、Ambient Occlusionをベイクする.
+  * マテリアルを参照するメッシュがすべて同じ形状から作られ、UV0が[0, 1]に収まる場合に対象とする.
+  * 遮蔽物は同じ形状のメッシュのみで、他の形状による遮蔽は考慮しない.
+  */
+ void CSceneData::m_bakeAmbientOcclusion ()
+ {
+	if (!m_exportParam.texBakeAO || materialsList.empty()) return;
+
+	const size_t materialsCount = materialsList.size();
+	int texSize = std::max(1, std::min(8192, m_exportParam.texBakeAOSize));		// 以前に保存された値も8192までに制限.
+	if (m_exportParam.optMaxTextureSize != USD_DATA::EXPORT::texture_size_none) {
+		texSize = std::min(texSize, USD_DATA::EXPORT::getTextureSize(m_exportParam.optMaxTextureSize));
+	}
+	const int raysCount = 64;
+
+	// マテリアルごとに、参照するメッシュの形状を求める.
+	// 複数の形状から参照される場合、またはUV0が[0, 1]の範囲外の場合は対象外.
+	std::vector<void *> shapeHandles(materialsCount, NULL);
+	std::vector<bool> enables(materialsCount, false);
+	for (size_t i = 0; i < materialsCount; ++i) {
+		enables[i] = (materialsList[i].occlusionTexture.textureParam.imageIndex < 0);
+	}
+	{
+		const float fMin = 0.0f - 1e-4f;
+		const float fMax = 1.0f + 1e-4f;
+		for (size_t i = 0; i < nodesList.size(); ++i) {
+			if (nodesList[i]->nodeType != USD_DATA::NODE_TYPE::mesh_node) continue;
+			const CNodeMeshData& meshD = static_cast<const CNodeMeshData &>(*nodesList[i]);
+			if (meshD.materialIndex < 0 || meshD.materialIndex >= (int)materialsCount) continue;
+			const int materialIndex = meshD.materialIndex;
+			if (!enables[materialIndex]) continue;
+
+			if (!meshD.shapeHandle || (shapeHandles[materialIndex] && shapeHandles[materialIndex] != meshD.shapeHandle)) {
+				enables[materialIndex] = false;
+				continue;
+			}
+			shapeHandles[materialIndex] = meshD.shapeHandle;
+
+			if (meshD.faceUV0.empty() || meshD.faceUV0.size() != meshD.faceIndices.size()) {
+				enables[materialIndex] = false;
+				continue;
+			}
+			for (size_t j = 0; j < meshD.faceUV0.size(); ++j) {
+				const sxsdk::vec2& uv = meshD.faceUV0[j];
+				if (uv.x < fMin || uv.x > fMax || uv.y < fMin || uv.y > fMax) {
+					enables[materialIndex] = false;
+					break;
+				}
+			}
+		}
+	}
+
+	std::vector<float> positions, normals, faceUVs;
+	for (size_t i = 0; i < materialsCount; ++i) {
+		if (!enables[i] || !shapeHandles[i]) continue;
+
+		// 同じ形状のメッシュを遮蔽物として追加し、このマテリアルを参照するメッシュをベイク対象とする.
+		CAmbientOcclusionBake aoBake(texSize, texSize);
+		for (size_t j = 0; j < nodesList.size(); ++j) {
+			if (nodesList[j]->nodeType != USD_DATA::NODE_TYPE::mesh_node) continue;
+			const CNodeMeshData& meshD = static_cast<const CNodeMeshData &>(*nodesList[j]);
+			if (meshD.shapeHandle != shapeHandles[i]) continue;
+			const bool bakeTarget = (meshD.materialIndex == (int)i);
+
+			positions.resize(meshD.vertices.size() * 3);
+			for (size_t k = 0; k < meshD.vertices.size(); ++k) {
+				positions[k * 3 + 0] = meshD.vertices[k].x;
+				positions[k * 3 + 1] = meshD.vertices[k].y;
+				positions[k * 3 + 2] = meshD.vertices[k].z;
+			}
+			normals.clear();
+			faceUVs.clear();
+			if (bakeTarget) {
+				if (meshD.normals.size() == meshD.vertices.size()) {
+					normals.resize(meshD.normals.size() * 3);
+					for (size_t k = 0; k < meshD.normals.size(); ++k) {
+						normals[k * 3 + 0] = meshD.normals[k].x;
+						normals[k * 3 + 1] = meshD.normals[k].y;
+						normals[k * 3 + 2] = meshD.normals[k].z;
+					}
+				}
+				faceUVs.resize(meshD.faceUV0.size() * 2);
+				for (size_t k = 0; k < meshD.faceUV0.size(); ++k) {
+					faceUVs[k * 2 + 0] = meshD.faceUV0[k].x;
+					faceUVs[k * 2 + 1] = meshD.faceUV0[k].y;
+				}
+			}
+			aoBake.appendMesh(positions, normals, meshD.faceVertexCounts, meshD.faceIndices, faceUVs, bakeTarget);
+		}
+
+		std::vector<unsigned char> grayBuff;
+		const float maxDistance = aoBake.getBoundingBoxSize() * 0.25f;
+		if (maxDistance <= 0.0f || !aoBake.bake(raysCount, maxDistance, grayBuff)) continue;
+
+		// ベイクしたテクスチャと同じく、同一イメージの共有やファイル名の割り当てを行う.
+		CMaterialData& materialD = materialsList[i];
+		std::string materialName = StringUtil::getFileName(materialD.name);
+		if (!StringUtil::checkASCII(materialName)) materialName = "";
+		CTextureMappingData texMappingD;
+		const int imageIndex = m_materialTextureBake->storeGrayscaleImage(MAPPING_TYPE_USD_OCCLUSION, materialName, grayBuff, texSize, texSize, texMappingD);
+		if (imageIndex < 0) continue;
+
+		materialD.occlusionTexture.textureSource = USD_DATA::TEXTURE_SOURE::texture_source_r;
+		materialD.occlusionTexture.textureParam.imageIndex   = imageIndex;
+		materialD.occlusionTexture.textureParam.uvLayerIndex = 0;
+	}
+ }
+
+ /**
+  * 小さいベイク済みテクスチャを、アトラスのページにまとめる.
+  * マテリアルが参照するテクスチャがすべてベイク済みで指定サイズ以下、かつ参照するメッシュのUVが[0, 1]に収まる場合に対象とする.
+  * マテリアルごとに1つの矩形を割り当て、Diffuse/Normalなどのテクスチャの種類ごとに同じ配置のページを作成する.
+  */
+ void CSceneData::m_packTexturesAtlas ()
+ {
+	if (!m_exportParam.texPackAtlas || materialsList.empty()) return;
+
+	const std::vector<CImageData>& imagesList = m_materialTextureBake->getImagesList();
+	const size_t materialsCount = materialsList.size();
+	const int maxSize = std::max(1, m_exportParam.texAtlasMaxSize);
+	const int padding = 4;
+	int pageSize = 2048;
+	if (m_exportParam.optMaxTextureSize != USD_DATA::EXPORT::texture_size_none) {
+		pageSize = std::min(pageSize, USD_DATA::EXPORT::getTextureSize(m_exportParam.optMaxTextureSize));
+	}
+
+	// テクスチャの種類ごとのファイル名の接尾語.
+	const int slotsCount = 8;
+	const char* slotNames[] = {"_albedo", "_normal", "_roughness", "_metallic", "_emissive", "_occlusion", "_opacity", "_transparency"};
+
+	// マテリアルごとに、アトラスにまとめられるか判定.
+	// 同じイメージを参照するマッピング(ORMなど)は、最初に参照するテクスチャの種類のページに格納する.
+	std::vector<int> uvLayers(materialsCount, -1);				// 参照するUV層 (-1の場合は対象外).
+	std::vector<int> rectWidths(materialsCount, 0), rectHeights(materialsCount, 0);
+	std::vector<int> mappingSlots(materialsCount * slotsCount, -1);
+	for (size_t i = 0; i < materialsCount; ++i) {
+		const CMaterialData& materialD = materialsList[i];
+		const CTextureMappingData* mappings[] = {&materialD.diffuseTexture, &materialD.normalTexture, &materialD.roughnessTexture, &materialD.metallicTexture,
+			&materialD.emissiveTexture, &materialD.occlusionTexture, &materialD.opacityTexture, &materialD.transparencyTexture};
+
+		bool enableF = true;
+		int uvLayer = -1;
+		for (int j = 0; j < slotsCount && enableF; ++j) {
+			const CTextureParamData& texParam = mappings[j]->textureParam;
+			if (texParam.imageIndex < 0) continue;
+			if (texParam.imageIndex >= (int)imagesList.size()) {
+				enableF = false;
+				break;
+			}
+			const CImageData& imageD = imagesList[texParam.imageIndex];
+			if (imageD.pMasterImageHandle || !imageD.hasPixels() || imageD.fileName == "") enableF = false;
+			if (std::max(imageD.imageWidth, imageD.imageHeight) > maxSize) enableF = false;
+			if (texParam.repeatU > 1 || texParam.repeatV > 1) enableF = false;
+			if (uvLayer >= 0 && uvLayer != texParam.uvLayerIndex) enableF = false;
+			uvLayer = texParam.uvLayerIndex;
+
+			rectWidths[i]  = std::max(rectWidths[i], imageD.imageWidth);
+			rectHeights[i] = std::max(rectHeights[i], imageD.imageHeight);
+
+			mappingSlots[i * slotsCount + j] = j;
+			for (int k = 0; k < j; ++k) {
+				if (mappings[k]->textureParam.imageIndex == texParam.imageIndex) {
+					mappingSlots[i * slotsCount + j] = k;
+					break;
+				}
+			}
+		}
+		if (enableF && uvLayer >= 0) uvLayers[i] = uvLayer;
+	}
+
+	// 参照するメッシュのUVが[0, 1]の範囲外の場合は、繰り返しとなるため対象外.
+	// メッシュから参照されないマテリアルも対象外とする.
+	std::vector<int> meshesCount(materialsCount, 0);
+	{
+		const float fMin = 0.0f - 1e-4f;
+		const float fMax = 1.0f + 1e-4f;
+		for (size_t i = 0; i < nodesList.size(); ++i) {
+			if (nodesList[i]->nodeType != USD_DATA::NODE_TYPE::mesh_node) continue;
+			const CNodeMeshData& meshD = static_cast<const CNodeMeshData &>(*nodesList[i]);
+			if (meshD.materialIndex < 0 || meshD.materialIndex >= (int)materialsCount) continue;
+			const int materialIndex = meshD.materialIndex;
+			if (uvLayers[materialIndex] < 0) continue;
+
+			const std::vector<sxsdk::vec2>& faceUVs = (uvLayers[materialIndex] == 0) ? meshD.faceUV0 : meshD.faceUV1;
+			if (faceUVs.empty() || faceUVs.size() != meshD.faceIndices.size()) {
+				uvLayers[materialIndex] = -1;
+				continue;
+			}
+			for (size_t j = 0; j < faceUVs.size(); ++j) {
+				const sxsdk::vec2& uv = faceUVs[j];
+				if (uv.x < fMin || uv.x > fMax || uv.y < fMin || uv.y > fMax) {
+					uvLayers[materialIndex] = -1;
+					break;
+				}
+			}
+			meshesCount[materialIndex]++;
+		}
+	}
+
+	// 対象のマテリアルの矩形をページに配置.
+	std::vector<int> targetMaterials;
+	std::vector<int> widths, heights;
+	for (size_t i = 0; i < materialsCount; ++i) {
+		if (uvLayers[i] < 0 || meshesCount[i] == 0) continue;
+		targetMaterials.push_back((int)i);
+		widths.push_back(rectWidths[i]);
+		heights.push_back(rectHeights[i]);
+	}
+	if (targetMaterials.size() < 2) return;
+
+	CTextureAtlas textureAtlas(pageSize, padding);
+	if (!textureAtlas.pack(widths, heights)) return;
+	const std::vector<CAtlasRectData>& rects = textureAtlas.getRects();
+	const int pagesCount = textureAtlas.getPagesCount();
+
+	// テクスチャの種類とページごとに、アトラスのイメージを作成.
+	std::vector<int> atlasImageIndices((size_t)slotsCount * (size_t)pagesCount, -1);
+	for (int slot = 0; slot < slotsCount; ++slot) {
+		for (int page = 0; page < pagesCount; ++page) {
+			// このページに格納するイメージ (マテリアル番号/イメージ番号) を集める.
+			// すべてグレイスケールの場合は1チャンネルで、すべてjpegの場合はjpegで出力する.
+			std::vector<int> rectIndices, imageIndices;
+			bool grayF = true;
+			bool jpegF = true;
+			for (size_t i = 0; i < targetMaterials.size(); ++i) {
+				if (rects[i].pageIndex != page) continue;
+				const int materialIndex = targetMaterials[i];
+				const CMaterialData& materialD = materialsList[materialIndex];
+				const CTextureMappingData* mappings[] = {&materialD.diffuseTexture, &materialD.normalTexture, &materialD.roughnessTexture, &materialD.metallicTexture,
+					&materialD.emissiveTexture, &materialD.occlusionTexture, &materialD.opacityTexture, &materialD.transparencyTexture};
+				if (mappingSlots[materialIndex * slotsCount + slot] != slot) continue;
+
+				const int imageIndex = mappings[slot]->textureParam.imageIndex;
+				const CImageData& imageD = imagesList[imageIndex];
+				rectIndices.push_back((int)i);
+				imageIndices.push_back(imageIndex);
+				if (imageD.pixelFormat != USD_DATA::IMAGE_PIXEL_FORMAT::image_pixel_format_gray8) grayF = false;
+				const std::string extStr = StringUtil::getFileExtension(imageD.fileName);
+				if (extStr != "jpg" && extStr != "jpeg") jpegF = false;
+			}
+			if (rectIndices.empty()) continue;
+
+			const int pageWidth  = textureAtlas.getPageWidth(page);
+			const int pageHeight = textureAtlas.getPageHeight(page);
+			CImageData atlasImageD;
+			atlasImageD.imageWidth  = pageWidth;
+			atlasImageD.imageHeight = pageHeight;
+			if (grayF) atlasImageD.pixelFormat = USD_DATA::IMAGE_PIXEL_FORMAT::image_pixel_format_gray8;
+			const int pixelBytes = atlasImageD.getPixelBytes();
+
+			// 使用しない領域は黒(不透明)で埋める.
+			atlasImageD.pixelsBuff.resize((size_t)pageWidth * (size_t)pageHeight * (size_t)pixelBytes, 0);
+			if (pixelBytes == 4) {
+				for (size_t i = 3; i < atlasImageD.pixelsBuff.size(); i += 4) atlasImageD.pixelsBuff[i] = 255;
+			}
+
+			for (size_t i = 0; i < rectIndices.size(); ++i) {
+				const CAtlasRectData& rect = rects[rectIndices[i]];
+				const CImageData& imageD = imagesList[imageIndices[i]];
+				const bool srcGrayF = (imageD.pixelFormat == USD_DATA::IMAGE_PIXEL_FORMAT::image_pixel_format_gray8);
+				std::vector<unsigned char> srcBuff;
+				if (!imageD.loadPixels(srcBuff)) continue;
+
+				// 同じマテリアルの他のテクスチャとサイズが異なる場合は、矩形のサイズにリサイズ.
+				if (imageD.imageWidth != rect.width || imageD.imageHeight != rect.height) {
+					std::vector<unsigned char> resizedBuff;
+					bool retF = false;
+					if (srcGrayF) {
+						retF = ImageUtil::resizeGray8(srcBuff, imageD.imageWidth, imageD.imageHeight, resizedBuff, rect.width, rect.height, ImageUtil::resize_filter_lanczos3);
+					} else {
+						retF = ImageUtil::resizeRGBA8(srcBuff, imageD.imageWidth, imageD.imageHeight, resizedBuff, rect.width, rect.height, ImageUtil::resize_filter_lanczos3);
+					}
+					if (!retF) continue;
+					srcBuff.swap(resizedBuff);
+				}
+				if (srcGrayF && !grayF) {
+					std::vector<unsigned char> rgbaBuff;
+					ImageUtil::convertGray8ToRGBA8(srcBuff, rgbaBuff);
+					srcBuff.swap(rgbaBuff);
+				}
+				textureAtlas.copyRectPixels(srcBuff, pixelBytes, rect, atlasImageD.pixelsBuff, pageWidth, pageHeight);
+			}
+
+			atlasImageD.pixelsHash = HashUtil::calcFNV1a64(&(atlasImageD.pixelsBuff[0]), atlasImageD.pixelsBuff.size());
+			atlasImageD.fileName   = std::string("atlas") + std::to_string(page) + std::string(slotNames[slot]) + std::string(jpegF ? ".jpg" : ".png");
+			atlasImageIndices[(size_t)slot * (size_t)pagesCount + page] = m_materialTextureBake->appendImage(atlasImageD);
+		}
+	}
+
+	// マテリアルのテクスチャの参照を、アトラスのイメージに置き換える.
+	std::set<int> replacedImages;
+	for (size_t i = 0; i < targetMaterials.size(); ++i) {
+		const CAtlasRectData& rect = rects[i];
+		if (rect.pageIndex < 0) continue;
+		const int materialIndex = targetMaterials[i];
+		CMaterialData& materialD = materialsList[materialIndex];
+		CTextureMappingData* mappings[] = {&materialD.diffuseTexture, &materialD.normalTexture, &materialD.roughnessTexture, &materialD.metallicTexture,
+			&materialD.emissiveTexture, &materialD.occlusionTexture, &materialD.opacityTexture, &materialD.transparencyTexture};
+		for (int j = 0; j < slotsCount; ++j) {
+			CTextureParamData& texParam = mappings[j]->textureParam;
+			if (texParam.imageIndex < 0) continue;
+			const int slot = mappingSlots[materialIndex * slotsCount + j];
+			const int atlasImageIndex = atlasImageIndices[(size_t)slot * (size_t)pagesCount + rect.pageIndex];
+			if (atlasImageIndex < 0) continue;
+			replacedImages.insert(texParam.imageIndex);
+			texParam.imageIndex = atlasImageIndex;
+			texParam.wrapRepeat = false;		// 隣の矩形を参照しないようにする.
+		}
+	}
+
+	// メッシュのUVを、アトラス上の矩形の範囲に変換.
+	// USDのV値は逆転しているため、イメージの上端がV=1になる.
+	{
+		std::vector<int> materialRectIndices(materialsCount, -1);
+		for (size_t i = 0; i < targetMaterials.size(); ++i) {
+			if (rects[i].pageIndex >= 0) materialRectIndices[targetMaterials[i]] = (int)i;
+		}
+		for (size_t i = 0; i < nodesList.size(); ++i) {
+			if (nodesList[i]->nodeType != USD_DATA::NODE_TYPE::mesh_node) continue;
+			CNodeMeshData& meshD = static_cast<CNodeMeshData &>(*nodesList[i]);
+			if (meshD.materialIndex < 0 || meshD.materialIndex >= (int)materialsCount) continue;
+			const int rectIndex = materialRectIndices[meshD.materialIndex];
+			if (rectIndex < 0) continue;
+
+			const CAtlasRectData& rect = rects[rectIndex];
+			const float pageWidth  = (float)textureAtlas.getPageWidth(rect.pageIndex);
+			const float pageHeight = (float)textureAtlas.getPageHeight(rect.pageIndex);
+			std::vector<sxsdk::vec2>& faceUVs = (uvLayers[meshD.materialIndex] == 0) ? meshD.faceUV0 : meshD.faceUV1;
+			for (size_t j = 0; j < faceUVs.size(); ++j) {
+				sxsdk::vec2& uv = faceUVs[j];
+				const float u = std::min(std::max(uv.x, 0.0f), 1.0f);
+				const float v = std::min(std::max(uv.y, 0.0f), 1.0f);
+				uv.x = ((float)rect.x + u * (float)rect.width) / pageWidth;
+				uv.y = 1.0f - ((float)rect.y + (1.0f - v) * (float)rect.height) / pageHeight;
+			}
+		}
+	}
+
+	// どのマテリアルからも参照されなくなったイメージは出力しない.
+	for (size_t i = 0; i < materialsCount; ++i) {
+		const CMaterialData& materialD = materialsList[i];
+		const CTextureMappingData* mappings[] = {&materialD.diffuseTexture, &materialD.normalTexture, &materialD.roughnessTexture, &materialD.metallicTexture,
+			&materialD.emissiveTexture, &materialD.occlusionTexture, &materialD.opacityTexture, &materialD.transparencyTexture};
+		for (int j = 0; j < slotsCount; ++j) replacedImages.erase(mappings[j]->textureParam.imageIndex);
+	}
+	for (std::set<int>::const_iterator iter = replacedImages.begin(); iter != replacedImages.end(); ++iter) {
+		m_materialTextureBake->releaseImage(*iter);
+	}
+ }
+
+ /**
+  * ミップマップ付きのktx2ファイルを出力.
+  * 出力ファイル名は、fileNameの拡張子をktx2に置き換えたものになる.
+  * ベースカラー/Emissiveのテクスチャは、sRGBとして格納する.
+  * @param[in] fileName    出力ファイル名 (png).
+  * @param[in] imageIndex  イメージ番号.
+  * @param[in] rgbaBuff    RGBA(8bit)のピクセル.
+  * @param[in] width       幅.
+  * @param[in] height      高さ.
+  */
+ void CSceneData::m_saveTextureKTX2 (const std::string fileName, const int imageIndex, const std::vector<unsigned char>& rgbaBuff, const int width, const int height)
+ {
+	const std::string ktx2FileName = StringUtil::SetFileImageExtension(fileName, "ktx2", true);
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	std::vector<unsigned char> ktx2Buff;
+	const bool useSRGB = (imageIndex >= 0 && imageIndex < (int)m_texturesSRGB.size()) ? m_texturesSRGB[imageIndex] : false;
+	if (!KTX2Writer::encodeRGBA8(rgbaBuff, width, height, ktx2Buff, useSRGB)) return;
+	m_appendTextureReport(ktx2FileName, ktx2Buff.size(), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+	m_outputTextureBuffer(ktx2FileName, ktx2Buff);
+ }
+
 /**
  * usdzファイルを出力。exportUSDのあとに実行すること.
  */
@@ -795,9 +1716,374 @@ void CSceneData::exportUSDZ (const std::string& filePath)
 {
 	if (m_exportFilesList.empty()) return;
 
-	CUSDExporter usdExport;
-	usdExport.exportUSDZ(filePath, m_exportFilesList);
-	m_usdzFileName = filePath;
+	// 同一フォルダの一時ファイルに出力し、完了後に置き換える.
+	const std::string tempFilePath = FileUtil::getTempFileName(filePath);
+	CUSDZWriter usdzWriter;
+	if (!usdzWriter.open(tempFilePath)) return;
+
+	// 出力済みのファイルを格納 (先頭はUSDファイル).
+	{
+		std::vector<std::string> names;
+		for (size_t i = 0; i < m_exportFilesList.size(); ++i) names.push_back(StringUtil::getFileName(m_exportFilesList[i]));
+		usdzWriter.addFiles(m_exportFilesList, names);
+	}
+
+	// テクスチャはファイルを経由せずにusdzに格納.
+	if (m_isUSDZOnlyOutput()) {
+		m_pUSDZWriter = &usdzWriter;
+		m_exportTextures(m_exportFilesList[0]);
+		m_pUSDZWriter = NULL;
+	}
+
+	if (usdzWriter.close() && FileUtil::replaceFile(tempFilePath, filePath)) {
+		m_usdzFileName = filePath;
+	} else {
+		std::remove(tempFilePath.c_str());
+	}
+}
+
+/**
+ * usdzのみを出力するか (テクスチャを作業フォルダに残す必要がない).
+ */
+bool CSceneData::m_isUSDZOnlyOutput () const
+{
+	return (m_exportParam.exportUSDZ || m_exportParam.exportAppleUSDZ) && !m_exportParam.exportOutputTempFiles;
+}
+
+/**
+ * 形状/マテリアル/アニメーションを別々のサブレイヤとして出力するか.
+ * Appleのusdz互換の場合は、1つのレイヤとして出力する.
+ */
+bool CSceneData::m_useSplitLayers () const
+{
+	return m_exportParam.exportSplitLayers && !m_exportParam.exportAppleUSDZ;
+}
+
+/**
+ * サブレイヤのファイル名を取得 (USD_DATA::LAYER_TYPEの順。作成しない場合は"").
+ * ルートレイヤのファイル名に「_geometry.usdc」「_materials.usda」「_anim.usdc」を付けたものになる.
+ * アニメーションのサブレイヤは、アニメーションまたはスキンを出力する場合のみ作成する.
+ */
+void CSceneData::m_getSubLayerFileNames (const std::string& filePath, std::vector<std::string>& fileNames)
+{
+	const std::string fileName = StringUtil::getFileName(filePath);
+	const std::string baseName = filePath.substr(0, filePath.length() - fileName.length()) + StringUtil::getFileName(filePath, false);
+	const bool useAnim = (m_exportParam.animKeyframeMode != USD_DATA::EXPORT::ANIM_KEYFRAME_MODE::anim_keyframe_none) || m_exportParam.optOutputBoneSkin;
+
+	fileNames.clear();
+	fileNames.resize(USD_DATA::LAYER_TYPE::layer_type_count, std::string(""));
+	fileNames[USD_DATA::LAYER_TYPE::layer_type_geometry]  = baseName + std::string("_geometry.usdc");
+	fileNames[USD_DATA::LAYER_TYPE::layer_type_materials] = baseName + std::string("_materials.usda");
+	if (useAnim) fileNames[USD_DATA::LAYER_TYPE::layer_type_anim] = baseName + std::string("_anim.usdc");
+}
+
+/**
+ * 差分エクスポート用の出力情報(マニフェスト)を使用するか.
+ * usdzのみを出力する場合、スキンを出力する場合、サブレイヤに分けて出力する場合は使用しない.
+ */
+bool CSceneData::m_useExportManifest () const
+{
+	if (!m_exportParam.exportIncremental) return false;
+	if (m_isUSDZOnlyOutput()) return false;
+	if (m_exportParam.optOutputBoneSkin) return false;
+	if (m_useSplitLayers()) return false;
+	return true;
+}
+
+/**
+ * 差分エクスポート時に、前回から変更のないノードか判定.
+ * 変更のあるノードは、書き直す前に属性をクリアする.
+ */
+bool CSceneData::m_checkSameNode (CUSDExporter& usdExport, const std::string& nodeName, const unsigned long long hash)
+{
+	m_manifest.nodesHash[nodeName] = hash;
+	if (!m_incrementalExport) return false;
+	if (!usdExport.existNode(nodeName)) return false;
+	if (m_prevManifest.isSameNode(nodeName, hash)) return true;
+
+	usdExport.resetNode(nodeName);
+	return false;
+}
+
+/**
+ * マテリアルのハッシュ値を計算 (差分エクスポート用).
+ * イメージ番号は出力ごとに変わりうるため、参照の有無とテクスチャのファイル名から計算する.
+ */
+unsigned long long CSceneData::m_calcMaterialHash (const CMaterialData& materialD)
+{
+	const std::vector<CImageData>& imagesList = m_materialTextureBake->getImagesList();
+	CMaterialData tmpMaterialD = materialD;
+	CTextureMappingData* texturesList[] = {
+		&tmpMaterialD.diffuseTexture, &tmpMaterialD.normalTexture, &tmpMaterialD.roughnessTexture, &tmpMaterialD.metallicTexture,
+		&tmpMaterialD.emissiveTexture, &tmpMaterialD.occlusionTexture, &tmpMaterialD.opacityTexture, &tmpMaterialD.transparencyTexture
+	};
+
+	unsigned long long hash = m_hashString(materialD.name, HashUtil::FNV1A64_OFFSET_BASIS);
+	for (size_t i = 0; i < sizeof(texturesList) / sizeof(texturesList[0]); ++i) {
+		int& imageIndex = texturesList[i]->textureParam.imageIndex;
+		const bool useImage = (imageIndex >= 0 && imageIndex < (int)imagesList.size());
+		hash = m_hashString(useImage ? imagesList[imageIndex].fileName : std::string(""), hash);
+		imageIndex = useImage ? 0 : -1;
+	}
+	return m_hashVector(std::vector<unsigned long long>(1, tmpMaterialD.getHash()), hash);
+}
+
+/**
+ * 差分エクスポート時に、前回から変更のないマテリアルか判定.
+ * 変更のあるマテリアルは、出力し直す前に削除する (前回のinputが残らないようにするため).
+ */
+bool CSceneData::m_checkSameMaterial (CUSDExporter& usdExport, const CMaterialData& materialD)
+{
+	const unsigned long long hash = m_calcMaterialHash(materialD);
+	m_manifest.materialsHash[materialD.name] = hash;
+	if (!m_incrementalExport) return false;
+	if (!usdExport.existNode(materialD.name)) return false;
+	if (m_prevManifest.isSameMaterial(materialD.name, hash)) return true;
+
+	usdExport.removeNode(materialD.name);
+	return false;
+}
+
+/**
+ * 差分エクスポート時に、前回から削除されたノード、リンクの参照、マテリアルを削除.
+ * 変更のあったマテリアルは、m_checkSameMaterialで出力し直す前に削除する.
+ */
+void CSceneData::m_removeOldNodes (CUSDExporter& usdExport)
+{
+	// 今回出力しないマテリアルを削除.
+	{
+		std::set<std::string> namesList;
+		for (size_t i = 0; i < materialsList.size(); ++i) namesList.insert(materialsList[i].name);
+		for (std::map<std::string, unsigned long long>::const_iterator it = m_prevManifest.materialsHash.begin(); it != m_prevManifest.materialsHash.end(); ++it) {
+			if (namesList.find(it->first) == namesList.end()) usdExport.removeNode(it->first);
+		}
+	}
+
+	// リンクの参照は出力し直す.
+	for (size_t i = 0; i < m_prevManifest.refNodesList.size(); ++i) {
+		usdExport.removeNode(m_prevManifest.refNodesList[i]);
+	}
+
+	// 今回出力しないノードを削除.
+	std::set<std::string> namesList;
+	for (size_t i = 0; i < nodesList.size(); ++i) {
+		const CNodeBaseData& nodeBaseD = *nodesList[i];
+		if ((nodeBaseD.nodeType) == USD_DATA::NODE_TYPE::ref_node) continue;
+		namesList.insert(nodeBaseD.name);
+	}
+	for (std::map<std::string, unsigned long long>::const_iterator it = m_prevManifest.nodesHash.begin(); it != m_prevManifest.nodesHash.end(); ++it) {
+		if (namesList.find(it->first) == namesList.end()) usdExport.removeNode(it->first);
+	}
+}
+
+/**
+ * テクスチャのハッシュ値を計算 (差分エクスポート用).
+ */
+unsigned long long CSceneData::m_calcTextureHash (const CImageData& imageD)
+{
+	unsigned long long hash = HashUtil::FNV1A64_OFFSET_BASIS;
+
+	if (imageD.pMasterImageHandle) {
+		// マスターイメージのピクセルと、変換要素から計算.
+		try {
+			// ピクセルのハッシュ値は、マスターイメージのキャッシュで1回のみ計算される.
+			const std::vector<unsigned long long> pixelsHash(1, m_materialTextureBake->getImageCache().getPixelsHash(imageD.pMasterImageHandle));
+			hash = m_hashVector(pixelsHash, hash);
+		} catch (...) { }
+
+		const CTextureTransform& texTransform = imageD.texTransform;
+		std::vector<float> values;
+		values.push_back((float)imageD.textureSource);
+		values.push_back(imageD.occlusionF ? 1.0f : 0.0f);
+		values.push_back(texTransform.multiR);
+		values.push_back(texTransform.multiG);
+		values.push_back(texTransform.multiB);
+		values.push_back(texTransform.multiA);
+		values.push_back(texTransform.offsetR);
+		values.push_back(texTransform.offsetG);
+		values.push_back(texTransform.offsetB);
+		values.push_back(texTransform.offsetA);
+		values.push_back(texTransform.flipColor ? 1.0f : 0.0f);
+		values.push_back(texTransform.occlusion ? 1.0f : 0.0f);
+		values.push_back(texTransform.textureNormal ? 1.0f : 0.0f);
+		values.push_back(texTransform.textureWeight);
+		for (int i = 0; i < 4; ++i) values.push_back(texTransform.factor[i]);
+		values.push_back(texTransform.convGrayscale ? 1.0f : 0.0f);
+		hash = m_hashVector(values, hash);
+
+	} else {
+		// ベイクしたイメージは、ベイク時に計算したピクセルのハッシュ値を使用.
+		std::vector<unsigned long long> values;
+		values.push_back(imageD.pixelsHash);
+		values.push_back((unsigned long long)imageD.imageWidth);
+		values.push_back((unsigned long long)imageD.imageHeight);
+		values.push_back((unsigned long long)imageD.pixelFormat);
+		hash = m_hashVector(values, hash);
+	}
+	return hash;
+}
+
+/**
+ * 差分エクスポート時に、前回と同じテクスチャの場合は出力済みのファイルをそのまま使用.
+ */
+bool CSceneData::m_reuseTextureFiles (const std::string& fileName, const int imageIndex, const CImageData& imageD)
+{
+	if (!m_useExportManifest() || m_pUSDZWriter) return false;
+
+	// テクセル密度から出力サイズを決める場合は、形状の変更でサイズが変わるため必要なピクセル数も含める.
+	unsigned long long hash = m_calcTextureHash(imageD);
+	if (m_exportParam.optMaxTextureSize == USD_DATA::EXPORT::texture_size_auto) {
+		const int requiredSize = (imageIndex >= 0 && imageIndex < (int)m_texturesRequiredSize.size()) ? m_texturesRequiredSize[imageIndex] : 0;
+		hash = m_hashVector(std::vector<int>(1, requiredSize), hash);
+	}
+
+	// ktx2はカラーとして参照されるかでsRGB/リニアが変わる.
+	if (m_exportParam.optTextureType == USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_ktx2) {
+		const bool useSRGB = (imageIndex >= 0 && imageIndex < (int)m_texturesSRGB.size()) ? m_texturesSRGB[imageIndex] : false;
+		hash = m_hashVector(std::vector<int>(1, useSRGB ? 1 : 0), hash);
+	}
+	m_manifest.texturesHash[imageD.fileName] = hash;
+	if (!m_incrementalExport || !m_prevManifest.isSameTexture(imageD.fileName, hash)) return false;
+
+	// 出力されるはずのファイルがすべて存在するか.
+	const bool outputKTX2 = (m_exportParam.optTextureType == USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_ktx2);
+	std::vector<std::string> filesList;
+	if (!outputKTX2 || m_exportParam.useShaderPreviewSurface()) filesList.push_back(fileName);		// MDLのみの場合はktx2のみを参照する.
+	if (outputKTX2) filesList.push_back(StringUtil::SetFileImageExtension(fileName, "ktx2", true));
+	for (size_t i = 0; i < filesList.size(); ++i) {
+		if (!FileUtil::existFile(filesList[i])) return false;
+	}
+
+	// USDZ出力時のためのファイル名保持.
+	m_exportFilesList.insert(m_exportFilesList.end(), filesList.begin(), filesList.end());
+	return true;
+}
+
+/**
+ * エンコード済みのテクスチャを出力.
+ * usdzに直接格納する場合はファイルを経由しない.
+ * @param[in] fileName  出力ファイル名.
+ * @param[in] buff      ファイルのデータ.
+ */
+bool CSceneData::m_outputTextureBuffer (const std::string& fileName, const std::vector<unsigned char>& buff)
+{
+	if (buff.empty()) return false;
+	if (m_pUSDZWriter) return m_pUSDZWriter->addBuffer(StringUtil::getFileName(fileName), &(buff[0]), buff.size());
+
+	try {
+		// 同一フォルダの一時ファイルに出力し、完了後に置き換える.
+		const std::string tempFileName = FileUtil::getTempFileName(fileName);
+		std::ofstream outStream(tempFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!outStream) return false;
+		outStream.write((const char *)&(buff[0]), buff.size());
+		outStream.close();
+		if (outStream.fail()) {
+			std::remove(tempFileName.c_str());
+			return false;
+		}
+		if (!FileUtil::replaceFile(tempFileName, fileName)) return false;
+
+		// USDZ出力時のためのファイル名保持.
+		m_exportFilesList.push_back(fileName);
+		return true;
+	} catch (...) { }
+	return false;
+}
+
+/**
+ * imageをテクスチャとして出力.
+ * usdzに直接格納する場合は、作業ファイルを格納後に削除する.
+ * @param[in] fileName  出力ファイル名.
+ * @param[in] image     imageクラス.
+ */
+bool CSceneData::m_outputTextureImage (const std::string& fileName, sxsdk::image_interface* image)
+{
+	// 同一フォルダの一時ファイルに出力し、完了後に置き換える.
+	// 一時ファイル名は拡張子を変えないため、imageの保存形式は同じになる.
+	const std::string tempFileName = FileUtil::getTempFileName(fileName);
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	try {
+		image->save(tempFileName.c_str());
+	} catch (...) {
+		std::remove(tempFileName.c_str());
+		return false;
+	}
+	m_appendTextureReport(fileName, FileUtil::getFileSize(tempFileName), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+
+	if (m_pUSDZWriter) {
+		const bool retF = m_pUSDZWriter->addFile(tempFileName, StringUtil::getFileName(fileName));
+		std::remove(tempFileName.c_str());
+		return retF;
+	}
+	if (!FileUtil::replaceFile(tempFileName, fileName)) return false;
+
+	// USDZ出力時のためのファイル名保持.
+	m_exportFilesList.push_back(fileName);
+	return true;
+}
+
+/**
+ * ピクセルバッファをエクスポートパラメータの圧縮設定でpng/jpegにエンコードして出力.
+ */
+bool CSceneData::m_outputTexturePixels (const std::string& fileName, const std::vector<unsigned char>& pixelsBuff, const int width, const int height, const bool grayscale)
+{
+	if (width <= 0 || height <= 0) return false;
+	const size_t lineBytes = (size_t)width * (grayscale ? 1 : 4);
+	if (pixelsBuff.size() < lineBytes * (size_t)height) return false;
+
+	const unsigned char* pixels = &(pixelsBuff[0]);
+	return m_outputTextureLines(fileName, [pixels, lineBytes](const int y) { return pixels + (size_t)y * lineBytes; }, width, height, grayscale);
+}
+
+/**
+ * 1ラインずつ取得したピクセルをエクスポートパラメータの圧縮設定でpng/jpegにエンコードして出力.
+ */
+bool CSceneData::m_outputTextureLines (const std::string& fileName, const ImageUtil::LineReader& readLine, const int width, const int height, const bool grayscale)
+{
+	const std::string extStr = StringUtil::getFileExtension(fileName);
+	if (extStr != "png" && extStr != "jpg" && extStr != "jpeg") return false;
+
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	std::vector<unsigned char> buff;
+	bool retF = false;
+	if (extStr == "png") {
+		PNGWriter::CEncodeParam param;
+		param.compressionLevel = m_exportParam.texPNGCompressionLevel;
+		param.filterType       = (PNGWriter::FILTER_TYPE)m_exportParam.texPNGFilterType;		// 並びはPNG_FILTER_TYPEと同じ.
+		param.optimize         = m_exportParam.texPNGOptimize;
+		retF = PNGWriter::encodeLines(readLine, width, height, grayscale ? 1 : 4, buff, param);
+
+	} else {
+		if (grayscale) {
+			// 1ラインずつRGBAに変換.
+			std::vector<unsigned char> rgbaLine((size_t)width * 4);
+			retF = JPEGWriter::encodeLines([&readLine, &rgbaLine, width](const int y) -> const unsigned char* {
+				const unsigned char* pLine = readLine(y);
+				if (!pLine) return NULL;
+				for (int x = 0; x < width; ++x) {
+					rgbaLine[x * 4 + 0] = rgbaLine[x * 4 + 1] = rgbaLine[x * 4 + 2] = pLine[x];
+					rgbaLine[x * 4 + 3] = 255;
+				}
+				return &(rgbaLine[0]);
+			}, width, height, buff, m_exportParam.texJPEGQuality);
+		} else {
+			retF = JPEGWriter::encodeLines(readLine, width, height, buff, m_exportParam.texJPEGQuality);
+		}
+	}
+	if (!retF) return false;
+
+	m_appendTextureReport(fileName, buff.size(), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+	return m_outputTextureBuffer(fileName, buff);
+}
+
+/**
+ * テクスチャの出力サイズ/エンコード時間を記録.
+ */
+void CSceneData::m_appendTextureReport (const std::string& fileName, const unsigned long long bytes, const double msec)
+{
+	char szStr[256];
+	snprintf(szStr, sizeof(szStr), " : %llu bytes, %.1f ms", bytes, msec);
+	m_texturesReport.push_back(StringUtil::getFileName(fileName) + std::string(szStr));
 }
 
 /**
@@ -1091,6 +2377,8 @@ void CSceneData::m_setLinkMaterials (CUSDExporter& usdExport, const int tIndex,
 			CNodeNullData& nodeD = static_cast<CNodeNullData &>(nodeBaseD);
 			if (nodeRefData.shapeHandle == nodeD.shapeHandle) {
 				// orgName内にある要素をたどり、「rel material:binding」のマテリアルの参照をorgNameに複製する.
+				// 差分エクスポート時は、前回複製したマテリアルを削除してから複製し直す.
+				if (m_incrementalExport) usdExport.removeNode(nodeD.name + std::string("/Materials"));
 				usdExport.setMaterialsInScope(nodeD.name, materialsList);
 				break;
 			}
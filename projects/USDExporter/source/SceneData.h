@@ -15,10 +15,15 @@
 #include "USDExporter.h"
 #include "TextureTransform.h"
 #include "MaterialTextureBake.h"
+#include "USDZWriter.h"
+#include "ExportManifest.h"
+#include "ImageUtil.h"
 
 #include <string>
 #include <vector>
 #include <memory>
+#include <map>
+#include <unordered_map>
 
 class CSceneData
 {
@@ -67,11 +72,24 @@ private:
 
 	std::vector<std::string> m_exportFilesList;		// 出力したファイルのフルパスを保持。usdz出力時に使用する.
 	std::string m_usdzFileName;						// 出力したUSDZファイル名.
+	CUSDZWriter* m_pUSDZWriter;						// テクスチャを直接usdzに格納する場合の出力先 (NULLの場合はファイル出力).
 
 	std::vector<CSkeletonData> m_skeletonList;		// アニメーション用のスケルトンリスト.
 
 	std::unique_ptr<CMaterialTextureBake> m_materialTextureBake;		// マテリアルで使用するテクスチャベイク用.
 
+	CExportManifest m_manifest;					// 今回の出力情報 (差分エクスポート用).
+	CExportManifest m_prevManifest;				// 前回の出力情報 (差分エクスポート用).
+	bool m_incrementalExport;					// 前回の出力を元に、変更のあった要素のみを書き換える場合はtrue.
+
+	std::vector<std::string> m_texturesReport;	// テクスチャごとの出力サイズ/エンコード時間.
+	double m_materialsExportTime;				// マテリアルの出力時間 (ms).
+	std::vector<int> m_texturesRequiredSize;	// テクセル密度から求めた、テクスチャごとに必要な長辺のピクセル数 (0の場合は不明).
+	std::vector<bool> m_texturesSRGB;			// テクスチャごとに、ベースカラー/Emissiveとして参照されるか (ktx2をsRGBとして出力).
+
+	std::map<void*, int> m_surfaceMaterialIndex;	// 表面材質(sxsdk::surface_class)のポインタから、マテリアル番号を取得.
+	std::unordered_map<unsigned long long, std::vector<int> > m_materialHashIndices;	// マテリアルのパラメータのハッシュ値から、マテリアル番号を取得.
+
 public:
 	std::string filePath;					// 保存ファイルパス.
 	CTempMeshData tmpMeshData;				// メッシュ情報の一時格納用.
@@ -137,10 +155,186 @@ private:
 
 	 /**
 	  * テクスチャをエクスポートパラメータでリサイズしてファイル出力.
+	  * @param[in] fileName    出力ファイル名.
+	  * @param[in] imageIndex  イメージ番号.
+	  * @param[in] image       imageクラス.
+	  * @param[in] grayscale   グレイスケールのイメージの場合はtrue。pngの場合は1チャンネルで出力する.
+	  */
+	 void m_saveTextureImage (const std::string fileName, const int imageIndex, sxsdk::image_interface* image, const bool grayscale = false);
+
+	 /**
+	  * マスターイメージのキャッシュ済みのピクセルから、テクスチャをファイル出力.
+	  * @param[in] fileName            出力ファイル名.
+	  * @param[in] imageIndex          イメージ番号.
+	  * @param[in] pMasterImageHandle  マスターイメージのハンドル.
+	  * @return 出力した場合はtrue.
+	  */
+	 bool m_saveTextureCachedPixels (const std::string fileName, const int imageIndex, void* pMasterImageHandle);
+
+	 /**
+	  * 加工なしで使用できるマスターイメージの場合に、元の画像ファイルをそのままコピーして出力.
+	  * @param[in] fileName     出力ファイル名.
+	  * @param[in] imageIndex   イメージ番号.
+	  * @param[in] masterImage  マスターイメージクラス.
+	  * @param[in] imageSize    イメージのサイズ.
+	  * @return 出力した場合はtrue.
+	  */
+	 bool m_copySourceImageFile (const std::string fileName, const int imageIndex, sxsdk::master_image_class& masterImage, const sx::vec<int,2>& imageSize);
+
+	 /**
+	  * 最大テクスチャサイズが自動の場合に、メッシュの表面積とUVの面積からテクスチャごとに必要なピクセル数を計算.
+	  * 結果はm_texturesRequiredSizeに格納される.
+	  */
+	 void m_calcTexturesRequiredSize ();
+
+	 /**
+	  * ベースカラー/Emissiveとして参照されるテクスチャを調べる.
+	  * 結果はm_texturesSRGBに格納される.
+	  */
+	 void m_calcTexturesSRGB ();
+
+	 /**
+	  * エクスポートパラメータから、テクスチャの出力サイズを求める.
+	  * @param[in] imageIndex  イメージ番号.
+	  * @param[in] size        元のサイズ.
+	  */
+	 sx::vec<int,2> m_calcOutputTextureSize (const int imageIndex, const sx::vec<int,2>& size) const;
+
+	 /**
+	  * Occlusionテクスチャを持たないマテリアルに、Ambient Occlusionをベイクする.
+	  * マテリアルを参照するメッシュが1つの形状に含まれる場合に、その形状のメッシュを遮蔽物としてUV0上に計算する.
+	  */
+	 void m_bakeAmbientOcclusion ();
+
+	 /**
+	  * 小さいベイク済みテクスチャを、アトラスのページにまとめる.
+	  * マテリアル単位で配置し、そのマテリアルを参照するメッシュのUVをアトラス上の矩形に変換する.
+	  */
+	 void m_packTexturesAtlas ();
+
+	 /**
+	  * ミップマップ付きのktx2ファイルを出力.
+	  * @param[in] fileName    出力ファイル名 (png).
+	  * @param[in] imageIndex  イメージ番号.
+	  * @param[in] rgbaBuff    RGBA(8bit)のピクセル.
+	  * @param[in] width       幅.
+	  * @param[in] height      高さ.
+	  */
+	 void m_saveTextureKTX2 (const std::string fileName, const int imageIndex, const std::vector<unsigned char>& rgbaBuff, const int width, const int height);
+
+	 /**
+	  * エンコード済みのテクスチャを出力.
+	  * usdzに直接格納する場合はファイルを経由しない.
+	  * @param[in] fileName  出力ファイル名.
+	  * @param[in] buff      ファイルのデータ.
+	  */
+	 bool m_outputTextureBuffer (const std::string& fileName, const std::vector<unsigned char>& buff);
+
+	 /**
+	  * imageをテクスチャとして出力.
+	  * usdzに直接格納する場合は、作業ファイルを格納後に削除する.
 	  * @param[in] fileName  出力ファイル名.
 	  * @param[in] image     imageクラス.
 	  */
-	 void m_saveTextureImage (const std::string fileName, sxsdk::image_interface* image);
+	 bool m_outputTextureImage (const std::string& fileName, sxsdk::image_interface* image);
+
+	 /**
+	  * ピクセルバッファをエクスポートパラメータの圧縮設定でpng/jpegにエンコードして出力.
+	  * @param[in] fileName     出力ファイル名 (拡張子で形式を判断).
+	  * @param[in] pixelsBuff   ピクセル (グレイスケールの場合は1チャンネル、それ以外はRGBA).
+	  * @param[in] width        幅.
+	  * @param[in] height       高さ.
+	  * @param[in] grayscale    グレイスケール(8bit)のピクセルの場合はtrue.
+	  * @return png/jpeg以外の形式の場合、またはエンコードに失敗した場合はfalse.
+	  */
+	 bool m_outputTexturePixels (const std::string& fileName, const std::vector<unsigned char>& pixelsBuff, const int width, const int height, const bool grayscale);
+
+	 /**
+	  * 1ラインずつ取得したピクセルをエクスポートパラメータの圧縮設定でpng/jpegにエンコードして出力.
+	  * 画像全体のピクセルをメモリ上に保持しない.
+	  * @param[in] fileName     出力ファイル名 (拡張子で形式を判断).
+	  * @param[in] readLine     ラインの取得関数 (グレイスケールの場合は1チャンネル、それ以外はRGBA).
+	  * @param[in] width        幅.
+	  * @param[in] height       高さ.
+	  * @param[in] grayscale    グレイスケール(8bit)のピクセルの場合はtrue.
+	  * @return png/jpeg以外の形式の場合、またはエンコードに失敗した場合はfalse.
+	  */
+	 bool m_outputTextureLines (const std::string& fileName, const ImageUtil::LineReader& readLine, const int width, const int height, const bool grayscale);
+
+	 /**
+	  * テクスチャの出力サイズ/エンコード時間を記録.
+	  * @param[in] fileName    出力ファイル名.
+	  * @param[in] bytes       出力したバイト数.
+	  * @param[in] msec        エンコードにかかった時間 (ミリ秒).
+	  */
+	 void m_appendTextureReport (const std::string& fileName, const unsigned long long bytes, const double msec);
+
+	 /**
+	  * usdzのみを出力するか (テクスチャを作業フォルダに残す必要がない).
+	  */
+	 bool m_isUSDZOnlyOutput () const;
+
+	 /**
+	  * 形状/マテリアル/アニメーションを別々のサブレイヤとして出力するか.
+	  */
+	 bool m_useSplitLayers () const;
+
+	 /**
+	  * サブレイヤのファイル名を取得 (USD_DATA::LAYER_TYPEの順。作成しない場合は"").
+	  * @param[in]  filePath    ルートレイヤのファイルパス.
+	  * @param[out] fileNames   サブレイヤのファイルパス.
+	  */
+	 void m_getSubLayerFileNames (const std::string& filePath, std::vector<std::string>& fileNames);
+
+	 /**
+	  * 差分エクスポート用の出力情報(マニフェスト)を使用するか.
+	  * usdzのみを出力する場合、スキンを出力する場合は使用しない.
+	  */
+	 bool m_useExportManifest () const;
+
+	 /**
+	  * 差分エクスポート時に、前回から変更のないノードか判定.
+	  * 変更のあるノードは、書き直す前に属性をクリアする.
+	  * @param[in] usdExport  USDエクスポートクラス.
+	  * @param[in] nodeName   ノード名.
+	  * @param[in] hash       ノードのハッシュ値.
+	  * @return 前回と同じ内容のノードが存在する場合はtrue.
+	  */
+	 bool m_checkSameNode (CUSDExporter& usdExport, const std::string& nodeName, const unsigned long long hash);
+
+	 /**
+	  * マテリアルのハッシュ値を計算 (差分エクスポート用).
+	  * イメージ番号は出力ごとに変わりうるため、参照するテクスチャのファイル名から計算する.
+	  */
+	 unsigned long long m_calcMaterialHash (const CMaterialData& materialD);
+
+	 /**
+	  * 差分エクスポート時に、前回から変更のないマテリアルか判定.
+	  * 変更のあるマテリアルは、出力し直す前に削除する.
+	  * @param[in] usdExport  USDエクスポートクラス.
+	  * @param[in] materialD  マテリアルデータ.
+	  * @return 前回と同じ内容のマテリアルが存在する場合はtrue.
+	  */
+	 bool m_checkSameMaterial (CUSDExporter& usdExport, const CMaterialData& materialD);
+
+	 /**
+	  * 差分エクスポート時に、前回から削除されたノード、リンクの参照、マテリアルを削除.
+	  */
+	 void m_removeOldNodes (CUSDExporter& usdExport);
+
+	 /**
+	  * テクスチャのハッシュ値を計算 (差分エクスポート用).
+	  */
+	 unsigned long long m_calcTextureHash (const CImageData& imageD);
+
+	 /**
+	  * 差分エクスポート時に、前回と同じテクスチャの場合は出力済みのファイルをそのまま使用.
+	  * @param[in] fileName    出力ファイル名.
+	  * @param[in] imageIndex  イメージ番号.
+	  * @param[in] imageD      イメージ情報.
+	  * @return 出力済みのファイルを使用する場合はtrue.
+	  */
+	 bool m_reuseTextureFiles (const std::string& fileName, const int imageIndex, const CImageData& imageD);
 
 	 /**
 	  * スキンを持つ形状で、名前の重複がある場合は別名を付ける.
@@ -153,6 +347,13 @@ private:
 	 int m_findSameMaterial (sxsdk::surface_class* pSurface);
 	 int m_findSameMaterial (sxsdk::master_surface_class* pMasterSurface);
 
+	 /**
+	  * 同じパラメータを持つマテリアル番号を取得.
+	  * @param[in] materialD  マテリアル情報.
+	  * @return 存在しない場合は-1.
+	  */
+	 int m_findSameMaterialData (const CMaterialData& materialD);
+
 public:
 	CSceneData ();
 	~CSceneData ();
@@ -163,8 +364,9 @@ public:
 	 * エクスポート開始の情報を渡す.
 	 * @param[in] scene        Shade3Dのシーンクラス.
 	 * @param[in] exportParam  エクスポートパラメータ.
+	 * @param[in] workPath     作業フォルダ (ベイクしたテクスチャのピクセルを一時ファイルとして退避する).
 	 */
-	void setupExport (sxsdk::scene_interface* scene, const CExportParam& exportParam);
+	void setupExport (sxsdk::scene_interface* scene, const CExportParam& exportParam, const std::string& workPath = "");
 
 	/**
 	 * 指定の形状を格納する.
@@ -238,6 +440,8 @@ public:
 
 	/**
 	 * usdzファイルを出力。exportUSDのあとに実行すること.
+	 * usdzのみを出力する場合は、テクスチャはここでusdzに直接格納される.
+	 * @param[in] filePath  出力ファイルパス.
 	 */
 	void exportUSDZ (const std::string& filePath);
 
@@ -245,6 +449,16 @@ public:
 	 * エクスポートしたファイル一覧を取得 (usdzも含む).
 	 */
 	std::vector<std::string> getExportFilesList () const;
+
+	/**
+	 * テクスチャごとの出力サイズ/エンコード時間を取得.
+	 */
+	const std::vector<std::string>& getTexturesReport () const { return m_texturesReport; }
+
+	/**
+	 * マテリアルの出力時間 (ms)を取得.
+	 */
+	double getMaterialsExportTime () const { return m_materialsExportTime; }
 };
 
 #endif
@@ -373,6 +373,22 @@ sx::vec<int,2> Shade3DUtil::calcImageSizePowerOf2 (const sx::vec<int,2>& size, c
 	return retSize;
 }
 
+/**
+ * 必要なピクセル数を満たす、ミップマップの段のテクスチャサイズを求める.
+ * @param[in] size          元のサイズ.
+ * @param[in] requiredSize  長辺に必要なピクセル数.
+ * @param[in] maxSize       最大サイズ。マイナスの場合は上限なし.
+ */
+sx::vec<int,2> Shade3DUtil::calcImageSizeMipLevel (const sx::vec<int,2>& size, const int requiredSize, const int maxSize)
+{
+	sx::vec<int,2> retSize = calcImageSizePowerOf2(size, maxSize);
+	while (std::max(retSize[0], retSize[1]) / 2 >= requiredSize && std::min(retSize[0], retSize[1]) > 4) {
+		retSize[0] >>= 1;
+		retSize[1] >>= 1;
+	}
+	return retSize;
+}
+
 namespace {
 	/**
 	 * イメージがアルファ要素を持つか.
@@ -425,56 +441,70 @@ bool Shade3DUtil::hasImageAlpha (sxsdk::image_interface* image)
 	return ::m_hasImageAlpha(image);
 }
 
-/**
- * 画像を指定のサイズにリサイズ。アルファも考慮（image->duplicate_imageはアルファを考慮しないため）.
- * @param[in] image  元の画像.
- * @param[in] size   変更するサイズ.
- */
-compointer<sxsdk::image_interface> Shade3DUtil::resizeImageWithAlpha (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size)
-{
-	// アルファを持たない場合はimage->duplicate_imageを使用.
-	if (!::m_hasImageAlpha(image)) {
-		return compointer<sxsdk::image_interface>(image->duplicate_image(&size));
-	}
-
-	compointer<sxsdk::image_interface> retImage;
-	try {
-		// Alpha要素をいったんRedに入れて、sizeの大きさにリサイズ.
-		const sx::vec<int,2> orgSize = image->get_size();
-		compointer<sxsdk::image_interface> alphaImage(scene->create_image_interface(orgSize));
+namespace {
+	/**
+	 * ImageUtil::resizeRGBAでイメージをリサイズし、新しいイメージとして返す.
+	 * アルファは乗算済みとして補間されるため、RGBとアルファを1回のリサイズで処理できる.
+	 */
+	sxsdk::image_interface* m_resizeImage (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size, const ImageUtil::RESIZE_FILTER filter) {
+		if (!image || size.x <= 0 || size.y <= 0) return NULL;
+		const int srcWidth  = image->get_size().x;
+		const int srcHeight = image->get_size().y;
+		if (srcWidth <= 0 || srcHeight <= 0) return NULL;
+		const int dstWidth  = size.x;
+		const int dstHeight = size.y;
+
+		// 同じサイズの場合はリサイズせずに複製.
+		if (srcWidth == dstWidth && srcHeight == dstHeight) return image->duplicate_image();
+
+		std::vector<sxsdk::rgba_class> lineD;
+		lineD.resize(std::max(srcWidth, dstWidth));
+
+		std::vector<float> srcBuff, dstBuff;
+		srcBuff.resize((size_t)srcWidth * (size_t)srcHeight * 4);
+		dstBuff.resize((size_t)dstWidth * (size_t)dstHeight * 4);
 		{
-			const int wid = image->get_size().x;
-			const int hei = image->get_size().y;
-			std::vector<sxsdk::rgba_class> lineD, lineD2;
-			lineD.resize(wid);
-			lineD2.resize(wid, sxsdk::rgba_class(0, 0, 0, 1));
-			for (int y = 0; y < hei; ++y) {
-				image->get_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
-				for (int x = 0; x < wid; ++x) lineD2[x].red = lineD[x].alpha;
-				alphaImage->set_pixels_rgba_float(0, y, wid, 1, &(lineD2[0]));
+			size_t iPos = 0;
+			for (int y = 0; y < srcHeight; ++y) {
+				image->get_pixels_rgba_float(0, y, srcWidth, 1, &(lineD[0]));
+				for (int x = 0; x < srcWidth; ++x, iPos += 4) {
+					srcBuff[iPos + 0] = lineD[x].red;
+					srcBuff[iPos + 1] = lineD[x].green;
+					srcBuff[iPos + 2] = lineD[x].blue;
+					srcBuff[iPos + 3] = lineD[x].alpha;
+				}
 			}
 		}
-		alphaImage->update();
-		compointer<sxsdk::image_interface> alphaImage2(alphaImage->duplicate_image(&size));
+		if (!ImageUtil::resizeRGBA(&(srcBuff[0]), srcWidth, srcHeight, &(dstBuff[0]), dstWidth, dstHeight, filter)) return NULL;
+		std::vector<float>().swap(srcBuff);
 
-		// imageをsizeの大きさにリサイズし、アルファも更新.
-		retImage = compointer<sxsdk::image_interface>(image->duplicate_image(&size));
+		sxsdk::image_interface* retImage = scene->create_image_interface(size);
+		if (!retImage) return NULL;
 		{
-			const int wid = size.x;
-			const int hei = size.y;
-			std::vector<sxsdk::rgba_class> lineD, lineD2;
-			lineD.resize(wid);
-			lineD2.resize(wid);
-			for (int y = 0; y < hei; ++y) {
-				retImage->get_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
-				alphaImage2->get_pixels_rgba_float(0, y, wid, 1, &(lineD2[0]));
-
-				for (int x = 0; x < wid; ++x) lineD[x].alpha = lineD2[x].red;
-				retImage->set_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
+			size_t iPos = 0;
+			for (int y = 0; y < dstHeight; ++y) {
+				for (int x = 0; x < dstWidth; ++x, iPos += 4) {
+					lineD[x] = sxsdk::rgba_class(dstBuff[iPos + 0], dstBuff[iPos + 1], dstBuff[iPos + 2], dstBuff[iPos + 3]);
+				}
+				retImage->set_pixels_rgba_float(0, y, dstWidth, 1, &(lineD[0]));
 			}
 		}
 		retImage->update();
+		return retImage;
+	}
+}
 
+/**
+ * 画像を指定のサイズにリサイズ。アルファも考慮（image->duplicate_imageはアルファを考慮しないため）.
+ * @param[in] image   元の画像.
+ * @param[in] size    変更するサイズ.
+ * @param[in] filter  リサイズ時のフィルタ.
+ */
+compointer<sxsdk::image_interface> Shade3DUtil::resizeImageWithAlpha (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size, const ImageUtil::RESIZE_FILTER filter)
+{
+	compointer<sxsdk::image_interface> retImage;
+	try {
+		retImage = compointer<sxsdk::image_interface>(::m_resizeImage(scene, image, size, filter));
 	} catch (...) { }
 
 	return retImage;
@@ -483,51 +513,11 @@ compointer<sxsdk::image_interface> Shade3DUtil::resizeImageWithAlpha (sxsdk::sce
 /**
  * compointerを使用せずにイメージをリサイズ.
  */
-sxsdk::image_interface* Shade3DUtil::resizeImageWithAlphaNotCom (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size)
+sxsdk::image_interface* Shade3DUtil::resizeImageWithAlphaNotCom (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size, const ImageUtil::RESIZE_FILTER filter)
 {
-	// アルファを持たない場合はimage->duplicate_imageを使用.
-	if (!::m_hasImageAlpha(image)) {
-		return image->duplicate_image(&size);
-	}
-
 	sxsdk::image_interface* retImage = NULL;
 	try {
-		// Alpha要素をいったんRedに入れて、sizeの大きさにリサイズ.
-		const sx::vec<int,2> orgSize = image->get_size();
-		compointer<sxsdk::image_interface> alphaImage(scene->create_image_interface(orgSize));
-		{
-			const int wid = image->get_size().x;
-			const int hei = image->get_size().y;
-			std::vector<sxsdk::rgba_class> lineD, lineD2;
-			lineD.resize(wid);
-			lineD2.resize(wid, sxsdk::rgba_class(0, 0, 0, 1));
-			for (int y = 0; y < hei; ++y) {
-				image->get_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
-				for (int x = 0; x < wid; ++x) lineD2[x].red = lineD[x].alpha;
-				alphaImage->set_pixels_rgba_float(0, y, wid, 1, &(lineD2[0]));
-			}
-		}
-		alphaImage->update();
-		compointer<sxsdk::image_interface> alphaImage2(alphaImage->duplicate_image(&size));
-
-		// imageをsizeの大きさにリサイズし、アルファも更新.
-		retImage = image->duplicate_image(&size);
-		{
-			const int wid = size.x;
-			const int hei = size.y;
-			std::vector<sxsdk::rgba_class> lineD, lineD2;
-			lineD.resize(wid);
-			lineD2.resize(wid);
-			for (int y = 0; y < hei; ++y) {
-				retImage->get_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
-				alphaImage2->get_pixels_rgba_float(0, y, wid, 1, &(lineD2[0]));
-
-				for (int x = 0; x < wid; ++x) lineD[x].alpha = lineD2[x].red;
-				retImage->set_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
-			}
-		}
-		retImage->update();
-
+		retImage = ::m_resizeImage(scene, image, size, filter);
 	} catch (...) { }
 
 	return retImage;
@@ -545,6 +535,58 @@ bool Shade3DUtil::isOcclusionMappingLayer (sxsdk::mapping_layer_class* mappingLa
 	return false;
 }
 
+/**
+ * イメージ以外のパターン(Shade3Dのプロシージャルテクスチャ)のマッピングレイヤで、テクスチャとしてベイクできるものの場合にパラメータを取得.
+ */
+bool Shade3DUtil::getProceduralPatternParam (sxsdk::mapping_layer_class* mappingLayer, ProceduralPattern::CPatternParam& patternParam)
+{
+	patternParam.clear();
+	if (!mappingLayer) return false;
+	try {
+		const int pattern = mappingLayer->get_pattern();
+		if (pattern == sxsdk::enums::checker_pattern) patternParam.type = ProceduralPattern::pattern_checker;
+		else if (pattern == sxsdk::enums::stripe_pattern) patternParam.type = ProceduralPattern::pattern_stripe;
+		else if (pattern == sxsdk::enums::cloud_pattern) patternParam.type = ProceduralPattern::pattern_cloud;
+		else return false;
+
+		// UV投影で、ベイク時に合成するマッピングの種類のみ.
+		if (mappingLayer->get_projection() != 3) return false;
+		const int type = mappingLayer->get_type();
+		if (type != sxsdk::enums::diffuse_mapping && type != sxsdk::enums::reflection_mapping && type != sxsdk::enums::roughness_mapping &&
+			type != sxsdk::enums::glow_mapping && type != sxsdk::enums::transparency_mapping && type != sxsdk::enums::bump_mapping) return false;
+
+		patternParam.repeatU   = std::max(1, mappingLayer->get_repetition_x());
+		patternParam.repeatV   = std::max(1, mappingLayer->get_repetition_y());
+		patternParam.flipColor = mappingLayer->get_flip_color();
+		patternParam.flipH     = mappingLayer->get_horizontal_flip();
+		patternParam.flipV     = mappingLayer->get_vertical_flip();
+		patternParam.swapAxes  = mappingLayer->get_swap_axes();
+		return true;
+	} catch (...) { }
+	return false;
+}
+
+/**
+ * 指定の表面材質が、ベイクできないイメージ以外のパターンのマッピングレイヤを持つか.
+ */
+bool Shade3DUtil::hasUnsupportedPatternMappingLayer (sxsdk::surface_class* surface)
+{
+	if (!surface) return false;
+	try {
+		ProceduralPattern::CPatternParam patternParam;
+		const int layersCou = surface->get_number_of_mapping_layers();
+		for (int i = 0; i < layersCou; ++i) {
+			sxsdk::mapping_layer_class& mLayer = surface->mapping_layer(i);
+			if (mLayer.get_pattern() == sxsdk::enums::image_pattern) continue;
+			if (Shade3DUtil::isOcclusionMappingLayer(&mLayer)) continue;
+			if (MathUtil::isZero(mLayer.get_weight())) continue;
+			if (Shade3DUtil::getProceduralPatternParam(&mLayer, patternParam)) continue;
+			return true;
+		}
+	} catch (...) { }
+	return false;
+}
+
 /**
  * 選択形状(active_shape)での、Occlusion用のmapping_layer_classを取得.
  */
@@ -7,6 +7,8 @@
 #include "GlobalHeader.h"
 #include "USDData.h"
 #include "TextureTransform.h"
+#include "ImageUtil.h"
+#include "ProceduralPattern.h"
 #include <vector>
 
 namespace Shade3DUtil {
@@ -60,6 +62,15 @@ namespace Shade3DUtil {
 	 */
 	sx::vec<int,2> calcImageSizePowerOf2 (const sx::vec<int,2>& size, const int maxSize = -1);
 
+	/**
+	 * 必要なピクセル数を満たす、ミップマップの段のテクスチャサイズを求める.
+	 * 2の累乗にリサイズしたサイズから、長辺がrequiredSize以上となる範囲で縦横を1/2ずつ縮小する.
+	 * @param[in] size          元のサイズ.
+	 * @param[in] requiredSize  長辺に必要なピクセル数.
+	 * @param[in] maxSize       最大サイズ。マイナスの場合は上限なし.
+	 */
+	sx::vec<int,2> calcImageSizeMipLevel (const sx::vec<int,2>& size, const int requiredSize, const int maxSize = -1);
+
 	/**
 	 * 指定のマスターイメージがAlpha情報を持つかどうか.
 	 * @param[in] masterImage  マスターイメージ.
@@ -70,21 +81,37 @@ namespace Shade3DUtil {
 
 	/**
 	 * 画像を指定のサイズにリサイズ。アルファも考慮（image->duplicate_imageはアルファを考慮しないため）.
-	 * @param[in] image  元の画像.
-	 * @param[in] size   変更するサイズ.
+	 * @param[in] image   元の画像.
+	 * @param[in] size    変更するサイズ.
+	 * @param[in] filter  リサイズ時のフィルタ.
 	 */
-	compointer<sxsdk::image_interface> resizeImageWithAlpha (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size);
+	compointer<sxsdk::image_interface> resizeImageWithAlpha (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size, const ImageUtil::RESIZE_FILTER filter = ImageUtil::resize_filter_lanczos3);
 
 	/**
 	 * compointerを使用せずにイメージをリサイズ.
 	 */
-	sxsdk::image_interface* resizeImageWithAlphaNotCom (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size);
+	sxsdk::image_interface* resizeImageWithAlphaNotCom (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size, const ImageUtil::RESIZE_FILTER filter = ImageUtil::resize_filter_lanczos3);
 
 	/**
 	 * 指定のマッピングレイヤがOcclusion用のレイヤかどうか.
 	 */
 	bool isOcclusionMappingLayer (sxsdk::mapping_layer_class* mappingLayer);
 
+	/**
+	 * イメージ以外のパターン(Shade3Dのプロシージャルテクスチャ)のマッピングレイヤで、テクスチャとしてベイクできるものの場合にパラメータを取得.
+	 * パターンは市松模様/縞/雲、マッピングの種類は拡散反射/反射/荒さ/発光/透明/バンプのみ.
+	 * @param[in]  mappingLayer  マッピングレイヤ.
+	 * @param[out] patternParam  パターンのパラメータが返る.
+	 * @return ベイクできない場合はfalse.
+	 */
+	bool getProceduralPatternParam (sxsdk::mapping_layer_class* mappingLayer, ProceduralPattern::CPatternParam& patternParam);
+
+	/**
+	 * 指定の表面材質が、ベイクできないイメージ以外のパターンのマッピングレイヤを持つか.
+	 * これらは出力時には無視される.
+	 */
+	bool hasUnsupportedPatternMappingLayer (sxsdk::surface_class* surface);
+
 	/**
 	 * 選択形状(active_shape)での、Occlusion用のmapping_layer_classを取得.
 	 */
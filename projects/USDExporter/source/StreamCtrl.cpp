@@ -117,6 +117,79 @@ void StreamCtrl::saveExportDialogParam (sxsdk::shade_interface& shade, const CEx
 			stream->write_int(iDat);
 		}
 
+		// ver.108 - 
+		{
+			iDat = data.texOptPackORM ? 1 : 0;
+			stream->write_int(iDat);
+		}
+
+		// ver.109 - 
+		{
+			iDat = data.exportIncremental ? 1 : 0;
+			stream->write_int(iDat);
+		}
+
+		// ver.10a - 
+		{
+			iDat = data.exportSplitLayers ? 1 : 0;
+			stream->write_int(iDat);
+		}
+
+		// ver.10b - 
+		{
+			stream->write_int(data.texPNGCompressionLevel);
+
+			iDat = (int)data.texPNGFilterType;
+			stream->write_int(iDat);
+
+			iDat = data.texPNGOptimize ? 1 : 0;
+			stream->write_int(iDat);
+
+			stream->write_int(data.texJPEGQuality);
+
+			iDat = data.texEncodeReport ? 1 : 0;
+			stream->write_int(iDat);
+		}
+
+		// ver.10c - 
+		{
+			stream->write_int(data.texTexelDensity);
+		}
+
+		// ver.10d - 
+		{
+			iDat = data.texPackAtlas ? 1 : 0;
+			stream->write_int(iDat);
+
+			stream->write_int(data.texAtlasMaxSize);
+		}
+
+		// ver.10e - 
+		{
+			iDat = data.texCopySourceImages ? 1 : 0;
+			stream->write_int(iDat);
+		}
+
+		// ver.10f - 
+		{
+			iDat = data.mergeSameMaterials ? 1 : 0;
+			stream->write_int(iDat);
+		}
+
+		// ver.110 - 
+		{
+			iDat = data.texBakeAO ? 1 : 0;
+			stream->write_int(iDat);
+
+			stream->write_int(data.texBakeAOSize);
+		}
+
+		// ver.111 - 
+		{
+			iDat = data.materialOutputPreviewSurface ? 1 : 0;
+			stream->write_int(iDat);
+		}
+
 	} catch (...) { }
 }
 
@@ -230,6 +303,84 @@ void StreamCtrl::loadExportDialogParam (sxsdk::shade_interface& shade, CExportPa
 			data.optKind = (USD_DATA::EXPORT::KIND_TYPE)iDat;
 		}
 
+		// ver.108 - 
+		if (iVersion >= USD_EXPORTER_DLG_STREAM_VERSION_108) {
+			stream->read_int(iDat);
+			data.texOptPackORM = iDat ? true : false;
+		}
+
+		// ver.109 - 
+		if (iVersion >= USD_EXPORTER_DLG_STREAM_VERSION_109) {
+			stream->read_int(iDat);
+			data.exportIncremental = iDat ? true : false;
+		}
+
+		// ver.10a - 
+		if (iVersion >= USD_EXPORTER_DLG_STREAM_VERSION_10A) {
+			stream->read_int(iDat);
+			data.exportSplitLayers = iDat ? true : false;
+		}
+
+		// ver.10b - 
+		if (iVersion >= USD_EXPORTER_DLG_STREAM_VERSION_10B) {
+			stream->read_int(iDat);
+			data.texPNGCompressionLevel = iDat;
+
+			stream->read_int(iDat);
+			data.texPNGFilterType = (USD_DATA::EXPORT::PNG_FILTER_TYPE)iDat;
+
+			stream->read_int(iDat);
+			data.texPNGOptimize = iDat ? true : false;
+
+			stream->read_int(iDat);
+			data.texJPEGQuality = iDat;
+
+			stream->read_int(iDat);
+			data.texEncodeReport = iDat ? true : false;
+		}
+
+		// ver.10c - 
+		if (iVersion >= USD_EXPORTER_DLG_STREAM_VERSION_10C) {
+			stream->read_int(iDat);
+			data.texTexelDensity = iDat;
+		}
+
+		// ver.10d - 
+		if (iVersion >= USD_EXPORTER_DLG_STREAM_VERSION_10D) {
+			stream->read_int(iDat);
+			data.texPackAtlas = iDat ? true : false;
+
+			stream->read_int(iDat);
+			data.texAtlasMaxSize = iDat;
+		}
+
+		// ver.10e - 
+		if (iVersion >= USD_EXPORTER_DLG_STREAM_VERSION_10E) {
+			stream->read_int(iDat);
+			data.texCopySourceImages = iDat ? true : false;
+		}
+
+		// ver.10f - 
+		if (iVersion >= USD_EXPORTER_DLG_STREAM_VERSION_10F) {
+			stream->read_int(iDat);
+			data.mergeSameMaterials = iDat ? true : false;
+		}
+
+		// ver.110 - 
+		if (iVersion >= USD_EXPORTER_DLG_STREAM_VERSION_110) {
+			stream->read_int(iDat);
+			data.texBakeAO = iDat ? true : false;
+
+			stream->read_int(iDat);
+			data.texBakeAOSize = iDat;
+		}
+
+		// ver.111 - 
+		if (iVersion >= USD_EXPORTER_DLG_STREAM_VERSION_111) {
+			stream->read_int(iDat);
+			data.materialOutputPreviewSurface = iDat ? true : false;
+		}
+
 	} catch (...) { }
 }
 
@@ -0,0 +1,187 @@
+﻿/**
+ * 小さいテクスチャを1枚のアトラスのページにまとめて配置.
+ */
+#include "TextureAtlas.h"
+
+#include <algorithm>
+
+namespace {
+	/**
+	 * 1つの棚の情報.
+	 */
+	struct ATLAS_SHELF {
+		int pageIndex;
+		int y;				// 棚の上端.
+		int height;			// 棚の高さ (パディングを含む).
+		int usedWidth;		// 使用済みの幅 (パディングを含む).
+	};
+
+	/**
+	 * 指定の値以上の2の累乗を取得.
+	 */
+	int m_calcPowerOf2 (const int v) {
+		int size = 1;
+		while (size < v) size <<= 1;
+		return size;
+	}
+}
+
+//------------------------------------------------------------------.
+CAtlasRectData::CAtlasRectData ()
+{
+	clear();
+}
+
+CAtlasRectData::~CAtlasRectData ()
+{
+}
+
+void CAtlasRectData::clear ()
+{
+	pageIndex = -1;
+	x = y = 0;
+	width = height = 0;
+}
+
+//------------------------------------------------------------------.
+CTextureAtlas::CTextureAtlas (const int pageSize, const int padding)
+{
+	m_pageSize = std::max(1, pageSize);
+	m_padding  = std::max(0, padding);
+}
+
+CTextureAtlas::~CTextureAtlas ()
+{
+}
+
+void CTextureAtlas::clear ()
+{
+	m_rects.clear();
+	m_pageWidths.clear();
+	m_pageHeights.clear();
+}
+
+/**
+ * 指定のサイズの矩形をページに配置.
+ */
+bool CTextureAtlas::pack (const std::vector<int>& widths, const std::vector<int>& heights)
+{
+	clear();
+	const size_t rectsCount = std::min(widths.size(), heights.size());
+	m_rects.resize(rectsCount);
+	if (rectsCount == 0) return false;
+
+	// 高さの大きい順 (同じ場合は幅の大きい順) に配置する.
+	std::vector<int> orders(rectsCount);
+	for (size_t i = 0; i < rectsCount; ++i) orders[i] = (int)i;
+	std::stable_sort(orders.begin(), orders.end(), [&](const int a, const int b) {
+		if (heights[a] != heights[b]) return heights[a] > heights[b];
+		return widths[a] > widths[b];
+	});
+
+	std::vector<ATLAS_SHELF> shelves;
+	std::vector<int> pageUsedHeights;
+	for (size_t i = 0; i < rectsCount; ++i) {
+		const int index = orders[i];
+		const int width  = widths[index] + m_padding * 2;
+		const int height = heights[index] + m_padding * 2;
+		if (widths[index] <= 0 || heights[index] <= 0 || width > m_pageSize || height > m_pageSize) continue;
+
+		// 収まる棚のうち、高さの余りが最も少ないものを採用.
+		int shelfIndex = -1;
+		for (size_t j = 0; j < shelves.size(); ++j) {
+			const ATLAS_SHELF& shelf = shelves[j];
+			if (shelf.height < height || shelf.usedWidth + width > m_pageSize) continue;
+			if (shelfIndex < 0 || shelf.height < shelves[shelfIndex].height) shelfIndex = (int)j;
+		}
+
+		// 新しい棚を追加 (ページに空きがない場合はページを追加).
+		if (shelfIndex < 0) {
+			int pageIndex = -1;
+			for (size_t j = 0; j < pageUsedHeights.size(); ++j) {
+				if (pageUsedHeights[j] + height <= m_pageSize) {
+					pageIndex = (int)j;
+					break;
+				}
+			}
+			if (pageIndex < 0) {
+				pageIndex = (int)pageUsedHeights.size();
+				pageUsedHeights.push_back(0);
+			}
+			ATLAS_SHELF shelf;
+			shelf.pageIndex = pageIndex;
+			shelf.y         = pageUsedHeights[pageIndex];
+			shelf.height    = height;
+			shelf.usedWidth = 0;
+			pageUsedHeights[pageIndex] += height;
+			shelfIndex = (int)shelves.size();
+			shelves.push_back(shelf);
+		}
+
+		ATLAS_SHELF& shelf = shelves[shelfIndex];
+		CAtlasRectData& rect = m_rects[index];
+		rect.pageIndex = shelf.pageIndex;
+		rect.x         = shelf.usedWidth + m_padding;
+		rect.y         = shelf.y + m_padding;
+		rect.width     = widths[index];
+		rect.height    = heights[index];
+		shelf.usedWidth += width;
+	}
+
+	// 1つの矩形のみのページはまとめる効果がないため除外し、ページ番号を詰める.
+	const int pagesCount = (int)pageUsedHeights.size();
+	std::vector<int> rectsCountInPage(pagesCount, 0);
+	for (size_t i = 0; i < rectsCount; ++i) {
+		if (m_rects[i].pageIndex >= 0) rectsCountInPage[m_rects[i].pageIndex]++;
+	}
+	std::vector<int> newPageIndices(pagesCount, -1);
+	for (int i = 0; i < pagesCount; ++i) {
+		if (rectsCountInPage[i] < 2) continue;
+		newPageIndices[i] = (int)m_pageWidths.size();
+		m_pageWidths.push_back(0);
+		m_pageHeights.push_back(0);
+	}
+
+	// ページのサイズは、使用している範囲を含む2の累乗にする.
+	for (size_t i = 0; i < rectsCount; ++i) {
+		CAtlasRectData& rect = m_rects[i];
+		if (rect.pageIndex < 0) continue;
+		rect.pageIndex = newPageIndices[rect.pageIndex];
+		if (rect.pageIndex < 0) {
+			rect.clear();
+			continue;
+		}
+		m_pageWidths[rect.pageIndex]  = std::max(m_pageWidths[rect.pageIndex], rect.x + rect.width + m_padding);
+		m_pageHeights[rect.pageIndex] = std::max(m_pageHeights[rect.pageIndex], rect.y + rect.height + m_padding);
+	}
+	for (size_t i = 0; i < m_pageWidths.size(); ++i) {
+		m_pageWidths[i]  = m_calcPowerOf2(m_pageWidths[i]);
+		m_pageHeights[i] = m_calcPowerOf2(m_pageHeights[i]);
+	}
+
+	return !m_pageWidths.empty();
+}
+
+/**
+ * ページの矩形の位置にピクセルを複写.
+ */
+void CTextureAtlas::copyRectPixels (const std::vector<unsigned char>& srcBuff, const int pixelBytes, const CAtlasRectData& rect, std::vector<unsigned char>& pageBuff, const int pageWidth, const int pageHeight) const
+{
+	if (rect.width <= 0 || rect.height <= 0) return;
+	if (srcBuff.size() < (size_t)rect.width * (size_t)rect.height * (size_t)pixelBytes) return;
+	if (pageBuff.size() < (size_t)pageWidth * (size_t)pageHeight * (size_t)pixelBytes) return;
+
+	const int x1 = std::max(0, rect.x - m_padding);
+	const int y1 = std::max(0, rect.y - m_padding);
+	const int x2 = std::min(pageWidth, rect.x + rect.width + m_padding);
+	const int y2 = std::min(pageHeight, rect.y + rect.height + m_padding);
+	for (int y = y1; y < y2; ++y) {
+		const int srcY = std::min(std::max(y - rect.y, 0), rect.height - 1);
+		const unsigned char* pSrcLine = &(srcBuff[(size_t)srcY * (size_t)rect.width * (size_t)pixelBytes]);
+		unsigned char* pDstLine = &(pageBuff[(size_t)y * (size_t)pageWidth * (size_t)pixelBytes]);
+		for (int x = x1; x < x2; ++x) {
+			const int srcX = std::min(std::max(x - rect.x, 0), rect.width - 1);
+			for (int i = 0; i < pixelBytes; ++i) pDstLine[x * pixelBytes + i] = pSrcLine[srcX * pixelBytes + i];
+		}
+	}
+}
@@ -0,0 +1,108 @@
+﻿/**
+ * 小さいテクスチャを1枚のアトラスのページにまとめて配置.
+ * 高さ順に並べて、棚(シェルフ)単位で左から詰めていく.
+ */
+
+#ifndef _TEXTUREATLAS_H
+#define _TEXTUREATLAS_H
+
+#include <vector>
+
+//------------------------------------------------------------------.
+/**
+ * アトラス上に配置した矩形.
+ */
+class CAtlasRectData
+{
+public:
+	int pageIndex;					// 配置したページ番号 (-1の場合は配置しない).
+	int x, y;						// ページ上の左上の位置 (パディングは含まない).
+	int width, height;				// 幅と高さ.
+
+public:
+	CAtlasRectData ();
+	~CAtlasRectData ();
+
+	CAtlasRectData (const CAtlasRectData& v) {
+		this->pageIndex = v.pageIndex;
+		this->x = v.x;
+		this->y = v.y;
+		this->width  = v.width;
+		this->height = v.height;
+	}
+
+	CAtlasRectData& operator = (const CAtlasRectData &v) {
+		this->pageIndex = v.pageIndex;
+		this->x = v.x;
+		this->y = v.y;
+		this->width  = v.width;
+		this->height = v.height;
+		return (*this);
+	}
+
+	void clear ();
+};
+
+//------------------------------------------------------------------.
+/**
+ * テクスチャアトラスの配置計算.
+ */
+class CTextureAtlas
+{
+private:
+	int m_pageSize;								// ページの最大サイズ.
+	int m_padding;								// 矩形の周囲に確保するピクセル数.
+
+	std::vector<CAtlasRectData> m_rects;		// 配置した矩形.
+	std::vector<int> m_pageWidths;				// ページごとの幅 (2の累乗).
+	std::vector<int> m_pageHeights;				// ページごとの高さ (2の累乗).
+
+public:
+	/**
+	 * @param[in] pageSize  ページの最大サイズ.
+	 * @param[in] padding   矩形の周囲に確保するピクセル数 (ミップマップ/バイリニア補間時のにじみ防止).
+	 */
+	CTextureAtlas (const int pageSize = 2048, const int padding = 4);
+	~CTextureAtlas ();
+
+	void clear ();
+
+	/**
+	 * 指定のサイズの矩形をページに配置.
+	 * ページに収まらない矩形と、1つの矩形のみとなったページの矩形はpageIndexが-1になる.
+	 * @param[in] widths   矩形ごとの幅.
+	 * @param[in] heights  矩形ごとの高さ.
+	 * @return 1つ以上のページを作成した場合はtrue.
+	 */
+	bool pack (const std::vector<int>& widths, const std::vector<int>& heights);
+
+	/**
+	 * 配置した矩形を取得.
+	 */
+	const std::vector<CAtlasRectData>& getRects () const { return m_rects; }
+
+	/**
+	 * ページ数を取得.
+	 */
+	int getPagesCount () const { return (int)m_pageWidths.size(); }
+
+	/**
+	 * ページのサイズを取得.
+	 */
+	int getPageWidth (const int pageIndex) const { return m_pageWidths[pageIndex]; }
+	int getPageHeight (const int pageIndex) const { return m_pageHeights[pageIndex]; }
+
+	/**
+	 * ページの矩形の位置にピクセルを複写.
+	 * パディングの領域は矩形の端のピクセルで埋める.
+	 * @param[in]  srcBuff     複写元のピクセル (rect.width x rect.height x pixelBytes).
+	 * @param[in]  pixelBytes  1ピクセルのバイト数.
+	 * @param[in]  rect        配置した矩形.
+	 * @param[out] pageBuff    ページのピクセル.
+	 * @param[in]  pageWidth   ページの幅.
+	 * @param[in]  pageHeight  ページの高さ.
+	 */
+	void copyRectPixels (const std::vector<unsigned char>& srcBuff, const int pixelBytes, const CAtlasRectData& rect, std::vector<unsigned char>& pageBuff, const int pageWidth, const int pageHeight) const;
+};
+
+#endif
@@ -58,6 +58,22 @@ namespace USD_DATA {
 		image_format_other				// その他.
 	};
 
+	/**
+	 * レイヤを分割して出力する場合のサブレイヤの種類.
+	 */
+	enum LAYER_TYPE {
+		layer_type_geometry = 0,		// 形状 (geometry).
+		layer_type_materials,			// マテリアル (materials).
+		layer_type_anim,				// アニメーション (anim).
+		layer_type_count,				// サブレイヤの数.
+	};
+
+	// ベイクしたイメージのピクセルの格納形式.
+	enum IMAGE_PIXEL_FORMAT {
+		image_pixel_format_rgba8 = 0,	// RGBA (8bit x 4).
+		image_pixel_format_gray8,		// グレイスケール (8bit x 1).
+	};
+
 	/**
 	 * メッシュの情報.
 	 * これは、USDにエクスポートする際に使用する作業情報.
@@ -12,6 +12,11 @@
 #include "StringUtil.h"
 
 #include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usd/editTarget.h"
+#include "pxr/usd/sdf/layer.h"
+#include "pxr/usd/sdf/changeBlock.h"
+#include "pxr/usd/sdf/primSpec.h"
+#include "pxr/usd/sdf/attributeSpec.h"
 #include "pxr/usd/usdGeom/xform.h"
 #include "pxr/usd/usdGeom/sphere.h"
 #include "pxr/usd/usdGeom/mesh.h"
@@ -22,8 +27,6 @@
 #include "pxr/usd/usdShade/shader.h"
 #include "pxr/usd/usdShade/materialBindingAPI.h"		// USD v.21.02
 
-#include "pxr/usd/usd/zipfile.h"
-
 #include "pxr/usd/usdSkel/root.h"
 #include "pxr/usd/usdSkel/skeleton.h"
 #include "pxr/usd/usdSkel/animation.h"
@@ -37,16 +40,23 @@
 #include <memory>
 #include <iostream>
 #include <map>
+#include <set>
 
 // 以下のnamespace内に、UsdXXXXのクラスがある.
 using namespace PXR_INTERNAL_NS;
 
 UsdStageRefPtr g_stage = NULL;		// USDエクスポート時のクラス.
+std::vector<SdfLayerRefPtr> g_subLayers;		// レイヤを分割して出力する場合のサブレイヤ (USD_DATA::LAYER_TYPEの順).
+std::set<std::string> g_shaderTemplateInputs;	// Shaderのテンプレートに表示情報を格納済みのinput ("テンプレートのパス.input名").
 
 #define ROOT_PATH  "/root"
 #define MATERIAL_ROOT_PATH  "/root/Materials"
 #define SKELETONS_ROOT_PATH  "/root/Skeletons"
 
+// MDLのShaderのテンプレート(class prim)を格納するパス.
+// 外部参照された場合もspecializesが解決できるように、rootノードの下に配置する.
+#define SHADER_TEMPLATES_ROOT_PATH  "/root/_ShaderTemplates"
+
 // min-max範囲指定を使用するかどうか.
 #define USE_DICTIONARY_RANGE  0
 
@@ -74,6 +84,109 @@ UsdStageRefPtr g_stage = NULL;		// USDエクスポート時のクラス.
 			transOp.Set(GfVec3f(matrix.scale[0], matrix.scale[1], matrix.scale[2]));
 		}
 	}
+
+	/**
+	 * レイヤにprimのspecを作成 (UsdStage::DefinePrimと同じく、defとして型を指定).
+	 * UsdStageを介さないため、SdfChangeBlock内でも作成したprimをそのまま参照できる.
+	 * @param[in] layer      格納先のレイヤ.
+	 * @param[in] path       primのパス.
+	 * @param[in] typeName   primの型 ("Shader"など)。""の場合は型を指定しない.
+	 * @param[in] specifier  テンプレート(class)として作成する場合はSdfSpecifierClass.
+	 */
+	SdfPrimSpecHandle m_definePrimSpec (const SdfLayerHandle& layer, const SdfPath& path, const std::string& typeName, const SdfSpecifier specifier = SdfSpecifierDef)
+	{
+		SdfPrimSpecHandle primSpec = SdfCreatePrimInLayer(layer, path);
+		if (!primSpec) return primSpec;
+		primSpec->SetSpecifier(specifier);
+		if (typeName != "") primSpec->SetTypeName(typeName);
+		return primSpec;
+	}
+
+	/**
+	 * primのspecに属性を作成し、値を指定.
+	 * UsdShadeのinput/outputと同じく、customではない属性として作成する.
+	 * すでに存在する場合は、その属性に値を指定する.
+	 * @param[in] primSpec     対象のprim.
+	 * @param[in] name         属性名 ("inputs:diffuseColor"など).
+	 * @param[in] typeName     属性の型.
+	 * @param[in] value        値。空の場合は値を指定しない.
+	 * @param[in] variability  uniformの場合はSdfVariabilityUniform.
+	 */
+	SdfAttributeSpecHandle m_createAttributeSpec (const SdfPrimSpecHandle& primSpec, const std::string& name, const SdfValueTypeName& typeName, const VtValue& value = VtValue(), const SdfVariability variability = SdfVariabilityVarying)
+	{
+		const SdfPath attrPath = primSpec->GetPath().AppendProperty(TfToken(name));
+		SdfAttributeSpecHandle attrSpec = primSpec->GetLayer()->GetAttributeAtPath(attrPath);
+		if (!attrSpec) attrSpec = SdfAttributeSpec::New(primSpec, name, typeName, variability, false);
+		if (attrSpec && !value.IsEmpty()) attrSpec->SetDefaultValue(value);
+		return attrSpec;
+	}
+
+	/**
+	 * 属性を、接続元の属性につなぐ (UsdShadeInput::ConnectToSourceと同じく接続元を置き換える).
+	 * @param[in] attrSpec        接続先の属性 (inputs:xxx / outputs:xxx).
+	 * @param[in] sourceAttrSpec  接続元の属性.
+	 */
+	void m_connectAttributeSpec (const SdfAttributeSpecHandle& attrSpec, const SdfAttributeSpecHandle& sourceAttrSpec)
+	{
+		if (!attrSpec || !sourceAttrSpec) return;
+		attrSpec->GetConnectionPathList().ClearEditsAndMakeExplicit();
+		attrSpec->GetConnectionPathList().GetExplicitItems().push_back(sourceAttrSpec->GetPath());
+	}
+
+	/**
+	 * 属性を、接続元のShaderのoutputにつなぐ.
+	 * UsdShadeInput::ConnectToSourceと同じく、outputが存在しない場合は接続先と同じ型で作成する.
+	 * @param[in] attrSpec        接続先の属性.
+	 * @param[in] sourcePrimSpec  接続元のShader.
+	 * @param[in] sourceName      接続元のoutput名 ("rgb"など).
+	 */
+	void m_connectToOutputSpec (const SdfAttributeSpecHandle& attrSpec, const SdfPrimSpecHandle& sourcePrimSpec, const std::string& sourceName)
+	{
+		if (!attrSpec || !sourcePrimSpec) return;
+		m_connectAttributeSpec(attrSpec, m_createAttributeSpec(sourcePrimSpec, std::string("outputs:") + sourceName, attrSpec->GetTypeName()));
+	}
+
+	/**
+	 * Shaderのinputに表示用の情報 (グループ名、表示名、デフォルト値、範囲)を指定.
+	 * テンプレートを指定した場合は、テンプレート側のinputに1度だけ格納する.
+	 * UsdStageを介さずにSdfのspecとして格納するため、SdfChangeBlock内から呼ぶことができる.
+	 * @param[in] inSpec        対象のinput.
+	 * @param[in] templatePath  Shaderのテンプレートのパス。""の場合はinSpecに直接格納する.
+	 * @return 表示情報を格納したattribute。テンプレートに格納済みの場合は無効なhandleを返す.
+	 */
+	SdfAttributeSpecHandle m_setShaderInputMetadata (const SdfAttributeSpecHandle& inSpec, const std::string& templatePath, const std::string& displayGroup, const std::string& displayName, const VtValue& defaultValue, const VtValue& minValue = VtValue(), const VtValue& maxValue = VtValue())
+	{
+		if (!inSpec) return SdfAttributeSpecHandle();
+
+		SdfAttributeSpecHandle attrSpec;
+		if (templatePath == "") {
+			attrSpec = inSpec;
+		} else {
+			const std::string keyStr = templatePath + std::string(".") + SdfPath::StripNamespace(inSpec->GetName());
+			if (g_shaderTemplateInputs.find(keyStr) != g_shaderTemplateInputs.end()) return SdfAttributeSpecHandle();
+			g_shaderTemplateInputs.insert(keyStr);
+
+			SdfPrimSpecHandle templateSpec = inSpec->GetLayer()->GetPrimAtPath(SdfPath(templatePath));
+			if (!templateSpec) return SdfAttributeSpecHandle();
+			attrSpec = m_createAttributeSpec(templateSpec, inSpec->GetName(), inSpec->GetTypeName());
+			if (!attrSpec) return SdfAttributeSpecHandle();
+		}
+
+		attrSpec->SetDisplayGroup(displayGroup);
+		attrSpec->SetDisplayName(displayName);
+
+		// デフォルトの値を指定.
+		attrSpec->SetCustomData("default", defaultValue);
+#if USE_DICTIONARY_RANGE
+		if (!minValue.IsEmpty() && !maxValue.IsEmpty()) {
+			VtDictionary dic;
+			dic.SetValueAtPath("max", maxValue);
+			dic.SetValueAtPath("min", minValue);
+			attrSpec->SetCustomData("range", VtValue(dic));
+		}
+#endif
+		return attrSpec;
+	}
  }
 
 CUSDExporter::CUSDExporter ()
@@ -81,6 +194,8 @@ CUSDExporter::CUSDExporter ()
 	clear();
 	g_stage = NULL;
 	m_versionString = "";
+	m_exportFileName = "";
+	m_subLayerFileNames.clear();
 }
 
 /**
@@ -358,9 +473,18 @@ void CUSDExporter::setVersionString (const std::string& verStr)
 /**
  * Export開始.
  */
-void CUSDExporter::beginExport (const std::string& fileName, const CExportParam& exportParam)
+void CUSDExporter::beginExport (const std::string& fileName, const CExportParam& exportParam, const std::string& baseFileName)
 {
-	g_stage = UsdStage::CreateNew(fileName);
+	m_exportFileName = "";
+	m_subLayerFileNames.clear();
+	g_subLayers.clear();
+	g_shaderTemplateInputs.clear();
+	if (baseFileName != "") {
+		// 前回出力したファイルを開き、endExportで別名として保存する.
+		g_stage = UsdStage::Open(baseFileName);
+		if (g_stage) m_exportFileName = fileName;
+	}
+	if (!g_stage) g_stage = UsdStage::CreateNew(fileName);
 	m_exportParam = exportParam;
 
 	if (g_stage) {
@@ -421,13 +545,103 @@ void CUSDExporter::endExport ()
 {
 	if (!g_stage) return;
 
+	// サブレイヤを使用する場合.
+	if (!g_subLayers.empty()) {
+		for (size_t i = 0; i < g_subLayers.size(); ++i) {
+			if (g_subLayers[i]) g_subLayers[i]->Save();
+		}
+
+		// ルートレイヤからの参照を、出力後のサブレイヤのファイル名に置き換えて保存.
+		// ステージを破棄してから置き換えることで、置き換え後のファイルが読み込まれないようにする.
+		// 強いレイヤから順に「アニメーション」「マテリアル」「形状」となる.
+		SdfLayerRefPtr rootLayer = g_stage->GetRootLayer();
+		g_stage.Reset();
+		g_stage = NULL;
+
+		std::vector<std::string> subLayerPaths;
+		for (int i = (int)USD_DATA::LAYER_TYPE::layer_type_count - 1; i >= 0; --i) {
+			if (g_subLayers[i] && m_subLayerFileNames[i] != "") subLayerPaths.push_back(m_subLayerFileNames[i]);
+		}
+		rootLayer->SetSubLayerPaths(subLayerPaths);
+		if (m_exportFileName != "") {
+			rootLayer->Export(m_exportFileName);
+		} else {
+			rootLayer->Save();
+		}
+		rootLayer = NULL;
+
+		g_subLayers.clear();
+		m_subLayerFileNames.clear();
+		m_exportFileName = "";
+		return;
+	}
+
 	// ファイル保存.
-	g_stage->Save();
+	if (m_exportFileName != "") {
+		g_stage->GetRootLayer()->Export(m_exportFileName);
+	} else {
+		g_stage->Save();
+	}
+	m_exportFileName = "";
 
 	g_stage.Reset();
 	g_stage = NULL;
 }
 
+/**
+ * 形状/マテリアル/アニメーションを別々のサブレイヤとして出力する場合に、サブレイヤを作成.
+ * @param[in] tempFileNames  出力時に書き込むサブレイヤのファイル名 (USD_DATA::LAYER_TYPEの順。作成しない場合は"").
+ * @param[in] fileNames      ルートレイヤから参照するサブレイヤのファイル名 (USD_DATA::LAYER_TYPEの順).
+ */
+void CUSDExporter::createSubLayers (const std::vector<std::string>& tempFileNames, const std::vector<std::string>& fileNames)
+{
+	g_subLayers.clear();
+	m_subLayerFileNames.clear();
+	if (!g_stage) return;
+	if (tempFileNames.size() < (size_t)USD_DATA::LAYER_TYPE::layer_type_count || fileNames.size() < (size_t)USD_DATA::LAYER_TYPE::layer_type_count) return;
+
+	// 作業中は、ルートレイヤから一時ファイルのサブレイヤを参照する.
+	std::vector<std::string> subLayerPaths;
+	g_subLayers.resize(USD_DATA::LAYER_TYPE::layer_type_count);
+	m_subLayerFileNames.resize(USD_DATA::LAYER_TYPE::layer_type_count);
+	for (int i = (int)USD_DATA::LAYER_TYPE::layer_type_count - 1; i >= 0; --i) {
+		if (tempFileNames[i] == "") continue;
+		g_subLayers[i] = SdfLayer::CreateNew(tempFileNames[i]);
+		if (!g_subLayers[i]) continue;
+		m_subLayerFileNames[i] = fileNames[i];
+		subLayerPaths.push_back(g_subLayers[i]->GetIdentifier());
+	}
+	if (subLayerPaths.empty()) {
+		g_subLayers.clear();
+		m_subLayerFileNames.clear();
+		return;
+	}
+	g_stage->GetRootLayer()->SetSubLayerPaths(subLayerPaths);
+}
+
+/**
+ * 書き込み先のレイヤを切り替え (レイヤを分割して出力する場合).
+ * 指定の種類のサブレイヤがない場合は、形状のサブレイヤまたはルートレイヤに書き込む.
+ */
+void CUSDExporter::m_setEditTarget (const USD_DATA::LAYER_TYPE layerType)
+{
+	if (!g_stage || g_subLayers.empty()) return;
+
+	SdfLayerRefPtr layer = g_subLayers[layerType];
+	if (!layer) layer = g_subLayers[USD_DATA::LAYER_TYPE::layer_type_geometry];
+	if (!layer) layer = g_stage->GetRootLayer();
+	g_stage->SetEditTarget(UsdEditTarget(layer));
+}
+
+/**
+ * 書き込み先をルートレイヤにする.
+ */
+void CUSDExporter::m_setEditTargetRoot ()
+{
+	if (!g_stage || g_subLayers.empty()) return;
+	g_stage->SetEditTarget(UsdEditTarget(g_stage->GetRootLayer()));
+}
+
 /**
  * スケルトン情報を渡す.
  */
@@ -451,6 +665,7 @@ void CUSDExporter::SetImagesList (const std::vector<CImageData>& imagesList)
 void CUSDExporter::appendNodeMaterial (const CMaterialData& materialData)
 {
 	if (!g_stage) return;
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_materials);
 
 	// "/Materials"が存在しない場合は追加.
 	const std::string materialsName = MATERIAL_ROOT_PATH;
@@ -473,6 +688,7 @@ void CUSDExporter::appendNodeMaterial (const CMaterialData& materialData)
 void CUSDExporter::appendNodeMaterial_OmniverseMDL (const CMaterialData& materialData)
 {
 	if (!g_stage) return;
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_materials);
 
 	// "/Materials"が存在しない場合は追加.
 	const std::string materialsName = MATERIAL_ROOT_PATH;
@@ -486,25 +702,76 @@ void CUSDExporter::appendNodeMaterial_OmniverseMDL (const CMaterialData& materia
 	//-----------------------------------.
 	UsdPrim primMat = g_stage->DefinePrim(SdfPath(materialData.name), TfToken("Material"));
 	m_appendNodeMaterial_OmniverseMDL(materialData.name, materialData);
+
+	// 同じマテリアルにUsdPreviewSurfaceも出力 (outputs:surface).
+	if (m_exportParam.useShaderPreviewSurface()) m_appendNodeMaterial(materialData.name, materialData);
+}
+
+/**
+ * Materialノードをまとめて出力.
+ * UsdStageは変更通知を受けてprimを構成するため、SdfChangeBlock内でUsdStage経由で作成したprimは参照できない.
+ * UsdPreviewSurface/MDLのネットワークはレイヤにSdfのspecとして直接格納するため、Materialのprimも含めてSdfChangeBlock内で出力する.
+ * MDLのShaderのテンプレートも同じレイヤにspecとして格納する.
+ * MDLとUsdPreviewSurfaceの両方を出力する場合は、outputs:mdl:surfaceとoutputs:surfaceを同じマテリアルに持つ.
+ * @param[in] materialsList  マテリアルデータのリスト.
+ */
+void CUSDExporter::appendNodeMaterials (const std::vector<CMaterialData>& materialsList)
+{
+	if (!g_stage || materialsList.empty()) return;
+
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_materials);
+	const SdfLayerHandle layer = g_stage->GetEditTarget().GetLayer();
+	if (!layer) return;
+
+	// "/Materials"が存在しない場合は追加.
+	const std::string materialsName = MATERIAL_ROOT_PATH;
+	UsdPrim prim = g_stage->GetPrimAtPath(SdfPath(materialsName));
+	if (!prim.IsValid()) {
+		g_stage->DefinePrim(SdfPath(materialsName), TfToken("Scope"));
+	}
+
+	if (!m_exportParam.useShaderMDL()) {
+		// Materialとその下のUsdPreviewSurfaceのネットワークを格納.
+		SdfChangeBlock changeBlock;
+		for (size_t i = 0; i < materialsList.size(); ++i) {
+			if (!::m_definePrimSpec(layer, SdfPath(materialsList[i].name), "Material")) continue;
+			m_appendNodeMaterial(materialsList[i].name, materialsList[i]);
+		}
+		return;
+	}
+
+	// MaterialとMDLのShader (テンプレート、inputとその表示情報)を格納.
+	// 同じマテリアルにUsdPreviewSurfaceも出力する場合は (outputs:surface)、同じSdfChangeBlock内で格納する.
+	// ベイクしたテクスチャはMDLと共有する.
+	{
+		SdfChangeBlock changeBlock;
+		for (size_t i = 0; i < materialsList.size(); ++i) {
+			if (!::m_definePrimSpec(layer, SdfPath(materialsList[i].name), "Material")) continue;
+			m_appendNodeMaterial_OmniverseMDL(materialsList[i].name, materialsList[i]);
+			if (m_exportParam.useShaderPreviewSurface()) m_appendNodeMaterial(materialsList[i].name, materialsList[i]);
+		}
+	}
 }
 
 /**
  * 指定のUSDのパスにマテリアル(UsdPreviewSurface)情報を格納.
+ * UsdStageを介さずに、書き込み先のレイヤにSdfのspecとして格納する.
+ * そのため、appendNodeMaterialsでSdfChangeBlock内からまとめて呼ぶことができる.
  * @param[in] pathStr        USD上のパス (/root/xxx/red).
  * @param[in] materialData   マテリアルデータ.
  */
 void CUSDExporter::m_appendNodeMaterial (const std::string& pathStr, const CMaterialData& materialData)
 {
-	UsdPrim primMat = g_stage->GetPrimAtPath(SdfPath(pathStr));
-	if (!primMat.IsValid()) return;
-
-	UsdShadeMaterial mat(primMat);
+	const SdfLayerHandle layer = g_stage->GetEditTarget().GetLayer();
+	if (!layer) return;
+	SdfPrimSpecHandle matSpec = layer->GetPrimAtPath(SdfPath(pathStr));
+	if (!matSpec) return;
 
 	// PBR Shaderの作成.
-	UsdPrim primShader = g_stage->DefinePrim(SdfPath(pathStr + std::string("/PBRShader")), TfToken("Shader"));
-	UsdShadeShader shader(primShader);
+	SdfPrimSpecHandle shaderSpec = ::m_definePrimSpec(layer, SdfPath(pathStr + std::string("/PBRShader")), "Shader");
+	if (!shaderSpec) return;
 
-	shader.CreateIdAttr().Set(TfToken("UsdPreviewSurface"));
+	::m_createAttributeSpec(shaderSpec, "info:id", SdfValueTypeNames->Token, VtValue(TfToken("UsdPreviewSurface")), SdfVariabilityUniform);
 
 	if (materialData.diffuseTexture.textureParam.imageIndex < 0) {
 		// 色をリニアにする.
@@ -514,34 +781,34 @@ void CUSDExporter::m_appendNodeMaterial (const std::string& pathStr, const CMate
 		vB = materialData.diffuseColor[2];
 		USD_DATA::convColorLinear(vR, vG, vB);
 
-		shader.CreateInput(TfToken("diffuseColor"), SdfValueTypeNames->Color3f).Set(GfVec3f(vR, vG, vB));
+		::m_createAttributeSpec(shaderSpec, "inputs:diffuseColor", SdfValueTypeNames->Color3f, VtValue(GfVec3f(vR, vG, vB)));
 	}
 
 	if (materialData.roughnessTexture.textureParam.imageIndex < 0) {
-		shader.CreateInput(TfToken("roughness"), SdfValueTypeNames->Float).Set(materialData.roughness);
+		::m_createAttributeSpec(shaderSpec, "inputs:roughness", SdfValueTypeNames->Float, VtValue(materialData.roughness));
 	}
 
 	if (materialData.metallicTexture.textureParam.imageIndex < 0) {
-		shader.CreateInput(TfToken("metallic"), SdfValueTypeNames->Float).Set(materialData.metallic);
+		::m_createAttributeSpec(shaderSpec, "inputs:metallic", SdfValueTypeNames->Float, VtValue(materialData.metallic));
 	}
 
 	if (materialData.opacityTexture.textureParam.imageIndex < 0) {
-		shader.CreateInput(TfToken("opacity"), SdfValueTypeNames->Float).Set(materialData.opacity);
+		::m_createAttributeSpec(shaderSpec, "inputs:opacity", SdfValueTypeNames->Float, VtValue(materialData.opacity));
 	}
 
 	if (materialData.alphaModeParam.alphaModeType == CommonParam::alpha_mode_mask) {
 		// AlphaModeでのMask指定.
-		shader.CreateInput(TfToken("opacityThreshold"), SdfValueTypeNames->Float).Set(materialData.alphaModeParam.alphaCutoff);
+		::m_createAttributeSpec(shaderSpec, "inputs:opacityThreshold", SdfValueTypeNames->Float, VtValue(materialData.alphaModeParam.alphaCutoff));
 
 	} else if (materialData.alphaModeParam.alphaModeType == CommonParam::alpha_mode_opaque) {
 		// 不透明マスクもしくはBaseColorにAlpha要素を持つ場合.
 		if (materialData.useDiffuseAlpha) {
-			shader.CreateInput(TfToken("opacityThreshold"), SdfValueTypeNames->Float).Set(0.5f);
+			::m_createAttributeSpec(shaderSpec, "inputs:opacityThreshold", SdfValueTypeNames->Float, VtValue(0.5f));
 		}
 	}
 
 	// 透過ピクセルがある場合、iorが影響するためior=1.0も出力する必要がある.
-	shader.CreateInput(TfToken("ior"), SdfValueTypeNames->Float).Set(materialData.ior);
+	::m_createAttributeSpec(shaderSpec, "inputs:ior", SdfValueTypeNames->Float, VtValue(materialData.ior));
 
 	if (materialData.emissiveTexture.textureParam.imageIndex < 0) {
 		if (!MathUtil::isZero(materialData.emissiveColor[0]) || !MathUtil::isZero(materialData.emissiveColor[1]) || !MathUtil::isZero(materialData.emissiveColor[2])) {
@@ -552,7 +819,7 @@ void CUSDExporter::m_appendNodeMaterial (const std::string& pathStr, const CMate
 			vB = materialData.emissiveColor[2];
 			USD_DATA::convColorLinear(vR, vG, vB);
 
-			shader.CreateInput(TfToken("emissiveColor"), SdfValueTypeNames->Color3f).Set(GfVec3f(vR, vG, vB));
+			::m_createAttributeSpec(shaderSpec, "inputs:emissiveColor", SdfValueTypeNames->Color3f, VtValue(GfVec3f(vR, vG, vB)));
 		}
 	}
 
@@ -592,11 +859,12 @@ void CUSDExporter::m_appendNodeMaterial (const std::string& pathStr, const CMate
 	}
 
 	// MaterialからShaderをつなぐ.
-	mat.CreateSurfaceOutput().ConnectToSource(shader, TfToken("surface"));
+	::m_connectToOutputSpec(::m_createAttributeSpec(matSpec, "outputs:surface", SdfValueTypeNames->Token), shaderSpec, "surface");
 }
 
 /**
  * テクスチャ情報を出力.
+ * m_appendNodeMaterialと同じく、書き込み先のレイヤにSdfのspecとして格納する.
  * @param[in] pathStr        USD上のパス (/root/xxx/red).
  * @param[in] materialData  マテリアル情報クラス.
  * @param[in] patternType   テクスチャの種類.
@@ -604,13 +872,13 @@ void CUSDExporter::m_appendNodeMaterial (const std::string& pathStr, const CMate
  */
 void CUSDExporter::m_outputTextureData (const std::string& pathStr, const CMaterialData& materialData, const USD_DATA::TEXTURE_PATTERN_TYPE& patternType, const USD_DATA::TEXTURE_SOURE& textureSource)
 {
-	UsdPrim primMat = g_stage->GetPrimAtPath(SdfPath(pathStr));
-	if (!primMat.IsValid()) return;
-	UsdShadeMaterial mat(primMat);
+	const SdfLayerHandle layer = g_stage->GetEditTarget().GetLayer();
+	if (!layer) return;
+	SdfPrimSpecHandle matSpec = layer->GetPrimAtPath(SdfPath(pathStr));
+	if (!matSpec) return;
 
-	UsdPrim primShader = g_stage->GetPrimAtPath(SdfPath(pathStr + std::string("/PBRShader")));
-	if (!primShader.IsValid()) return;
-	UsdShadeShader shader(primShader);
+	SdfPrimSpecHandle shaderSpec = layer->GetPrimAtPath(SdfPath(pathStr + std::string("/PBRShader")));
+	if (!shaderSpec) return;
 
 	// マッピングの種類ごとの情報を取得.
 	CTextureMappingData mappingD;
@@ -680,100 +948,145 @@ void CUSDExporter::m_outputTextureData (const std::string& pathStr, const CMater
 	const bool convGrayscale = m_imagesList[mappingD.textureParam.imageIndex].texTransform.convGrayscale;
 	if (convGrayscale) mappingSource = "r";
 
+	const std::string inputName = std::string("inputs:") + connectSource;
+
+	// Occlusion/Roughness/MetallicをR/G/Bにまとめたテクスチャの場合は、1つのUsdUVTextureを共有する.
+	if (patternType == USD_DATA::TEXTURE_PATTERN_TYPE::texture_pattern_type_occlusion ||
+		patternType == USD_DATA::TEXTURE_PATTERN_TYPE::texture_pattern_type_roughness ||
+		patternType == USD_DATA::TEXTURE_PATTERN_TYPE::texture_pattern_type_metallic) {
+		if (materialData.usePackedORMTexture()) {
+			texName = "/ormTexture";
+
+			// すでにUsdUVTextureが作成済みの場合は、R/G/Bの出力を接続するのみ.
+			SdfPrimSpecHandle ormTextureSpec = layer->GetPrimAtPath(SdfPath(pathStr + texName));
+			if (ormTextureSpec) {
+				::m_connectToOutputSpec(::m_createAttributeSpec(shaderSpec, inputName, SdfValueTypeNames->Float), ormTextureSpec, mappingSource);
+				return;
+			}
+		}
+	}
+
 	// UVレイヤ番号 (0 or 1).
 	const int uvIndex = mappingD.textureParam.uvLayerIndex;
 
 	// UVのReader.
 	const std::string stReaderPath = pathStr + std::string((uvIndex == 0) ? "/stReader" : "/stReader2");
-	UsdPrim primReader = g_stage->GetPrimAtPath(SdfPath(stReaderPath));
-	UsdShadeShader shaderReader;
-	if (!primReader.IsValid()) {
-		primReader = g_stage->DefinePrim(SdfPath(stReaderPath), TfToken("Shader"));
-		shaderReader = UsdShadeShader(primReader);
-		shaderReader.CreateIdAttr().Set(TfToken("UsdPrimvarReader_float2"));
-	} else {
-		shaderReader = UsdShadeShader(primReader);
+	SdfPrimSpecHandle readerSpec = layer->GetPrimAtPath(SdfPath(stReaderPath));
+	if (!readerSpec) {
+		readerSpec = ::m_definePrimSpec(layer, SdfPath(stReaderPath), "Shader");
+		if (!readerSpec) return;
+		::m_createAttributeSpec(readerSpec, "info:id", SdfValueTypeNames->Token, VtValue(TfToken("UsdPrimvarReader_float2")), SdfVariabilityUniform);
 	}
 
 	// UsdTransform2d.
 	// テクスチャの反復指定をUsdTransform2dのscaleで表現.
-	bool useTransform2D = false;
-	UsdPrim transform2DShader;
+	SdfPrimSpecHandle transform2DSpec;
 	if (mappingD.textureParam.repeatU > 1 || mappingD.textureParam.repeatV > 1) {
-		useTransform2D = true;
 		const std::string transform2DName = pathStr + std::string(texName) + std::string("_Transform2d");
-		transform2DShader = g_stage->DefinePrim(SdfPath(transform2DName), TfToken("Shader"));
-		UsdShadeShader tShader = UsdShadeShader(transform2DShader);
-		tShader.CreateIdAttr().Set(TfToken("UsdTransform2d"));
+		transform2DSpec = ::m_definePrimSpec(layer, SdfPath(transform2DName), "Shader");
+		if (!transform2DSpec) return;
+		::m_createAttributeSpec(transform2DSpec, "info:id", SdfValueTypeNames->Token, VtValue(TfToken("UsdTransform2d")), SdfVariabilityUniform);
 
 		// float2 inputs:inは、Readerに接続.
-		tShader.CreateInput(TfToken("in"), SdfValueTypeNames->Token).ConnectToSource(shaderReader, TfToken("result"));
+		::m_connectToOutputSpec(::m_createAttributeSpec(transform2DSpec, "inputs:in", SdfValueTypeNames->Token), readerSpec, "result");
 
 		// 回転/移動スケール/を指定.
-		tShader.CreateInput(TfToken("rotation"), SdfValueTypeNames->Float).Set(0.0f);
-		tShader.CreateInput(TfToken("translation"), SdfValueTypeNames->Float2).Set(GfVec2f(0.0f, 0.0f));
+		::m_createAttributeSpec(transform2DSpec, "inputs:rotation", SdfValueTypeNames->Float, VtValue(0.0f));
+		::m_createAttributeSpec(transform2DSpec, "inputs:translation", SdfValueTypeNames->Float2, VtValue(GfVec2f(0.0f, 0.0f)));
 		const float scaleU = (float)mappingD.textureParam.repeatU;
 		const float scaleV = (float)mappingD.textureParam.repeatV;
-		tShader.CreateInput(TfToken("scale"), SdfValueTypeNames->Float2).Set(GfVec2f(scaleU, scaleV));
+		::m_createAttributeSpec(transform2DSpec, "inputs:scale", SdfValueTypeNames->Float2, VtValue(GfVec2f(scaleU, scaleV)));
 	}
 
-	UsdPrim texShader = g_stage->DefinePrim(SdfPath(pathStr + std::string(texName)), TfToken("Shader"));
-	UsdShadeShader shaderTexture(texShader);
+	SdfPrimSpecHandle textureSpec = ::m_definePrimSpec(layer, SdfPath(pathStr + std::string(texName)), "Shader");
+	if (!textureSpec) return;
 
-	shaderTexture.CreateIdAttr().Set(TfToken("UsdUVTexture"));
+	::m_createAttributeSpec(textureSpec, "info:id", SdfValueTypeNames->Token, VtValue(TfToken("UsdUVTexture")), SdfVariabilityUniform);
 
 	// ファイル名を指定.
 	const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-	shaderTexture.CreateInput(TfToken("file"), SdfValueTypeNames->Asset).Set(SdfAssetPath(fileName));
+	::m_createAttributeSpec(textureSpec, "inputs:file", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
 	// UV0の場合は"st"、UV1の場合は"st2"とつなぐ.
-	if (useTransform2D) {
-		// UsdTransform2dに接続.
-		shaderTexture.CreateInput(TfToken((uvIndex == 0) ? "st" : "st2"), SdfValueTypeNames->Float2).ConnectToSource(UsdShadeShader(transform2DShader), TfToken("result"));
-	} else {
-		// UVのためのReaderと接続.
-		shaderTexture.CreateInput(TfToken((uvIndex == 0) ? "st" : "st2"), SdfValueTypeNames->Float2).ConnectToSource(shaderReader, TfToken("result"));
-	}
+	// UsdTransform2dがある場合はそれに接続し、ない場合はUVのためのReaderと接続.
+	SdfAttributeSpecHandle stSpec = ::m_createAttributeSpec(textureSpec, (uvIndex == 0) ? "inputs:st" : "inputs:st2", SdfValueTypeNames->Float2);
+	::m_connectToOutputSpec(stSpec, transform2DSpec ? transform2DSpec : readerSpec, "result");
 
 	// wrap指定 (repeatで繰り返し指定).
 	const std::string wrapS = mappingD.textureParam.wrapRepeat ? "repeat" : "clamp";
-	shaderTexture.CreateInput(TfToken("wrapS"), SdfValueTypeNames->Token).Set(TfToken(wrapS));
-	shaderTexture.CreateInput(TfToken("wrapT"), SdfValueTypeNames->Token).Set(TfToken(wrapS));
+	::m_createAttributeSpec(textureSpec, "inputs:wrapS", SdfValueTypeNames->Token, VtValue(TfToken(wrapS)));
+	::m_createAttributeSpec(textureSpec, "inputs:wrapT", SdfValueTypeNames->Token, VtValue(TfToken(wrapS)));
 
 	// scaleは、テクスチャに対してRGBなどのFactorを乗算したい場合に使用する.
 	// input.bias / input.scaleは効かない ? (USD 19.07とiOS12.4.1).
 	// iOS13ではinput.scaleが効く.
 #if false
-	shaderTexture.CreateInput(TfToken("bias"), SdfValueTypeNames->Float4).Set(GfVec4f(0.0f, 0.0f, 0.0f, 0.0f));
-	shaderTexture.CreateInput(TfToken("scale"), SdfValueTypeNames->Float4).Set(GfVec4f(1.0f, 1.0f, 1.0f, 1.0f));
+	::m_createAttributeSpec(textureSpec, "inputs:bias", SdfValueTypeNames->Float4, VtValue(GfVec4f(0.0f, 0.0f, 0.0f, 0.0f)));
+	::m_createAttributeSpec(textureSpec, "inputs:scale", SdfValueTypeNames->Float4, VtValue(GfVec4f(1.0f, 1.0f, 1.0f, 1.0f)));
 #endif
 
 	// Textureをshaderの対象要素にマッピング.
+	SdfValueTypeName inputType = SdfValueTypeNames->Float;
 	if (mappingSource == "rgb") {
-		if (patternType == USD_DATA::TEXTURE_PATTERN_TYPE::texture_pattern_type_normal) {
-			shader.CreateInput(TfToken(connectSource), SdfValueTypeNames->Normal3f).ConnectToSource(shaderTexture, TfToken(mappingSource));
-		} else {
-			shader.CreateInput(TfToken(connectSource), SdfValueTypeNames->Color3f).ConnectToSource(shaderTexture, TfToken(mappingSource));
-		}
-	} else {
-		shader.CreateInput(TfToken(connectSource), SdfValueTypeNames->Float).ConnectToSource(shaderTexture, TfToken(mappingSource));
+		inputType = (patternType == USD_DATA::TEXTURE_PATTERN_TYPE::texture_pattern_type_normal) ? SdfValueTypeNames->Normal3f : SdfValueTypeNames->Color3f;
 	}
+	::m_connectToOutputSpec(::m_createAttributeSpec(shaderSpec, inputName, inputType), textureSpec, mappingSource);
 
 #if false
 	// ColorSpaceを指定.
 	if (patternType == USD_DATA::TEXTURE_PATTERN_TYPE::texture_pattern_type_difuseColor || patternType == USD_DATA::TEXTURE_PATTERN_TYPE::texture_pattern_type_emissiveColor) {
-		shaderTexture.CreateInput(TfToken("sourceColorSpace"), SdfValueTypeNames->Token).Set(TfToken("sRGB"));
+		::m_createAttributeSpec(textureSpec, "inputs:sourceColorSpace", SdfValueTypeNames->Token, VtValue(TfToken("sRGB")));
 	} else {
-		shaderTexture.CreateInput(TfToken("sourceColorSpace"), SdfValueTypeNames->Token).Set(TfToken("raw"));
+		::m_createAttributeSpec(textureSpec, "inputs:sourceColorSpace", SdfValueTypeNames->Token, VtValue(TfToken("raw")));
 	}
 #endif
 	
 	// UVの接続.
-	UsdShadeInput stInput = mat.CreateInput(TfToken((uvIndex == 0) ? "frame:stPrimvarName" : "frame:stPrimvarName2"), SdfValueTypeNames->Token);
-	stInput.Set(TfToken((uvIndex == 0) ? "st" : "st2"));
+	SdfAttributeSpecHandle stInputSpec = ::m_createAttributeSpec(matSpec, (uvIndex == 0) ? "inputs:frame:stPrimvarName" : "inputs:frame:stPrimvarName2", SdfValueTypeNames->Token, VtValue(TfToken((uvIndex == 0) ? "st" : "st2")));
 
 	// Textureに割り当てるUVを接続.
-	shaderReader.CreateInput(TfToken("varname"), SdfValueTypeNames->Token).ConnectToSource(stInput);
+	::m_connectAttributeSpec(::m_createAttributeSpec(readerSpec, "inputs:varname", SdfValueTypeNames->Token), stInputSpec);
+}
+
+/**
+ * MDLで参照するテクスチャファイル名を取得.
+ * KTX2出力の場合は、拡張子をktx2に置き換えたものを返す.
+ * @param[in] imageIndex  m_imagesListのインデックス.
+ */
+std::string CUSDExporter::m_getMDLTextureFileName (const int imageIndex)
+{
+	const std::string fileName = m_imagesList[imageIndex].fileName;
+	if (m_exportParam.optTextureType == USD_DATA::EXPORT::TEXTURE_TYPE::texture_type_replace_ktx2) {
+		return StringUtil::SetFileImageExtension(fileName, "ktx2", true);
+	}
+	return fileName;
+}
+
+/**
+ * MDLのShaderのテンプレート(class prim)を取得.
+ * MDLのソースアセットの指定はテンプレートにのみ格納し、各マテリアルのShaderはこれをspecializesで参照する.
+ * テンプレートは書き込み先のレイヤにSdfのspecとして格納するため、SdfChangeBlock内から呼ぶことができる.
+ * @param[in] mdlName  MDL名 ("OmniPBR"、"OmniGlass").
+ * @return テンプレートのパス.
+ */
+std::string CUSDExporter::m_getShaderTemplateMDL (const std::string& mdlName)
+{
+	const std::string templatePath = std::string(SHADER_TEMPLATES_ROOT_PATH) + std::string("/") + mdlName;
+	if (g_shaderTemplateInputs.find(templatePath) != g_shaderTemplateInputs.end()) return templatePath;
+	g_shaderTemplateInputs.insert(templatePath);
+
+	const SdfLayerHandle layer = g_stage->GetEditTarget().GetLayer();
+	if (!layer) return templatePath;
+	::m_definePrimSpec(layer, SdfPath(SHADER_TEMPLATES_ROOT_PATH), "", SdfSpecifierClass);
+	SdfPrimSpecHandle templateSpec = ::m_definePrimSpec(layer, SdfPath(templatePath), "Shader", SdfSpecifierClass);
+	if (!templateSpec) return templatePath;
+
+	// UsdShadeShader::SetSourceAssetと同じ属性を格納.
+	::m_createAttributeSpec(templateSpec, "info:implementationSource", SdfValueTypeNames->Token, VtValue(TfToken("sourceAsset")), SdfVariabilityUniform);
+	::m_createAttributeSpec(templateSpec, "info:mdl:sourceAsset", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(mdlName + std::string(".mdl"))), SdfVariabilityUniform);
+	::m_createAttributeSpec(templateSpec, "info:mdl:sourceAsset:subIdentifier", SdfValueTypeNames->Token, VtValue(TfToken(mdlName)), SdfVariabilityUniform);
+
+	return templatePath;
 }
 
 /**
@@ -789,18 +1102,19 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 		return;
 	}
 
-	UsdPrim primMat = g_stage->GetPrimAtPath(SdfPath(pathStr));
-	if (!primMat.IsValid()) return;
-
-	UsdShadeMaterial mat(primMat);
-	const TfToken mdlToken("mdl");
+	const SdfLayerHandle layer = g_stage->GetEditTarget().GetLayer();
+	if (!layer) return;
+	SdfPrimSpecHandle matSpec = layer->GetPrimAtPath(SdfPath(pathStr));
+	if (!matSpec) return;
 
 	// OmniPBRの作成.
-	UsdPrim primShader = g_stage->DefinePrim(SdfPath(pathStr + std::string("/Shader")), TfToken("Shader"));
-	UsdShadeShader shader(primShader);
+	// MDLのソースアセットやinputの表示情報はテンプレートに格納し、specializesで参照する.
+	// UsdStageを介さずに、書き込み先のレイヤにSdfのspecとして格納する.
+	SdfPrimSpecHandle shaderSpec = ::m_definePrimSpec(layer, SdfPath(pathStr + std::string("/Shader")), "Shader");
+	if (!shaderSpec) return;
 
-	shader.SetSourceAsset(SdfAssetPath("OmniPBR.mdl"), mdlToken);
-	shader.GetPrim().CreateAttribute(TfToken("info:mdl:sourceAsset:subIdentifier"), SdfValueTypeNames->Token, false, SdfVariabilityUniform).Set(TfToken("OmniPBR")); 
+	const std::string templatePath = m_getShaderTemplateMDL("OmniPBR");
+	shaderSpec->GetSpecializesList().Prepend(SdfPath(templatePath));
 
 	//-----------------------------------------------.
 	// BaseColorの指定.
@@ -813,39 +1127,19 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 		vB = materialData.diffuseColor[2];
 		USD_DATA::convColorLinear(vR, vG, vB);
 
-		UsdShadeInput in = shader.CreateInput(TfToken("diffuse_color_constant"), SdfValueTypeNames->Color3f);
-		in.Set(GfVec3f(vR, vG, vB));
-		UsdAttribute attr = in.GetAttr();
-		attr.SetDisplayGroup(std::string("Albedo"));
-		attr.SetDisplayName(std::string("Base Color"));
-
-		// デフォルトの値を指定.
-		attr.SetCustomDataByKey(TfToken("default"), VtValue(GfVec3f(0.2f, 0.2f, 0.2f)));
-#if USE_DICTIONARY_RANGE
-		{
-			VtDictionary dic;
-			dic.SetValueAtPath("max", VtValue(GfVec3f(100000, 100000, 100000)));
-			dic.SetValueAtPath("min", VtValue(GfVec3f(0, 0, 0)));
-			attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-		}
-#endif
+		SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:diffuse_color_constant", SdfValueTypeNames->Color3f, VtValue(GfVec3f(vR, vG, vB)));
+		::m_setShaderInputMetadata(in, templatePath, "Albedo", "Base Color", VtValue(GfVec3f(0.2f, 0.2f, 0.2f)), VtValue(GfVec3f(0, 0, 0)), VtValue(GfVec3f(100000, 100000, 100000)));
 
 	} else {
 		// BaseColorテクスチャを指定.
 		const CTextureMappingData& mappingD = materialData.diffuseTexture;
 
 		{
-			const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-			UsdShadeInput in = shader.CreateInput(TfToken("diffuse_texture"), SdfValueTypeNames->Asset);
-			in.Set(SdfAssetPath(fileName));
-
-			UsdAttribute attr = in.GetAttr();
-			attr.SetColorSpace(TfToken("sRGB"));
-			attr.SetDisplayGroup(std::string("Albedo"));
-			attr.SetDisplayName(std::string("Albedo Map"));
+			const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:diffuse_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+			in->SetColorSpace(TfToken("sRGB"));
+			::m_setShaderInputMetadata(in, templatePath, "Albedo", "Albedo Map", VtValue(SdfAssetPath("")));
 		}
 
 		// Diffuseテクスチャに乗算する色を指定.
@@ -862,22 +1156,8 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 				vR = vG = vB = 1.0f;
 			}
 
-			UsdShadeInput in = shader.CreateInput(TfToken("diffuse_tint"), SdfValueTypeNames->Color3f);
-			in.Set(GfVec3f(vR, vG, vB));
-			UsdAttribute attr = in.GetAttr();
-			attr.SetDisplayGroup(std::string("Albedo"));
-			attr.SetDisplayName(std::string("Color Tint"));
-
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(GfVec3f(1, 1, 1)));
-#if USE_DICTIONARY_RANGE
-			{
-				VtDictionary dic;
-				dic.SetValueAtPath("max", VtValue(GfVec3f(100000, 100000, 100000)));
-				dic.SetValueAtPath("min", VtValue(GfVec3f(0, 0, 0)));
-				attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-			}
-#endif
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:diffuse_tint", SdfValueTypeNames->Color3f, VtValue(GfVec3f(vR, vG, vB)));
+			::m_setShaderInputMetadata(in, templatePath, "Albedo", "Color Tint", VtValue(GfVec3f(1, 1, 1)), VtValue(GfVec3f(0, 0, 0)), VtValue(GfVec3f(100000, 100000, 100000)));
 		}
 	}
 
@@ -888,40 +1168,23 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 		const CTextureMappingData& mappingD = materialData.normalTexture;
 
 		{
-			const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-			UsdShadeInput in = shader.CreateInput(TfToken("normalmap_texture"), SdfValueTypeNames->Asset);
-			in.Set(SdfAssetPath(fileName));
+			const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:normalmap_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-			UsdAttribute attr = in.GetAttr();
-			attr.SetColorSpace(TfToken("raw"));
-			attr.SetDisplayGroup(std::string("Normal"));
-			attr.SetDisplayName(std::string("Normal Map"));
-
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+			in->SetColorSpace(TfToken("raw"));
+			::m_setShaderInputMetadata(in, templatePath, "Normal", "Normal Map", VtValue(SdfAssetPath("")));
 		}
 
 		// Normal Mapの強さを指定.
 		{
-			UsdShadeInput in = shader.CreateInput(TfToken("bump_factor"), SdfValueTypeNames->Float);
-			in.Set(materialData.normalStrength);
-			UsdAttribute attr = in.GetAttr();
-			attr.SetDisplayGroup(std::string("Normal"));
-			attr.SetDisplayName(std::string("Normal Map Strength"));
-
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(1.0f));
-#if USE_DICTIONARY_RANGE
-			{
-				VtDictionary dic;
-				dic.SetValueAtPath("max", VtValue(100000.0f));
-				dic.SetValueAtPath("min", VtValue(-100000.0f));
-				attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-			}
-#endif
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:bump_factor", SdfValueTypeNames->Float, VtValue(materialData.normalStrength));
+			::m_setShaderInputMetadata(in, templatePath, "Normal", "Normal Map Strength", VtValue(1.0f), VtValue(-100000.0f), VtValue(100000.0f));
 		}
 	}
 
+	// Occlusion/Roughness/MetallicをR/G/Bにまとめたテクスチャ(ORM)を使用するか.
+	const bool useORMTexture = materialData.usePackedORMTexture();
+
 	//-----------------------------------------------.
 	// Metallicの指定.
 	//-----------------------------------------------.
@@ -929,58 +1192,24 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 		const CTextureMappingData& mappingD = materialData.metallicTexture;
 
 		if (mappingD.textureParam.imageIndex < 0) {
-			UsdShadeInput in = shader.CreateInput(TfToken("metallic_constant"), SdfValueTypeNames->Float);
-			in.Set(materialData.metallic);
-			UsdAttribute attr = in.GetAttr();
-			attr.SetDisplayGroup(std::string("Reflectivity"));
-			attr.SetDisplayName(std::string("Metallic Amount"));
-
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(0.0f));
-#if USE_DICTIONARY_RANGE
-			{
-				VtDictionary dic;
-				dic.SetValueAtPath("max", VtValue(1.0f));
-				dic.SetValueAtPath("min", VtValue(0.0f));
-				attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-			}
-#endif
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:metallic_constant", SdfValueTypeNames->Float, VtValue(materialData.metallic));
+			::m_setShaderInputMetadata(in, templatePath, "Reflectivity", "Metallic Amount", VtValue(0.0f), VtValue(0.0f), VtValue(1.0f));
 		} else {
-			{
-				const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-				UsdShadeInput in = shader.CreateInput(TfToken("metallic_texture"), SdfValueTypeNames->Asset);
-				in.Set(SdfAssetPath(fileName));
+			if (!useORMTexture) {
+				const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:metallic_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-				UsdAttribute attr = in.GetAttr();
 				if (m_exportParam.grayscaleTexturesColorSpace == USD_DATA::EXPORT::TEXTURE_COLOR_SPACE::texture_colorspace_raw) {
-					attr.SetColorSpace(TfToken("raw"));
+					in->SetColorSpace(TfToken("raw"));
 				} else {
-					attr.SetColorSpace(TfToken("sRGB"));
+					in->SetColorSpace(TfToken("sRGB"));
 				}
 
-				attr.SetDisplayGroup(std::string("Reflectivity"));
-				attr.SetDisplayName(std::string("Metallic Map"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+				::m_setShaderInputMetadata(in, templatePath, "Reflectivity", "Metallic Map", VtValue(SdfAssetPath("")));
 			}
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("metallic_texture_influence"), SdfValueTypeNames->Float);
-				in.Set(materialData.metallic);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Reflectivity"));
-				attr.SetDisplayName(std::string("Metallic Map Influence"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(0.0f));
-#if USE_DICTIONARY_RANGE
-				{
-					VtDictionary dic;
-					dic.SetValueAtPath("max", VtValue(1.0f));
-					dic.SetValueAtPath("min", VtValue(0.0f));
-					attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-				}
-#endif
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:metallic_texture_influence", SdfValueTypeNames->Float, VtValue(materialData.metallic));
+				::m_setShaderInputMetadata(in, templatePath, "Reflectivity", "Metallic Map Influence", VtValue(0.0f), VtValue(0.0f), VtValue(1.0f));
 			}
 		}
 	}
@@ -992,60 +1221,26 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 		const CTextureMappingData& mappingD = materialData.roughnessTexture;
 
 		if (mappingD.textureParam.imageIndex < 0) {
-			UsdShadeInput in = shader.CreateInput(TfToken("reflection_roughness_constant"), SdfValueTypeNames->Float);
-			in.Set(materialData.roughness);
-			UsdAttribute attr = in.GetAttr();
-			attr.SetDisplayGroup(std::string("Reflectivity"));
-			attr.SetDisplayName(std::string("Roughness Amount"));
-
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(0.5f));
-#if USE_DICTIONARY_RANGE
-			{
-				VtDictionary dic;
-				dic.SetValueAtPath("max", VtValue(1.0f));
-				dic.SetValueAtPath("min", VtValue(0.0f));
-				attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-			}
-#endif
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:reflection_roughness_constant", SdfValueTypeNames->Float, VtValue(materialData.roughness));
+			::m_setShaderInputMetadata(in, templatePath, "Reflectivity", "Roughness Amount", VtValue(0.5f), VtValue(0.0f), VtValue(1.0f));
 		} else {
-			{
-				const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-				UsdShadeInput in = shader.CreateInput(TfToken("reflectionroughness_texture"), SdfValueTypeNames->Asset);
-				in.Set(SdfAssetPath(fileName));
+			if (!useORMTexture) {
+				const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:reflectionroughness_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-				UsdAttribute attr = in.GetAttr();
 				if (m_exportParam.grayscaleTexturesColorSpace == USD_DATA::EXPORT::TEXTURE_COLOR_SPACE::texture_colorspace_raw) {
-					attr.SetColorSpace(TfToken("raw"));
+					in->SetColorSpace(TfToken("raw"));
 				} else {
-					attr.SetColorSpace(TfToken("sRGB"));
+					in->SetColorSpace(TfToken("sRGB"));
 				}
 
-				attr.SetDisplayGroup(std::string("Reflectivity"));
-				attr.SetDisplayName(std::string("Roughness Map"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+				::m_setShaderInputMetadata(in, templatePath, "Reflectivity", "Roughness Map", VtValue(SdfAssetPath("")));
 			}
 
 			// reflection_roughness_texture_influenceで1.0を指定すると、Roughness Mapの値をそのまま反映.
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("reflection_roughness_texture_influence"), SdfValueTypeNames->Float);
-				in.Set(1.0f);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Reflectivity"));
-				attr.SetDisplayName(std::string("Roughness Map Influence"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(0.0f));
-#if USE_DICTIONARY_RANGE
-				{
-					VtDictionary dic;
-					dic.SetValueAtPath("max", VtValue(1.0f));
-					dic.SetValueAtPath("min", VtValue(0.0f));
-					attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-				}
-#endif
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:reflection_roughness_texture_influence", SdfValueTypeNames->Float, VtValue(1.0f));
+				::m_setShaderInputMetadata(in, templatePath, "Reflectivity", "Roughness Map Influence", VtValue(0.0f), VtValue(0.0f), VtValue(1.0f));
 			}
 		}
 	}
@@ -1056,45 +1251,46 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 	{
 		const CTextureMappingData& mappingD = materialData.occlusionTexture;
 		if (mappingD.textureParam.imageIndex >= 0) {
-			{
-				const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-				UsdShadeInput in = shader.CreateInput(TfToken("ao_texture"), SdfValueTypeNames->Asset);
-				in.Set(SdfAssetPath(fileName));
+			if (!useORMTexture) {
+				const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:ao_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-				UsdAttribute attr = in.GetAttr();
 				if (m_exportParam.grayscaleTexturesColorSpace == USD_DATA::EXPORT::TEXTURE_COLOR_SPACE::texture_colorspace_raw) {
-					attr.SetColorSpace(TfToken("raw"));
+					in->SetColorSpace(TfToken("raw"));
 				} else {
-					attr.SetColorSpace(TfToken("sRGB"));
+					in->SetColorSpace(TfToken("sRGB"));
 				}
 
-				attr.SetDisplayGroup(std::string("AO"));
-				attr.SetDisplayName(std::string("Ambient Occlusion Map"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+				::m_setShaderInputMetadata(in, templatePath, "AO", "Ambient Occlusion Map", VtValue(SdfAssetPath("")));
 			}
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("ao_to_diffuse"), SdfValueTypeNames->Float);
-				in.Set(1.0f);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("AO"));
-				attr.SetDisplayName(std::string("AO to Diffuse"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(0.0f));
-#if USE_DICTIONARY_RANGE
-				{
-					VtDictionary dic;
-					dic.SetValueAtPath("max", VtValue(100000.0f));
-					dic.SetValueAtPath("min", VtValue(-100000.0f));
-					attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-				}
-#endif
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:ao_to_diffuse", SdfValueTypeNames->Float, VtValue(1.0f));
+				::m_setShaderInputMetadata(in, templatePath, "AO", "AO to Diffuse", VtValue(0.0f), VtValue(-100000.0f), VtValue(100000.0f));
 			}
 		}
 	}
 
+	//-----------------------------------------------.
+	// ORMテクスチャの指定.
+	// R : Occlusion、G : Roughness、B : Metallic.
+	//-----------------------------------------------.
+	if (useORMTexture) {
+		int imageIndex = materialData.occlusionTexture.textureParam.imageIndex;
+		if (imageIndex < 0) imageIndex = materialData.roughnessTexture.textureParam.imageIndex;
+		if (imageIndex < 0) imageIndex = materialData.metallicTexture.textureParam.imageIndex;
+		{
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:enable_ORM_texture", SdfValueTypeNames->Bool, VtValue(true));
+			::m_setShaderInputMetadata(in, templatePath, "Reflectivity", "Enable ORM Texture", VtValue(false));
+		}
+		{
+			const std::string fileName = m_getMDLTextureFileName(imageIndex);
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:ORM_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
+
+			in->SetColorSpace(TfToken("raw"));
+			::m_setShaderInputMetadata(in, templatePath, "Reflectivity", "ORM Map", VtValue(SdfAssetPath("")));
+		}
+	}
+
 	//-----------------------------------------------.
 	// Opacityの指定.
 	//-----------------------------------------------.
@@ -1102,107 +1298,58 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 		const CTextureMappingData& mappingD = materialData.opacityTexture;
 		if (mappingD.textureParam.imageIndex >= 0) {
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("enable_opacity"), SdfValueTypeNames->Bool);
-				in.Set(true);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Enable Opacity"));
-
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(false));
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:enable_opacity", SdfValueTypeNames->Bool, VtValue(true));
+				::m_setShaderInputMetadata(in, templatePath, "Opacity", "Enable Opacity", VtValue(false));
 			}
 
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("enable_opacity_texture"), SdfValueTypeNames->Bool);
-				in.Set(true);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Enable Opacity Texture"));
-
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(false));
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:enable_opacity_texture", SdfValueTypeNames->Bool, VtValue(true));
+				::m_setShaderInputMetadata(in, templatePath, "Opacity", "Enable Opacity Texture", VtValue(false));
 			}
 
 			// Opacityの影響度.
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("opacity_constant"), SdfValueTypeNames->Float);
-				in.Set(1.0f);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Opacity Amount"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(1.0f));
-#if USE_DICTIONARY_RANGE
-				{
-					VtDictionary dic;
-					dic.SetValueAtPath("max", VtValue(1.0f));
-					dic.SetValueAtPath("min", VtValue(0.0f));
-					attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-				}
-#endif
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:opacity_constant", SdfValueTypeNames->Float, VtValue(1.0f));
+				::m_setShaderInputMetadata(in, templatePath, "Opacity", "Opacity Amount", VtValue(1.0f), VtValue(0.0f), VtValue(1.0f));
 			}
 			
 			// Mono Sourceを"mono_alpha"とすると、BaseColorのAlphaをOpacityとすることになる.
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("opacity_mode"), SdfValueTypeNames->Int);
-				in.Set(materialData.useDiffuseAlpha ? 0 : 1);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Opacity Mono Source"));
-
-				attr.SetMetadata(TfToken("renderType"), VtValue("::base::mono_mode"));
-
-				{
-					NdrTokenMap tMap;
-					tMap[TfToken("__SDR__enum_value")].append("mono_average");
-					tMap[TfToken("options")].append("mono_alpha:0|mono_average:1|mono_luminance:2|mono_maximum:3");
-
-					in.SetSdrMetadata(tMap);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:opacity_mode", SdfValueTypeNames->Int, VtValue(materialData.useDiffuseAlpha ? 0 : 1));
+				SdfAttributeSpecHandle attrSpec = ::m_setShaderInputMetadata(in, templatePath, "Opacity", "Opacity Mono Source", VtValue(1));
+				if (attrSpec) {
+					attrSpec->SetInfo(TfToken("renderType"), VtValue(std::string("::base::mono_mode")));
+
+					// UsdShadeInput::SetSdrMetadataと同じく、文字列の辞書として格納.
+					VtDictionary sdrDic;
+					sdrDic["__SDR__enum_value"] = VtValue(std::string("mono_average"));
+					sdrDic["options"] = VtValue(std::string("mono_alpha:0|mono_average:1|mono_luminance:2|mono_maximum:3"));
+					attrSpec->SetInfo(TfToken("sdrMetadata"), VtValue(sdrDic));
 				}
-
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(1));
 			}
 
 			// テクスチャの指定.
 			{
-				const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-				UsdShadeInput in = shader.CreateInput(TfToken("opacity_texture"), SdfValueTypeNames->Asset);
-				in.Set(SdfAssetPath(fileName));
+				const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:opacity_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-				UsdAttribute attr = in.GetAttr();
 				if (m_exportParam.grayscaleTexturesColorSpace == USD_DATA::EXPORT::TEXTURE_COLOR_SPACE::texture_colorspace_raw) {
-					attr.SetColorSpace(TfToken("raw"));
+					in->SetColorSpace(TfToken("raw"));
 				} else {
-					attr.SetColorSpace(TfToken("sRGB"));
+					in->SetColorSpace(TfToken("sRGB"));
 				}
 
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Opacity Map"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+				::m_setShaderInputMetadata(in, templatePath, "Opacity", "Opacity Map", VtValue(SdfAssetPath("")));
 			}
 
 			// Cutout(cutoff)の指定.
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("opacity_threshold"), SdfValueTypeNames->Float);
-				in.Set(0.0f);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:opacity_threshold", SdfValueTypeNames->Float, VtValue(0.0f));
 				if (materialData.alphaModeParam.alphaModeType == CommonParam::alpha_mode_type::alpha_mode_mask) {
-					in.Set(materialData.alphaModeParam.alphaCutoff);
+					in->SetDefaultValue(VtValue(materialData.alphaModeParam.alphaCutoff));
 				}
 
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Opacity Threshold"));
-
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(0.0f));
-#if USE_DICTIONARY_RANGE
-				{
-					VtDictionary dic;
-					dic.SetValueAtPath("max", VtValue(1.0f));
-					dic.SetValueAtPath("min", VtValue(0.0f));
-					attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-				}
-#endif
+				::m_setShaderInputMetadata(in, templatePath, "Opacity", "Opacity Threshold", VtValue(0.0f), VtValue(0.0f), VtValue(1.0f));
 			}
 		}
 	}
@@ -1213,28 +1360,17 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 	const float emissiveMinV = 0.001f;
 	if (!materialData.unlitMode && (materialData.emissiveColor[0] > emissiveMinV || materialData.emissiveColor[1] > emissiveMinV || materialData.emissiveColor[2] > emissiveMinV)) {
 		{
-			UsdShadeInput in = shader.CreateInput(TfToken("enable_emission"), SdfValueTypeNames->Bool);
-			in.Set(true);
-			UsdAttribute attr = in.GetAttr();
-			attr.SetDisplayGroup(std::string("Emissive"));
-			attr.SetDisplayName(std::string("Emissive Emission"));
-
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(false));
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:enable_emission", SdfValueTypeNames->Bool, VtValue(true));
+			::m_setShaderInputMetadata(in, templatePath, "Emissive", "Emissive Emission", VtValue(false));
 		}
 
 		const CTextureMappingData& mappingD = materialData.emissiveTexture;
 		if (mappingD.textureParam.imageIndex >= 0) {
-			const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-			UsdShadeInput in = shader.CreateInput(TfToken("emissive_color_texture"), SdfValueTypeNames->Asset);
-			in.Set(SdfAssetPath(fileName));
-
-			UsdAttribute attr = in.GetAttr();
-			attr.SetColorSpace(TfToken("auto"));
-			attr.SetDisplayGroup(std::string("Emissive"));
-			attr.SetDisplayName(std::string("Emissive Color map"));
+			const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:emissive_color_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+			in->SetColorSpace(TfToken("auto"));
+			::m_setShaderInputMetadata(in, templatePath, "Emissive", "Emissive Color map", VtValue(SdfAssetPath("")));
 
 		}
 		{
@@ -1245,41 +1381,13 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 			vB = materialData.emissiveColor[2];
 			USD_DATA::convColorLinear(vR, vG, vB);
 
-			UsdShadeInput in = shader.CreateInput(TfToken("emissive_color"), SdfValueTypeNames->Color3f);
-			in.Set(GfVec3f(vR, vG, vB));
-			UsdAttribute attr = in.GetAttr();
-			attr.SetDisplayGroup(std::string("Emissive"));
-			attr.SetDisplayName(std::string("Emissive Color"));
-
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(GfVec3f(1.0f, 0.1f, 0.1f)));
-#if USE_DICTIONARY_RANGE
-			{
-				VtDictionary dic;
-				dic.SetValueAtPath("max", VtValue(GfVec3f(100000, 100000, 100000)));
-				dic.SetValueAtPath("min", VtValue(GfVec3f(0, 0, 0)));
-				attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-			}
-#endif
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:emissive_color", SdfValueTypeNames->Color3f, VtValue(GfVec3f(vR, vG, vB)));
+			::m_setShaderInputMetadata(in, templatePath, "Emissive", "Emissive Color", VtValue(GfVec3f(1.0f, 0.1f, 0.1f)), VtValue(GfVec3f(0, 0, 0)), VtValue(GfVec3f(100000, 100000, 100000)));
 		}
 
 		{
-			UsdShadeInput in = shader.CreateInput(TfToken("emissive_intensity"), SdfValueTypeNames->Float);
-			in.Set(materialData.emissiveIntensity * 5000.0f);
-			UsdAttribute attr = in.GetAttr();
-			attr.SetDisplayGroup(std::string("Emissive"));
-			attr.SetDisplayName(std::string("Emissive Intensity"));
-
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(40.0f));
-#if USE_DICTIONARY_RANGE
-			{
-				VtDictionary dic;
-				dic.SetValueAtPath("max", VtValue(100000.0f));
-				dic.SetValueAtPath("min", VtValue(-100000.0f));
-				attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-			}
-#endif
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:emissive_intensity", SdfValueTypeNames->Float, VtValue(materialData.emissiveIntensity * 5000.0f));
+			::m_setShaderInputMetadata(in, templatePath, "Emissive", "Emissive Intensity", VtValue(40.0f), VtValue(-100000.0f), VtValue(100000.0f));
 		}
 	}
 
@@ -1288,17 +1396,11 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 		const CTextureMappingData& mappingD = materialData.emissiveTexture;
 		if (mappingD.textureParam.imageIndex >= 0) {
 			{
-				const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-				UsdShadeInput in = shader.CreateInput(TfToken("diffuse_texture"), SdfValueTypeNames->Asset);
-				in.Set(SdfAssetPath(fileName));
+				const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:diffuse_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-				UsdAttribute attr = in.GetAttr();
-				attr.SetColorSpace(TfToken("sRGB"));
-				attr.SetDisplayGroup(std::string("Albedo"));
-				attr.SetDisplayName(std::string("Albedo Map"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+				in->SetColorSpace(TfToken("sRGB"));
+				::m_setShaderInputMetadata(in, templatePath, "Albedo", "Albedo Map", VtValue(SdfAssetPath("")));
 			}
 		}
 	}
@@ -1403,30 +1505,16 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
 			}
 
 			if (texRepeatX != 1 || texRepeatY != 1) {
-				UsdShadeInput in = shader.CreateInput(TfToken("texture_scale"), SdfValueTypeNames->Float2);
-				in.Set(GfVec2f(texRepeatX, texRepeatY));
-
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("UV"));
-				attr.SetDisplayName(std::string("Texture Scale"));
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:texture_scale", SdfValueTypeNames->Float2, VtValue(GfVec2f(texRepeatX, texRepeatY)));
 
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(GfVec2f(1, 1)));
-#if USE_DICTIONARY_RANGE
-				{
-					VtDictionary dic;
-					dic.SetValueAtPath("max", VtValue(GfVec2f(100000, 100000)));
-					dic.SetValueAtPath("min", VtValue(GfVec2f(-100000, -100000)));
-					attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-				}
-#endif
+				::m_setShaderInputMetadata(in, templatePath, "UV", "Texture Scale", VtValue(GfVec2f(1, 1)), VtValue(GfVec2f(-100000, -100000)), VtValue(GfVec2f(100000, 100000)));
 			}
 		}
 	}
 
 	// MaterialからShaderをつなぐ.
-	UsdShadeOutput mdlOutput = mat.CreateSurfaceOutput(mdlToken);
-	mdlOutput.ConnectToSource(shader, TfToken("out"));
+	SdfAttributeSpecHandle mdlOutput = ::m_createAttributeSpec(matSpec, "outputs:mdl:surface", SdfValueTypeNames->Token);
+	::m_connectToOutputSpec(mdlOutput, shaderSpec, "out");
 }
 
 /**
@@ -1436,39 +1524,26 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL (const std::string& pathStr
  */
 void CUSDExporter::m_appendNodeMaterial_OmniverseMDL_Glass (const std::string& pathStr, const CMaterialData& materialData)
 {
-	UsdPrim primMat = g_stage->GetPrimAtPath(SdfPath(pathStr));
-	if (!primMat.IsValid()) return;
+	const SdfLayerHandle layer = g_stage->GetEditTarget().GetLayer();
+	if (!layer) return;
+	SdfPrimSpecHandle matSpec = layer->GetPrimAtPath(SdfPath(pathStr));
+	if (!matSpec) return;
 
-	UsdShadeMaterial mat(primMat);
-	const TfToken mdlToken("mdl");
+	// OmniGlassの作成.
+	// MDLのソースアセットやinputの表示情報はテンプレートに格納し、specializesで参照する.
+	// UsdStageを介さずに、書き込み先のレイヤにSdfのspecとして格納する.
+	SdfPrimSpecHandle shaderSpec = ::m_definePrimSpec(layer, SdfPath(pathStr + std::string("/Shader")), "Shader");
+	if (!shaderSpec) return;
 
-	// OmniPBRの作成.
-	UsdPrim primShader = g_stage->DefinePrim(SdfPath(pathStr + std::string("/Shader")), TfToken("Shader"));
-	UsdShadeShader shader(primShader);
-
-	shader.SetSourceAsset(SdfAssetPath("OmniGlass.mdl"), mdlToken);
-	shader.GetPrim().CreateAttribute(TfToken("info:mdl:sourceAsset:subIdentifier"), SdfValueTypeNames->Token, false, SdfVariabilityUniform).Set(TfToken("OmniGlass")); 
+	const std::string templatePath = m_getShaderTemplateMDL("OmniGlass");
+	shaderSpec->GetSpecializesList().Prepend(SdfPath(templatePath));
 
 	//-----------------------------------------------.
 	// Depth.
 	//-----------------------------------------------.
 	{
-		UsdShadeInput in = shader.CreateInput(TfToken("depth"), SdfValueTypeNames->Float);
-		in.Set(0.001f);
-		UsdAttribute attr = in.GetAttr();
-		attr.SetDisplayGroup(std::string("Color"));
-		attr.SetDisplayName(std::string("Volume Absorption Scale"));
-
-		// デフォルトの値を指定.
-		attr.SetCustomDataByKey(TfToken("default"), VtValue(0.001f));
-#if USE_DICTIONARY_RANGE
-		{
-			VtDictionary dic;
-			dic.SetValueAtPath("max", VtValue(1000.0f));
-			dic.SetValueAtPath("min", VtValue(0.0f));
-			attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-		}
-#endif
+		SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:depth", SdfValueTypeNames->Float, VtValue(0.001f));
+		::m_setShaderInputMetadata(in, templatePath, "Color", "Volume Absorption Scale", VtValue(0.001f), VtValue(0.0f), VtValue(1000.0f));
 	}
 
 	//-----------------------------------------------.
@@ -1477,59 +1552,25 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL_Glass (const std::string& p
 	{
 		const CTextureMappingData& mappingD = materialData.roughnessTexture;
 		{
-			UsdShadeInput in = shader.CreateInput(TfToken("frosting_roughness"), SdfValueTypeNames->Float);
-			in.Set(materialData.roughness);
-			UsdAttribute attr = in.GetAttr();
-			attr.SetDisplayGroup(std::string("Roughness"));
-			attr.SetDisplayName(std::string("Glass Roughness"));
-
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(0.0f));
-#if USE_DICTIONARY_RANGE
-			{
-				VtDictionary dic;
-				dic.SetValueAtPath("max", VtValue(1.0f));
-				dic.SetValueAtPath("min", VtValue(0.0f));
-				attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-			}
-#endif
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:frosting_roughness", SdfValueTypeNames->Float, VtValue(materialData.roughness));
+			::m_setShaderInputMetadata(in, templatePath, "Roughness", "Glass Roughness", VtValue(0.0f), VtValue(0.0f), VtValue(1.0f));
 		}
 
 		if (mappingD.textureParam.imageIndex >= 0) {
 			{
-				const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-				UsdShadeInput in = shader.CreateInput(TfToken("roughness_texture"), SdfValueTypeNames->Asset);
-				in.Set(SdfAssetPath(fileName));
+				const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:roughness_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-				UsdAttribute attr = in.GetAttr();
 				if (m_exportParam.grayscaleTexturesColorSpace == USD_DATA::EXPORT::TEXTURE_COLOR_SPACE::texture_colorspace_raw) {
-					attr.SetColorSpace(TfToken("raw"));
+					in->SetColorSpace(TfToken("raw"));
 				} else {
-					attr.SetColorSpace(TfToken("sRGB"));
+					in->SetColorSpace(TfToken("sRGB"));
 				}
-				attr.SetDisplayGroup(std::string("Roughness"));
-				attr.SetDisplayName(std::string("Roughness Texture"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+				::m_setShaderInputMetadata(in, templatePath, "Roughness", "Roughness Texture", VtValue(SdfAssetPath("")));
 			}
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("roughness_texture_influence"), SdfValueTypeNames->Float);
-				in.Set(1.0f);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Roughness"));
-				attr.SetDisplayName(std::string("Roughness Texture Influence"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(1.0f));
-#if USE_DICTIONARY_RANGE
-				{
-					VtDictionary dic;
-					dic.SetValueAtPath("max", VtValue(100000.f));
-					dic.SetValueAtPath("min", VtValue(-100000.f));
-					attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-				}
-#endif
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:roughness_texture_influence", SdfValueTypeNames->Float, VtValue(1.0f));
+				::m_setShaderInputMetadata(in, templatePath, "Roughness", "Roughness Texture Influence", VtValue(1.0f), VtValue(-100000.f), VtValue(100000.f));
 			}
 		}
 	}
@@ -1541,37 +1582,17 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL_Glass (const std::string& p
 		const CTextureMappingData& mappingD = materialData.normalTexture;
 
 		{
-			const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-			UsdShadeInput in = shader.CreateInput(TfToken("normal_map_texture"), SdfValueTypeNames->Asset);
-			in.Set(SdfAssetPath(fileName));
-
-			UsdAttribute attr = in.GetAttr();
-			attr.SetColorSpace(TfToken("raw"));
-			attr.SetDisplayGroup(std::string("Normal"));
-			attr.SetDisplayName(std::string("Normal Map Texture"));
+			const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:normal_map_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+			in->SetColorSpace(TfToken("raw"));
+			::m_setShaderInputMetadata(in, templatePath, "Normal", "Normal Map Texture", VtValue(SdfAssetPath("")));
 		}
 
 		// Normal Mapの強さを指定.
 		{
-			UsdShadeInput in = shader.CreateInput(TfToken("normal_map_strength"), SdfValueTypeNames->Float);
-			in.Set(materialData.normalStrength);
-			UsdAttribute attr = in.GetAttr();
-			attr.SetDisplayGroup(std::string("Normal"));
-			attr.SetDisplayName(std::string("Normal Map Strength"));
-
-			// デフォルトの値を指定.
-			attr.SetCustomDataByKey(TfToken("default"), VtValue(1.0f));
-#if USE_DICTIONARY_RANGE
-			{
-				VtDictionary dic;
-				dic.SetValueAtPath("max", VtValue(10.0f));
-				dic.SetValueAtPath("min", VtValue(0.0f));
-				attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-			}
-#endif
+			SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:normal_map_strength", SdfValueTypeNames->Float, VtValue(materialData.normalStrength));
+			::m_setShaderInputMetadata(in, templatePath, "Normal", "Normal Map Strength", VtValue(1.0f), VtValue(0.0f), VtValue(10.0f));
 		}
 	}
 
@@ -1586,44 +1607,16 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL_Glass (const std::string& p
 		vB = materialData.transparencyColor[2];
 		USD_DATA::convColorLinear(vR, vG, vB);
 
-		UsdShadeInput in = shader.CreateInput(TfToken("glass_color"), SdfValueTypeNames->Color3f);
-		in.Set(GfVec3f(vR, vG, vB));
-		UsdAttribute attr = in.GetAttr();
-		attr.SetDisplayGroup(std::string("Color"));
-		attr.SetDisplayName(std::string("Glass Color"));
-
-		// デフォルトの値を指定.
-		attr.SetCustomDataByKey(TfToken("default"), VtValue(GfVec3f(1, 1, 1)));
-#if USE_DICTIONARY_RANGE
-		{
-			VtDictionary dic;
-			dic.SetValueAtPath("max", VtValue(GfVec3f(1, 1, 1)));
-			dic.SetValueAtPath("min", VtValue(GfVec3f(0, 0, 0)));
-			attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-		}
-#endif
+		SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:glass_color", SdfValueTypeNames->Color3f, VtValue(GfVec3f(vR, vG, vB)));
+		::m_setShaderInputMetadata(in, templatePath, "Color", "Glass Color", VtValue(GfVec3f(1, 1, 1)), VtValue(GfVec3f(0, 0, 0)), VtValue(GfVec3f(1, 1, 1)));
 	}
 
 	//-----------------------------------------------.
 	// Glass IOR.
 	//-----------------------------------------------.
 	{
-		UsdShadeInput in = shader.CreateInput(TfToken("glass_ior"), SdfValueTypeNames->Float);
-		in.Set(materialData.ior);
-		UsdAttribute attr = in.GetAttr();
-		attr.SetDisplayGroup(std::string("Refraction"));
-		attr.SetDisplayName(std::string("Glass IOR"));
-
-		// デフォルトの値を指定.
-		attr.SetCustomDataByKey(TfToken("default"), VtValue(1.491f));
-#if USE_DICTIONARY_RANGE
-		{
-			VtDictionary dic;
-			dic.SetValueAtPath("max", VtValue(4.0f));
-			dic.SetValueAtPath("min", VtValue(1.0f));
-			attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-		}
-#endif
+		SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:glass_ior", SdfValueTypeNames->Float, VtValue(materialData.ior));
+		::m_setShaderInputMetadata(in, templatePath, "Refraction", "Glass IOR", VtValue(1.491f), VtValue(1.0f), VtValue(4.0f));
 	}
 
 	//-----------------------------------------------.
@@ -1633,97 +1626,53 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL_Glass (const std::string& p
 		const CTextureMappingData& mappingD = materialData.opacityTexture;
 		if (mappingD.textureParam.imageIndex >= 0) {
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("enable_opacity"), SdfValueTypeNames->Bool);
-				in.Set(true);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Enable Opacity"));
-
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(false));
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:enable_opacity", SdfValueTypeNames->Bool, VtValue(true));
+				::m_setShaderInputMetadata(in, templatePath, "Opacity", "Enable Opacity", VtValue(false));
 			}
 
 			// Opacityの影響度.
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("cutout_opacity"), SdfValueTypeNames->Float);
-				in.Set(1.0f);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Opacity Amount"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(1.0f));
-#if USE_DICTIONARY_RANGE
-				{
-					VtDictionary dic;
-					dic.SetValueAtPath("max", VtValue(1.0f));
-					dic.SetValueAtPath("min", VtValue(0.0f));
-					attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-				}
-#endif
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:cutout_opacity", SdfValueTypeNames->Float, VtValue(1.0f));
+				::m_setShaderInputMetadata(in, templatePath, "Opacity", "Opacity Amount", VtValue(1.0f), VtValue(0.0f), VtValue(1.0f));
 			}
 			
 			// Mono Sourceを"mono_alpha"とすると、BaseColorのAlphaをOpacityとすることになる.
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("cutout_opacity_mono_source"), SdfValueTypeNames->Int);
-				in.Set(materialData.useDiffuseAlpha ? 0 : 1);
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Opacity Mono Source"));
-
-				attr.SetMetadata(TfToken("renderType"), VtValue("::base::mono_mode"));
-
-				{
-					NdrTokenMap tMap;
-					tMap[TfToken("__SDR__enum_value")].append("mono_alpha");
-					tMap[TfToken("options")].append("mono_alpha:0|mono_average:1|mono_luminance:2|mono_maximum:3");
-
-					in.SetSdrMetadata(tMap);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:cutout_opacity_mono_source", SdfValueTypeNames->Int, VtValue(materialData.useDiffuseAlpha ? 0 : 1));
+				SdfAttributeSpecHandle attrSpec = ::m_setShaderInputMetadata(in, templatePath, "Opacity", "Opacity Mono Source", VtValue(0));
+				if (attrSpec) {
+					attrSpec->SetInfo(TfToken("renderType"), VtValue(std::string("::base::mono_mode")));
+
+					// UsdShadeInput::SetSdrMetadataと同じく、文字列の辞書として格納.
+					VtDictionary sdrDic;
+					sdrDic["__SDR__enum_value"] = VtValue(std::string("mono_alpha"));
+					sdrDic["options"] = VtValue(std::string("mono_alpha:0|mono_average:1|mono_luminance:2|mono_maximum:3"));
+					attrSpec->SetInfo(TfToken("sdrMetadata"), VtValue(sdrDic));
 				}
-
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(0));
 			}
 
 			// テクスチャの指定.
 			{
-				const std::string fileName = m_imagesList[mappingD.textureParam.imageIndex].fileName;
-				UsdShadeInput in = shader.CreateInput(TfToken("cutout_opacity_texture"), SdfValueTypeNames->Asset);
-				in.Set(SdfAssetPath(fileName));
+				const std::string fileName = m_getMDLTextureFileName(mappingD.textureParam.imageIndex);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:cutout_opacity_texture", SdfValueTypeNames->Asset, VtValue(SdfAssetPath(fileName)));
 
-				UsdAttribute attr = in.GetAttr();
 				if (m_exportParam.grayscaleTexturesColorSpace == USD_DATA::EXPORT::TEXTURE_COLOR_SPACE::texture_colorspace_raw) {
-					attr.SetColorSpace(TfToken("raw"));
+					in->SetColorSpace(TfToken("raw"));
 				} else {
-					attr.SetColorSpace(TfToken("sRGB"));
+					in->SetColorSpace(TfToken("sRGB"));
 				}
 
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Opacity Map"));
-
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(SdfAssetPath("")));
+				::m_setShaderInputMetadata(in, templatePath, "Opacity", "Opacity Map", VtValue(SdfAssetPath("")));
 			}
 
 			// Cutout(cutoff)の指定.
 			{
-				UsdShadeInput in = shader.CreateInput(TfToken("opacity_threshold"), SdfValueTypeNames->Float);
-				in.Set(0.0f);
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:opacity_threshold", SdfValueTypeNames->Float, VtValue(0.0f));
 				if (materialData.alphaModeParam.alphaModeType == CommonParam::alpha_mode_type::alpha_mode_mask) {
-					in.Set(materialData.alphaModeParam.alphaCutoff);
+					in->SetDefaultValue(VtValue(materialData.alphaModeParam.alphaCutoff));
 				}
 
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("Opacity"));
-				attr.SetDisplayName(std::string("Opacity Threshold"));
-
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(0.0f));
-#if USE_DICTIONARY_RANGE
-				{
-					VtDictionary dic;
-					dic.SetValueAtPath("max", VtValue(1.0f));
-					dic.SetValueAtPath("min", VtValue(0.0f));
-					attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-				}
-#endif
+				::m_setShaderInputMetadata(in, templatePath, "Opacity", "Opacity Threshold", VtValue(0.0f), VtValue(0.0f), VtValue(1.0f));
 			}
 		}
 	}
@@ -1732,13 +1681,8 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL_Glass (const std::string& p
 	// thin.
 	//-----------------------------------------------.
 	{
-		UsdShadeInput in = shader.CreateInput(TfToken("thin_walled"), SdfValueTypeNames->Bool);
-		in.Set(materialData.glassThin);
-		UsdAttribute attr = in.GetAttr();
-		attr.SetDisplayGroup(std::string("Refraction"));
-		attr.SetDisplayName(std::string("Thin Walled"));
-
-		attr.SetCustomDataByKey(TfToken("default"), VtValue(false));
+		SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:thin_walled", SdfValueTypeNames->Bool, VtValue(materialData.glassThin));
+		::m_setShaderInputMetadata(in, templatePath, "Refraction", "Thin Walled", VtValue(false));
 	}
 
 	//-----------------------------------------------.
@@ -1795,30 +1739,16 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL_Glass (const std::string& p
 			}
 
 			if (texRepeatX != 1 || texRepeatY != 1) {
-				UsdShadeInput in = shader.CreateInput(TfToken("texture_scale"), SdfValueTypeNames->Float2);
-				in.Set(GfVec2f(texRepeatX, texRepeatY));
-
-				UsdAttribute attr = in.GetAttr();
-				attr.SetDisplayGroup(std::string("UV"));
-				attr.SetDisplayName(std::string("Texture Scale"));
+				SdfAttributeSpecHandle in = ::m_createAttributeSpec(shaderSpec, "inputs:texture_scale", SdfValueTypeNames->Float2, VtValue(GfVec2f(texRepeatX, texRepeatY)));
 
-				// デフォルトの値を指定.
-				attr.SetCustomDataByKey(TfToken("default"), VtValue(GfVec2f(1, 1)));
-#if USE_DICTIONARY_RANGE
-				{
-					VtDictionary dic;
-					dic.SetValueAtPath("max", VtValue(GfVec2f(100000, 100000)));
-					dic.SetValueAtPath("min", VtValue(GfVec2f(-100000, -100000)));
-					attr.SetCustomDataByKey(TfToken("range"), VtValue(dic));
-				}
-#endif
+				::m_setShaderInputMetadata(in, templatePath, "UV", "Texture Scale", VtValue(GfVec2f(1, 1)), VtValue(GfVec2f(-100000, -100000)), VtValue(GfVec2f(100000, 100000)));
 			}
 		}
 	}
 
 	// MaterialからShaderをつなぐ.
-	UsdShadeOutput mdlOutput = mat.CreateSurfaceOutput(mdlToken);
-	mdlOutput.ConnectToSource(shader, TfToken("out"));
+	SdfAttributeSpecHandle mdlOutput = ::m_createAttributeSpec(matSpec, "outputs:mdl:surface", SdfValueTypeNames->Token);
+	::m_connectToOutputSpec(mdlOutput, shaderSpec, "out");
 }
 
 /**
@@ -1830,6 +1760,7 @@ void CUSDExporter::m_appendNodeMaterial_OmniverseMDL_Glass (const std::string& p
 void CUSDExporter::appendNodeNull (const std::string& nodeName, const USD_DATA::NodeMatrixData& matrix, const CJointMotionData& jointMotion)
 {
 	if (!g_stage) return;
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_geometry);
 
 	std::string nodePath = nodeName;
 	UsdPrim node = g_stage->DefinePrim(SdfPath(nodePath), TfToken("Xform"));
@@ -1849,12 +1780,13 @@ void CUSDExporter::appendNodeNull (const std::string& nodeName, const USD_DATA::
  * @param[in] refNodeName        参照するノード名 (/root/xxx/mesh1 などのパス形式).
  * @param[in] refMaterialName    参照するマテリアル名 (/root/materials/xxx1 などのパス形式).
  */
-void CUSDExporter::setShapeReference (const std::string& nodeName, const std::string& refNodeName, const std::string& refMaterialName)
+std::string CUSDExporter::setShapeReference (const std::string& nodeName, const std::string& refNodeName, const std::string& refMaterialName)
 {
-	if (!g_stage) return;
+	if (!g_stage) return "";
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_geometry);
 
 	int iPos = nodeName.find_last_of("/");
-	if (iPos == std::string::npos) return;
+	if (iPos == std::string::npos) return "";
 
 	const std::string sPath = nodeName.substr(0, iPos);
 	const std::string sName = nodeName.substr(iPos + 1);
@@ -1866,10 +1798,12 @@ void CUSDExporter::setShapeReference (const std::string& nodeName, const std::st
 	}
 
 	UsdPrim node = g_stage->GetPrimAtPath(SdfPath(sPath));
-	if (!node.IsValid()) return;
+	if (!node.IsValid()) return "";
 
+	// 差分エクスポート時は既存の参照が残っているため、一度クリアする.
 	std::string nodePath = sPath + std::string("/ref_") + rName;
 	UsdPrim nodeRef = g_stage->OverridePrim(SdfPath(nodePath));
+	nodeRef.GetReferences().ClearReferences();
 	nodeRef.GetReferences().AddInternalReference(SdfPath(refNodeName));
 
 	// マテリアルを割り当て.
@@ -1880,6 +1814,7 @@ void CUSDExporter::setShapeReference (const std::string& nodeName, const std::st
 			UsdShadeMaterialBindingAPI(nodeRef).Bind(mat);
 		}
 	}
+	return nodePath;
 }
 
 /**
@@ -1892,6 +1827,7 @@ void CUSDExporter::m_setTransformAnimation (const std::string& nodeName, const C
 
 	UsdPrim node = g_stage->GetPrimAtPath(SdfPath(nodeName));
 	if (!node.IsValid()) return;
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_anim);
 
 	// 移動アニメーションを指定.
 	if (!jointMotion.translations.empty()) {
@@ -1963,6 +1899,7 @@ bool CUSDExporter::m_hasSkinMesh (const USD_DATA::MeshData& meshData)
 void CUSDExporter::appendNodeMesh (const std::string& nodeName, const USD_DATA::NodeMatrixData& matrix, const USD_DATA::MeshData& meshData, const bool doubleSided)
 {
 	if (!g_stage) return;
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_geometry);
 
 	// スキン使用時は、Skeleton内にMeshを入れる必要がある.
 	std::string meshPath = nodeName;
@@ -2226,6 +2163,7 @@ void CUSDExporter::appendNodeMesh (const std::string& nodeName, const USD_DATA::
  */
 void CUSDExporter::setRefinement (const std::string& nodeName, const bool enableOverride, const int refinementLevel)
 {
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_geometry);
 	UsdPrim prim = g_stage->GetPrimAtPath(SdfPath(nodeName));
 	if (!prim.IsValid()) return;
 
@@ -2239,28 +2177,6 @@ void CUSDExporter::setRefinement (const std::string& nodeName, const bool enable
 	}
 }
 
-/**
- * usdzファイルを出力.
- * @param[in] filePath  出力ファイルパス.
- * @param[in] files     出力で追加するファイル（すべて絶対パスで指定）.
- */
-bool CUSDExporter::exportUSDZ (const std::string& filePath, std::vector<std::string>& files)
-{
-	UsdZipFileWriter zipWriter = UsdZipFileWriter::CreateNew(filePath);
-
-	for (size_t i = 0; i < files.size(); ++i) {
-		// ファイル名を取得.
-		const std::string fileName2 = StringUtil::getFileName(files[i]);
-
-		// 第一引数は絶対パスでのファイル名指定、第二引数はzipアーカイブでの指定.
-		zipWriter.AddFile(files[i], fileName2);
-	}
-
-	zipWriter.Save();
-
-	return true;
-}
-
 /**
  * アニメーション情報を出力.
  * @param[in] startFrame  開始フレーム.
@@ -2270,6 +2186,7 @@ bool CUSDExporter::exportUSDZ (const std::string& filePath, std::vector<std::str
 void CUSDExporter::setAnimationData (const float startFrame, const float endFrame, const float framerate)
 {
 	if (!g_stage) return;
+	m_setEditTargetRoot();		// ステージのメタデータはルートレイヤに格納する.
 
 	g_stage->SetFramesPerSecond((double)framerate);
 	g_stage->SetStartTimeCode((double)startFrame);
@@ -2282,6 +2199,7 @@ void CUSDExporter::setAnimationData (const float startFrame, const float endFram
 void CUSDExporter::appendSkeletonData (const CSkeletonData& skelData)
 {
 	if (!g_stage) return;
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_geometry);
 
 	// Skeletonのルート.
 	{
@@ -2298,9 +2216,6 @@ void CUSDExporter::appendSkeletonData (const CSkeletonData& skelData)
 	UsdSkelRoot skelRoot(prim1);
 	UsdPrim prim2 = g_stage->DefinePrim(SdfPath(skelName), TfToken("Skeleton"));
 	UsdSkelSkeleton skeleton(prim2);
-	UsdPrim prim3 = g_stage->DefinePrim(SdfPath(animName), TfToken("SkelAnimation"));
-	UsdSkelAnimation skelAnim(prim3);
-
 	// 対応するジョイント名を格納.
 	std::vector<TfToken> jointTokens;
 	{
@@ -2341,6 +2256,10 @@ void CUSDExporter::appendSkeletonData (const CSkeletonData& skelData)
 	}
 
 	// SkelAnimationにキーフレーム情報を格納.
+	// レイヤを分割する場合は、SkelAnimationとBindはアニメーションのサブレイヤに格納する.
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_anim);
+	UsdPrim prim3 = g_stage->DefinePrim(SdfPath(animName), TfToken("SkelAnimation"));
+	UsdSkelAnimation skelAnim(prim3);
 	{
 		// Skeletonで、SkelAnimationをBind.
 		UsdSkelBindingAPI binding = UsdSkelBindingAPI::Apply(skeleton.GetPrim());
@@ -2463,12 +2382,14 @@ namespace {
 /**
  * マテリアルを複製.
  * これはShade3Dのリンク使用時に、マスターオブジェクトのスコープ内でマテリアルを参照できるようにする.
+ * 複製したマテリアルは、ルートのマテリアルを内部参照する.
  * @param[in]  nodeName       対象のノードパス.
  * @param[in]  materialsList  マテリアル情報のリスト.
  */
 void CUSDExporter::setMaterialsInScope (const std::string& nodeName, const std::vector<CMaterialData>& materialsList)
 {
 	if (!g_stage) return;
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_materials);
 
 	// すでにnodeName内に"Materials"のノードがある場合はスキップ.
 	const std::string materialsName = nodeName + std::string("/Materials");
@@ -2527,19 +2448,14 @@ void CUSDExporter::setMaterialsInScope (const std::string& nodeName, const std::
 			}
 			if (mIndex < 0) continue;
 
-			// マテリアルの実体.
-			UsdPrim primMat = g_stage->GetPrimAtPath(SdfPath(matPath));
-
 			// マテリアルのノードを作成.
+			// Shaderのネットワークは複製せず、ルートのマテリアルを内部参照するだけにする.
+			// 同じマテリアルを参照するメッシュが複数ある場合は、作成済みのノードを使用する.
 			const std::string newPath = materialsName + std::string("/") + orgMaterialName;
-			UsdPrim newPrimMat = g_stage->DefinePrim(SdfPath(newPath), TfToken("Material"));
-
-			// マテリアル情報を追加.
-			if (!m_exportParam.useShaderMDL()) {
-				m_appendNodeMaterial(newPath, materialsList[mIndex]);
-			} else {
-				// OmniverseのMDLの場合.
-				m_appendNodeMaterial_OmniverseMDL(newPath, materialsList[mIndex]);
+			UsdPrim newPrimMat = g_stage->GetPrimAtPath(SdfPath(newPath));
+			if (!newPrimMat.IsValid()) {
+				newPrimMat = g_stage->DefinePrim(SdfPath(newPath), TfToken("Material"));
+				newPrimMat.GetReferences().AddInternalReference(SdfPath(materialsList[mIndex].name));
 			}
 
 			// 参照を置き換え.
@@ -2555,6 +2471,7 @@ void CUSDExporter::setMaterialsInScope (const std::string& nodeName, const std::
  */
 void CUSDExporter::setActive (const std::string& nodeName, const bool activeV)
 {
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_geometry);
 	UsdPrim prim = g_stage->GetPrimAtPath(SdfPath(nodeName));
 	if (!prim.IsValid()) return;
 
@@ -2573,6 +2490,7 @@ void CUSDExporter::setActive (const std::string& nodeName, const bool activeV)
  */
 void CUSDExporter::setVisible (const std::string& nodeName, const bool visible)
 {
+	m_setEditTarget(USD_DATA::LAYER_TYPE::layer_type_geometry);
 	UsdPrim prim = g_stage->GetPrimAtPath(SdfPath(nodeName));
 	if (!prim.IsValid()) return;
 
@@ -2585,3 +2503,42 @@ void CUSDExporter::setVisible (const std::string& nodeName, const bool visible)
 	}
 }
 
+/**
+ * 指定のノードが存在するか.
+ * @param[in] nodeName    ノード名 (/root/xxx/mesh1 などのパス形式).
+ */
+bool CUSDExporter::existNode (const std::string& nodeName)
+{
+	if (!g_stage) return false;
+	UsdPrim prim = g_stage->GetPrimAtPath(SdfPath(nodeName));
+	return prim.IsValid();
+}
+
+/**
+ * 指定のノードを子ノードも含めて削除.
+ * @param[in] nodeName    ノード名 (/root/xxx/mesh1 などのパス形式).
+ */
+void CUSDExporter::removeNode (const std::string& nodeName)
+{
+	if (!g_stage) return;
+	UsdPrim prim = g_stage->GetPrimAtPath(SdfPath(nodeName));
+	if (!prim.IsValid()) return;
+
+	g_stage->RemovePrim(SdfPath(nodeName));
+}
+
+/**
+ * 指定のノードの属性をすべて削除 (子ノードは残す).
+ * @param[in] nodeName    ノード名 (/root/xxx/mesh1 などのパス形式).
+ */
+void CUSDExporter::resetNode (const std::string& nodeName)
+{
+	if (!g_stage) return;
+	UsdPrim prim = g_stage->GetPrimAtPath(SdfPath(nodeName));
+	if (!prim.IsValid()) return;
+
+	const std::vector<UsdProperty> propList = prim.GetAuthoredProperties();
+	for (size_t i = 0; i < propList.size(); ++i) {
+		prim.RemoveProperty(propList[i].GetName());
+	}
+}
@@ -23,6 +23,8 @@ private:
 	std::vector<CImageData> m_imagesList;			// 出力するイメージ情報のリスト.
 
 	std::string m_versionString;					// プラグインバージョンの文字列.
+	std::string m_exportFileName;					// 既存のUSDファイルを開いて出力する場合の出力先.
+	std::vector<std::string> m_subLayerFileNames;	// レイヤを分割して出力する場合の、ルートレイヤから参照するサブレイヤのファイル名.
 
 public:
 	CUSDExporter ();
@@ -59,6 +61,18 @@ public:
 	void testCreateSphereWithAnimation (const std::string& fileName);
 
 private:
+	/**
+	 * 書き込み先のレイヤを切り替え (レイヤを分割して出力する場合).
+	 * 指定の種類のサブレイヤがない場合は、形状のサブレイヤまたはルートレイヤに書き込む.
+	 * @param[in] layerType  サブレイヤの種類.
+	 */
+	void m_setEditTarget (const USD_DATA::LAYER_TYPE layerType);
+
+	/**
+	 * 書き込み先をルートレイヤにする.
+	 */
+	void m_setEditTargetRoot ();
+
 	/**
 	 * ヘッダ情報を出力.
 	 */
@@ -73,6 +87,20 @@ private:
 	 */
 	void m_outputTextureData (const std::string& pathStr, const CMaterialData& materialData, const USD_DATA::TEXTURE_PATTERN_TYPE& patternType, const USD_DATA::TEXTURE_SOURE& textureSource);
 
+	/**
+	 * MDLで参照するテクスチャファイル名を取得.
+	 * @param[in] imageIndex  m_imagesListのインデックス.
+	 */
+	std::string m_getMDLTextureFileName (const int imageIndex);
+
+	/**
+	 * MDLのShaderのテンプレート(class prim)を取得.
+	 * 存在しない場合は作成する.
+	 * @param[in] mdlName  MDL名 ("OmniPBR"、"OmniGlass").
+	 * @return テンプレートのパス.
+	 */
+	std::string m_getShaderTemplateMDL (const std::string& mdlName);
+
 	/**
 	 * 指定のメッシュがスキンを持つか.
 	 */
@@ -110,14 +138,25 @@ public:
 	//-----------------------------------------------------------.
 	/**
 	 * Export開始.
+	 * @param[in] fileName      出力ファイル名.
+	 * @param[in] exportParam   エクスポートパラメータ.
+	 * @param[in] baseFileName  前回出力したUSDファイル名。指定した場合は、このファイルを開いて変更部分のみを書き換える.
 	 */
-	void beginExport (const std::string& fileName, const CExportParam& exportParam);
+	void beginExport (const std::string& fileName, const CExportParam& exportParam, const std::string& baseFileName = "");
 
 	/**
 	 * Export終了.
 	 */
 	void endExport ();
 
+	/**
+	 * 形状/マテリアル/アニメーションを別々のサブレイヤとして出力する場合に、サブレイヤを作成.
+	 * beginExportのあとに呼ぶこと。ルートレイヤは、これらのサブレイヤを合成するだけのレイヤになる.
+	 * @param[in] tempFileNames  出力時に書き込むサブレイヤのファイル名 (USD_DATA::LAYER_TYPEの順。作成しない場合は"").
+	 * @param[in] fileNames      ルートレイヤから参照するサブレイヤのファイル名 (USD_DATA::LAYER_TYPEの順).
+	 */
+	void createSubLayers (const std::vector<std::string>& tempFileNames, const std::vector<std::string>& fileNames);
+
 	/**
 	 * バージョン文字列を渡す.
 	 * @param[in] verStr  バージョン文字列。 "0.0.1.2" など.
@@ -134,13 +173,6 @@ public:
 	 */
 	void SetImagesList (const std::vector<CImageData>& imagesList);
 
-	/**
-	 * usdzファイルを出力.
-	 * @param[in] filePath  出力ファイルパス.
-	 * @param[in] files     出力で追加するファイル（すべて絶対パスで指定）.
-	 */
-	bool exportUSDZ (const std::string& filePath, std::vector<std::string>& files);
-
 	/**
 	 * Materialノードを出力.
 	 * @param[in] materialData   マテリアルデータ.
@@ -153,9 +185,17 @@ public:
 	 */
 	void appendNodeMaterial_OmniverseMDL (const CMaterialData& materialData);
 
+	/**
+	 * Materialノードをまとめて出力.
+	 * MDLの場合は、inputの格納をSdfChangeBlockでまとめて変更通知を1度にする.
+	 * @param[in] materialsList  マテリアルデータのリスト.
+	 */
+	void appendNodeMaterials (const std::vector<CMaterialData>& materialsList);
+
 	/**
 	 * マテリアルを複製.
 	 * これはShade3Dのリンク使用時に、マスターオブジェクトのスコープ内でマテリアルを参照できるようにする.
+	 * 複製したマテリアルは、ルートのマテリアルを内部参照する.
 	 * @param[in]  nodeName       対象のノードパス.
 	 * @param[in]  materialsList  マテリアル情報のリスト.
 	 */
@@ -191,8 +231,9 @@ public:
 	 * @param[in] nodeName           ノード名 (/root/xxx/mesh1 などのパス形式).
 	 * @param[in] refNodeName        参照するノード名 (/root/xxx/mesh1 などのパス形式).
 	 * @param[in] refMaterialName    参照するマテリアル名 (/root/materials/xxx1 などのパス形式).
+	 * @return 参照として作成したノードのパス.
 	 */
-	void setShapeReference (const std::string& nodeName, const std::string& refNodeName, const std::string& refMaterialName);
+	std::string setShapeReference (const std::string& nodeName, const std::string& refNodeName, const std::string& refMaterialName);
 
 	/**
 	 * アニメーション情報を出力.
@@ -219,6 +260,25 @@ public:
 	 */
 	void setVisible (const std::string& nodeName, const bool visible = true);
 
+	/**
+	 * 指定のノードが存在するか.
+	 * @param[in] nodeName    ノード名 (/root/xxx/mesh1 などのパス形式).
+	 */
+	bool existNode (const std::string& nodeName);
+
+	/**
+	 * 指定のノードを子ノードも含めて削除.
+	 * @param[in] nodeName    ノード名 (/root/xxx/mesh1 などのパス形式).
+	 */
+	void removeNode (const std::string& nodeName);
+
+	/**
+	 * 指定のノードの属性をすべて削除 (子ノードは残す).
+	 * 差分エクスポート時に、変更のあったノードを書き直す前に使用.
+	 * @param[in] nodeName    ノード名 (/root/xxx/mesh1 などのパス形式).
+	 */
+	void resetNode (const std::string& nodeName);
+
 };
 
 #endif
@@ -8,9 +8,11 @@
 #include "Shade3DUtil.h"
 #include "StreamCtrl.h"
 #include "StringUtil.h"
+#include "FileUtil.h"
 #include "MathUtil.h"
 
 #include <time.h>
+#include <cstdio>
 
 // ダイアログボックスのパラメータ.
 enum {
@@ -18,6 +20,8 @@ enum {
 	dlg_file_usdz = 102,					// usdzを出力.
 	dlg_file_export_apple_usdz = 103,		// Appleのusdz互換.
 	dlg_file_export_output_temp_files = 104,	// usdz出力時に作業ファイルを出力.
+	dlg_file_export_incremental = 105,		// 変更のあった要素のみを書き換える (差分エクスポート).
+	dlg_file_export_split_layers = 106,		// 形状/マテリアル/アニメーションを別々のサブレイヤとして出力.
 
 	dlg_option_bone_skin = 203,				// ボーンとスキンを出力.
 	dlg_option_vertex_color = 204,			// 頂点カラーを出力.
@@ -30,6 +34,18 @@ enum {
 	dlg_option_max_texture_size = 302,		// 最大テクスチャサイズ.
 	dlg_option_texture_grayscale = 303,		// R/G/B/A指定をグレイスケールに分けて出力.
 	dlg_option_bake_without_processing_textures_id = 305,	// テクスチャを加工せずにベイク.
+	dlg_option_texture_pack_orm = 306,		// Occlusion/Roughness/Metallicを1枚のテクスチャにまとめる.
+	dlg_option_png_compression_level = 307,	// pngの圧縮レベル.
+	dlg_option_png_filter_type = 308,		// pngのフィルタ.
+	dlg_option_png_optimize = 309,			// pngの最適化.
+	dlg_option_jpeg_quality = 310,			// jpegの品質.
+	dlg_option_texture_encode_report = 311,	// テクスチャの出力サイズ/エンコード時間を表示.
+	dlg_option_texel_density = 312,			// 最大テクスチャサイズが自動の場合のテクセル密度.
+	dlg_option_texture_pack_atlas = 313,	// 小さいベイク済みテクスチャをアトラスにまとめる.
+	dlg_option_texture_atlas_max_size = 314,	// アトラスにまとめるテクスチャの最大サイズ.
+	dlg_option_texture_copy_source = 315,	// 加工なしのテクスチャは元の画像ファイルをコピー.
+	dlg_option_texture_bake_ao = 316,		// Ambient Occlusionをベイク.
+	dlg_option_texture_bake_ao_size = 317,	// Ambient Occlusionをベイクするテクスチャのサイズ.
 
 	dlg_option_anim_keyframe_mode = 401,	// アニメーションのキーフレーム出力モード.
 	dlg_option_anim_keyframe_step = 402,	// アニメーションのキーフレームのステップ数.
@@ -37,6 +53,8 @@ enum {
 	dlg_material_shader_type = 501,				// USDでのShaderの種類.
 	dlg_separateOpacityAndTransmission = 502,	// 「不透明(Opacity)」と「透明(Transmission)」を分ける.
 	dlg_grayscale_texture_colorspace = 503,		// グレイスケールテクスチャのColor Space.
+	dlg_merge_same_materials = 504,				// 同じパラメータのマテリアルを1つにまとめる.
+	dlg_material_output_preview_surface = 505,	// MDL時に、UsdPreviewSurfaceも出力する.
 };
 
 CUSDExporterInterface::CUSDExporterInterface (sxsdk::shade_interface& shade) : shade(shade)
@@ -136,8 +154,14 @@ void CUSDExporterInterface::do_export (sxsdk::plugin_exporter_interface *plugin_
 	// streamに、ダイアログボックスのパラメータを保存.
 	StreamCtrl::saveExportDialogParam(shade, m_exportParam);
 
+	// ベイクしたテクスチャのピクセルは、作業フォルダに一時ファイルとして退避する.
+	std::string tempPath = "";
+	try {
+		tempPath = std::string(shade.get_temporary_path("shade3d_temp_usd"));
+	} catch (...) { }
+
 	m_sceneData.clear();
-	m_sceneData.setupExport(scene, m_exportParam);
+	m_sceneData.setupExport(scene, m_exportParam, tempPath);
 	m_warningCheck.clear();
 
 	try {
@@ -260,9 +284,17 @@ void CUSDExporterInterface::clean_up (void *)
 	}
 
 	// 作業用ファイル名のフルパス.
+	// 出力先のパスがASCIIで、usdz以外のファイルも出力する場合は、作業用ディレクトリを経由せずに出力先に直接出力する.
+	// 出力先では、同一フォルダの一時ファイルに書き込んだ後に置き換えている.
 	std::string tempFileName = "";
 	{
-		tempFileName = tempPath + StringUtil::getFileSeparator() + sFileName;
+		const bool outputUSDZ = (m_exportParam.exportUSDZ || m_exportParam.exportAppleUSDZ);
+		const std::string dstFileName = StringUtil::getFileDir(m_orgFilePath) + StringUtil::getFileSeparator() + sFileName;
+		if (!changedName && StringUtil::checkASCII(dstFileName) && (!outputUSDZ || m_exportParam.exportOutputTempFiles)) {
+			tempFileName = dstFileName;
+		} else {
+			tempFileName = tempPath + StringUtil::getFileSeparator() + sFileName;
+		}
 	}
 
 	// USDのファイルの種類により拡張子を変える.
@@ -286,6 +318,7 @@ void CUSDExporterInterface::clean_up (void *)
 	}
 
 	// USDファイルを出力.
+	// 出力先に直接出力する場合、出力先のファイルは一時ファイルとの置き換えが成功するまで変更しない.
 	m_sceneData.exportUSD(shade, filePath2);
 
 	// USDZファイルを出力.
@@ -302,15 +335,15 @@ void CUSDExporterInterface::clean_up (void *)
 		}
 		usdzFilePath = usdzFilePath + std::string(".usdz");
 
+		// 出力先のパスがASCIIの場合は、作業用ディレクトリを経由せずに直接usdzを出力.
+		{
+			const std::string dstUSDZFilePath = StringUtil::getFileDir(m_orgFilePath) + StringUtil::getFileSeparator() + StringUtil::getFileName(usdzFilePath);
+			if (!changedName && StringUtil::checkASCII(dstUSDZFilePath)) usdzFilePath = dstUSDZFilePath;
+		}
+
 		m_sceneData.exportUSDZ(usdzFilePath);		// usdzファイルとして出力.
 	}
 
-	// Macでの対策.
-	// Macでは、既存のファイルが存在すると上書きされない.
-	try {
-		shade.delete_file(m_orgFilePath.c_str());
-	} catch (...) { }
-
 	// 作業用ディレクトリから、m_orgFilePathのフォルダにコピー.
 	{
 		const std::string dstDir = StringUtil::getFileDir(m_orgFilePath);
@@ -319,7 +352,16 @@ void CUSDExporterInterface::clean_up (void *)
 			const std::string srcPathName = filesList[i];
 			const std::string srcName = StringUtil::getFileName(srcPathName);
 			const std::string dstPathName = dstDir + StringUtil::getFileSeparator() + srcName;
+			if (srcPathName == dstPathName) continue;		// 出力先に直接出力済み.
 			if (StringUtil::getFileExtension(srcName) == "usdz" || (usdzFilePath == "" || m_exportParam.exportOutputTempFiles)) {
+				// Macでの対策.
+				// Macでは、既存のファイルが存在すると上書きされない.
+				// 作業用ディレクトリに出力できた場合のみ、コピーの直前に出力先を削除する.
+				if (dstPathName == m_orgFilePath && FileUtil::existFile(srcPathName)) {
+					try {
+						shade.delete_file(m_orgFilePath.c_str());
+					} catch (...) { }
+				}
 				try {
 					shade.copy_file(srcPathName.c_str(), dstPathName.c_str());
 				} catch (...) { }
@@ -350,6 +392,18 @@ void CUSDExporterInterface::clean_up (void *)
 		shade.message(std::string("Export : ") + usdzFilePath);
 	}
 
+	// テクスチャごとの出力サイズ/エンコード時間を表示.
+	if (m_exportParam.texEncodeReport) {
+		const std::vector<std::string>& reportList = m_sceneData.getTexturesReport();
+		for (size_t i = 0; i < reportList.size(); ++i) {
+			shade.message(std::string("Texture : ") + reportList[i]);
+		}
+
+		char szStr[256];
+		snprintf(szStr, sizeof(szStr), "%d materials, %.1f ms", (int)m_sceneData.materialsList.size(), m_sceneData.getMaterialsExportTime());
+		shade.message(std::string("Material : ") + std::string(szStr));
+	}
+
 	// 元のシーケンスモードに戻す.
 	if (m_exportParam.optOutputBoneSkin) {
 		if (m_oldSequenceMode) {
@@ -859,6 +913,18 @@ void CUSDExporterInterface::end_polymesh (void *)
 			}
 		}
 
+		// ベイクできないイメージ以外のパターンのマッピングレイヤがある場合は、警告を出す.
+		{
+			bool proceduralF = false;
+			sxsdk::shape_class* pS = Shade3DUtil::getHasSurfaceParentShape(m_pCurrentShape);
+			if (pS && pS->has_surface()) proceduralF = Shade3DUtil::hasUnsupportedPatternMappingLayer(pS->get_surface());
+			for (size_t i = 0; i < m_sceneData.tmpMeshData.faceGroupMasterSurfaces.size() && !proceduralF; ++i) {
+				sxsdk::master_surface_class* pMasterSurface = m_sceneData.tmpMeshData.faceGroupMasterSurfaces[i];
+				if (pMasterSurface) proceduralF = Shade3DUtil::hasUnsupportedPatternMappingLayer(pMasterSurface->get_surface());
+			}
+			if (proceduralF) m_warningCheck.appendProceduralPatternUsedShape(m_pCurrentShape);
+		}
+
 		m_sceneData.appendNodeMesh(m_pCurrentShape, m_currentPathName, m, m_sceneData.tmpMeshData);
 	}
 
@@ -953,6 +1019,18 @@ void CUSDExporterInterface::load_dialog_data (sxsdk::dialog_interface &d,void *)
 		item->set_bool(m_exportParam.exportOutputTempFiles);
 		item->set_enabled(m_exportParam.exportAppleUSDZ || m_exportParam.exportUSDZ);
 	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_file_export_incremental));
+		item->set_bool(m_exportParam.exportIncremental);
+		item->set_enabled(!(m_exportParam.exportAppleUSDZ || m_exportParam.exportUSDZ) || m_exportParam.exportOutputTempFiles);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_file_export_split_layers));
+		item->set_bool(m_exportParam.exportSplitLayers);
+		item->set_enabled(!m_exportParam.exportAppleUSDZ);
+	}
 
 	{
 		sxsdk::dialog_item_class* item;
@@ -964,6 +1042,12 @@ void CUSDExporterInterface::load_dialog_data (sxsdk::dialog_interface &d,void *)
 		item = &(d.get_dialog_item(dlg_option_max_texture_size));
 		item->set_selection((int)m_exportParam.optMaxTextureSize);
 	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_texel_density));
+		item->set_int(m_exportParam.texTexelDensity);
+		item->set_enabled(m_exportParam.optMaxTextureSize == USD_DATA::EXPORT::MAX_TEXTURE_SIZE::texture_size_auto);
+	}
 	{
 		sxsdk::dialog_item_class* item;
 		item = &(d.get_dialog_item(dlg_option_bone_skin));
@@ -1007,6 +1091,64 @@ void CUSDExporterInterface::load_dialog_data (sxsdk::dialog_interface &d,void *)
 		item = &(d.get_dialog_item(dlg_option_bake_without_processing_textures_id));
 		item->set_bool(m_exportParam.bakeWithoutProcessingTextures);
 	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_texture_pack_orm));
+		item->set_bool(m_exportParam.texOptPackORM);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_texture_pack_atlas));
+		item->set_bool(m_exportParam.texPackAtlas);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_texture_atlas_max_size));
+		item->set_int(m_exportParam.texAtlasMaxSize);
+		item->set_enabled(m_exportParam.texPackAtlas);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_texture_copy_source));
+		item->set_bool(m_exportParam.texCopySourceImages);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_texture_bake_ao));
+		item->set_bool(m_exportParam.texBakeAO);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_texture_bake_ao_size));
+		item->set_int(m_exportParam.texBakeAOSize);
+		item->set_enabled(m_exportParam.texBakeAO);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_png_compression_level));
+		item->set_int(m_exportParam.texPNGCompressionLevel);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_png_filter_type));
+		item->set_selection((int)m_exportParam.texPNGFilterType);
+		item->set_enabled(!m_exportParam.texPNGOptimize);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_png_optimize));
+		item->set_bool(m_exportParam.texPNGOptimize);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_jpeg_quality));
+		item->set_int(m_exportParam.texJPEGQuality);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_option_texture_encode_report));
+		item->set_bool(m_exportParam.texEncodeReport);
+	}
 	{
 		sxsdk::dialog_item_class* item;
 		item = &(d.get_dialog_item(dlg_option_anim_keyframe_mode));
@@ -1037,6 +1179,17 @@ void CUSDExporterInterface::load_dialog_data (sxsdk::dialog_interface &d,void *)
 		item->set_selection((int)m_exportParam.grayscaleTexturesColorSpace);
 		item->set_enabled(!m_exportParam.exportAppleUSDZ && m_exportParam.materialShaderType != USD_DATA::EXPORT::MATERIAL_SHADER_TYPE::material_shader_type_UsdPreviewSurface);
 	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_merge_same_materials));
+		item->set_bool(m_exportParam.mergeSameMaterials);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_material_output_preview_surface));
+		item->set_bool(m_exportParam.materialOutputPreviewSurface);
+		item->set_enabled(!m_exportParam.exportAppleUSDZ && m_exportParam.materialShaderType != USD_DATA::EXPORT::MATERIAL_SHADER_TYPE::material_shader_type_UsdPreviewSurface);
+	}
 
 }
 
@@ -1066,6 +1219,15 @@ bool CUSDExporterInterface::respond (sxsdk::dialog_interface &dialog, sxsdk::dia
 
 	if (id == dlg_file_export_output_temp_files) {
 		m_exportParam.exportOutputTempFiles = item.get_bool();
+		load_dialog_data(dialog);		// UIのディム状態を更新.
+		return true;
+	}
+	if (id == dlg_file_export_incremental) {
+		m_exportParam.exportIncremental = item.get_bool();
+		return true;
+	}
+	if (id == dlg_file_export_split_layers) {
+		m_exportParam.exportSplitLayers = item.get_bool();
 		return true;
 	}
 
@@ -1084,6 +1246,36 @@ bool CUSDExporterInterface::respond (sxsdk::dialog_interface &dialog, sxsdk::dia
 	}
 	if (id == dlg_option_max_texture_size) {
 		m_exportParam.optMaxTextureSize = (USD_DATA::EXPORT::MAX_TEXTURE_SIZE)item.get_selection();
+		load_dialog_data(dialog);		// UIのディム状態を更新.
+		return true;
+	}
+	if (id == dlg_option_texel_density) {
+		m_exportParam.texTexelDensity = std::max(1, item.get_int());
+		load_dialog_data(dialog);
+		return true;
+	}
+	if (id == dlg_option_texture_pack_atlas) {
+		m_exportParam.texPackAtlas = item.get_bool();
+		load_dialog_data(dialog);		// UIのディム状態を更新.
+		return true;
+	}
+	if (id == dlg_option_texture_atlas_max_size) {
+		m_exportParam.texAtlasMaxSize = std::max(1, item.get_int());
+		load_dialog_data(dialog);
+		return true;
+	}
+	if (id == dlg_option_texture_copy_source) {
+		m_exportParam.texCopySourceImages = item.get_bool();
+		return true;
+	}
+	if (id == dlg_option_texture_bake_ao) {
+		m_exportParam.texBakeAO = item.get_bool();
+		load_dialog_data(dialog);		// UIのディム状態を更新.
+		return true;
+	}
+	if (id == dlg_option_texture_bake_ao_size) {
+		m_exportParam.texBakeAOSize = std::max(1, std::min(8192, item.get_int()));
+		load_dialog_data(dialog);
 		return true;
 	}
 	if (id == dlg_option_bone_skin) {
@@ -1118,6 +1310,32 @@ bool CUSDExporterInterface::respond (sxsdk::dialog_interface &dialog, sxsdk::dia
 	if (id == dlg_option_bake_without_processing_textures_id) {
 		m_exportParam.bakeWithoutProcessingTextures = item.get_bool();
 	}
+	if (id == dlg_option_texture_pack_orm) {
+		m_exportParam.texOptPackORM = item.get_bool();
+	}
+	if (id == dlg_option_png_compression_level) {
+		m_exportParam.texPNGCompressionLevel = std::max(0, std::min(9, item.get_int()));
+		load_dialog_data(dialog);
+		return true;
+	}
+	if (id == dlg_option_png_filter_type) {
+		m_exportParam.texPNGFilterType = (USD_DATA::EXPORT::PNG_FILTER_TYPE)item.get_selection();
+		return true;
+	}
+	if (id == dlg_option_png_optimize) {
+		m_exportParam.texPNGOptimize = item.get_bool();
+		load_dialog_data(dialog);		// UIのディム状態を更新.
+		return true;
+	}
+	if (id == dlg_option_jpeg_quality) {
+		m_exportParam.texJPEGQuality = std::max(1, std::min(100, item.get_int()));
+		load_dialog_data(dialog);
+		return true;
+	}
+	if (id == dlg_option_texture_encode_report) {
+		m_exportParam.texEncodeReport = item.get_bool();
+		return true;
+	}
 	if (id == dlg_option_anim_keyframe_mode) {
 		m_exportParam.animKeyframeMode = (USD_DATA::EXPORT::ANIM_KEYFRAME_MODE)item.get_selection();
 		load_dialog_data(dialog);		// UIのディム状態を更新.
@@ -1142,6 +1360,14 @@ bool CUSDExporterInterface::respond (sxsdk::dialog_interface &dialog, sxsdk::dia
 		m_exportParam.grayscaleTexturesColorSpace = (USD_DATA::EXPORT::TEXTURE_COLOR_SPACE)item.get_selection();
 		return true;
 	}
+	if (id == dlg_merge_same_materials) {
+		m_exportParam.mergeSameMaterials = item.get_bool();
+		return true;
+	}
+	if (id == dlg_material_output_preview_surface) {
+		m_exportParam.materialOutputPreviewSurface = item.get_bool();
+		return true;
+	}
 
 	return false;
 }
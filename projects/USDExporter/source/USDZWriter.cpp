@@ -0,0 +1,443 @@
+﻿/**
+ * USDZ(zip)ファイルの出力.
+ * 参考 : https://openusd.org/release/spec_usdz.html , https://pkware.cachefly.net/webdocs/casestudies/APPNOTE.TXT
+ */
+#include "USDZWriter.h"
+#include "HashUtil.h"
+
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+// データ開始位置のアラインメント.
+#define USDZ_DATA_ALIGNMENT  64
+
+// 一度に読み込むバイト数.
+#define USDZ_FILE_READ_BLOCK_SIZE  (1024 * 1024)
+
+// addFilesで、CRC32を並列計算する場合の1タスクあたりのバイト数.
+#define USDZ_CRC_CHUNK_SIZE  (16 * 1024 * 1024)
+
+// addFilesで、一度に書き込むバイト数.
+#define USDZ_FILE_WRITE_BLOCK_SIZE  (8 * 1024 * 1024)
+
+namespace {
+	/**
+	 * リトルエンディアンでバッファに追加.
+	 */
+	void m_writeU16 (std::vector<unsigned char>& buff, const unsigned int v) {
+		for (int i = 0; i < 2; ++i) buff.push_back((unsigned char)((v >> (i * 8)) & 0xff));
+	}
+	void m_writeU32 (std::vector<unsigned char>& buff, const unsigned int v) {
+		for (int i = 0; i < 4; ++i) buff.push_back((unsigned char)((v >> (i * 8)) & 0xff));
+	}
+	void m_writeU32 (unsigned char* buff, const unsigned int v) {
+		for (int i = 0; i < 4; ++i) buff[i] = (unsigned char)((v >> (i * 8)) & 0xff);
+	}
+
+	// 更新日時 (MS-DOS形式。1980/01/01 00:00:00で固定).
+	const unsigned int DOS_TIME = 0;
+	const unsigned int DOS_DATE = (1 << 5) | 1;
+
+	/**
+	 * ファイルサイズを取得.
+	 * @return 読み込めない場合は-1.
+	 */
+	long long m_getFileSize (const std::string& filePath) {
+		std::ifstream inStream(filePath.c_str(), std::ios::in | std::ios::binary);
+		if (!inStream) return -1;
+		inStream.seekg(0, std::ios::end);
+		return (long long)inStream.tellg();
+	}
+
+	/**
+	 * ファイルの一部のCRC32を計算.
+	 */
+	bool m_calcFileCRC32 (const std::string& filePath, const unsigned long long offset, const unsigned long long size, unsigned int& crc32) {
+		crc32 = 0;
+		std::ifstream inStream(filePath.c_str(), std::ios::in | std::ios::binary);
+		if (!inStream) return false;
+		inStream.seekg((std::streamoff)offset, std::ios::beg);
+
+		std::vector<unsigned char> buff((size_t)std::min((unsigned long long)USDZ_FILE_READ_BLOCK_SIZE, size));
+		unsigned long long remainSize = size;
+		while (remainSize > 0) {
+			const size_t readSize = (size_t)std::min((unsigned long long)buff.size(), remainSize);
+			inStream.read((char *)&(buff[0]), (std::streamsize)readSize);
+			if ((size_t)inStream.gcount() != readSize) return false;
+			crc32 = HashUtil::calcCRC32(&(buff[0]), readSize, crc32);
+			remainSize -= readSize;
+		}
+		return true;
+	}
+
+	/**
+	 * CRC32の計算タスク (ファイルの一部分).
+	 */
+	class CCRCTaskData
+	{
+	public:
+		int fileIndex;					// ファイル番号.
+		unsigned long long offset;		// 開始位置.
+		unsigned long long size;		// バイト数.
+		unsigned int crc32;				// 計算結果.
+		bool result;					// 読み込めた場合はtrue.
+	};
+}
+
+CUSDZWriter::CUSDZWriter ()
+{
+	m_offset = 0;
+	m_failed = false;
+}
+
+CUSDZWriter::~CUSDZWriter ()
+{
+	if (isOpen()) close();
+}
+
+/**
+ * usdzファイルを作成.
+ * @param[in] filePath  出力ファイルパス.
+ */
+bool CUSDZWriter::open (const std::string& filePath)
+{
+	if (isOpen()) close();
+
+	m_offset = 0;
+	m_failed = false;
+	m_entries.clear();
+
+	m_stream.open(filePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	return isOpen();
+}
+
+/**
+ * ローカルファイルヘッダを出力.
+ * データの開始位置が64バイト境界になるように、extra fieldでパディングする.
+ * @return ローカルファイルヘッダの位置.
+ */
+unsigned long long CUSDZWriter::m_writeLocalFileHeader (const std::string& name, const unsigned int crc32, const unsigned int size)
+{
+	const unsigned long long headerOffset = m_offset;
+
+	size_t extraSize = 0;
+	{
+		const size_t rem = (size_t)((headerOffset + 30 + name.length()) % USDZ_DATA_ALIGNMENT);
+		if (rem != 0) {
+			extraSize = USDZ_DATA_ALIGNMENT - rem;
+			if (extraSize < 4) extraSize += USDZ_DATA_ALIGNMENT;		// extra fieldのヘッダ分 (4バイト) が必要.
+		}
+	}
+
+	std::vector<unsigned char> buff;
+	m_writeU32(buff, 0x04034b50);			// local file header signature.
+	m_writeU16(buff, 20);					// version needed to extract.
+	m_writeU16(buff, 0);					// general purpose bit flag.
+	m_writeU16(buff, 0);					// compression method (stored).
+	m_writeU16(buff, DOS_TIME);
+	m_writeU16(buff, DOS_DATE);
+	m_writeU32(buff, crc32);
+	m_writeU32(buff, size);					// compressed size.
+	m_writeU32(buff, size);					// uncompressed size.
+	m_writeU16(buff, (unsigned int)name.length());
+	m_writeU16(buff, (unsigned int)extraSize);
+	buff.insert(buff.end(), name.begin(), name.end());
+	if (extraSize > 0) {
+		m_writeU16(buff, 0x1986);				// パディング用のextra field (USDの実装と同じID).
+		m_writeU16(buff, (unsigned int)(extraSize - 4));
+		buff.resize(buff.size() + (extraSize - 4), 0);
+	}
+
+	m_stream.write((const char *)&(buff[0]), buff.size());
+	m_offset += buff.size();
+	return headerOffset;
+}
+
+/**
+ * メモリ上のデータをファイルとして追加.
+ * @param[in] name  zip内でのファイル名.
+ * @param[in] data  データ.
+ * @param[in] size  データのバイト数.
+ */
+bool CUSDZWriter::addBuffer (const std::string& name, const unsigned char* data, const size_t size)
+{
+	if (!isOpen() || m_failed || name == "") return false;
+	if ((unsigned long long)size > 0xffffffffULL || m_offset > 0xffffffffULL) {
+		m_failed = true;
+		return false;
+	}
+
+	try {
+		CEntryData entry;
+		entry.name   = name;
+		entry.crc32  = (size > 0) ? HashUtil::calcCRC32(data, size) : 0;
+		entry.size   = (unsigned int)size;
+		entry.offset = (unsigned int)m_writeLocalFileHeader(entry.name, entry.crc32, entry.size);
+
+		if (size > 0) m_stream.write((const char *)data, (std::streamsize)size);
+		m_offset += size;
+		if (m_stream.fail()) {
+			m_failed = true;
+			return false;
+		}
+		m_entries.push_back(entry);
+		return true;
+
+	} catch (...) { }
+	m_failed = true;
+	return false;
+}
+
+/**
+ * ファイルを追加.
+ * ローカルファイルヘッダのCRC32は、データの書き込み後に上書きする (ファイルの読み込みは1回のみ).
+ * @param[in] srcFilePath  追加するファイルの絶対パス.
+ * @param[in] name         zip内でのファイル名.
+ */
+bool CUSDZWriter::addFile (const std::string& srcFilePath, const std::string& name)
+{
+	if (!isOpen() || m_failed || name == "") return false;
+
+	try {
+		std::ifstream inStream(srcFilePath.c_str(), std::ios::in | std::ios::binary);
+		if (!inStream) return false;
+		inStream.seekg(0, std::ios::end);
+		const unsigned long long fileSize = (unsigned long long)inStream.tellg();
+		inStream.seekg(0, std::ios::beg);
+		if (fileSize > 0xffffffffULL || m_offset > 0xffffffffULL) {
+			m_failed = true;
+			return false;
+		}
+
+		CEntryData entry;
+		entry.name   = name;
+		entry.crc32  = 0;
+		entry.size   = (unsigned int)fileSize;
+		entry.offset = (unsigned int)m_writeLocalFileHeader(entry.name, entry.crc32, entry.size);
+
+		std::vector<unsigned char> buff(USDZ_FILE_READ_BLOCK_SIZE);
+		unsigned long long remainSize = fileSize;
+		while (remainSize > 0) {
+			const size_t readSize = (size_t)std::min((unsigned long long)buff.size(), remainSize);
+			inStream.read((char *)&(buff[0]), (std::streamsize)readSize);
+			if ((size_t)inStream.gcount() != readSize) {
+				m_failed = true;
+				return false;
+			}
+			entry.crc32 = HashUtil::calcCRC32(&(buff[0]), readSize, entry.crc32);
+			m_stream.write((const char *)&(buff[0]), (std::streamsize)readSize);
+			remainSize -= readSize;
+		}
+		m_offset += fileSize;
+
+		// CRC32を上書き.
+		{
+			unsigned char crcBuff[4];
+			m_writeU32(crcBuff, entry.crc32);
+			m_stream.seekp((std::streamoff)(entry.offset + 14), std::ios::beg);
+			m_stream.write((const char *)crcBuff, 4);
+			m_stream.seekp(0, std::ios::end);
+		}
+		if (m_stream.fail()) {
+			m_failed = true;
+			return false;
+		}
+		m_entries.push_back(entry);
+		return true;
+
+	} catch (...) { }
+	m_failed = true;
+	return false;
+}
+
+/**
+ * 複数のファイルをまとめて追加.
+ * CRC32は複数スレッドで先に計算し、ローカルファイルヘッダを確定させてから順に書き込む.
+ * @param[in] srcFilePaths  追加するファイルの絶対パス.
+ * @param[in] names         zip内でのファイル名.
+ * @param[in] threadsCount  スレッド数。0の場合は自動.
+ * @return 読み込めないファイルがあった場合はfalse (それ以外は格納される).
+ */
+bool CUSDZWriter::addFiles (const std::vector<std::string>& srcFilePaths, const std::vector<std::string>& names, const int threadsCount)
+{
+	if (!isOpen() || m_failed || srcFilePaths.size() != names.size()) return false;
+	const int filesCount = (int)srcFilePaths.size();
+	if (filesCount == 0) return true;
+
+	try {
+		// ファイルサイズを取得.
+		std::vector<long long> fileSizes(filesCount);
+		for (int i = 0; i < filesCount; ++i) {
+			fileSizes[i] = (names[i] != "") ? m_getFileSize(srcFilePaths[i]) : -1;
+			if (fileSizes[i] > (long long)0xffffffffLL) {
+				m_failed = true;
+				return false;
+			}
+		}
+
+		// ファイルを一定サイズごとに分割して、CRC32の計算タスクを作成.
+		std::vector<CCRCTaskData> tasks;
+		for (int i = 0; i < filesCount; ++i) {
+			if (fileSizes[i] < 0) continue;
+			unsigned long long offset = 0;
+			do {
+				CCRCTaskData task;
+				task.fileIndex = i;
+				task.offset    = offset;
+				task.size      = std::min((unsigned long long)USDZ_CRC_CHUNK_SIZE, (unsigned long long)fileSizes[i] - offset);
+				task.crc32     = 0;
+				task.result    = false;
+				tasks.push_back(task);
+				offset += task.size;
+			} while (offset < (unsigned long long)fileSizes[i]);
+		}
+
+		// 複数スレッドでCRC32を計算.
+		{
+			int tCount = (threadsCount > 0) ? threadsCount : (int)std::thread::hardware_concurrency();
+			tCount = std::max(1, std::min(tCount, (int)tasks.size()));
+
+			std::atomic<int> taskIndex(0);
+			auto func = [&]() {
+				while (true) {
+					const int index = taskIndex++;
+					if (index >= (int)tasks.size()) break;
+					CCRCTaskData& task = tasks[index];
+					task.result = m_calcFileCRC32(srcFilePaths[task.fileIndex], task.offset, task.size, task.crc32);
+				}
+			};
+
+			std::vector<std::thread> threads;
+			for (int i = 1; i < tCount; ++i) {
+				try {
+					threads.push_back(std::thread(func));
+				} catch (...) {
+					break;
+				}
+			}
+			func();
+			for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+		}
+
+		// ファイルごとにCRC32を結合.
+		std::vector<unsigned int> fileCRCs(filesCount, 0);
+		for (size_t i = 0; i < tasks.size(); ++i) {
+			const CCRCTaskData& task = tasks[i];
+			if (!task.result) {
+				fileSizes[task.fileIndex] = -1;
+				continue;
+			}
+			fileCRCs[task.fileIndex] = HashUtil::combineCRC32(fileCRCs[task.fileIndex], task.crc32, task.size);
+		}
+
+		// ローカルファイルヘッダとデータを順に書き込む.
+		bool retF = true;
+		std::vector<unsigned char> buff;
+		for (int i = 0; i < filesCount; ++i) {
+			if (fileSizes[i] < 0) {
+				retF = false;
+				continue;
+			}
+			if (m_offset > 0xffffffffULL) {
+				m_failed = true;
+				return false;
+			}
+			std::ifstream inStream(srcFilePaths[i].c_str(), std::ios::in | std::ios::binary);
+			if (!inStream) {
+				retF = false;
+				continue;
+			}
+
+			CEntryData entry;
+			entry.name   = names[i];
+			entry.crc32  = fileCRCs[i];
+			entry.size   = (unsigned int)fileSizes[i];
+			entry.offset = (unsigned int)m_writeLocalFileHeader(entry.name, entry.crc32, entry.size);
+
+			if (buff.empty() && entry.size > 0) buff.resize(USDZ_FILE_WRITE_BLOCK_SIZE);
+			unsigned long long remainSize = entry.size;
+			while (remainSize > 0) {
+				const size_t readSize = (size_t)std::min((unsigned long long)buff.size(), remainSize);
+				inStream.read((char *)&(buff[0]), (std::streamsize)readSize);
+				if ((size_t)inStream.gcount() != readSize) {
+					// CRC32の計算後にファイルが変更された場合.
+					m_failed = true;
+					return false;
+				}
+				m_stream.write((const char *)&(buff[0]), (std::streamsize)readSize);
+				remainSize -= readSize;
+			}
+			m_offset += entry.size;
+			if (m_stream.fail()) {
+				m_failed = true;
+				return false;
+			}
+			m_entries.push_back(entry);
+		}
+		return retF;
+
+	} catch (...) { }
+	m_failed = true;
+	return false;
+}
+
+/**
+ * usdzファイルを閉じる (Central directoryを出力).
+ */
+bool CUSDZWriter::close ()
+{
+	if (!isOpen()) return false;
+
+	try {
+		if (!m_failed) {
+			const unsigned long long centralDirOffset = m_offset;
+			std::vector<unsigned char> buff;
+			for (size_t i = 0; i < m_entries.size(); ++i) {
+				const CEntryData& entry = m_entries[i];
+				m_writeU32(buff, 0x02014b50);		// central file header signature.
+				m_writeU16(buff, 20);				// version made by.
+				m_writeU16(buff, 20);				// version needed to extract.
+				m_writeU16(buff, 0);				// general purpose bit flag.
+				m_writeU16(buff, 0);				// compression method (stored).
+				m_writeU16(buff, DOS_TIME);
+				m_writeU16(buff, DOS_DATE);
+				m_writeU32(buff, entry.crc32);
+				m_writeU32(buff, entry.size);
+				m_writeU32(buff, entry.size);
+				m_writeU16(buff, (unsigned int)entry.name.length());
+				m_writeU16(buff, 0);				// extra field length.
+				m_writeU16(buff, 0);				// file comment length.
+				m_writeU16(buff, 0);				// disk number start.
+				m_writeU16(buff, 0);				// internal file attributes.
+				m_writeU32(buff, 0);				// external file attributes.
+				m_writeU32(buff, entry.offset);
+				buff.insert(buff.end(), entry.name.begin(), entry.name.end());
+			}
+			const size_t centralDirSize = buff.size();
+
+			m_writeU32(buff, 0x06054b50);			// end of central dir signature.
+			m_writeU16(buff, 0);					// number of this disk.
+			m_writeU16(buff, 0);					// number of the disk with the start of the central directory.
+			m_writeU16(buff, (unsigned int)m_entries.size());
+			m_writeU16(buff, (unsigned int)m_entries.size());
+			m_writeU32(buff, (unsigned int)centralDirSize);
+			m_writeU32(buff, (unsigned int)centralDirOffset);
+			m_writeU16(buff, 0);					// .ZIP file comment length.
+
+			if (m_entries.size() > 0xffff || centralDirOffset > 0xffffffffULL) {
+				m_failed = true;
+			} else {
+				m_stream.write((const char *)&(buff[0]), buff.size());
+				m_offset += buff.size();
+			}
+		}
+		m_stream.close();
+		if (m_stream.fail()) m_failed = true;
+
+	} catch (...) {
+		m_failed = true;
+	}
+	m_entries.clear();
+	return !m_failed;
+}
@@ -0,0 +1,85 @@
+﻿/**
+ * USDZ(zip)ファイルの出力.
+ * 無圧縮で、各ファイルのデータ開始位置を64バイト境界に揃えて格納する.
+ * ファイルを経由せずに、メモリ上のデータをそのまま追加することもできる.
+ */
+
+#ifndef _USDZWRITER_H
+#define _USDZWRITER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+class CUSDZWriter
+{
+private:
+	/**
+	 * 格納したファイルの情報 (Central directory用).
+	 */
+	class CEntryData
+	{
+	public:
+		std::string name;				// zip内でのファイル名.
+		unsigned int crc32;				// CRC32.
+		unsigned int size;				// ファイルサイズ.
+		unsigned int offset;			// ローカルファイルヘッダの位置.
+	};
+
+	std::ofstream m_stream;
+	unsigned long long m_offset;				// 現在の書き込み位置.
+	std::vector<CEntryData> m_entries;			// 格納したファイル.
+	bool m_failed;								// 書き込みに失敗した場合はtrue.
+
+private:
+	/**
+	 * ローカルファイルヘッダを出力.
+	 * データの開始位置が64バイト境界になるように、extra fieldでパディングする.
+	 * @return ローカルファイルヘッダの位置.
+	 */
+	unsigned long long m_writeLocalFileHeader (const std::string& name, const unsigned int crc32, const unsigned int size);
+
+public:
+	CUSDZWriter ();
+	~CUSDZWriter ();
+
+	/**
+	 * usdzファイルを作成.
+	 * @param[in] filePath  出力ファイルパス.
+	 */
+	bool open (const std::string& filePath);
+
+	/**
+	 * usdzファイルを閉じる (Central directoryを出力).
+	 */
+	bool close ();
+
+	bool isOpen () const { return m_stream.is_open(); }
+
+	/**
+	 * メモリ上のデータをファイルとして追加.
+	 * @param[in] name  zip内でのファイル名.
+	 * @param[in] data  データ.
+	 * @param[in] size  データのバイト数.
+	 */
+	bool addBuffer (const std::string& name, const unsigned char* data, const size_t size);
+
+	/**
+	 * ファイルを追加.
+	 * @param[in] srcFilePath  追加するファイルの絶対パス.
+	 * @param[in] name         zip内でのファイル名.
+	 */
+	bool addFile (const std::string& srcFilePath, const std::string& name);
+
+	/**
+	 * 複数のファイルをまとめて追加.
+	 * CRC32は複数スレッドで先に計算し、ローカルファイルヘッダを確定させてから順に書き込む.
+	 * @param[in] srcFilePaths  追加するファイルの絶対パス.
+	 * @param[in] names         zip内でのファイル名.
+	 * @param[in] threadsCount  スレッド数。0の場合は自動.
+	 * @return 読み込めないファイルがあった場合はfalse (それ以外は格納される).
+	 */
+	bool addFiles (const std::vector<std::string>& srcFilePaths, const std::vector<std::string>& names, const int threadsCount = 0);
+};
+
+#endif
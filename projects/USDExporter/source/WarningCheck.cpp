@@ -19,6 +19,7 @@ void CWarningCheck::clear ()
 	m_shearUsedNameList.clear();
 	m_classicSkinUsedNameList.clear();
 	m_unsupportedJointUsedNameList.clear();
+	m_proceduralPatternUsedNameList.clear();
 }
 
 /**
@@ -75,6 +76,24 @@ void CWarningCheck::appendUnsupportedJointUsedShape (sxsdk::shape_class* shape)
 	m_unsupportedJointUsedNameList.push_back(name);
 }
 
+/**
+ * イメージ以外のパターンのマッピングレイヤを使っている形状を追加.
+ */
+void CWarningCheck::appendProceduralPatternUsedShape (sxsdk::shape_class* shape)
+{
+	const std::string name = shape->get_name();
+
+	int index = -1;
+	for (size_t i = 0; i < m_proceduralPatternUsedNameList.size(); ++i) {
+		if (name == m_proceduralPatternUsedNameList[i]) {
+			index = (int)i;
+			break;
+		}
+	}
+	if (index >= 0) return;
+	m_proceduralPatternUsedNameList.push_back(name);
+}
+
 /**
  * 警告メッセージを出力.
  */
@@ -121,5 +140,19 @@ void CWarningCheck::outputWarningMessage (sxsdk::shade_interface& shade)
 
 		shade.message("");
 	}
+
+	if (!m_proceduralPatternUsedNameList.empty()) {
+		std::string msgStr = shade.gettext("export_msg_used_procedural_pattern");
+		shade.message(msgStr);
+
+		msgStr = "  ";
+		for (size_t i = 0; i < m_proceduralPatternUsedNameList.size(); ++i) {
+			if (i != 0) msgStr += ",";
+			msgStr += m_proceduralPatternUsedNameList[i];
+		}
+		shade.message(msgStr);
+
+		shade.message("");
+	}
 }
 
@@ -15,6 +15,7 @@ private:
 	std::vector<std::string> m_shearUsedNameList;					// せん断を使っている形状名のリスト.
 	std::vector<std::string> m_classicSkinUsedNameList;				// クラシックスキンを使っている形状名のリスト.
 	std::vector<std::string> m_unsupportedJointUsedNameList;		// 未サポートのジョイントを使っている形状名のリスト.
+	std::vector<std::string> m_proceduralPatternUsedNameList;		// イメージ以外のパターンのマッピングレイヤを使っている形状名のリスト.
 
 public:
 	CWarningCheck ();
@@ -37,6 +38,10 @@ public:
 	 */
 	void appendUnsupportedJointUsedShape (sxsdk::shape_class* shape);
 
+	/**
+	 * イメージ以外のパターンのマッピングレイヤを使っている形状を追加.
+	 */
+	void appendProceduralPatternUsedShape (sxsdk::shape_class* shape);
 
 	/**
 	 * 警告メッセージを出力.
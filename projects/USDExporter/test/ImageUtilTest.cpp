@@ -0,0 +1,277 @@
+﻿/**
+ * ImageUtilのリサイズ処理(フィルタカーネル、端の処理)のテスト.
+ * Shade3D SDKやUSDに依存しないため、単体でビルドして実行できる.
+ *
+ * g++ -std=gnu++14 -O2 -Wall -I../source ImageUtilTest.cpp ../source/ImageUtil.cpp -lpthread -o ImageUtilTest
+ * ./ImageUtilTest
+ */
+#include "ImageUtil.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+namespace {
+	int g_failedCount = 0;
+
+	const ImageUtil::RESIZE_FILTER g_filtersList[] = {
+		ImageUtil::resize_filter_box,
+		ImageUtil::resize_filter_bilinear,
+		ImageUtil::resize_filter_bicubic,
+		ImageUtil::resize_filter_lanczos3,
+	};
+	const char* g_filterNamesList[] = { "box", "bilinear", "bicubic", "lanczos3" };
+
+	void m_check (const bool ret, const char* testName, const char* filterName, const int v1, const int v2) {
+		if (ret) return;
+		std::printf("FAILED : %s (%s, %d x %d)\n", testName, filterName, v1, v2);
+		g_failedCount++;
+	}
+
+	/**
+	 * RGBA(float)のバッファを作成.
+	 * @param[in] func  (x, y, rgba)を受け取り、ピクセル値を格納する関数.
+	 */
+	template<typename F> std::vector<float> m_createRGBA (const int width, const int height, F func) {
+		std::vector<float> buff((size_t)width * (size_t)height * 4);
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				func(x, y, &(buff[((size_t)y * (size_t)width + (size_t)x) * 4]));
+			}
+		}
+		return buff;
+	}
+
+	/**
+	 * フィルタカーネルの定義 (比較用).
+	 */
+	double m_kernel (const int filterIndex, const double x) {
+		const double pi = 3.14159265358979323846;
+		const double ax = std::abs(x);
+		switch (filterIndex) {
+		case 0:
+			return (ax <= 0.5) ? 1.0 : 0.0;
+		case 1:
+			return (ax < 1.0) ? (1.0 - ax) : 0.0;
+		case 2:
+			if (ax < 1.0) return 1.5 * ax * ax * ax - 2.5 * ax * ax + 1.0;
+			if (ax < 2.0) return -0.5 * ax * ax * ax + 2.5 * ax * ax - 4.0 * ax + 2.0;
+			return 0.0;
+		case 3:
+			if (ax < 1e-8) return 1.0;
+			if (ax >= 3.0) return 0.0;
+			return (3.0 * std::sin(pi * ax) * std::sin(pi * ax / 3.0)) / (pi * pi * ax * ax);
+		}
+		return 0.0;
+	}
+
+	/**
+	 * 1ピクセルだけ値を持つラインを拡大した場合に、カーネルの形がそのまま出力されること.
+	 * 重みは参照するピクセルの合計で正規化される.
+	 */
+	void m_testKernelWeights () {
+		const int srcW = 21, scale = 4, dstW = srcW * scale;
+		const int impulseX = srcW / 2;
+		const std::vector<float> srcBuff = m_createRGBA(srcW, 1, [&](const int x, const int, float* p) {
+			p[0] = (x == impulseX) ? 1.5f : 0.5f;	p[1] = 0.0f;	p[2] = 0.0f;	p[3] = 1.0f;
+		});
+		for (int f = 0; f < 4; ++f) {
+			std::vector<float> dstBuff((size_t)dstW * 4);
+			bool chkF = ImageUtil::resizeRGBA(&(srcBuff[0]), srcW, 1, &(dstBuff[0]), dstW, 1, g_filtersList[f]);
+			for (int x = 0; x < dstW && chkF; ++x) {
+				const double center = ((double)x + 0.5) / (double)scale;
+				double sumW = 0.0;
+				for (int i = 0; i < srcW; ++i) sumW += m_kernel(f, (double)i + 0.5 - center);
+				const double v = 0.5 + m_kernel(f, (double)impulseX + 0.5 - center) / sumW;
+				if (std::abs(dstBuff[x * 4] - v) > 1e-4) chkF = false;
+			}
+			m_check(chkF, "kernel weights", g_filterNamesList[f], dstW, 1);
+		}
+	}
+
+	/**
+	 * 一定値のイメージは、拡大/縮小および端でも同じ値のままであること.
+	 * 端で範囲外を参照しない場合も、重みが正規化されていることを確認する.
+	 */
+	void m_testConstant () {
+		const int sizesList[][4] = { {16, 16, 37, 23}, {37, 23, 16, 16}, {64, 8, 5, 3}, {1, 1, 7, 9}, {7, 9, 1, 1}, {3, 5, 3, 17} };
+		for (int f = 0; f < 4; ++f) {
+			for (int i = 0; i < 6; ++i) {
+				const int srcW = sizesList[i][0], srcH = sizesList[i][1];
+				const int dstW = sizesList[i][2], dstH = sizesList[i][3];
+				const std::vector<float> srcBuff = m_createRGBA(srcW, srcH, [](const int, const int, float* p) {
+					p[0] = 0.25f;	p[1] = 0.5f;	p[2] = 0.75f;	p[3] = 1.0f;
+				});
+				std::vector<float> dstBuff((size_t)dstW * (size_t)dstH * 4);
+				const bool ret = ImageUtil::resizeRGBA(&(srcBuff[0]), srcW, srcH, &(dstBuff[0]), dstW, dstH, g_filtersList[f]);
+				bool chkF = ret;
+				for (size_t j = 0; j < dstBuff.size() && chkF; j += 4) {
+					if (std::abs(dstBuff[j + 0] - 0.25f) > 1e-5f || std::abs(dstBuff[j + 1] - 0.5f) > 1e-5f ||
+						std::abs(dstBuff[j + 2] - 0.75f) > 1e-5f || std::abs(dstBuff[j + 3] - 1.0f) > 1e-5f) chkF = false;
+				}
+				m_check(chkF, "constant", g_filterNamesList[f], dstW, dstH);
+			}
+		}
+	}
+
+	/**
+	 * 補間型のカーネル(bilinear/bicubic/lanczos3)では、3倍に拡大した時に
+	 * 元のピクセル中心と一致する位置(3k+1)は元の値がそのまま出力されること (端も含む).
+	 */
+	void m_testInterpolation () {
+		const int srcW = 11, srcH = 7;
+		const int dstW = srcW * 3, dstH = srcH * 3;
+		const std::vector<float> srcBuff = m_createRGBA(srcW, srcH, [](const int x, const int y, float* p) {
+			const float v = (float)((x * 7 + y * 13) % 17) / 16.0f;
+			p[0] = v;	p[1] = 1.0f - v;	p[2] = 0.5f;	p[3] = 1.0f;
+		});
+		for (int f = 1; f < 4; ++f) {
+			std::vector<float> dstBuff((size_t)dstW * (size_t)dstH * 4);
+			bool chkF = ImageUtil::resizeRGBA(&(srcBuff[0]), srcW, srcH, &(dstBuff[0]), dstW, dstH, g_filtersList[f]);
+			for (int y = 0; y < srcH && chkF; ++y) {
+				for (int x = 0; x < srcW && chkF; ++x) {
+					const float* pS = &(srcBuff[((size_t)y * srcW + x) * 4]);
+					const float* pD = &(dstBuff[((size_t)(y * 3 + 1) * dstW + (x * 3 + 1)) * 4]);
+					if (std::abs(pS[0] - pD[0]) > 1e-5f || std::abs(pS[1] - pD[1]) > 1e-5f) chkF = false;
+				}
+			}
+			m_check(chkF, "interpolation", g_filterNamesList[f], dstW, dstH);
+		}
+	}
+
+	/**
+	 * bilinear/bicubicは、端から離れた位置では1次関数(グラデーション)をそのまま再現すること.
+	 */
+	void m_testLinearRamp () {
+		const int srcW = 32, dstW = 80;
+		const std::vector<float> srcBuff = m_createRGBA(srcW, 1, [](const int x, const int, float* p) {
+			p[0] = ((float)x + 0.5f) / (float)srcW;	p[1] = 0.0f;	p[2] = 0.0f;	p[3] = 1.0f;
+		});
+		for (int f = 1; f < 3; ++f) {
+			std::vector<float> dstBuff((size_t)dstW * 4);
+			bool chkF = ImageUtil::resizeRGBA(&(srcBuff[0]), srcW, 1, &(dstBuff[0]), dstW, 1, g_filtersList[f]);
+			const int margin = 2 * dstW / srcW + 2;			// カーネルが端にかかる範囲は除く.
+			for (int x = margin; x < dstW - margin && chkF; ++x) {
+				const float v = ((float)x + 0.5f) / (float)dstW;
+				if (std::abs(dstBuff[x * 4] - v) > 1e-4f) chkF = false;
+			}
+			m_check(chkF, "linear ramp", g_filterNamesList[f], dstW, 1);
+		}
+	}
+
+	/**
+	 * boxで1/2に縮小した場合は、2x2ピクセルの平均になること (端も含む).
+	 */
+	void m_testBoxDownsample () {
+		const int srcW = 8, srcH = 6;
+		std::vector<unsigned char> srcBuff((size_t)srcW * srcH * 4), dstBuff;
+		for (size_t i = 0; i < srcBuff.size(); ++i) srcBuff[i] = ((i & 3) == 3) ? 255 : (unsigned char)((i * 37) & 0xfe);
+		bool chkF = ImageUtil::resizeRGBA8(srcBuff, srcW, srcH, dstBuff, srcW / 2, srcH / 2, ImageUtil::resize_filter_box);
+		for (int y = 0; y < srcH / 2 && chkF; ++y) {
+			for (int x = 0; x < srcW / 2 && chkF; ++x) {
+				for (int c = 0; c < 3; ++c) {
+					int sum = 0;
+					for (int j = 0; j < 4; ++j) sum += srcBuff[((size_t)(y * 2 + (j >> 1)) * srcW + (x * 2 + (j & 1))) * 4 + c];
+					const int v = dstBuff[((size_t)y * (srcW / 2) + x) * 4 + c];
+					if (std::abs(v - (sum + 2) / 4) > 1) chkF = false;
+				}
+			}
+		}
+		m_check(chkF, "box downsample", "box", srcW / 2, srcH / 2);
+	}
+
+	/**
+	 * アルファが0のピクセルの色は、補間結果に影響しないこと (乗算済みアルファでの補間).
+	 */
+	void m_testPremultipliedAlpha () {
+		const int srcW = 8, srcH = 8;
+		const std::vector<float> srcBuff = m_createRGBA(srcW, srcH, [](const int x, const int y, float* p) {
+			const bool transparentF = ((x + y) & 1) != 0;
+			p[0] = transparentF ? 1.0f : 0.0f;	p[1] = transparentF ? 0.0f : 1.0f;	p[2] = 0.0f;	p[3] = transparentF ? 0.0f : 1.0f;
+		});
+		for (int f = 0; f < 4; ++f) {
+			const int dstW = 13, dstH = 5;
+			std::vector<float> dstBuff((size_t)dstW * dstH * 4);
+			bool chkF = ImageUtil::resizeRGBA(&(srcBuff[0]), srcW, srcH, &(dstBuff[0]), dstW, dstH, g_filtersList[f]);
+			for (size_t i = 0; i < dstBuff.size() && chkF; i += 4) {
+				if (dstBuff[i + 3] < 1e-3f) continue;
+				if (dstBuff[i + 0] > 1e-4f || std::abs(dstBuff[i + 1] - 1.0f) > 1e-4f) chkF = false;
+				if (dstBuff[i + 3] < 0.0f || dstBuff[i + 3] > 1.0f) chkF = false;
+			}
+			m_check(chkF, "premultiplied alpha", g_filterNamesList[f], dstW, dstH);
+		}
+	}
+
+	/**
+	 * 白黒の境界でのリンギング(lanczos3/bicubic)は、8bitの範囲に収まること.
+	 */
+	void m_testClampGray8 () {
+		const int srcW = 16, srcH = 4;
+		std::vector<unsigned char> srcBuff((size_t)srcW * srcH), dstBuff;
+		for (int y = 0; y < srcH; ++y) {
+			for (int x = 0; x < srcW; ++x) srcBuff[y * srcW + x] = (x < srcW / 2) ? 0 : 255;
+		}
+		for (int f = 0; f < 4; ++f) {
+			const int dstW = 57, dstH = 4;
+			bool chkF = ImageUtil::resizeGray8(srcBuff, srcW, srcH, dstBuff, dstW, dstH, g_filtersList[f]);
+			chkF = chkF && (dstBuff.size() == (size_t)dstW * dstH);
+			if (chkF) chkF = (dstBuff[0] == 0 && dstBuff[dstW - 1] == 255);
+			for (int x = 1; x < dstW && chkF; ++x) {
+				// 境界から離れた位置では単調であること.
+				if (std::abs(x - dstW / 2) > 8 && dstBuff[x] < dstBuff[x - 1] && x > dstW / 2) chkF = false;
+			}
+			m_check(chkF, "clamp gray8", g_filterNamesList[f], dstW, dstH);
+		}
+	}
+
+	/**
+	 * 同じサイズの場合はそのままコピーされること.
+	 * サイズが不正な場合はfalseを返すこと.
+	 */
+	void m_testSameSizeAndInvalid () {
+		const int srcW = 9, srcH = 5;
+		std::vector<unsigned char> srcBuff((size_t)srcW * srcH * 4), dstBuff;
+		for (size_t i = 0; i < srcBuff.size(); ++i) srcBuff[i] = (unsigned char)(i * 13);
+		for (int f = 0; f < 4; ++f) {
+			const bool ret = ImageUtil::resizeRGBA8(srcBuff, srcW, srcH, dstBuff, srcW, srcH, g_filtersList[f]);
+			m_check(ret && dstBuff == srcBuff, "same size", g_filterNamesList[f], srcW, srcH);
+		}
+		m_check(!ImageUtil::resizeRGBA8(srcBuff, srcW, srcH, dstBuff, 0, srcH), "invalid size", "-", 0, srcH);
+		m_check(!ImageUtil::resizeRGBA8(srcBuff, srcW + 1, srcH, dstBuff, 4, 4), "buffer size", "-", srcW + 1, srcH);
+	}
+
+	/**
+	 * スレッド数によらず、同じ結果になること.
+	 */
+	void m_testThreads () {
+		const int srcW = 300, srcH = 280, dstW = 191, dstH = 517;
+		std::vector<unsigned char> srcBuff((size_t)srcW * srcH * 4), dstBuff1, dstBuff2;
+		for (size_t i = 0; i < srcBuff.size(); ++i) srcBuff[i] = (unsigned char)((i * 2654435761u) >> 24);
+		for (int f = 0; f < 4; ++f) {
+			const bool ret1 = ImageUtil::resizeRGBA8(srcBuff, srcW, srcH, dstBuff1, dstW, dstH, g_filtersList[f], 1);
+			const bool ret2 = ImageUtil::resizeRGBA8(srcBuff, srcW, srcH, dstBuff2, dstW, dstH, g_filtersList[f], 4);
+			m_check(ret1 && ret2 && dstBuff1 == dstBuff2, "threads", g_filterNamesList[f], dstW, dstH);
+		}
+	}
+}
+
+int main ()
+{
+	m_testKernelWeights();
+	m_testConstant();
+	m_testInterpolation();
+	m_testLinearRamp();
+	m_testBoxDownsample();
+	m_testPremultipliedAlpha();
+	m_testClampGray8();
+	m_testSameSizeAndInvalid();
+	m_testThreads();
+
+	if (g_failedCount > 0) {
+		std::printf("%d test(s) failed.\n", g_failedCount);
+		return 1;
+	}
+	std::printf("All tests passed.\n");
+	return 0;
+}